@@ -42,6 +42,32 @@ extern "C" {
 /* Forward declaration */
 struct atom_tcb;
 
+/* Execution budget, see atomThreadSetBudget() */
+typedef struct atom_budget
+{
+    struct atom_tcb *tcb_ptr;     /* Thread charged against this budget */
+    uint32_t budget;              /* Execution ticks allowed per period */
+    uint32_t period;              /* Replenishment period in ticks */
+    uint32_t remaining;           /* Execution ticks left in this period */
+    uint8_t exhausted_priority;   /* Priority when exhausted, or ATOM_BUDGET_SUSPEND */
+    uint8_t priority;             /* Thread's priority before it was demoted */
+    uint8_t exhausted;            /* TRUE if the budget is used up for this period */
+    uint8_t suspended;            /* TRUE if the budget took the thread off the ready queue */
+    ATOM_TIMER timer;             /* Replenishment timer */
+} ATOM_BUDGET;
+
+/* Partition window in the major frame, see atomPartitionScheduleSet() */
+#ifdef ATOM_NUM_PARTITIONS
+#if ATOM_NUM_PARTITIONS < 2
+#error ATOM_NUM_PARTITIONS must include the system partition and at least one other
+#endif
+typedef struct atom_partition_window
+{
+    uint8_t partition;            /* Partition allowed to run in this window */
+    uint32_t ticks;               /* Length of the window in system ticks */
+} ATOM_PARTITION_WINDOW;
+#endif
+
 typedef struct atom_tcb
 {
     /*
@@ -58,6 +84,9 @@ typedef struct atom_tcb
     /* Thread priority (0-255) */
     uint8_t priority;
 
+    /* Preemption threshold: only threads of higher priority can preempt */
+    uint8_t threshold;
+
     /* Thread entry point and parameter */
     void (*entry_point)(uint32_t);
     uint32_t entry_param;
@@ -65,12 +94,29 @@ typedef struct atom_tcb
     /* Queue pointers */
     struct atom_tcb *prev_tcb;    /* Previous TCB in doubly-linked TCB list */
     struct atom_tcb *next_tcb;    /* Next TCB in doubly-linked list */
+    struct atom_tcb **tcb_queue;  /* TCB queue this TCB is on (NULL if none) */
 
     /* Suspension data */
     uint8_t suspended;            /* TRUE if task is currently suspended */
     uint8_t suspend_wake_status;  /* Status returned to woken suspend calls */
     ATOM_TIMER *suspend_timo_cb;  /* Callback registered for suspension timeouts */
+    POINTER suspend_data;         /* Object-specific data for the suspension */
     uint8_t terminated;           /* TRUE if task is being terminated (run to completion) */
+    struct atom_tcb *join_q;      /* Queue of threads waiting for this one to terminate */
+
+    /* Execution budget charged while the thread runs (NULL if none) */
+    ATOM_BUDGET *budget;
+
+    /* Partition the thread belongs to (0 is the system partition) */
+#ifdef ATOM_NUM_PARTITIONS
+    uint8_t partition;
+#endif
+
+    /* Absolute deadline (in system ticks) used if EDF scheduling is enabled */
+#ifdef ATOM_EDF
+    uint32_t deadline;
+    uint32_t relative_deadline;   /* Added to the release time on each wake (0 = none) */
+#endif
 
     /* Details used if thread stack-checking is required */
 #ifdef ATOM_STACK_CHECKING
@@ -108,6 +154,27 @@ extern uint8_t atomOSStarted;
 /* Idle thread priority (lowest) */
 #define IDLE_THREAD_PRIORITY    255
 
+/* Budget exhaustion action: suspend the thread instead of demoting it */
+#define ATOM_BUDGET_SUSPEND     0
+
+/* Number of deferred interrupt handlers (soft IRQs), up to 32 */
+#ifndef ATOM_NUM_SOFTIRQS
+#define ATOM_NUM_SOFTIRQS       8
+#endif
+
+/**
+ * Earliest-deadline-first band. If ATOM_EDF is defined, threads with
+ * priorities from ATOM_EDF_PRIO_HIGH to ATOM_EDF_PRIO_LOW (inclusive) are
+ * scheduled by absolute deadline rather than by priority. Threads outside
+ * the band keep the normal fixed-priority behaviour.
+ */
+#ifdef ATOM_EDF
+#if !defined(ATOM_EDF_PRIO_HIGH) || !defined(ATOM_EDF_PRIO_LOW)
+#error ATOM_EDF requires ATOM_EDF_PRIO_HIGH and ATOM_EDF_PRIO_LOW
+#endif
+#define ATOM_EDF_BAND(tcb)      (((tcb)->priority >= ATOM_EDF_PRIO_HIGH) && ((tcb)->priority <= ATOM_EDF_PRIO_LOW))
+#endif
+
 
 /* Function prototypes */
 extern uint8_t atomOSInit (void *idle_thread_stack_bottom, uint32_t idle_thread_stack_size, uint8_t idle_thread_stack_check);
@@ -118,14 +185,33 @@ extern void atomSched (uint8_t timer_tick);
 extern void atomIntEnter (void);
 extern void atomIntExit (uint8_t timer_tick);
 
+extern uint8_t atomSoftIrqRegister (uint8_t irq, void (*handler)(void));
+extern uint8_t atomSoftIrqRaise (uint8_t irq);
+
 extern uint8_t tcbEnqueuePriority (ATOM_TCB **tcb_queue_ptr, ATOM_TCB *tcb_ptr);
 extern ATOM_TCB *tcbDequeueHead (ATOM_TCB **tcb_queue_ptr);
 extern ATOM_TCB *tcbDequeueEntry (ATOM_TCB **tcb_queue_ptr, ATOM_TCB *tcb_ptr);
 extern ATOM_TCB *tcbDequeuePriority (ATOM_TCB **tcb_queue_ptr, uint8_t priority);
+extern uint8_t tcbWakeAll (ATOM_TCB **tcb_queue_ptr, uint8_t wake_status);
 
 extern ATOM_TCB *atomCurrentContext (void);
 
 extern uint8_t atomThreadCreate (ATOM_TCB *tcb_ptr, uint8_t priority, void (*entry_point)(uint32_t), uint32_t entry_param, void *stack_bottom, uint32_t stack_size, uint8_t stack_check);
+extern void atomThreadExit (void);
+extern uint8_t atomThreadTerminate (ATOM_TCB *tcb_ptr);
+extern uint8_t atomThreadJoin (ATOM_TCB *tcb_ptr, int32_t timeout);
+extern uint8_t atomThreadSetPriority (ATOM_TCB *tcb_ptr, uint8_t priority);
+extern uint8_t atomThreadSetThreshold (ATOM_TCB *tcb_ptr, uint8_t threshold);
+extern uint8_t atomThreadSetBudget (ATOM_TCB *tcb_ptr, ATOM_BUDGET *budget_ptr, uint32_t budget, uint32_t period, uint8_t exhausted_priority);
+extern uint8_t atomThreadClearBudget (ATOM_TCB *tcb_ptr);
+#ifdef ATOM_NUM_PARTITIONS
+extern uint8_t atomThreadSetPartition (ATOM_TCB *tcb_ptr, uint8_t partition);
+extern uint8_t atomPartitionScheduleSet (const ATOM_PARTITION_WINDOW *table, uint8_t num_windows);
+#endif
+#ifdef ATOM_EDF
+extern uint8_t atomThreadSetDeadline (ATOM_TCB *tcb_ptr, uint32_t deadline);
+extern uint8_t atomThreadSetRelativeDeadline (ATOM_TCB *tcb_ptr, uint32_t relative_deadline);
+#endif
 extern uint8_t atomThreadStackCheck (ATOM_TCB *tcb_ptr, uint32_t *used_bytes, uint32_t *free_bytes);
 
 extern void archContextSwitch (ATOM_TCB *old_tcb_ptr, ATOM_TCB *new_tcb_ptr);
@@ -133,6 +219,11 @@ extern void archThreadContextInit (ATOM_TCB *tcb_ptr, void *stack_top, void (*en
 extern void archFirstThreadRestore(ATOM_TCB *new_tcb_ptr);
 
 extern void atomTimerTick (void);
+extern void atomTimerAdvance (uint32_t ticks);
+extern void atomBudgetTick (uint32_t ticks);
+#ifdef ATOM_NUM_PARTITIONS
+extern void atomPartitionTick (uint32_t ticks);
+#endif
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,435 @@
+/*
+ * Copyright (c) 2022, Matt Liss
+ * Copyright (c) 2010, Kelvin Lawson. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. No personal names or organizations' names associated with the
+ *    Atomthreads project may be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE ATOMTHREADS PROJECT AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/**
+ * \file
+ * Cyclic executive library.
+ *
+ *
+ * This module implements a time-triggered cyclic executive, built when
+ * the ATOM_CYCLIC macro is defined. It has the following features:
+ *
+ * \par Static schedule
+ * Jobs are released at fixed tick offsets within a repeating hyperperiod,
+ * according to a constant table prepared at design time. The timing of
+ * every job is therefore known in advance, as is often required for
+ * certification of safety-critical systems.
+ *
+ * \par Constant-time release
+ * The table is sorted by offset, so the system tick only compares the
+ * position in the hyperperiod with the next table entry. No timers are
+ * registered and no lists are walked.
+ *
+ * \par Run-to-completion jobs
+ * Jobs are plain functions run one after another by a single executive
+ * thread, in table order. A job is never preempted by another job, so jobs
+ * can share data without locking. Jobs released at the same offset, or
+ * while an earlier job is still running, run as soon as the preceding job
+ * completes.
+ *
+ * \par Normal API kept
+ * The executive is an ordinary thread, so the rest of the kernel API works
+ * as usual. Other threads run whenever the executive thread is idle (or
+ * always, if they are higher priority), and jobs may use the kernel API
+ * to communicate with them.
+ *
+ *
+ * \n <b> Usage instructions: </b> \n
+ *
+ * Define ATOM_CYCLIC in the architecture port (or on the command line) and
+ * build a table of ATOM_CYCLIC_ENTRY, sorted by offset. Then call
+ * atomCyclicStart() with the table, the hyperperiod in ticks and the
+ * executive thread's priority and stack. Offset 0 is released on the first
+ * system tick after atomCyclicStart() returns.
+ *
+ * If the jobs fall so far behind that a job is released again before its
+ * previous release has started, the new release is dropped and counted as
+ * an overrun, which can be read with atomCyclicOverruns(). Each table
+ * entry has at most one release pending, so the other jobs keep their
+ * place in the schedule.
+ *
+ */
+
+
+#include "atom.h"
+#include "atomsem.h"
+#include "atomcyclic.h"
+
+
+#ifdef ATOM_CYCLIC
+
+/* Local data */
+
+/* Schedule table, or NULL if the executive is not running */
+static const ATOM_CYCLIC_ENTRY *cyclic_table = NULL;
+static uint8_t cyclic_num_entries;
+static uint32_t cyclic_hyperperiod;
+
+/* Position within the hyperperiod and next table entry to release */
+static uint32_t cyclic_frame_tick;
+static uint8_t cyclic_next_release;
+
+/**
+ * Table entries released but not yet started, one bit per entry, and the
+ * entry after the one last started. Entries are released in table order,
+ * so the oldest pending release is the first flagged entry from there.
+ */
+static uint8_t cyclic_pending[32];
+static uint8_t cyclic_next_run;
+
+/* Number of releases dropped because the jobs fell behind */
+static uint32_t cyclic_overruns;
+
+/* Executive thread and the semaphore counting its released jobs */
+static ATOM_TCB cyclic_tcb;
+static ATOM_SEM cyclic_sem;
+
+
+/* Forward declarations */
+
+static void atomCyclicRelease (uint8_t entry, uint32_t count);
+static void atomCyclicThread (uint32_t param);
+
+
+/**
+ * \b atomCyclicStart
+ *
+ * Starts the cyclic executive.
+ *
+ * \c table lists the job releases within the hyperperiod, in increasing
+ * order of offset (several entries may share an offset). Each offset must
+ * be less than \c hyperperiod. The table is not copied so must remain
+ * valid until atomCyclicStop() is called.
+ *
+ * The executive thread is created at \c priority using the given stack,
+ * and runs each job to completion when it is released.
+ *
+ * This function cannot be called from interrupt context.
+ *
+ * @param[in] table Pointer to the schedule table
+ * @param[in] num_entries Number of entries in the table
+ * @param[in] hyperperiod Length of the repeating schedule in ticks
+ * @param[in] priority Priority of the executive thread
+ * @param[in] stack_bottom Bottom of the executive thread's stack area
+ * @param[in] stack_size Size of the stack area in bytes
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERROR The executive is already running
+ * @retval ATOM_ERR_PARAM Bad parameters
+ * @retval ATOM_ERR_CONTEXT Called from interrupt context
+ */
+uint8_t atomCyclicStart (const ATOM_CYCLIC_ENTRY *table, uint8_t num_entries, uint32_t hyperperiod, uint8_t priority, void *stack_bottom, uint32_t stack_size)
+{
+    CRITICAL_STORE;
+    uint8_t status;
+    int i;
+
+    /* Parameter check */
+    status = ATOM_OK;
+    if ((table == NULL) || (num_entries == 0) || (hyperperiod == 0))
+    {
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Check each entry is in range and the table is sorted */
+        for (i = 0; i < num_entries; i++)
+        {
+            if ((table[i].job == NULL) || (table[i].offset >= hyperperiod)
+                || ((i > 0) && (table[i].offset < table[i - 1].offset)))
+            {
+                status = ATOM_ERR_PARAM;
+            }
+        }
+    }
+
+    if (status != ATOM_OK)
+    {
+        /* Bad parameters */
+    }
+
+    /* Check we are in thread context */
+    else if (atomCurrentContext() == NULL)
+    {
+        /* Not supported from interrupt context */
+        status = ATOM_ERR_CONTEXT;
+    }
+
+    /* Only one executive can run */
+    else if (cyclic_table != NULL)
+    {
+        status = ATOM_ERROR;
+    }
+
+    /* Create the semaphore counting released jobs */
+    else if (atomSemCreate (&cyclic_sem, 0) != ATOM_OK)
+    {
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Set up the schedule, ready to release offset 0 on the next tick */
+        cyclic_num_entries = num_entries;
+        cyclic_hyperperiod = hyperperiod;
+        cyclic_frame_tick = 0;
+        cyclic_next_release = 0;
+        cyclic_next_run = 0;
+        cyclic_overruns = 0;
+        for (i = 0; i < (int)sizeof(cyclic_pending); i++)
+        {
+            cyclic_pending[i] = 0;
+        }
+
+        /* Start the executive thread, it waits for the first release */
+        status = atomThreadCreate (&cyclic_tcb, priority, atomCyclicThread, 0,
+                    stack_bottom, stack_size, TRUE);
+
+        /* Start releasing jobs */
+        if (status == ATOM_OK)
+        {
+            CRITICAL_START ();
+            cyclic_table = table;
+            CRITICAL_END ();
+        }
+        else
+        {
+            (void)atomSemDelete (&cyclic_sem);
+        }
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomCyclicStop
+ *
+ * Stops the cyclic executive.
+ *
+ * No further jobs are released, and the executive thread is terminated.
+ * If a job was running it is stopped part way through. The table and the
+ * executive thread's stack may be reused once this function returns.
+ *
+ * This function cannot be called from interrupt context, or from a job.
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERROR The executive is not running
+ * @retval ATOM_ERR_CONTEXT Called from interrupt context
+ */
+uint8_t atomCyclicStop (void)
+{
+    CRITICAL_STORE;
+    uint8_t status;
+
+    /* Check we are in thread context */
+    if (atomCurrentContext() == NULL)
+    {
+        /* Not supported from interrupt context */
+        status = ATOM_ERR_CONTEXT;
+    }
+    else if (cyclic_table == NULL)
+    {
+        /* Not running */
+        status = ATOM_ERROR;
+    }
+    else
+    {
+        /* Stop releasing jobs */
+        CRITICAL_START ();
+        cyclic_table = NULL;
+        CRITICAL_END ();
+
+        /* Terminate the executive thread, then remove the semaphore */
+        (void)atomThreadTerminate (&cyclic_tcb);
+        status = atomSemDelete (&cyclic_sem);
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomCyclicOverruns
+ *
+ * Returns the number of job releases dropped since atomCyclicStart()
+ * because the previous release of the same job had not yet started.
+ *
+ * @return Number of overruns
+ */
+uint32_t atomCyclicOverruns (void)
+{
+    return (cyclic_overruns);
+}
+
+
+/**
+ * \b atomCyclicRelease
+ *
+ * This is an internal function not for use by application code.
+ *
+ * Releases a table entry \c count times. The first release is made
+ * pending unless the entry's previous release has not started yet, and
+ * any further releases are dropped and counted as overruns.
+ *
+ * @param[in] entry Index of the table entry
+ * @param[in] count Number of releases (at least one)
+ *
+ * @return None
+ */
+static void atomCyclicRelease (uint8_t entry, uint32_t count)
+{
+    /**
+     * If this entry's previous release has not started yet, drop the new
+     * release. The entry keeps its place in the pending jobs, so the jobs
+     * behind it are not shifted.
+     */
+    if (cyclic_pending[entry >> 3] & (1 << (entry & 7)))
+    {
+        cyclic_overruns += count;
+    }
+    else
+    {
+        cyclic_pending[entry >> 3] |= (uint8_t)(1 << (entry & 7));
+        (void)atomSemPut (&cyclic_sem);
+        cyclic_overruns += count - 1;
+    }
+}
+
+
+/**
+ * \b atomCyclicTick
+ *
+ * This is an internal function not for use by application code.
+ *
+ * Called by atomTimerAdvance() with the number of system ticks elapsed.
+ * Releases the jobs in the table at each position in the hyperperiod
+ * passed, then moves on to the position after them. Whole hyperperiods
+ * are accounted for arithmetically, releasing every entry once and
+ * counting its other releases as overruns, so the cost depends on the
+ * number of entries released rather than the number of ticks. If the
+ * executive thread is woken it is scheduled in by the timer interrupt's
+ * atomIntExit().
+ *
+ * @param[in] ticks Number of system ticks elapsed
+ *
+ * @return None
+ */
+void atomCyclicTick (uint32_t ticks)
+{
+    uint32_t cycles, end;
+    uint8_t entry;
+
+    /* Nothing to do unless the executive is running */
+    if (cyclic_table)
+    {
+        /* Each whole hyperperiod passed releases every entry once */
+        cycles = ticks / cyclic_hyperperiod;
+        if (cycles > 0)
+        {
+            for (entry = 0; entry < cyclic_num_entries; entry++)
+            {
+                atomCyclicRelease (entry, cycles);
+            }
+        }
+
+        /* Release each entry in the rest of the span, the table is sorted */
+        end = cyclic_frame_tick + (ticks % cyclic_hyperperiod);
+        if (end >= cyclic_hyperperiod)
+        {
+            /* Finish this hyperperiod and wrap to the start of the next */
+            while (cyclic_next_release < cyclic_num_entries)
+            {
+                atomCyclicRelease (cyclic_next_release++, 1);
+            }
+            cyclic_next_release = 0;
+            end -= cyclic_hyperperiod;
+        }
+        while ((cyclic_next_release < cyclic_num_entries)
+            && (cyclic_table[cyclic_next_release].offset < end))
+        {
+            atomCyclicRelease (cyclic_next_release++, 1);
+        }
+
+        /* Move on */
+        cyclic_frame_tick = end;
+    }
+}
+
+
+/**
+ * \b atomCyclicThread
+ *
+ * Entry point for the executive thread.
+ *
+ * Waits for each job release and runs the released jobs in the order
+ * they were released.
+ *
+ * @param[in] param Unused (optional thread entry parameter)
+ *
+ * @return None
+ */
+static void atomCyclicThread (uint32_t param)
+{
+    CRITICAL_STORE;
+    const ATOM_CYCLIC_ENTRY *entry;
+    uint8_t run;
+
+    /* Compiler warnings */
+    param = param;
+
+    /* Run released jobs until the semaphore is deleted */
+    while (atomSemGet (&cyclic_sem, 0) == ATOM_OK)
+    {
+        /**
+         * Find the oldest pending release, there is one for each count
+         * on the semaphore. Mark it started, so that it can be released
+         * again while it runs.
+         */
+        CRITICAL_START ();
+        run = cyclic_next_run;
+        while (!(cyclic_pending[run >> 3] & (1 << (run & 7))))
+        {
+            if (++run >= cyclic_num_entries)
+            {
+                run = 0;
+            }
+        }
+        cyclic_pending[run >> 3] &= (uint8_t)~(1 << (run & 7));
+        cyclic_next_run = (uint8_t)((run + 1 >= cyclic_num_entries) ? 0 : run + 1);
+        CRITICAL_END ();
+
+        /* Run the job to completion */
+        entry = &cyclic_table[run];
+        entry->job (entry->data);
+    }
+}
+
+#endif /* ATOM_CYCLIC */
@@ -0,0 +1,57 @@
+/*
+ * Copyright (c) 2022, Matt Liss
+ * Copyright (c) 2010, Kelvin Lawson. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. No personal names or organizations' names associated with the
+ *    Atomthreads project may be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE ATOMTHREADS PROJECT AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef __ATOM_CYCLIC_H
+#define __ATOM_CYCLIC_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifdef ATOM_CYCLIC
+
+typedef struct atom_cyclic_entry
+{
+    uint32_t    offset;             /* Release tick within the hyperperiod */
+    void        (*job)(POINTER);    /* Job function, run to completion */
+    POINTER     data;               /* Parameter passed to the job */
+} ATOM_CYCLIC_ENTRY;
+
+extern uint8_t atomCyclicStart (const ATOM_CYCLIC_ENTRY *table, uint8_t num_entries, uint32_t hyperperiod, uint8_t priority, void *stack_bottom, uint32_t stack_size);
+extern uint8_t atomCyclicStop (void);
+extern uint32_t atomCyclicOverruns (void);
+extern void atomCyclicTick (uint32_t ticks);
+
+#endif /* ATOM_CYCLIC */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __ATOM_CYCLIC_H */
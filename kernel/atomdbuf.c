@@ -0,0 +1,758 @@
+/*
+ * Copyright (c) 2022, Matt Liss
+ * Copyright (c) 2010, Kelvin Lawson. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. No personal names or organizations' names associated with the
+ *    Atomthreads project may be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE ATOMTHREADS PROJECT AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/**
+ * \file
+ * Double/triple buffer library.
+ *
+ *
+ * This module implements ping-pong (double) and triple buffer objects for
+ * passing blocks of data, typically filled by DMA, from an interrupt
+ * handler to a processing thread, with the following features:
+ *
+ * \par Zero-copy buffer swaps
+ * The producer never copies data: it hands over the buffer it has just
+ * filled and is given the next buffer to fill, in a constant number of
+ * cycles suitable for a DMA completion interrupt.
+ *
+ * \par Overrun detection
+ * If the consumer falls behind and the producer has nowhere to put a new
+ * block, the oldest unprocessed block is discarded and an overrun is
+ * counted. The producer always has a buffer to fill, so the DMA never
+ * stalls.
+ *
+ * \par Flexible blocking APIs
+ * The consumer thread can choose whether to block, block with timeout, or
+ * not block while waiting for a full buffer.
+ *
+ * \par Interrupt-safe calls
+ * All APIs can be called from interrupt context. Any calls which could
+ * potentially block have optional parameters to prevent blocking if you
+ * wish to call them from interrupt context. Any attempt to make a call
+ * which would block from interrupt context will be automatically and
+ * safely prevented.
+ *
+ * \par Smart deletion
+ * Where a buffer object is deleted while a thread is blocking on it, the
+ * blocking thread is woken and returned a status code to indicate the
+ * reason for being woken.
+ *
+ *
+ * \n <b> Usage instructions: </b> \n
+ *
+ * All buffer objects must be initialised before use by calling
+ * atomDbufCreate() with an array of two or three buffer pointers. Each
+ * buffer is at any time in one of four states: being filled by the
+ * producer, full and ready for the consumer, held by the consumer, or free.
+ * The producer starts out filling the first buffer in the array.
+ *
+ * When the producer has filled its buffer (e.g. in the DMA completion
+ * interrupt) it calls atomDbufSwap(), which marks the buffer ready and
+ * returns the next buffer to fill. The next buffer is a free buffer if
+ * there is one. Otherwise the consumer has fallen behind: if a full buffer
+ * is still waiting for the consumer, that older block is discarded and its
+ * buffer refilled, and if not (with two buffers, while the consumer still
+ * holds the other one) the block just completed is discarded and its
+ * buffer refilled. Either way atomDbufSwap() returns ATOM_ERR_OVF and the
+ * overrun is counted, which can be read using atomDbufOverruns().
+ *
+ * The consumer thread calls atomDbufGet() to wait for the next full
+ * buffer, which it then holds until it calls atomDbufGet() again or
+ * releases it early with atomDbufRelease(). With two buffers the consumer
+ * must have released its buffer by the time the producer fills the other
+ * one. With three buffers the producer can complete a further block while
+ * the consumer is processing, which absorbs jitter in the consumer's
+ * response time.
+ *
+ * \code
+ * void dma_complete_isr (void)
+ * {
+ *     void *next;
+ *
+ *     atomIntEnter ();
+ *     (void)atomDbufSwap (&adc_dbuf, &next);
+ *     dma_start (next, ADC_BLOCK_SIZE);
+ *     atomIntExit (FALSE);
+ * }
+ *
+ * void adc_thread (uint32_t param)
+ * {
+ *     void *block;
+ *
+ *     while (atomDbufGet (&adc_dbuf, 0, &block) == ATOM_OK)
+ *         process_block (block);
+ * }
+ * \endcode
+ *
+ * Buffer objects are designed for a single producer and a single consumer
+ * thread.
+ *
+ * A buffer object which is no longer required can be deleted using
+ * atomDbufDelete(). This function automatically wakes up any thread which
+ * is waiting on the deleted object.
+ *
+ */
+
+
+#include "atom.h"
+#include "atomdbuf.h"
+#include "atomtimer.h"
+
+
+/* Local data types */
+
+typedef struct dbuf_timer
+{
+    ATOM_TCB  *tcb_ptr;     /* Thread which is suspended with timeout */
+    ATOM_DBUF *dbuf_ptr;    /* Buffer object the thread is suspended on */
+} DBUF_TIMER;
+
+
+/* Forward declarations */
+
+static uint8_t dbuf_free (ATOM_DBUF *dbuf);
+static void atomDbufTimerCallback (POINTER cb_data);
+
+
+/**
+ * \b atomDbufCreate
+ *
+ * Initialises a double/triple buffer object.
+ *
+ * Must be called before calling any other buffer library routines on an
+ * object. Objects can be deleted later using atomDbufDelete().
+ *
+ * Does not allocate storage, the caller provides the object and an array
+ * of \c num_buffs pointers to the data buffers. The array must remain
+ * valid while the object is in use. The producer starts out filling
+ * \c buffs[0], and the other buffers start out free.
+ *
+ * This function can be called from interrupt context.
+ *
+ * @param[in] dbuf Pointer to buffer object
+ * @param[in] buffs Array of buffer pointers
+ * @param[in] num_buffs Number of buffers (2 or 3)
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_PARAM Bad parameters
+ */
+uint8_t atomDbufCreate (ATOM_DBUF *dbuf, void **buffs, uint8_t num_buffs)
+{
+    uint8_t status;
+
+    /* Parameter check */
+    if ((dbuf == NULL) || (buffs == NULL) || (num_buffs < 2) || (num_buffs > 3))
+    {
+        /* Bad parameters */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Store the buffer details */
+        dbuf->buffs = buffs;
+        dbuf->num_buffs = num_buffs;
+
+        /* The producer starts on the first buffer, the rest are free */
+        dbuf->fill = 0;
+        dbuf->ready = ATOM_DBUF_NONE;
+        dbuf->consumer = ATOM_DBUF_NONE;
+        dbuf->overruns = 0;
+
+        /* Initialise the suspended threads queue */
+        dbuf->suspQ = NULL;
+
+        /* Successful */
+        status = ATOM_OK;
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomDbufDelete
+ *
+ * Deletes a double/triple buffer object.
+ *
+ * Any threads currently suspended on the object will be woken up with
+ * return status ATOM_ERR_DELETED. If called at thread context then the
+ * scheduler will be called during this function which may schedule in one
+ * of the woken threads depending on relative priorities.
+ *
+ * This function can be called from interrupt context.
+ *
+ * @param[in] dbuf Pointer to buffer object
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_PARAM Bad parameter
+ */
+uint8_t atomDbufDelete (ATOM_DBUF *dbuf)
+{
+    uint8_t status;
+    CRITICAL_STORE;
+    uint8_t woken_threads;
+
+    /* Parameter check */
+    if (dbuf == NULL)
+    {
+        /* Bad pointer */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Protect access to the buffer object and OS queues */
+        CRITICAL_START ();
+
+        /* Wake up all suspended tasks in one go */
+        woken_threads = tcbWakeAll (&dbuf->suspQ, ATOM_ERR_DELETED);
+
+        /* Exit critical region */
+        CRITICAL_END ();
+
+        /* Successful */
+        status = ATOM_OK;
+
+        /**
+         * Only call the scheduler if we are in thread context, otherwise
+         * it will be called on exiting the ISR by atomIntExit().
+         */
+        if (woken_threads && atomCurrentContext())
+            atomSched (FALSE);
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomDbufSwap
+ *
+ * Hand over a full buffer and take the next buffer to fill.
+ *
+ * Called by the producer when it has filled its current buffer. The full
+ * buffer is made ready for the consumer and a pointer to the next buffer
+ * to fill is written to \c fill_ptr. If the consumer thread is blocking in
+ * atomDbufGet() it is handed the full buffer directly and woken.
+ *
+ * If the consumer has fallen behind so that no buffer is free, a block is
+ * discarded to give the producer a buffer to fill (see the module notes),
+ * the overrun count is incremented and ATOM_ERR_OVF is returned. A valid
+ * buffer to fill is returned in \c fill_ptr in this case too.
+ *
+ * The swap takes a constant number of cycles, apart from placing a woken
+ * thread on the ready queue. This function can be called from interrupt
+ * context, and is intended to be called from the producer's interrupt
+ * handler.
+ *
+ * @param[in] dbuf Pointer to buffer object
+ * @param[out] fill_ptr Pointer to which the next buffer to fill is written
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_OVF A block was discarded because the consumer is behind
+ * @retval ATOM_ERR_PARAM Bad parameters
+ */
+uint8_t atomDbufSwap (ATOM_DBUF *dbuf, void **fill_ptr)
+{
+    CRITICAL_STORE;
+    uint8_t status;
+    uint8_t full, next;
+    ATOM_TCB *tcb_ptr;
+    uint8_t woken_threads = FALSE;
+
+    /* Check parameters */
+    if ((dbuf == NULL) || (fill_ptr == NULL))
+    {
+        /* Bad pointer */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Protect access to the buffer object and OS queues */
+        CRITICAL_START ();
+
+        /* Default to success unless the consumer has fallen behind */
+        status = ATOM_OK;
+        full = dbuf->fill;
+
+        /* Take a free buffer to fill next if there is one */
+        if ((next = dbuf_free (dbuf)) != ATOM_DBUF_NONE)
+        {
+            /* The filled buffer is now ready for the consumer */
+            dbuf->fill = next;
+            dbuf->ready = full;
+        }
+
+        /**
+         * Otherwise if an older block has not yet been taken by the
+         * consumer, discard it and reuse its buffer. The block just
+         * filled replaces it as the ready buffer.
+         */
+        else if (dbuf->ready != ATOM_DBUF_NONE)
+        {
+            dbuf->fill = dbuf->ready;
+            dbuf->ready = full;
+            dbuf->overruns++;
+            status = ATOM_ERR_OVF;
+        }
+
+        /**
+         * Otherwise the consumer still holds the only other buffer, so
+         * the block just filled must be discarded and its buffer refilled.
+         */
+        else
+        {
+            dbuf->overruns++;
+            status = ATOM_ERR_OVF;
+        }
+
+        /* Hand any ready buffer straight to a waiting consumer */
+        if ((dbuf->ready != ATOM_DBUF_NONE)
+            && ((tcb_ptr = tcbDequeueHead (&dbuf->suspQ)) != NULL))
+        {
+            /* The consumer now holds the ready buffer */
+            dbuf->consumer = dbuf->ready;
+            dbuf->ready = ATOM_DBUF_NONE;
+            *(void **)tcb_ptr->suspend_data = dbuf->buffs[dbuf->consumer];
+
+            /* Set OK status to be returned to the waiting thread */
+            tcb_ptr->suspend_wake_status = ATOM_OK;
+
+            /**
+             * If there's a timeout on this suspension, remove it. This also
+             * stops the callback of a timeout which has already expired on
+             * this tick but not yet been called back, which would otherwise
+             * wake the consumer a second time.
+             */
+            if (tcb_ptr->suspend_timo_cb)
+            {
+                atomTimerDequeue (tcb_ptr->suspend_timo_cb);
+                tcb_ptr->suspend_timo_cb = NULL;
+            }
+
+            /* Move the waiting thread to the ready queue */
+            (void)tcbEnqueuePriority (&tcbReadyQ, tcb_ptr);
+
+            /* Request a reschedule */
+            woken_threads = TRUE;
+        }
+
+        /* Return the buffer to fill next */
+        *fill_ptr = dbuf->buffs[dbuf->fill];
+
+        /* Exit critical region */
+        CRITICAL_END ();
+
+        /**
+         * The scheduler may now make a policy decision to thread switch if
+         * we are currently in thread context. If we are in interrupt
+         * context it will be handled by atomIntExit().
+         */
+        if (woken_threads && atomCurrentContext())
+            atomSched (FALSE);
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomDbufGet
+ *
+ * Wait for the next full buffer.
+ *
+ * Called by the consumer thread. Any buffer the consumer still holds from
+ * a previous call is released first. On success a pointer to the next
+ * full buffer is written to \c buff_ptr, and the consumer holds that
+ * buffer until it next calls atomDbufGet() or atomDbufRelease().
+ *
+ * If no full buffer is ready, the call will do one of the following
+ * depending on the \c timeout value specified:
+ *
+ * \c timeout == 0 : Call will block until a buffer is ready \n
+ * \c timeout > 0 : Call will block until a buffer or the specified timeout \n
+ * \c timeout == -1 : Return immediately if no buffer is ready \n
+ *
+ * If a maximum timeout value is specified (\c timeout > 0), and no buffer
+ * is ready within the specified number of system ticks, the call will
+ * return with \c ATOM_TIMEOUT.
+ *
+ * This function can only be called from interrupt context if the \c timeout
+ * parameter is -1 (in which case it does not block).
+ *
+ * @param[in] dbuf Pointer to buffer object
+ * @param[in] timeout Max system ticks to block (0 = forever, -1 = no block)
+ * @param[out] buff_ptr Pointer to which the full buffer address is written
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_TIMEOUT Wait timed out before being woken
+ * @retval ATOM_WOULDBLOCK Called with timeout == -1 but no buffer was ready
+ * @retval ATOM_ERR_DELETED Object was deleted while suspended
+ * @retval ATOM_ERR_CONTEXT Not called in thread context and attempted to block
+ * @retval ATOM_ERR_PARAM Bad parameter
+ * @retval ATOM_ERR_QUEUE Problem putting the thread on the suspend queue
+ * @retval ATOM_ERR_TIMER Problem registering the timeout
+ */
+uint8_t atomDbufGet (ATOM_DBUF *dbuf, int32_t timeout, void **buff_ptr)
+{
+    CRITICAL_STORE;
+    uint8_t status;
+    DBUF_TIMER timer_data;
+    ATOM_TIMER timer_cb;
+    ATOM_TCB *curr_tcb_ptr;
+
+    /* Check parameters */
+    if ((dbuf == NULL) || (buff_ptr == NULL))
+    {
+        /* Bad pointer */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Protect access to the buffer object and OS queues */
+        CRITICAL_START ();
+
+        /* The consumer has finished with any buffer it was holding */
+        dbuf->consumer = ATOM_DBUF_NONE;
+
+        /* If no full buffer is ready, block the calling thread */
+        if (dbuf->ready == ATOM_DBUF_NONE)
+        {
+            /* If called with timeout >= 0, we should block */
+            if (timeout >= 0)
+            {
+                /* Nothing ready, block the calling thread */
+
+                /* Get the current TCB */
+                curr_tcb_ptr = atomCurrentContext();
+
+                /* Check we are actually in thread context */
+                if (curr_tcb_ptr)
+                {
+                    /* Add current thread to the list waiting for a buffer */
+                    if (tcbEnqueuePriority (&dbuf->suspQ, curr_tcb_ptr) == ATOM_OK)
+                    {
+                        /* Set suspended status for the current thread */
+                        curr_tcb_ptr->suspended = TRUE;
+
+                        /**
+                         * Store the destination so that the producer can
+                         * hand the next full buffer straight to us.
+                         */
+                        curr_tcb_ptr->suspend_data = (POINTER)buff_ptr;
+
+                        /* Track errors */
+                        status = ATOM_OK;
+
+                        /* Register a timer callback if requested */
+                        if (timeout)
+                        {
+                            /**
+                             * Fill out the data needed by the callback to
+                             * wake us up.
+                             */
+                            timer_data.tcb_ptr = curr_tcb_ptr;
+                            timer_data.dbuf_ptr = dbuf;
+
+                            /* Fill out the timer callback request structure */
+                            timer_cb.cb_func = atomDbufTimerCallback;
+                            timer_cb.cb_data = (POINTER)&timer_data;
+                            timer_cb.cb_ticks = timeout;
+
+                            /**
+                             * Store the timer details in the TCB so that we
+                             * can cancel the timer callback if a buffer is
+                             * swapped in before the timeout occurs.
+                             */
+                            curr_tcb_ptr->suspend_timo_cb = &timer_cb;
+
+                            /* Register a callback on timeout */
+                            if (atomTimerRegister (&timer_cb) != ATOM_OK)
+                            {
+                                /* Timer registration failed */
+                                status = ATOM_ERR_TIMER;
+
+                                /* Clean up and return to the caller */
+                                (void)tcbDequeueEntry (&dbuf->suspQ, curr_tcb_ptr);
+                                curr_tcb_ptr->suspended = FALSE;
+                                curr_tcb_ptr->suspend_timo_cb = NULL;
+                                curr_tcb_ptr->suspend_data = NULL;
+                            }
+                        }
+
+                        /* Set no timeout requested */
+                        else
+                        {
+                            /* No need to cancel timeouts on this one */
+                            curr_tcb_ptr->suspend_timo_cb = NULL;
+                        }
+
+                        /* Exit critical region */
+                        CRITICAL_END ();
+
+                        /* Check no errors occurred */
+                        if (status == ATOM_OK)
+                        {
+                            /**
+                             * Current thread now blocking, schedule in a new
+                             * one. We already know we are in thread context
+                             * so can call the scheduler from here.
+                             */
+                            atomSched (FALSE);
+
+                            /**
+                             * Normal atomDbufSwap() wakeups will set ATOM_OK
+                             * status, having already written the buffer
+                             * address to buff_ptr, while timeouts will set
+                             * ATOM_TIMEOUT and deletions will set
+                             * ATOM_ERR_DELETED.
+                             */
+                            status = curr_tcb_ptr->suspend_wake_status;
+                            curr_tcb_ptr->suspend_data = NULL;
+                        }
+                    }
+                    else
+                    {
+                        /* There was an error putting this thread on the suspend list */
+                        CRITICAL_END ();
+                        status = ATOM_ERR_QUEUE;
+                    }
+                }
+                else
+                {
+                    /* Not currently in thread context, can't suspend */
+                    CRITICAL_END ();
+                    status = ATOM_ERR_CONTEXT;
+                }
+            }
+            else
+            {
+                /* timeout == -1, requested not to block and nothing ready */
+                CRITICAL_END ();
+                status = ATOM_WOULDBLOCK;
+            }
+        }
+        else
+        {
+            /* No need to block, take the ready buffer */
+            dbuf->consumer = dbuf->ready;
+            dbuf->ready = ATOM_DBUF_NONE;
+            *buff_ptr = dbuf->buffs[dbuf->consumer];
+
+            /* Exit critical region */
+            CRITICAL_END ();
+
+            /* Successful */
+            status = ATOM_OK;
+        }
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomDbufRelease
+ *
+ * Release the buffer held by the consumer.
+ *
+ * Called by the consumer thread when it has finished with the buffer
+ * returned by atomDbufGet(), making it free for the producer. Calling this
+ * is optional, as atomDbufGet() releases the held buffer anyway, but
+ * releasing a buffer as soon as possible reduces the chance of overruns.
+ *
+ * This function can be called from interrupt context.
+ *
+ * @param[in] dbuf Pointer to buffer object
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_PARAM Bad parameter
+ */
+uint8_t atomDbufRelease (ATOM_DBUF *dbuf)
+{
+    CRITICAL_STORE;
+    uint8_t status;
+
+    /* Check parameters */
+    if (dbuf == NULL)
+    {
+        /* Bad pointer */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Protect access to the buffer object */
+        CRITICAL_START ();
+
+        /* The consumer's buffer is now free */
+        dbuf->consumer = ATOM_DBUF_NONE;
+
+        /* Exit critical region */
+        CRITICAL_END ();
+
+        /* Successful */
+        status = ATOM_OK;
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomDbufOverruns
+ *
+ * Read the number of overruns on a buffer object.
+ *
+ * Writes the number of blocks discarded by atomDbufSwap() because the
+ * consumer had fallen behind to \c overruns, and optionally resets the
+ * count.
+ *
+ * This function can be called from interrupt context.
+ *
+ * @param[in] dbuf Pointer to buffer object
+ * @param[out] overruns Pointer to which the overrun count is written
+ * @param[in] reset TRUE to reset the count after reading
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_PARAM Bad parameter
+ */
+uint8_t atomDbufOverruns (ATOM_DBUF *dbuf, uint32_t *overruns, uint8_t reset)
+{
+    CRITICAL_STORE;
+    uint8_t status;
+
+    /* Check parameters */
+    if ((dbuf == NULL) || (overruns == NULL))
+    {
+        /* Bad pointer */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Protect access to the buffer object */
+        CRITICAL_START ();
+
+        /* Read the count, and reset it if requested */
+        *overruns = dbuf->overruns;
+        if (reset)
+            dbuf->overruns = 0;
+
+        /* Exit critical region */
+        CRITICAL_END ();
+
+        /* Successful */
+        status = ATOM_OK;
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b dbuf_free
+ *
+ * This is an internal function not for use by application code.
+ *
+ * Finds a free buffer, i.e. one which is not being filled by the producer,
+ * waiting for the consumer or held by the consumer. With at most three
+ * buffers this takes a constant number of cycles.
+ *
+ * Assumes interrupts are already locked out.
+ *
+ * @param[in] dbuf Pointer to buffer object
+ *
+ * @return Index of a free buffer, or ATOM_DBUF_NONE if all are in use
+ */
+static uint8_t dbuf_free (ATOM_DBUF *dbuf)
+{
+    uint8_t index;
+
+    for (index = 0; index < dbuf->num_buffs; index++)
+    {
+        if ((index != dbuf->fill) && (index != dbuf->ready)
+            && (index != dbuf->consumer))
+            break;
+    }
+
+    return ((index < dbuf->num_buffs) ? index : ATOM_DBUF_NONE);
+}
+
+
+/**
+ * \b atomDbufTimerCallback
+ *
+ * This is an internal function not for use by application code.
+ *
+ * Timeouts on suspended threads are notified by the timer system through
+ * this generic callback. The timer system calls us back with a pointer to
+ * the relevant \c DBUF_TIMER object which is used to retrieve the
+ * buffer object details.
+ *
+ * @param[in] cb_data Pointer to a DBUF_TIMER object
+ */
+static void atomDbufTimerCallback (POINTER cb_data)
+{
+    DBUF_TIMER *timer_data_ptr;
+    CRITICAL_STORE;
+
+    /* Get the DBUF_TIMER structure pointer */
+    timer_data_ptr = (DBUF_TIMER *)cb_data;
+
+    /* Check parameter is valid */
+    if (timer_data_ptr)
+    {
+        /* Enter critical region */
+        CRITICAL_START ();
+
+        /* Only act if the thread was not woken before we got here */
+        if (timer_data_ptr->tcb_ptr->suspend_timo_cb)
+        {
+            /* Set status to indicate to the waiting thread that it timed out */
+            timer_data_ptr->tcb_ptr->suspend_wake_status = ATOM_TIMEOUT;
+
+            /* Flag as no timeout registered */
+            timer_data_ptr->tcb_ptr->suspend_timo_cb = NULL;
+
+            /* Remove this thread from the object's suspend list */
+            (void)tcbDequeueEntry (&timer_data_ptr->dbuf_ptr->suspQ, timer_data_ptr->tcb_ptr);
+
+            /* Put the thread on the ready queue */
+            (void)tcbEnqueuePriority (&tcbReadyQ, timer_data_ptr->tcb_ptr);
+        }
+
+        /* Exit critical region */
+        CRITICAL_END ();
+
+        /**
+         * Note that we don't call the scheduler now as it will be called
+         * when we exit the ISR by atomIntExit().
+         */
+    }
+}
@@ -0,0 +1,63 @@
+/*
+ * Copyright (c) 2022, Matt Liss
+ * Copyright (c) 2010, Kelvin Lawson. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. No personal names or organizations' names associated with the
+ *    Atomthreads project may be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE ATOMTHREADS PROJECT AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __ATOM_DBUF_H
+#define __ATOM_DBUF_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct atom_dbuf
+{
+    ATOM_TCB *  suspQ;          /* Queue of threads waiting for a full buffer */
+    void **     buffs;          /* Array of buffer pointers */
+    uint8_t     num_buffs;      /* Number of buffers (2 or 3) */
+    uint8_t     fill;           /* Buffer being filled by the producer */
+    uint8_t     ready;          /* Full buffer waiting for the consumer */
+    uint8_t     consumer;       /* Buffer held by the consumer */
+    uint32_t    overruns;       /* Full buffers discarded by the producer */
+} ATOM_DBUF;
+
+/* Index used when no buffer is in a given state */
+#define ATOM_DBUF_NONE          0xFF
+
+extern uint8_t atomDbufCreate (ATOM_DBUF *dbuf, void **buffs, uint8_t num_buffs);
+extern uint8_t atomDbufDelete (ATOM_DBUF *dbuf);
+extern uint8_t atomDbufSwap (ATOM_DBUF *dbuf, void **fill_ptr);
+extern uint8_t atomDbufGet (ATOM_DBUF *dbuf, int32_t timeout, void **buff_ptr);
+extern uint8_t atomDbufRelease (ATOM_DBUF *dbuf);
+extern uint8_t atomDbufOverruns (ATOM_DBUF *dbuf, uint32_t *overruns, uint8_t reset);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __ATOM_DBUF_H */
@@ -136,15 +136,11 @@ uint8_t atomEventCreate (ATOM_EVENT *event)
  * scheduler will be called during this function which may schedule in one
  * of the woken threads depending on relative priorities.
  *
- * This function can be called from interrupt context, but loops internally
- * waking up all threads blocking on the event, so the potential
- * execution cycles cannot be determined in advance.
+ * This function can be called from interrupt context.
  *
  * @param[in] event Pointer to event object
  *
  * @retval ATOM_OK Success
- * @retval ATOM_ERR_QUEUE Problem putting a woken thread on the ready queue
- * @retval ATOM_ERR_TIMER Problem cancelling a timeout on a woken thread
  */
 uint8_t atomEventDelete (ATOM_EVENT *event)
 {
@@ -161,67 +157,35 @@ uint8_t atomEventDelete (ATOM_EVENT *event)
     }
     else
     {
-        /* Default to success status unless errors occur during wakeup */
-        status = ATOM_OK;
-
-        /* Wake up all suspended tasks */
-        do {
-            /* Enter critical region */
-            CRITICAL_START ();
+        /* Protect access to the event object and OS queues */
+        CRITICAL_START ();
 
-            /* Check if any threads are suspended */
-            tcb_ptr = event->tcb_ptr;
+        /* Check if a thread is suspended on the event */
+        tcb_ptr = tcbDequeueHead (&event->tcb_ptr);
+        if (tcb_ptr)
+        {
+            /* Return error status to the waiting thread */
+            tcb_ptr->suspend_wake_status = ATOM_ERR_DELETED;
 
-            /* A thread is suspended on the event */
-            if (tcb_ptr)
+            /* If there's a timeout on this suspension, remove it */
+            if (tcb_ptr->suspend_timo_cb)
             {
-                /* Return error status to the waiting thread */
-                tcb_ptr->suspend_wake_status = ATOM_ERR_DELETED;
-
-                /* Put the thread on the ready queue */
-                if (tcbEnqueuePriority (&tcbReadyQ, tcb_ptr) != ATOM_OK)
-                {
-                    /* Exit critical region */
-                    CRITICAL_END ();
-
-                    /* Quit the loop, returning error */
-                    status = ATOM_ERR_QUEUE;
-                    break;
-                }
-
-                /* If there's a timeout on this suspension, cancel it */
-                if (tcb_ptr->suspend_timo_cb)
-                {
-                    /* Cancel the callback */
-                    if (atomTimerCancel (tcb_ptr->suspend_timo_cb) != ATOM_OK)
-                    {
-                        /* Exit critical region */
-                        CRITICAL_END ();
-
-                        /* Quit the loop, returning error */
-                        status = ATOM_ERR_TIMER;
-                        break;
-                    }
+                atomTimerDequeue (tcb_ptr->suspend_timo_cb);
+                tcb_ptr->suspend_timo_cb = NULL;
+            }
 
-                    /* Flag as no timeout registered */
-                    tcb_ptr->suspend_timo_cb = NULL;
-                }
+            /* Put the thread on the ready queue */
+            (void)tcbEnqueuePriority (&tcbReadyQ, tcb_ptr);
 
-                /* Exit critical region */
-                CRITICAL_END ();
+            /* Request a reschedule */
+            woken_threads = TRUE;
+        }
 
-                /* Request a reschedule */
-                woken_threads = TRUE;
-            }
+        /* Exit critical region */
+        CRITICAL_END ();
 
-            /* No more suspended threads */
-            else
-            {
-                /* Exit critical region and quit the loop */
-                CRITICAL_END ();
-                break;
-            }
-        } while (0);
+        /* Successful */
+        status = ATOM_OK;
 
         /* Call scheduler if any threads were woken up */
         if (woken_threads == TRUE)
@@ -331,8 +295,13 @@ uint8_t atomEventWait (ATOM_EVENT *event, uint32_t mask, uint32_t *value, int32_
                     }
                     else
                     {
-                        /* Save event data for atomEventSet() */
-                        event->tcb_ptr = curr_tcb_ptr;
+                        /**
+                         * Save event data for atomEventSet(). The waiting
+                         * thread is held as a single-entry TCB queue so that
+                         * the kernel can find and remove it if the thread is
+                         * terminated.
+                         */
+                        (void)tcbEnqueuePriority (&event->tcb_ptr, curr_tcb_ptr);
                         event->mask = mask;
 
                         /* Set suspended status for the current thread */
@@ -363,7 +332,7 @@ uint8_t atomEventWait (ATOM_EVENT *event, uint32_t mask, uint32_t *value, int32_
                                 status = ATOM_ERR_TIMER;
 
                                 /* Clean up and return to the caller */
-                                event->tcb_ptr = NULL;
+                                (void)tcbDequeueEntry (&event->tcb_ptr, curr_tcb_ptr);
                                 event->mask = 0;
                                 curr_tcb_ptr->suspended = FALSE;
                                 curr_tcb_ptr->suspend_timo_cb = NULL;
@@ -402,12 +371,18 @@ uint8_t atomEventWait (ATOM_EVENT *event, uint32_t mask, uint32_t *value, int32_
                              */
                             if (status == ATOM_OK && value != NULL)
                             {
-                                *value = event->flags & event->mask;
+                                *value = event->flags & mask;
                             }
 
-                            /* Clean up event data */
-                            event->tcb_ptr = NULL;
-                            event->mask = 0;
+                            /**
+                             * Clean up event data. We were detached from the
+                             * event when woken, so only clear the mask if no
+                             * other thread has started waiting since.
+                             */
+                            if (event->tcb_ptr == NULL)
+                            {
+                                event->mask = 0;
+                            }
                         }
 
                         /* Exit critical region */
@@ -492,7 +467,8 @@ uint8_t atomEventSet (ATOM_EVENT *event, uint32_t mask)
         /* If a thread is blocking on the event just set, wake it up */
         if (event->tcb_ptr != NULL && (event->flags & event->mask) != 0)
         {
-            tcb_ptr = event->tcb_ptr;
+            /* Detach the thread from the event */
+            tcb_ptr = tcbDequeueHead (&event->tcb_ptr);
             if (tcbEnqueuePriority (&tcbReadyQ, tcb_ptr) != ATOM_OK)
             {
                 /* Exit critical region */
@@ -512,6 +488,13 @@ uint8_t atomEventSet (ATOM_EVENT *event, uint32_t mask)
                 {
                     /* There was a problem cancelling a timeout on this event */
                     status = ATOM_ERR_TIMER;
+
+                    /**
+                     * The timeout is already being called back. The thread has
+                     * been woken here, so clear the flag to stop the callback
+                     * from acting on it.
+                     */
+                    tcb_ptr->suspend_timo_cb = NULL;
                 }
                 else
                 {
@@ -610,6 +593,7 @@ uint8_t atomEventClear (ATOM_EVENT *event, uint32_t mask)
 static void atomEventTimerCallback (POINTER cb_data)
 {
     ATOM_EVENT *timer_data_ptr;
+    ATOM_TCB *tcb_ptr;
     CRITICAL_STORE;
 
     /* Get the ATOM_EVENT structure pointer */
@@ -621,14 +605,21 @@ static void atomEventTimerCallback (POINTER cb_data)
         /* Enter critical region */
         CRITICAL_START ();
 
-        /* Set status to indicate to the waiting thread that it timed out */
-        timer_data_ptr->tcb_ptr->suspend_wake_status = ATOM_TIMEOUT;
+        /* Only act if the thread was not woken before we got here */
+        if (timer_data_ptr->tcb_ptr && timer_data_ptr->tcb_ptr->suspend_timo_cb)
+        {
+            /* Detach the waiting thread from the event */
+            tcb_ptr = tcbDequeueHead (&timer_data_ptr->tcb_ptr);
+
+            /* Set status to indicate to the waiting thread that it timed out */
+            tcb_ptr->suspend_wake_status = ATOM_TIMEOUT;
 
-        /* Flag as no timeout registered */
-        timer_data_ptr->tcb_ptr->suspend_timo_cb = NULL;
+            /* Flag as no timeout registered */
+            tcb_ptr->suspend_timo_cb = NULL;
 
-        /* Put the thread on the ready queue */
-        (void)tcbEnqueuePriority (&tcbReadyQ, timer_data_ptr->tcb_ptr);
+            /* Put the thread on the ready queue */
+            (void)tcbEnqueuePriority (&tcbReadyQ, tcb_ptr);
+        }
 
         /* Exit critical region */
         CRITICAL_END ();
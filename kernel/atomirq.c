@@ -0,0 +1,284 @@
+/*
+ * Copyright (c) 2022, Matt Liss
+ * Copyright (c) 2010, Kelvin Lawson. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. No personal names or organizations' names associated with the
+ *    Atomthreads project may be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE ATOMTHREADS PROJECT AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/**
+ * \file
+ * Threaded interrupt handler library.
+ *
+ *
+ * This module implements threaded interrupt handlers, with the following
+ * features:
+ *
+ * \par Bounded interrupt latency
+ * The low-level interrupt handler only masks the interrupt source and wakes
+ * a dedicated handler thread, so the time spent with interrupts disabled
+ * does not depend on how much work the interrupt requires.
+ *
+ * \par Prioritised, preemptible handlers
+ * The real handler runs in a thread at a priority chosen by the
+ * application. It can be preempted by higher priority threads and other
+ * interrupts, and lower priority handler threads can be preempted by it.
+ *
+ * \par Blocking calls
+ * Because the handler runs in thread context, it may make blocking kernel
+ * calls, for example waiting on a mutex protecting a shared bus.
+ *
+ *
+ * \n <b> Usage instructions: </b> \n
+ *
+ * Interrupt controllers are architecture specific, so the architecture port
+ * provides routines to mask and unmask an interrupt source, and registers
+ * the low-level interrupt handler. Ports wrap atomIrqThreadCreate() in a
+ * helper which passes the mask and unmask routines, for example
+ * arm_irq_register_threaded() on armv7a.
+ *
+ * atomIrqThreadCreate() starts the handler thread, which waits for the
+ * interrupt. The low-level interrupt handler (between its atomIntEnter()
+ * and atomIntExit() calls) calls atomIrqThreadWake(), which masks the
+ * source and wakes the thread. The thread calls the handler and unmasks the
+ * source again when the handler returns, so the source can not interrupt
+ * again until the handler has run. If the handler thread is the highest
+ * priority ready thread, it is switched to as the interrupt exits.
+ *
+ * The handler is responsible for clearing the cause of the interrupt in
+ * the peripheral before returning, as for a normal interrupt handler.
+ *
+ */
+
+
+#include "atom.h"
+#include "atomsem.h"
+#include "atomirq.h"
+
+
+/* Forward declarations */
+
+static void atomIrqThread (uint32_t param);
+
+
+/**
+ * \b atomIrqThreadCreate
+ *
+ * Initialises a threaded interrupt handler and starts its handler thread.
+ *
+ * The handler thread is started at \c priority and waits for the low-level
+ * interrupt handler to call atomIrqThreadWake(). It then calls \c handler
+ * with \c data and, once the handler returns, calls \c unmask with \c irq.
+ * The \c mask routine is called with \c irq by atomIrqThreadWake().
+ *
+ * This function is normally called through an architecture port helper,
+ * which supplies the mask and unmask routines. The interrupt source should
+ * not be enabled until this function has returned.
+ *
+ * This function cannot be called from interrupt context.
+ *
+ * @param[in] irq_thread Pointer to threaded interrupt handler object
+ * @param[in] irq Interrupt source number passed to \c mask and \c unmask
+ * @param[in] handler Threaded interrupt handler
+ * @param[in] data Parameter passed to \c handler
+ * @param[in] mask Routine to mask the interrupt source
+ * @param[in] unmask Routine to unmask the interrupt source
+ * @param[in] priority Priority of the handler thread
+ * @param[in] stack_bottom Bottom of the handler thread's stack area
+ * @param[in] stack_size Size of the stack area in bytes
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_PARAM Bad parameters
+ * @retval ATOM_ERR_QUEUE Error starting the handler thread
+ */
+uint8_t atomIrqThreadCreate (ATOM_IRQ_THREAD *irq_thread, uint32_t irq, void (*handler)(POINTER), POINTER data, void (*mask)(uint32_t), void (*unmask)(uint32_t), uint8_t priority, void *stack_bottom, uint32_t stack_size)
+{
+    uint8_t status;
+
+    /* Parameter check */
+    if ((irq_thread == NULL) || (handler == NULL) || (mask == NULL)
+        || (unmask == NULL))
+    {
+        /* Bad parameters */
+        status = ATOM_ERR_PARAM;
+    }
+
+    /* Create the semaphore the handler thread waits on */
+    else if (atomSemCreate (&irq_thread->sem, 0) != ATOM_OK)
+    {
+        /* Error creating the semaphore */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Store the handler details */
+        irq_thread->handler = handler;
+        irq_thread->data = data;
+        irq_thread->mask = mask;
+        irq_thread->unmask = unmask;
+        irq_thread->irq = irq;
+        irq_thread->count = 0;
+
+        /**
+         * Start the handler thread. It finds its handler details from the
+         * ATOM_IRQ_THREAD structure, which starts with its TCB.
+         */
+        status = atomThreadCreate (&irq_thread->tcb, priority, atomIrqThread, 0,
+                    stack_bottom, stack_size, TRUE);
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomIrqThreadDelete
+ *
+ * Deletes a threaded interrupt handler.
+ *
+ * The interrupt source is masked and the handler thread is terminated. If
+ * the handler was running it is stopped part way through, so the interrupt
+ * should normally be disabled in the peripheral first. The handler thread's
+ * TCB and stack may be reused once this function returns.
+ *
+ * This function cannot be called from interrupt context, or from the
+ * handler itself.
+ *
+ * @param[in] irq_thread Pointer to threaded interrupt handler object
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_PARAM Bad parameters
+ * @retval ATOM_ERR_CONTEXT Called from interrupt context
+ */
+uint8_t atomIrqThreadDelete (ATOM_IRQ_THREAD *irq_thread)
+{
+    uint8_t status;
+
+    /* Parameter check */
+    if (irq_thread == NULL)
+    {
+        /* Bad parameters */
+        status = ATOM_ERR_PARAM;
+    }
+
+    /* Check we are in thread context */
+    else if (atomCurrentContext() == NULL)
+    {
+        /* Not supported from interrupt context */
+        status = ATOM_ERR_CONTEXT;
+    }
+    else
+    {
+        /* Stop the source interrupting again */
+        irq_thread->mask (irq_thread->irq);
+
+        /* Terminate the handler thread, then remove the semaphore */
+        (void)atomThreadTerminate (&irq_thread->tcb);
+        status = atomSemDelete (&irq_thread->sem);
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomIrqThreadWake
+ *
+ * Wakes a threaded interrupt handler.
+ *
+ * Called by the low-level interrupt handler, between its atomIntEnter() and
+ * atomIntExit() calls. Masks the interrupt source and wakes the handler
+ * thread. The thread is scheduled in by atomIntExit() if it is the highest
+ * priority ready thread.
+ *
+ * @param[in] irq_thread Pointer to threaded interrupt handler object
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_PARAM Bad parameters
+ * @retval ATOM_ERR_OVF Too many wakes pending (source not masked)
+ */
+uint8_t atomIrqThreadWake (ATOM_IRQ_THREAD *irq_thread)
+{
+    uint8_t status;
+
+    /* Parameter check */
+    if (irq_thread == NULL)
+    {
+        /* Bad parameters */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Mask the source until the handler has run */
+        irq_thread->mask (irq_thread->irq);
+
+        /**
+         * Wake the handler thread. The source is masked until the handler
+         * completes, so no further wakes should arrive before it runs.
+         */
+        status = atomSemPut (&irq_thread->sem);
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomIrqThread
+ *
+ * This is an internal function not for use by application code.
+ *
+ * Entry point for threaded interrupt handler threads. Waits to be woken by
+ * atomIrqThreadWake(), then runs the handler and unmasks the source.
+ *
+ * @param[in] param Unused (the handler is found via the thread's TCB)
+ *
+ * @return None
+ */
+static void atomIrqThread (uint32_t param)
+{
+    ATOM_IRQ_THREAD *irq_thread;
+
+    /* Our TCB is the first member of our ATOM_IRQ_THREAD structure */
+    irq_thread = (ATOM_IRQ_THREAD *)atomCurrentContext();
+
+    /* Avoid compiler warning due to unused parameter */
+    param = param;
+
+    /* Handle interrupts until the semaphore is deleted */
+    while (atomSemGet (&irq_thread->sem, 0) == ATOM_OK)
+    {
+        /* Run the handler with the source masked */
+        irq_thread->handler (irq_thread->data);
+        irq_thread->count++;
+
+        /* Allow the source to interrupt again */
+        irq_thread->unmask (irq_thread->irq);
+    }
+
+    /* The handler was deleted, terminate this thread */
+    atomThreadExit ();
+}
@@ -0,0 +1,59 @@
+/*
+ * Copyright (c) 2022, Matt Liss
+ * Copyright (c) 2010, Kelvin Lawson. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. No personal names or organizations' names associated with the
+ *    Atomthreads project may be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE ATOMTHREADS PROJECT AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef __ATOM_IRQ_H
+#define __ATOM_IRQ_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "atomsem.h"
+
+typedef struct atom_irq_thread
+{
+    ATOM_TCB    tcb;                /* Handler thread TCB (must be first) */
+    ATOM_SEM    sem;                /* Signalled by the low-level handler */
+    void        (*handler)(POINTER);/* Threaded interrupt handler */
+    POINTER     data;               /* Parameter passed to the handler */
+    void        (*mask)(uint32_t);  /* Port routine to mask the source */
+    void        (*unmask)(uint32_t);/* Port routine to unmask the source */
+    uint32_t    irq;                /* Interrupt source number */
+    uint32_t    count;              /* Number of interrupts handled */
+} ATOM_IRQ_THREAD;
+
+extern uint8_t atomIrqThreadCreate (ATOM_IRQ_THREAD *irq_thread, uint32_t irq, void (*handler)(POINTER), POINTER data, void (*mask)(uint32_t), void (*unmask)(uint32_t), uint8_t priority, void *stack_bottom, uint32_t stack_size);
+extern uint8_t atomIrqThreadDelete (ATOM_IRQ_THREAD *irq_thread);
+extern uint8_t atomIrqThreadWake (ATOM_IRQ_THREAD *irq_thread);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __ATOM_IRQ_H */
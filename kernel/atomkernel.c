@@ -125,18 +125,35 @@
  * \b Application-callable general functions: \n
  *
  * \li atomThreadCreate(): Thread creation API.
+ * \li atomThreadExit() / atomThreadTerminate(): Thread termination APIs.
+ * \li atomThreadJoin(): Waits for a thread to terminate.
+ * \li atomThreadSetPriority(): Changes a thread's priority.
+ * \li atomThreadSetThreshold(): Changes a thread's preemption threshold.
+ * \li atomThreadSetBudget() / atomThreadClearBudget(): Limits a thread's
+ *     execution time per period.
+ * \li atomThreadSetDeadline() / atomThreadSetRelativeDeadline(): Set a
+ *     thread's EDF deadline (if ATOM_EDF).
+ * \li atomThreadSetPartition() / atomPartitionScheduleSet(): Time
+ *     partitioning (if ATOM_NUM_PARTITIONS).
  * \li atomCurrentContext(): Used by kernel and application code to check
  *     whether the thread is currently running at thread or interrupt context.
  *     This is very useful for implementing safety checks and preventing
  *     interrupt handlers from making kernel calls that would block.
  * \li atomIntEnter() / atomIntExit(): Must be called by any interrupt handlers.
+ * \li atomSoftIrqRegister() / atomSoftIrqRaise(): Deferred interrupt handlers
+ *     run at the end of the outermost interrupt handler.
  *
  * \b Internal kernel functions: \n
  *
  * \li atomSched(): Core scheduler.
  * \li atomThreadSwitch(): Context-switch routine.
  * \li atomIdleThread(): Simple thread to be run when no other threads ready.
+ * \li atomSoftIrqRun(): Runs pending deferred interrupt handlers.
+ * \li atomBudgetTick(): Charges the running thread's execution budget.
+ * \li atomPartitionTick(): Switches partition windows.
+ * \li tcbReadyQueue(): Selects the ready queue to schedule from.
  * \li tcbEnqueuePriority(): Enqueues TCBs (task control blocks) on lists.
+ * \li tcbInsertPriority(): Requeues TCBs without treating them as released.
  * \li tcbDequeueHead(): Dequeues the head of a TCB list.
  * \li tcbDequeueEntry(): Dequeues a particular entry from a TCB list.
  * \li tcbDequeuePriority(): Dequeues an entry from a TCB list using priority.
@@ -147,6 +164,22 @@
 #include "atom.h"
 
 
+/* Local macros */
+
+/**
+ * TCB ordering on TCB queues: TRUE if \c a should be queued ahead of \c b.
+ * Normally this is by priority only. With ATOM_EDF, threads that are both
+ * in the EDF priority band are instead ordered by absolute deadline, using
+ * a wraparound-safe comparison of the tick counts.
+ */
+#ifdef ATOM_EDF
+#define EDF_EARLIER(a, b)   ((int32_t)((a)->deadline - (b)->deadline) < 0)
+#define TCB_BEFORE(a, b)    ((ATOM_EDF_BAND(a) && ATOM_EDF_BAND(b)) ? EDF_EARLIER(a, b) : ((a)->priority < (b)->priority))
+#else
+#define TCB_BEFORE(a, b)    ((a)->priority < (b)->priority)
+#endif
+
+
 /* Global data */
 
 /**
@@ -174,8 +207,38 @@ ATOM_TCB *tcbReadyQ = NULL;
 uint8_t atomOSStarted = FALSE;
 
 
+/* Local data types */
+
+typedef struct join_timer
+{
+    ATOM_TCB   *tcb_ptr;       /* Thread which is suspended with timeout */
+    ATOM_TCB   *join_tcb_ptr;  /* Thread being joined */
+} JOIN_TIMER;
+
+
 /* Local data */
 
+#ifdef ATOM_NUM_PARTITIONS
+/**
+ * Ready queues for partitions 1 and up, indexed by partition - 1. Ready
+ * threads in the system partition (0) stay on tcbReadyQ, and
+ * tcbEnqueuePriority() redirects other threads to their own partition's
+ * queue. The scheduler only looks at tcbReadyQ and the active partition's
+ * queue, so switching partitions does not need to touch any queues.
+ */
+static ATOM_TCB *partReadyQ[ATOM_NUM_PARTITIONS - 1];
+
+/* Partition currently allowed to run alongside the system partition */
+static uint8_t part_active = 0;
+
+/* Major frame table and its length, current window and ticks left in that window */
+static const ATOM_PARTITION_WINDOW *part_table = NULL;
+static uint8_t part_num_windows;
+static uint32_t part_frame_ticks;
+static uint8_t part_window;
+static uint32_t part_window_ticks;
+#endif
+
 /** This is a pointer to the TCB for the currently-running thread */
 static ATOM_TCB *curr_tcb = NULL;
 
@@ -185,16 +248,37 @@ static ATOM_TCB idle_tcb;
 /* Number of nested interrupts */
 static int atomIntCnt = 0;
 
+/* Set if a nested interrupt was a timer tick, for the outermost atomIntExit() */
+static uint8_t atomIntTimerTick = FALSE;
+
+/** Bitmap of pending deferred interrupt handlers (bit 0 runs first) */
+static volatile uint32_t softirq_pending = 0;
+
+/** Registered deferred interrupt handlers */
+static void (*softirq_handler[ATOM_NUM_SOFTIRQS])(void);
+
 
 /* Constants */
 
 /** Bytecode to fill thread stacks with for stack-checking purposes */
 #define STACK_CHECK_BYTE    0x5A
 
+/** Interrupt enable around deferred handlers is optional for ports */
+#ifndef ATOM_SOFTIRQ_INT_ENABLE
+#define ATOM_SOFTIRQ_INT_ENABLE()
+#define ATOM_SOFTIRQ_INT_DISABLE()
+#endif
+
 
 /* Forward declarations */
 static void atomThreadSwitch(ATOM_TCB *old_tcb, ATOM_TCB *new_tcb);
 static void atomIdleThread (uint32_t data);
+static void atomSoftIrqRun (void);
+static void atomThreadJoinTimerCallback (POINTER cb_data);
+static void atomBudgetCallback (POINTER cb_data);
+static void atomBudgetRestore (ATOM_BUDGET *budget_ptr);
+static ATOM_TCB **tcbReadyQueue (void);
+static uint8_t tcbInsertPriority (ATOM_TCB **tcb_queue_ptr, ATOM_TCB *tcb_ptr);
 
 
 /**
@@ -225,6 +309,9 @@ void atomSched (uint8_t timer_tick)
     CRITICAL_STORE;
     ATOM_TCB *new_tcb = NULL;
     int16_t lowest_pri;
+#ifdef ATOM_EDF
+    ATOM_TCB **ready_q;
+#endif
 
     /**
      * Check the OS has actually started. As long as the proper initialisation
@@ -253,7 +340,7 @@ void atomSched (uint8_t timer_tick)
          * actually be the suspending thread if it was unsuspended
          * before the scheduler was called.
          */
-        new_tcb = tcbDequeueHead (&tcbReadyQ);
+        new_tcb = tcbDequeueHead (tcbReadyQueue ());
 
         /**
          * Don't need to add the current thread to any queue because
@@ -266,14 +353,61 @@ void atomSched (uint8_t timer_tick)
         atomThreadSwitch (curr_tcb, new_tcb);
     }
 
+#ifdef ATOM_NUM_PARTITIONS
+    /**
+     * If the current thread's partition window has ended, it must be
+     * switched out regardless of priority. It goes back on its own
+     * partition's ready queue until the next window for that partition.
+     */
+    else if ((curr_tcb->partition != 0) && (curr_tcb->partition != part_active))
+    {
+        (void)tcbEnqueuePriority (&tcbReadyQ, curr_tcb);
+        new_tcb = tcbDequeueHead (tcbReadyQueue ());
+        atomThreadSwitch (curr_tcb, new_tcb);
+    }
+#endif
+
     /**
      * Otherwise the current thread is still ready, but check
      * if any other threads are ready.
      */
     else
     {
+#ifdef ATOM_EDF
+        /**
+         * Threads in the EDF band are preempted by any thread above the
+         * band, or by a ready thread in the band with an earlier deadline.
+         * The ready queue is in deadline order within the band, so only
+         * the head needs checking. On timer ticks an equal deadline is
+         * also allowed to preempt, giving round-robin between threads with
+         * the same deadline. A preemption threshold disables preemption by
+         * deadline, leaving only threads above the threshold.
+         */
+        ready_q = tcbReadyQueue ();
+        if (ATOM_EDF_BAND(curr_tcb))
+        {
+            lowest_pri = (int16_t)((curr_tcb->threshold < ATOM_EDF_PRIO_HIGH) ? curr_tcb->threshold : ATOM_EDF_PRIO_HIGH) - 1;
+            if ((curr_tcb->threshold >= curr_tcb->priority)
+                && *ready_q && ATOM_EDF_BAND(*ready_q)
+                && (EDF_EARLIER(*ready_q, curr_tcb)
+                    || ((timer_tick == TRUE) && ((*ready_q)->deadline == curr_tcb->deadline))))
+            {
+                new_tcb = tcbDequeueHead (ready_q);
+            }
+        }
+        else
+#endif
         /* Calculate which priority is allowed to be scheduled in */
-        if (timer_tick == TRUE)
+        if (curr_tcb->threshold < curr_tcb->priority)
+        {
+            /**
+             * The thread has raised its preemption threshold. Only threads
+             * of higher priority than the threshold can preempt, and there
+             * is no round-robin with threads of the same priority.
+             */
+            lowest_pri = (int16_t)curr_tcb->threshold - 1;
+        }
+        else if (timer_tick == TRUE)
         {
             /* Same priority or higher threads can preempt */
             lowest_pri = (int16_t)curr_tcb->priority;
@@ -293,20 +427,20 @@ void atomSched (uint8_t timer_tick)
         }
 
         /* Check if a reschedule is allowed */
-        if (lowest_pri >= 0)
+        if ((new_tcb == NULL) && (lowest_pri >= 0))
         {
             /* Check for a thread at the given minimum priority level or higher */
-            new_tcb = tcbDequeuePriority (&tcbReadyQ, (uint8_t)lowest_pri);
+            new_tcb = tcbDequeuePriority (tcbReadyQueue (), (uint8_t)lowest_pri);
+        }
 
-            /* If a thread was found, schedule it in */
-            if (new_tcb)
-            {
-                /* Add the current thread to the ready queue */
-                (void)tcbEnqueuePriority (&tcbReadyQ, curr_tcb);
+        /* If a thread was found, schedule it in */
+        if (new_tcb)
+        {
+            /* Add the current thread to the ready queue */
+            (void)tcbEnqueuePriority (&tcbReadyQ, curr_tcb);
 
-                /* Switch to the new thread */
-                atomThreadSwitch (curr_tcb, new_tcb);
-            }
+            /* Switch to the new thread */
+            atomThreadSwitch (curr_tcb, new_tcb);
         }
     }
 
@@ -362,7 +496,9 @@ static void atomThreadSwitch(ATOM_TCB *old_tcb, ATOM_TCB *new_tcb)
  * Creates and starts a new thread.
  *
  * Callers provide the ATOM_TCB structure storage, these are not obtained
- * from an internal TCB free list.
+ * from an internal TCB free list. The TCB and stack of a thread which has
+ * terminated (see atomThreadTerminate()) may be passed here again to start
+ * a new thread.
  *
  * The function puts the new thread on the ready queue and calls the
  * scheduler. If the priority is higher than the current priority, then the
@@ -406,9 +542,22 @@ uint8_t atomThreadCreate (ATOM_TCB *tcb_ptr, uint8_t priority, void (*entry_poin
         tcb_ptr->suspended = FALSE;
         tcb_ptr->terminated = FALSE;
         tcb_ptr->priority = priority;
+        tcb_ptr->threshold = IDLE_THREAD_PRIORITY;
         tcb_ptr->prev_tcb = NULL;
         tcb_ptr->next_tcb = NULL;
+        tcb_ptr->tcb_queue = NULL;
         tcb_ptr->suspend_timo_cb = NULL;
+        tcb_ptr->suspend_data = NULL;
+        tcb_ptr->join_q = NULL;
+        tcb_ptr->budget = NULL;
+#ifdef ATOM_NUM_PARTITIONS
+        tcb_ptr->partition = 0;
+#endif
+#ifdef ATOM_EDF
+        /* Until a deadline is set, treat the thread as due now */
+        tcb_ptr->deadline = atomTimeGet();
+        tcb_ptr->relative_deadline = 0;
+#endif
 
         /**
          * Store the thread entry point and parameter in the TCB. This may
@@ -447,58 +596,1242 @@ uint8_t atomThreadCreate (ATOM_TCB *tcb_ptr, uint8_t priority, void (*entry_poin
 		    count = (int32_t)stack_size;
             while (count > 0)
             {
-                /* Initialise all stack bytes from top down to 0x5A */
-                *((uint8_t *)stack_bottom + (count - 1)) = STACK_CHECK_BYTE;
-                count--;
+                /* Initialise all stack bytes from top down to 0x5A */
+                *((uint8_t *)stack_bottom + (count - 1)) = STACK_CHECK_BYTE;
+                count--;
+            }
+        }
+#else
+        /* Avoid compiler warning due to unused parameter */
+        stack_check = stack_check;
+#endif
+
+        /**
+         * Call the arch-specific routine to set up the stack. This routine
+         * is responsible for creating the context save area necessary for
+         * allowing atomThreadSwitch() to schedule it in. The initial
+         * archContextSwitch() call when this thread gets scheduled in the
+         * first time will then restore the program counter to the thread
+         * entry point, and any other necessary register values ready for
+         * it to start running.
+         */
+        archThreadContextInit (tcb_ptr, stack_top, entry_point, entry_param);
+
+        /* Protect access to the OS queue */
+        CRITICAL_START ();
+
+        /* Put this thread on the ready queue */
+        if (tcbEnqueuePriority (&tcbReadyQ, tcb_ptr) != ATOM_OK)
+        {
+            /* Exit critical region */
+            CRITICAL_END ();
+
+            /* Queue-related error */
+            status = ATOM_ERR_QUEUE;
+        }
+        else
+        {
+            /* Exit critical region */
+            CRITICAL_END ();
+
+            /**
+             * If the OS is started and we're in thread context, check if we
+             * should be scheduled in now.
+             */
+            if ((atomOSStarted == TRUE) && atomCurrentContext())
+                atomSched (FALSE);
+
+            /* Success */
+            status = ATOM_OK;
+        }
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomThreadExit
+ *
+ * Terminates the calling thread.
+ *
+ * This is equivalent to calling atomThreadTerminate() on the current thread,
+ * and is also called by the architecture ports if a thread returns from its
+ * entry point. Any threads waiting in atomThreadJoin() are woken.
+ *
+ * When called from thread context this function does not return. Calls from
+ * interrupt context have no effect, because there is no calling thread.
+ *
+ * @return None
+ */
+void atomThreadExit (void)
+{
+    /* Terminate ourselves, the scheduler will not switch back to us */
+    (void)atomThreadTerminate (atomCurrentContext());
+}
+
+
+/**
+ * \b atomThreadTerminate
+ *
+ * Terminates a thread.
+ *
+ * The thread is removed from whichever queue it is on, whether that is the
+ * ready queue or the suspend queue of an OS object it is blocking on. Any
+ * suspension timeout or timer delay registered for the thread is removed
+ * from the timer list. The thread will never be scheduled again, and any
+ * threads waiting for it in atomThreadJoin() are woken with ATOM_OK.
+ *
+ * Once the function returns (or, for a thread terminating itself, once the
+ * next thread has been scheduled in) the kernel holds no references to the
+ * thread's TCB or stack, so both may be reused, for example by passing them
+ * to atomThreadCreate() again.
+ *
+ * Resources held by the thread itself are not released: mutexes it owns
+ * remain locked, and timers it registered on its own behalf with
+ * atomTimerRegister() are not cancelled. Terminating a thread which has
+ * already terminated has no effect. The idle thread cannot be terminated.
+ *
+ * This function can be called from interrupt context. If the currently
+ * running thread is terminated from an interrupt handler, the thread is
+ * switched out when the interrupt exits.
+ *
+ * @param[in] tcb_ptr Pointer to the TCB of the thread to terminate
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_PARAM Bad parameters
+ */
+uint8_t atomThreadTerminate (ATOM_TCB *tcb_ptr)
+{
+    CRITICAL_STORE;
+    uint8_t status;
+
+    /* Parameter check */
+    if ((tcb_ptr == NULL) || (tcb_ptr == &idle_tcb))
+    {
+        /* Bad parameters */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Protect access to the TCB and OS queues */
+        CRITICAL_START ();
+
+        /* Nothing to do if the thread has already terminated */
+        if (tcb_ptr->terminated == FALSE)
+        {
+            /**
+             * Take the thread off whichever TCB queue it is on (ready queue
+             * or an object's suspend queue). The currently running thread
+             * and threads in a timer delay are not on any queue.
+             */
+            if (tcb_ptr->tcb_queue)
+            {
+                (void)tcbDequeueEntry (tcb_ptr->tcb_queue, tcb_ptr);
+            }
+
+            /**
+             * If there's a timeout or delay registered, remove it. This also
+             * stops the callback of one which has already expired on this
+             * tick but not yet been called back, which would otherwise put
+             * the terminated thread back on the ready queue.
+             */
+            if (tcb_ptr->suspend_timo_cb)
+            {
+                atomTimerDequeue (tcb_ptr->suspend_timo_cb);
+                tcb_ptr->suspend_timo_cb = NULL;
+            }
+
+            /* Stop replenishing any execution budget */
+            if (tcb_ptr->budget)
+            {
+                (void)atomTimerCancel (&tcb_ptr->budget->timer);
+                tcb_ptr->budget = NULL;
+            }
+
+            /**
+             * Flag the thread as terminated. If this is the currently
+             * running thread, the scheduler will switch to the next
+             * ready thread without putting this one back on the ready
+             * queue.
+             */
+            tcb_ptr->terminated = TRUE;
+            tcb_ptr->suspend_data = NULL;
+
+            /* Wake any threads waiting for this one to terminate */
+            (void)tcbWakeAll (&tcb_ptr->join_q, ATOM_OK);
+        }
+
+        /* Exit critical region */
+        CRITICAL_END ();
+
+        /**
+         * If we're in thread context, call the scheduler. This schedules
+         * us out if we terminated ourselves, or schedules in any higher
+         * priority threads which were waiting to join. In interrupt
+         * context this is handled by atomIntExit().
+         */
+        if ((atomOSStarted == TRUE) && atomCurrentContext())
+            atomSched (FALSE);
+
+        /* Success */
+        status = ATOM_OK;
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomThreadJoin
+ *
+ * Waits for a thread to terminate.
+ *
+ * If the thread has already terminated (by returning from its entry point,
+ * calling atomThreadExit() or being terminated with atomThreadTerminate())
+ * the function returns immediately. Otherwise the calling thread blocks until
+ * the thread terminates, or the timeout expires. Any number of threads may
+ * join the same thread.
+ *
+ * Depending on the \c timeout value specified the call will do one of
+ * the following if the thread has not yet terminated:
+ *
+ * \c timeout == 0 : Call will block until the thread terminates \n
+ * \c timeout > 0 : Call will block until the thread terminates or the
+ *                  specified timeout \n
+ * \c timeout == -1 : Return immediately if the thread has not terminated \n
+ *
+ * When the function returns ATOM_OK, the TCB and stack of the joined thread
+ * may be reused.
+ *
+ * This function can only be called from interrupt context if the \c timeout
+ * parameter is -1 (in which case it does not block).
+ *
+ * @param[in] tcb_ptr Pointer to the TCB of the thread to join
+ * @param[in] timeout Max system ticks to block (0 = forever)
+ *
+ * @retval ATOM_OK The thread has terminated
+ * @retval ATOM_TIMEOUT The thread had not terminated before the timeout
+ * @retval ATOM_WOULDBLOCK Called with timeout == -1 and the thread is running
+ * @retval ATOM_ERR_CONTEXT Not called in thread context and attempted to block
+ * @retval ATOM_ERR_PARAM Bad parameters (including joining the calling thread)
+ * @retval ATOM_ERR_QUEUE Problem putting the thread on the join queue
+ * @retval ATOM_ERR_TIMER Problem registering the timeout
+ */
+uint8_t atomThreadJoin (ATOM_TCB *tcb_ptr, int32_t timeout)
+{
+    CRITICAL_STORE;
+    uint8_t status;
+    JOIN_TIMER timer_data;
+    ATOM_TIMER timer_cb;
+    ATOM_TCB *curr_tcb_ptr;
+
+    /* Get the current TCB */
+    curr_tcb_ptr = atomCurrentContext();
+
+    /* Parameter check */
+    if ((tcb_ptr == NULL) || (tcb_ptr == &idle_tcb) || (tcb_ptr == curr_tcb_ptr))
+    {
+        /* Bad parameters */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Protect access to the TCB and OS queues */
+        CRITICAL_START ();
+
+        /* If the thread has already terminated, return immediately */
+        if (tcb_ptr->terminated == TRUE)
+        {
+            /* Exit critical region */
+            CRITICAL_END ();
+
+            /* Successful */
+            status = ATOM_OK;
+        }
+
+        /* Block if a timeout was requested */
+        else if (timeout >= 0)
+        {
+            /* Check we are actually in thread context */
+            if (curr_tcb_ptr)
+            {
+                /* Add current thread to the join queue of the thread */
+                if (tcbEnqueuePriority (&tcb_ptr->join_q, curr_tcb_ptr) != ATOM_OK)
+                {
+                    /* Exit critical region */
+                    CRITICAL_END ();
+
+                    /* There was an error putting this thread on the join queue */
+                    status = ATOM_ERR_QUEUE;
+                }
+                else
+                {
+                    /* Set suspended status for the current thread */
+                    curr_tcb_ptr->suspended = TRUE;
+
+                    /* Track errors */
+                    status = ATOM_OK;
+
+                    /* Register a timer callback if requested */
+                    if (timeout)
+                    {
+                        /* Fill out the data needed by the callback to wake us up */
+                        timer_data.tcb_ptr = curr_tcb_ptr;
+                        timer_data.join_tcb_ptr = tcb_ptr;
+
+                        /* Fill out the timer callback request structure */
+                        timer_cb.cb_func = atomThreadJoinTimerCallback;
+                        timer_cb.cb_data = (POINTER)&timer_data;
+                        timer_cb.cb_ticks = timeout;
+
+                        /**
+                         * Store the timer details in the TCB so that we can
+                         * cancel the timer callback if the thread terminates
+                         * before the timeout occurs.
+                         */
+                        curr_tcb_ptr->suspend_timo_cb = &timer_cb;
+
+                        /* Register a callback on timeout */
+                        if (atomTimerRegister (&timer_cb) != ATOM_OK)
+                        {
+                            /* Timer registration failed */
+                            status = ATOM_ERR_TIMER;
+
+                            /* Clean up and return to the caller */
+                            (void)tcbDequeueEntry (&tcb_ptr->join_q, curr_tcb_ptr);
+                            curr_tcb_ptr->suspended = FALSE;
+                            curr_tcb_ptr->suspend_timo_cb = NULL;
+                        }
+                    }
+
+                    /* Set no timeout requested */
+                    else
+                    {
+                        /* No need to cancel timeouts on this one */
+                        curr_tcb_ptr->suspend_timo_cb = NULL;
+                    }
+
+                    /* Exit critical region */
+                    CRITICAL_END ();
+
+                    /* Check no errors have occurred */
+                    if (status == ATOM_OK)
+                    {
+                        /**
+                         * Current thread now blocking, schedule in a new
+                         * one. We already know we are in thread context
+                         * so can call the scheduler from here.
+                         */
+                        atomSched (FALSE);
+
+                        /**
+                         * Normal wakeups on termination will set ATOM_OK
+                         * status, while timeouts will set ATOM_TIMEOUT.
+                         */
+                        status = curr_tcb_ptr->suspend_wake_status;
+                    }
+                }
+            }
+            else
+            {
+                /* Exit critical region */
+                CRITICAL_END ();
+
+                /* Not currently in thread context, can't suspend */
+                status = ATOM_ERR_CONTEXT;
+            }
+        }
+        else
+        {
+            /* timeout == -1, requested not to block and thread still running */
+            CRITICAL_END();
+            status = ATOM_WOULDBLOCK;
+        }
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomThreadJoinTimerCallback
+ *
+ * This is an internal function not for use by application code.
+ *
+ * Timeouts on threads suspended in atomThreadJoin() are notified by the
+ * timer system through this generic callback. The timer system calls us
+ * back with a pointer to the relevant \c JOIN_TIMER object which is used
+ * to retrieve the join details.
+ *
+ * @param[in] cb_data Pointer to a JOIN_TIMER object
+ */
+static void atomThreadJoinTimerCallback (POINTER cb_data)
+{
+    JOIN_TIMER *timer_data_ptr;
+    CRITICAL_STORE;
+
+    /* Get the JOIN_TIMER structure pointer */
+    timer_data_ptr = (JOIN_TIMER *)cb_data;
+
+    /* Check parameter is valid */
+    if (timer_data_ptr)
+    {
+        /* Enter critical region */
+        CRITICAL_START ();
+
+        /* Only act if the thread was not woken before we got here */
+        if (timer_data_ptr->tcb_ptr->suspend_timo_cb)
+        {
+            /* Set status to indicate to the waiting thread that it timed out */
+            timer_data_ptr->tcb_ptr->suspend_wake_status = ATOM_TIMEOUT;
+
+            /* Flag as no timeout registered */
+            timer_data_ptr->tcb_ptr->suspend_timo_cb = NULL;
+
+            /* Remove this thread from the join queue */
+            (void)tcbDequeueEntry (&timer_data_ptr->join_tcb_ptr->join_q, timer_data_ptr->tcb_ptr);
+
+            /* Put the thread on the ready queue */
+            (void)tcbEnqueuePriority (&tcbReadyQ, timer_data_ptr->tcb_ptr);
+        }
+
+        /* Exit critical region */
+        CRITICAL_END ();
+
+        /**
+         * Note that we don't call the scheduler now as it will be called
+         * when we exit the ISR by atomIntExit().
+         */
+    }
+}
+
+
+/**
+ * \b atomThreadSetPriority
+ *
+ * Changes the priority of a thread at runtime.
+ *
+ * The thread may be in any state. If it is on the ready queue, or is
+ * blocking on the suspend queue of any OS object (semaphore, queue, mutex
+ * etc), it is moved to its new position on that queue so that it is
+ * scheduled or woken in the correct order for its new priority. Threads
+ * suspended without a queue (e.g. in atomTimerDelay()) and the currently
+ * running thread simply take the new priority.
+ *
+ * The scheduler is then called, so if the change makes another thread
+ * higher priority than the caller (or raises a ready thread above the
+ * caller), the context switch happens before this function returns.
+ *
+ * This function can be called from interrupt context, in which case any
+ * reschedule is deferred until the interrupt exits.
+ *
+ * @param[in] tcb_ptr Pointer to the TCB of the thread to modify
+ * @param[in] priority New priority of the thread (0 to 255)
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_PARAM Bad parameters
+ */
+uint8_t atomThreadSetPriority (ATOM_TCB *tcb_ptr, uint8_t priority)
+{
+    CRITICAL_STORE;
+    ATOM_TCB **tcb_queue_ptr;
+    uint8_t status;
+
+    /* Parameter check */
+    if (tcb_ptr == NULL)
+    {
+        /* Bad parameters */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Protect access to the TCB and its queue */
+        CRITICAL_START ();
+
+        /**
+         * If the thread is on a TCB queue (the ready queue or an object's
+         * suspend queue) it must be requeued, because the queues are kept
+         * in priority order. Dequeue it, change the priority and enqueue
+         * it again on the same queue. It goes behind any other threads
+         * already on the queue at its new priority.
+         */
+        tcb_queue_ptr = tcb_ptr->tcb_queue;
+        if (tcb_queue_ptr)
+        {
+            (void)tcbDequeueEntry (tcb_queue_ptr, tcb_ptr);
+            tcb_ptr->priority = priority;
+            (void)tcbInsertPriority (tcb_queue_ptr, tcb_ptr);
+        }
+        else
+        {
+            /* Running or delayed thread, not on any queue */
+            tcb_ptr->priority = priority;
+        }
+
+        /* Exit critical region */
+        CRITICAL_END ();
+
+        /**
+         * If the OS is started and we're in thread context, check if we
+         * should be scheduled out now.
+         */
+        if ((atomOSStarted == TRUE) && atomCurrentContext())
+            atomSched (FALSE);
+
+        /* Success */
+        status = ATOM_OK;
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomThreadSetThreshold
+ *
+ * Sets the preemption threshold of a thread.
+ *
+ * While a thread is running, it can normally be preempted by any ready
+ * thread of higher priority. With a preemption threshold set, it can only
+ * be preempted by threads of higher priority than the threshold. Threads
+ * with priorities between the thread's own priority and its threshold
+ * wait until it blocks (or lowers its threshold) instead of forcing a
+ * context switch. Time-slicing with threads of the same priority is also
+ * disabled while the threshold is in effect.
+ *
+ * This is useful for groups of cooperating threads which do not need to
+ * preempt each other: each one can run to completion against the others,
+ * avoiding context switches and the need to protect data shared only
+ * within the group, while still being preempted by more urgent threads.
+ * The thread is still placed on the ready and suspend queues using its
+ * priority.
+ *
+ * A threshold numerically greater than or equal to the thread's priority
+ * (the default IDLE_THREAD_PRIORITY) has no effect. A threshold of 0
+ * disables preemption of the thread entirely.
+ *
+ * The scheduler is called in case lowering the threshold now allows a
+ * ready thread to preempt.
+ *
+ * @param[in] tcb_ptr Pointer to the TCB of the thread to modify
+ * @param[in] threshold New preemption threshold (0 to 255)
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_PARAM Bad parameters
+ */
+uint8_t atomThreadSetThreshold (ATOM_TCB *tcb_ptr, uint8_t threshold)
+{
+    uint8_t status;
+
+    /* Parameter check */
+    if (tcb_ptr == NULL)
+    {
+        /* Bad parameters */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Only used by the scheduler for the running thread, no requeue needed */
+        tcb_ptr->threshold = threshold;
+
+        /**
+         * If the OS is started and we're in thread context, check if we
+         * should be scheduled out now.
+         */
+        if ((atomOSStarted == TRUE) && atomCurrentContext())
+            atomSched (FALSE);
+
+        /* Success */
+        status = ATOM_OK;
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomThreadSetBudget
+ *
+ * Limits the execution time of a thread to \c budget ticks in every
+ * \c period ticks.
+ *
+ * While the thread is running, each system tick is charged against its
+ * budget. When the budget is used up the thread is either demoted to
+ * \c exhausted_priority, where it can only use time not wanted by higher
+ * priority threads, or if \c exhausted_priority is ATOM_BUDGET_SUSPEND it
+ * is suspended completely. At the end of each period the budget is
+ * replenished, and a demoted thread regains its priority or a suspended
+ * thread is made ready again. This can be used to stop a misbehaving or
+ * overloaded thread from starving lower priority threads, in the manner
+ * of a sporadic or deferrable server.
+ *
+ * Execution time is measured by sampling which thread is running on each
+ * system tick, so a thread is only charged for ticks that occur while it
+ * is running. Threads which always run for much less than a tick at a
+ * time are therefore charged statistically rather than exactly.
+ *
+ * The caller provides the ATOM_BUDGET storage, which must remain valid
+ * until atomThreadClearBudget() is called. The first period starts now.
+ * Changing the priority of a demoted thread with atomThreadSetPriority()
+ * is overridden when the budget is replenished.
+ *
+ * @param[in] tcb_ptr Pointer to the TCB of the thread to limit
+ * @param[in] budget_ptr Pointer to budget storage
+ * @param[in] budget Execution ticks allowed in each period
+ * @param[in] period Replenishment period in ticks (at least \c budget)
+ * @param[in] exhausted_priority Priority when exhausted, or ATOM_BUDGET_SUSPEND
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_PARAM Bad parameters or the thread already has a budget
+ * @retval ATOM_ERR_TIMER Could not register the replenishment timer
+ */
+uint8_t atomThreadSetBudget (ATOM_TCB *tcb_ptr, ATOM_BUDGET *budget_ptr, uint32_t budget, uint32_t period, uint8_t exhausted_priority)
+{
+    CRITICAL_STORE;
+    uint8_t status;
+
+    /* Parameter check */
+    if ((tcb_ptr == NULL) || (budget_ptr == NULL) || (budget == 0)
+        || (period < budget) || (tcb_ptr->budget != NULL))
+    {
+        /* Bad parameters */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Set up the budget with a full allowance */
+        budget_ptr->tcb_ptr = tcb_ptr;
+        budget_ptr->budget = budget;
+        budget_ptr->period = period;
+        budget_ptr->remaining = budget;
+        budget_ptr->exhausted_priority = exhausted_priority;
+        budget_ptr->priority = tcb_ptr->priority;
+        budget_ptr->exhausted = FALSE;
+        budget_ptr->suspended = FALSE;
+
+        /* Fill out the replenishment timer */
+        budget_ptr->timer.cb_func = atomBudgetCallback;
+        budget_ptr->timer.cb_data = (POINTER)budget_ptr;
+        budget_ptr->timer.cb_ticks = period;
+
+        /* Attach to the thread and start the first period together */
+        CRITICAL_START ();
+        if (atomTimerRegister (&budget_ptr->timer) != ATOM_OK)
+        {
+            /* Timer registration failed */
+            status = ATOM_ERR_TIMER;
+        }
+        else
+        {
+            tcb_ptr->budget = budget_ptr;
+            status = ATOM_OK;
+        }
+        CRITICAL_END ();
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomThreadClearBudget
+ *
+ * Removes the execution budget set by atomThreadSetBudget().
+ *
+ * If the budget is currently exhausted, the thread is restored to its
+ * priority or made ready again, and the scheduler is called in case it
+ * should now run. The ATOM_BUDGET storage can be reused on return.
+ *
+ * @param[in] tcb_ptr Pointer to the TCB of the thread
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_PARAM Bad parameters
+ * @retval ATOM_ERR_NOT_FOUND The thread has no budget
+ */
+uint8_t atomThreadClearBudget (ATOM_TCB *tcb_ptr)
+{
+    CRITICAL_STORE;
+    ATOM_BUDGET *budget_ptr;
+    uint8_t status;
+
+    /* Parameter check */
+    if (tcb_ptr == NULL)
+    {
+        /* Bad parameters */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Protect access to the TCB and budget */
+        CRITICAL_START ();
+
+        budget_ptr = tcb_ptr->budget;
+        if (budget_ptr == NULL)
+        {
+            /* Nothing to clear */
+            status = ATOM_ERR_NOT_FOUND;
+        }
+        else
+        {
+            /* Stop replenishing and detach from the thread */
+            (void)atomTimerCancel (&budget_ptr->timer);
+            tcb_ptr->budget = NULL;
+
+            /* Undo any demotion or suspension */
+            if (budget_ptr->exhausted == TRUE)
+            {
+                atomBudgetRestore (budget_ptr);
+            }
+
+            /* Successful */
+            status = ATOM_OK;
+        }
+
+        /* Exit critical region */
+        CRITICAL_END ();
+
+        /**
+         * If the OS is started and we're in thread context, check if we
+         * should be scheduled out now.
+         */
+        if ((status == ATOM_OK) && (atomOSStarted == TRUE) && atomCurrentContext())
+            atomSched (FALSE);
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomBudgetTick
+ *
+ * This is an internal function not for use by application code.
+ *
+ * Called by atomTimerAdvance() with the number of system ticks elapsed, to
+ * charge them to the execution budget of the thread that was interrupted.
+ * No more than the remaining budget is charged. If the budget runs out, the
+ * thread is demoted or suspended. The scheduler call made by the timer
+ * interrupt's atomIntExit() then switches to another thread if necessary.
+ *
+ * @param[in] ticks Number of system ticks elapsed
+ *
+ * @return None
+ */
+void atomBudgetTick (uint32_t ticks)
+{
+    ATOM_BUDGET *budget_ptr;
+
+    /* Check the running thread has a budget which isn't already used up */
+    budget_ptr = curr_tcb ? curr_tcb->budget : NULL;
+    if (budget_ptr && (budget_ptr->exhausted == FALSE) && (ticks > 0))
+    {
+        /* Charge the ticks, but never more than the budget has left */
+        if (ticks < budget_ptr->remaining)
+        {
+            budget_ptr->remaining -= ticks;
+        }
+
+        /* The budget is now used up */
+        else
+        {
+            budget_ptr->remaining = 0;
+            budget_ptr->exhausted = TRUE;
+            if (budget_ptr->exhausted_priority == ATOM_BUDGET_SUSPEND)
+            {
+                /**
+                 * Suspend the thread without putting it on any queue. It
+                 * is made ready again when the budget is replenished. A
+                 * thread which is already suspending itself on an OS
+                 * object (it has left its critical section but not yet
+                 * called the scheduler) is left to block there instead.
+                 */
+                if (curr_tcb->suspended == FALSE)
+                {
+                    curr_tcb->suspended = TRUE;
+                    budget_ptr->suspended = TRUE;
+                }
+            }
+            else
+            {
+                /**
+                 * Demote the thread. It is running so is not on the
+                 * ready queue, and can simply take the new priority.
+                 */
+                budget_ptr->priority = curr_tcb->priority;
+                curr_tcb->priority = budget_ptr->exhausted_priority;
+            }
+        }
+    }
+}
+
+
+/**
+ * \b atomBudgetRestore
+ *
+ * This is an internal function not for use by application code.
+ *
+ * Undoes the demotion or suspension of a thread whose budget was
+ * exhausted.
+ *
+ * \b NOTE: Assumes that the caller is already in a critical section.
+ *
+ * @param[in] budget_ptr Pointer to the exhausted budget
+ *
+ * @return None
+ */
+static void atomBudgetRestore (ATOM_BUDGET *budget_ptr)
+{
+    ATOM_TCB *tcb_ptr = budget_ptr->tcb_ptr;
+    ATOM_TCB **tcb_queue_ptr;
+
+    budget_ptr->exhausted = FALSE;
+
+    if (budget_ptr->exhausted_priority == ATOM_BUDGET_SUSPEND)
+    {
+        /* Nothing to undo unless the budget suspended the thread */
+        if (budget_ptr->suspended == TRUE)
+        {
+            budget_ptr->suspended = FALSE;
+
+            /**
+             * If the budget ran out on this tick the thread has not been
+             * scheduled out yet, so just let it carry on running.
+             */
+            if (tcb_ptr == curr_tcb)
+            {
+                tcb_ptr->suspended = FALSE;
+            }
+
+            /**
+             * Otherwise make the thread ready again, unless it was
+             * terminated while suspended. It must not already be on a TCB
+             * queue or waiting for a timeout, which would mean something
+             * else has taken charge of it.
+             */
+            else if ((tcb_ptr->terminated == FALSE)
+                && (tcb_ptr->tcb_queue == NULL)
+                && (tcb_ptr->suspend_timo_cb == NULL))
+            {
+                (void)tcbInsertPriority (&tcbReadyQ, tcb_ptr);
+            }
+        }
+    }
+    else
+    {
+        /* Restore the priority, requeueing if on a TCB queue */
+        tcb_queue_ptr = tcb_ptr->tcb_queue;
+        if (tcb_queue_ptr)
+        {
+            (void)tcbDequeueEntry (tcb_queue_ptr, tcb_ptr);
+            tcb_ptr->priority = budget_ptr->priority;
+            (void)tcbInsertPriority (tcb_queue_ptr, tcb_ptr);
+        }
+        else
+        {
+            tcb_ptr->priority = budget_ptr->priority;
+        }
+    }
+}
+
+
+/**
+ * \b atomBudgetCallback
+ *
+ * This is an internal function not for use by application code.
+ *
+ * Timer callback at the end of each budget period. Replenishes the budget,
+ * restores the thread if the budget was exhausted, and restarts the timer
+ * for the next period.
+ *
+ * Called from the timer interrupt, so the scheduler is called on exit
+ * from the interrupt by atomIntExit().
+ *
+ * @param[in] cb_data Pointer to the ATOM_BUDGET
+ *
+ * @return None
+ */
+static void atomBudgetCallback (POINTER cb_data)
+{
+    ATOM_BUDGET *budget_ptr = (ATOM_BUDGET *)cb_data;
+    CRITICAL_STORE;
+
+    /* Enter critical region */
+    CRITICAL_START ();
+
+    /* Replenish and restore the thread */
+    budget_ptr->remaining = budget_ptr->budget;
+    if (budget_ptr->exhausted == TRUE)
+    {
+        atomBudgetRestore (budget_ptr);
+    }
+
+    /* Start the next period */
+    budget_ptr->timer.cb_ticks = budget_ptr->period;
+    (void)atomTimerRegister (&budget_ptr->timer);
+
+    /* Exit critical region */
+    CRITICAL_END ();
+}
+
+
+#ifdef ATOM_EDF
+/**
+ * \b atomThreadSetDeadline
+ *
+ * Sets the absolute deadline of a thread for earliest-deadline-first
+ * scheduling.
+ *
+ * Threads with a priority in the EDF band (ATOM_EDF_PRIO_HIGH to
+ * ATOM_EDF_PRIO_LOW) are scheduled in order of their deadlines, earliest
+ * first, regardless of their priority within the band. Threads above the
+ * band always preempt EDF threads, and threads below the band only run
+ * when no EDF thread is ready. The deadline has no effect on threads
+ * outside the band.
+ *
+ * The deadline is an absolute system tick count for the thread's current
+ * job. Threads whose jobs each have the same relative deadline can
+ * instead use atomThreadSetRelativeDeadline(), which has the kernel
+ * derive the absolute deadline each time the thread is woken. A deadline
+ * set here then applies until the thread is next woken. Comparisons are
+ * made relative to each other so wraparound of the tick count is handled,
+ * as long as deadlines in use are within 2^31 ticks of each other.
+ *
+ * As with atomThreadSetPriority(), a thread on the ready queue or an
+ * object's suspend queue is requeued in its new position, and the
+ * scheduler is called in case another thread should now run.
+ *
+ * This function can be called from interrupt context, in which case any
+ * reschedule is deferred until the interrupt exits.
+ *
+ * @param[in] tcb_ptr Pointer to the TCB of the thread to modify
+ * @param[in] deadline Absolute deadline in system ticks
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_PARAM Bad parameters
+ */
+uint8_t atomThreadSetDeadline (ATOM_TCB *tcb_ptr, uint32_t deadline)
+{
+    CRITICAL_STORE;
+    ATOM_TCB **tcb_queue_ptr;
+    uint8_t status;
+
+    /* Parameter check */
+    if (tcb_ptr == NULL)
+    {
+        /* Bad parameters */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Protect access to the TCB and its queue */
+        CRITICAL_START ();
+
+        /* Requeue if on a TCB queue, which may be in deadline order */
+        tcb_queue_ptr = tcb_ptr->tcb_queue;
+        if (tcb_queue_ptr)
+        {
+            (void)tcbDequeueEntry (tcb_queue_ptr, tcb_ptr);
+            tcb_ptr->deadline = deadline;
+            (void)tcbInsertPriority (tcb_queue_ptr, tcb_ptr);
+        }
+        else
+        {
+            /* Running or delayed thread, not on any queue */
+            tcb_ptr->deadline = deadline;
+        }
+
+        /* Exit critical region */
+        CRITICAL_END ();
+
+        /**
+         * If the OS is started and we're in thread context, check if we
+         * should be scheduled out now.
+         */
+        if ((atomOSStarted == TRUE) && atomCurrentContext())
+            atomSched (FALSE);
+
+        /* Success */
+        status = ATOM_OK;
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomThreadSetRelativeDeadline
+ *
+ * Sets the relative deadline of a thread for earliest-deadline-first
+ * scheduling.
+ *
+ * The relative deadline is stored in the thread's TCB. Each time the
+ * thread is released, that is woken from any suspension (a delay, a
+ * timeout or an OS object), its absolute deadline is set to the release
+ * time plus \c relative_deadline before it is placed on the ready queue.
+ * A periodic thread therefore only needs to set its relative deadline
+ * once, then delay until each release time as usual.
+ *
+ * The call itself counts as a release, so the thread's current deadline
+ * is set to the current time plus \c relative_deadline, as with
+ * atomThreadSetDeadline(). Passing zero stops deriving deadlines on wake,
+ * leaving the current deadline unchanged until atomThreadSetDeadline() is
+ * called.
+ *
+ * This function can be called from interrupt context, in which case any
+ * reschedule is deferred until the interrupt exits.
+ *
+ * @param[in] tcb_ptr Pointer to the TCB of the thread to modify
+ * @param[in] relative_deadline Relative deadline in system ticks, or 0
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_PARAM Bad parameters
+ */
+uint8_t atomThreadSetRelativeDeadline (ATOM_TCB *tcb_ptr, uint32_t relative_deadline)
+{
+    CRITICAL_STORE;
+    uint8_t status;
+
+    /* Parameter check */
+    if (tcb_ptr == NULL)
+    {
+        /* Bad parameters */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Store the relative deadline for future releases */
+        CRITICAL_START ();
+        tcb_ptr->relative_deadline = relative_deadline;
+        CRITICAL_END ();
+
+        /* Treat this call as a release, requeueing the thread as necessary */
+        if (relative_deadline != 0)
+        {
+            status = atomThreadSetDeadline (tcb_ptr, atomTimeGet() + relative_deadline);
+        }
+        else
+        {
+            /* Success */
+            status = ATOM_OK;
+        }
+    }
+
+    return (status);
+}
+#endif
+
+
+#ifdef ATOM_NUM_PARTITIONS
+/**
+ * \b atomThreadSetPartition
+ *
+ * Assigns a thread to a time partition.
+ *
+ * Threads in the system partition (0, the default for new threads) can
+ * run at any time. Threads in other partitions can only run during their
+ * partition's windows in the major frame set by atomPartitionScheduleSet().
+ * Within those limits threads are scheduled by priority as normal, with
+ * the system partition and the active partition competing on priority.
+ *
+ * When a partition's window ends, its running thread is preempted at the
+ * window boundary even if it is the highest priority thread, and waits on
+ * its partition's ready queue until that partition's next window. Threads
+ * blocked on OS objects are not affected until they become ready.
+ *
+ * @param[in] tcb_ptr Pointer to the TCB of the thread to move
+ * @param[in] partition Partition (0 to ATOM_NUM_PARTITIONS-1)
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_PARAM Bad parameters
+ */
+uint8_t atomThreadSetPartition (ATOM_TCB *tcb_ptr, uint8_t partition)
+{
+    CRITICAL_STORE;
+    ATOM_TCB **tcb_queue_ptr;
+    uint8_t status;
+
+    /* Parameter check */
+    if ((tcb_ptr == NULL) || (tcb_ptr == &idle_tcb) || (partition >= ATOM_NUM_PARTITIONS))
+    {
+        /* Bad parameters */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Protect access to the TCB and ready queues */
+        CRITICAL_START ();
+
+        /**
+         * A ready thread must move to the new partition's ready queue.
+         * Threads on an object's suspend queue just take the new partition
+         * and are placed on the right ready queue when they are woken.
+         */
+        tcb_queue_ptr = tcb_ptr->tcb_queue;
+        if ((tcb_queue_ptr == &tcbReadyQ)
+            || ((tcb_queue_ptr >= &partReadyQ[0]) && (tcb_queue_ptr < &partReadyQ[ATOM_NUM_PARTITIONS - 1])))
+        {
+            (void)tcbDequeueEntry (tcb_queue_ptr, tcb_ptr);
+            tcb_ptr->partition = partition;
+            (void)tcbInsertPriority (&tcbReadyQ, tcb_ptr);
+        }
+        else
+        {
+            tcb_ptr->partition = partition;
+        }
+
+        /* Exit critical region */
+        CRITICAL_END ();
+
+        /**
+         * If the OS is started and we're in thread context, check if we
+         * should be scheduled out now.
+         */
+        if ((atomOSStarted == TRUE) && atomCurrentContext())
+            atomSched (FALSE);
+
+        /* Success */
+        status = ATOM_OK;
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomPartitionScheduleSet
+ *
+ * Sets the major frame: a table of windows, each giving one partition the
+ * right to run for a number of system ticks. The windows are run in order,
+ * and the table repeats once the last window has finished. A partition can
+ * appear in more than one window. A window for partition 0 only allows the
+ * system partition to run, which can be used for spare time.
+ *
+ * The first window starts immediately. The table is not copied, so must
+ * remain valid until replaced. Passing a NULL table stops the major frame,
+ * leaving only the system partition able to run, which is also the state
+ * before any table is set.
+ *
+ * Each window boundary is handled on the system tick in constant time by
+ * changing the active partition, because each partition has its own ready
+ * queue.
+ *
+ * @param[in] table Pointer to the window table, or NULL
+ * @param[in] num_windows Number of windows in the table
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_PARAM Bad parameters
+ */
+uint8_t atomPartitionScheduleSet (const ATOM_PARTITION_WINDOW *table, uint8_t num_windows)
+{
+    CRITICAL_STORE;
+    uint8_t status;
+    uint32_t frame_ticks;
+    int i;
+
+    /* Parameter check, and total up the length of the major frame */
+    status = ATOM_OK;
+    frame_ticks = 0;
+    if (table)
+    {
+        if (num_windows == 0)
+        {
+            status = ATOM_ERR_PARAM;
+        }
+        for (i = 0; i < num_windows; i++)
+        {
+            if ((table[i].partition >= ATOM_NUM_PARTITIONS) || (table[i].ticks == 0))
+            {
+                status = ATOM_ERR_PARAM;
             }
+            frame_ticks += table[i].ticks;
         }
-#else
-        /* Avoid compiler warning due to unused parameter */
-        stack_check = stack_check;
-#endif
+    }
+
+    if (status == ATOM_OK)
+    {
+        /* Start the first window, or stop the major frame */
+        CRITICAL_START ();
+        part_table = table;
+        part_num_windows = num_windows;
+        part_frame_ticks = frame_ticks;
+        part_window = 0;
+        if (table)
+        {
+            part_active = table[0].partition;
+            part_window_ticks = table[0].ticks;
+        }
+        else
+        {
+            part_active = 0;
+        }
+        CRITICAL_END ();
 
         /**
-         * Call the arch-specific routine to set up the stack. This routine
-         * is responsible for creating the context save area necessary for
-         * allowing atomThreadSwitch() to schedule it in. The initial
-         * archContextSwitch() call when this thread gets scheduled in the
-         * first time will then restore the program counter to the thread
-         * entry point, and any other necessary register values ready for
-         * it to start running.
+         * If the OS is started and we're in thread context, check if we
+         * should be scheduled out now.
          */
-        archThreadContextInit (tcb_ptr, stack_top, entry_point, entry_param);
+        if ((atomOSStarted == TRUE) && atomCurrentContext())
+            atomSched (FALSE);
+    }
 
-        /* Protect access to the OS queue */
-        CRITICAL_START ();
+    return (status);
+}
 
-        /* Put this thread on the ready queue */
-        if (tcbEnqueuePriority (&tcbReadyQ, tcb_ptr) != ATOM_OK)
-        {
-            /* Exit critical region */
-            CRITICAL_END ();
 
-            /* Queue-related error */
-            status = ATOM_ERR_QUEUE;
+/**
+ * \b atomPartitionTick
+ *
+ * This is an internal function not for use by application code.
+ *
+ * Called by atomTimerAdvance() with the number of system ticks elapsed, to
+ * move on through the windows of the major frame which have finished. Whole
+ * major frames are skipped arithmetically, so the cost does not depend on
+ * the number of ticks. The scheduler call made by the timer interrupt's
+ * atomIntExit() then switches out any thread whose partition is no longer
+ * active.
+ *
+ * @param[in] ticks Number of system ticks elapsed
+ *
+ * @return None
+ */
+void atomPartitionTick (uint32_t ticks)
+{
+    /* Check the major frame is running */
+    if (part_table)
+    {
+        /* Check whether the current window has ended */
+        if (ticks < part_window_ticks)
+        {
+            part_window_ticks -= ticks;
         }
         else
         {
-            /* Exit critical region */
-            CRITICAL_END ();
-
             /**
-             * If the OS is started and we're in thread context, check if we
-             * should be scheduled in now.
+             * Count the ticks from the start of the next window, skipping
+             * any whole major frames, which end where they started.
              */
-            if ((atomOSStarted == TRUE) && atomCurrentContext())
-                atomSched (FALSE);
+            ticks = (ticks - part_window_ticks) % part_frame_ticks;
+            if (++part_window >= part_num_windows)
+            {
+                part_window = 0;
+            }
 
-            /* Success */
-            status = ATOM_OK;
+            /* Move through the windows those ticks have passed */
+            while (ticks >= part_table[part_window].ticks)
+            {
+                ticks -= part_table[part_window].ticks;
+                if (++part_window >= part_num_windows)
+                {
+                    part_window = 0;
+                }
+            }
+            part_active = part_table[part_window].partition;
+            part_window_ticks = part_table[part_window].ticks - ticks;
         }
     }
-
-    return (status);
 }
+#endif
 
 
 #ifdef ATOM_STACK_CHECKING
@@ -606,17 +1939,213 @@ void atomIntEnter (void)
  * interrupt handlers to determine whether a new thread has now
  * been made ready and should be scheduled in.
  *
+ * At the end of the outermost interrupt handler any pending deferred
+ * handlers raised with atomSoftIrqRaise() are run first, still in
+ * interrupt context, so that threads they make ready are taken into
+ * account by the same scheduler call. Nested interrupt handlers leave
+ * scheduling to the outermost handler, remembering whether any of them
+ * was a timer tick.
+ *
  * @param timer_tick TRUE if this is a timer tick
  *
  * @return None
  */
 void atomIntExit (uint8_t timer_tick)
 {
-    /* Decrement the interrupt count */
-    atomIntCnt--;
+    /* Note timer ticks for the outermost interrupt exit */
+    if (timer_tick == TRUE)
+    {
+        atomIntTimerTick = TRUE;
+    }
+
+    /* Only the outermost interrupt handler runs deferred work and schedules */
+    if (atomIntCnt == 1)
+    {
+        /* Run any deferred interrupt handlers */
+        if (softirq_pending)
+        {
+            atomSoftIrqRun ();
+        }
+
+        /* Decrement the interrupt count */
+        atomIntCnt--;
+
+        /* Call the scheduler */
+        timer_tick = atomIntTimerTick;
+        atomIntTimerTick = FALSE;
+        atomSched (timer_tick);
+    }
+    else
+    {
+        /* Decrement the interrupt count */
+        atomIntCnt--;
+    }
+}
+
+
+/**
+ * \b atomSoftIrqRegister
+ *
+ * Registers a deferred interrupt handler (soft IRQ).
+ *
+ * Deferred handlers allow interrupt handlers to do the minimum of work in
+ * the hardware interrupt, and defer the rest without waking a thread. The
+ * interrupt handler calls atomSoftIrqRaise() to mark the deferred handler
+ * pending, and it is run at the end of the outermost interrupt handler,
+ * before any rescheduling takes place.
+ *
+ * Handler numbers range from 0 to ATOM_NUM_SOFTIRQS - 1. Where several are
+ * pending, lower numbered handlers run first. Passing a NULL \c handler
+ * unregisters the handler and discards any pending request for it.
+ *
+ * Deferred handlers run in interrupt context, so they may make the same
+ * kernel calls as interrupt handlers but must not block. Ports may run them
+ * with interrupts enabled (see ATOM_SOFTIRQ_INT_ENABLE() in atomport.h).
+ *
+ * @param[in] irq Deferred handler number
+ * @param[in] handler Handler function, or NULL to unregister
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_PARAM Bad parameters
+ */
+uint8_t atomSoftIrqRegister (uint8_t irq, void (*handler)(void))
+{
+    CRITICAL_STORE;
+    uint8_t status;
+
+    /* Parameter check */
+    if (irq >= ATOM_NUM_SOFTIRQS)
+    {
+        /* Bad handler number */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Protect access to the handler table and bitmap */
+        CRITICAL_START ();
+
+        /* Store the handler, discarding pending requests on unregister */
+        softirq_handler[irq] = handler;
+        if (handler == NULL)
+        {
+            softirq_pending &= ~((uint32_t)1 << irq);
+        }
+
+        /* Exit critical region */
+        CRITICAL_END ();
+
+        /* Successful */
+        status = ATOM_OK;
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomSoftIrqRaise
+ *
+ * Marks a deferred interrupt handler (soft IRQ) pending.
+ *
+ * Normally called from an interrupt handler, in which case the deferred
+ * handler runs at the end of the outermost interrupt handler. Raising the
+ * same handler several times before it runs results in a single call.
+ *
+ * If called from thread context, pending deferred handlers are run before
+ * this function returns, in interrupt context as if an interrupt had
+ * occurred, followed by a reschedule.
+ *
+ * @param[in] irq Deferred handler number
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_PARAM Bad handler number or no handler registered
+ */
+uint8_t atomSoftIrqRaise (uint8_t irq)
+{
+    CRITICAL_STORE;
+    uint8_t status;
+
+    /* Parameter check */
+    if ((irq >= ATOM_NUM_SOFTIRQS) || (softirq_handler[irq] == NULL))
+    {
+        /* Bad handler number */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Mark the handler pending */
+        CRITICAL_START ();
+        softirq_pending |= ((uint32_t)1 << irq);
+        CRITICAL_END ();
+
+        /**
+         * In thread context there is no interrupt exit to run the handler,
+         * so run it now, in interrupt context, by bracketing it in the
+         * interrupt entry and exit routines.
+         */
+        if (atomCurrentContext())
+        {
+            atomIntEnter ();
+            atomIntExit (FALSE);
+        }
+
+        /* Successful */
+        status = ATOM_OK;
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomSoftIrqRun
+ *
+ * This is an internal function not for use by application code.
+ *
+ * Runs pending deferred interrupt handlers, lowest numbered first, until
+ * none are pending. Called by the outermost atomIntExit() while still in
+ * interrupt context. Handlers raised while the handlers are running (for
+ * example by a nested interrupt) are also run.
+ *
+ * @return None
+ */
+static void atomSoftIrqRun (void)
+{
+    CRITICAL_STORE;
+    uint32_t pending;
+    uint8_t irq;
+    void (*handler)(void);
+
+    /* Protect access to the bitmap */
+    CRITICAL_START ();
+
+    while ((pending = softirq_pending) != 0)
+    {
+        /* Find the lowest numbered pending handler */
+        irq = 0;
+        while ((pending & 1) == 0)
+        {
+            pending >>= 1;
+            irq++;
+        }
+
+        /* Clear its pending bit before running it, so it can be raised again */
+        softirq_pending &= ~((uint32_t)1 << irq);
+        handler = softirq_handler[irq];
+
+        /* Run the handler outside of the critical region */
+        CRITICAL_END ();
+        if (handler)
+        {
+            ATOM_SOFTIRQ_INT_ENABLE ();
+            handler ();
+            ATOM_SOFTIRQ_INT_DISABLE ();
+        }
+        CRITICAL_START ();
+    }
 
-    /* Call the scheduler */
-    atomSched (timer_tick);
+    /* Exit critical region */
+    CRITICAL_END ();
 }
 
 
@@ -680,6 +2209,16 @@ uint8_t atomOSInit (void *idle_thread_stack_bottom, uint32_t idle_thread_stack_s
     curr_tcb = NULL;
     tcbReadyQ = NULL;
     atomOSStarted = FALSE;
+#ifdef ATOM_NUM_PARTITIONS
+    {
+        int i;
+
+        for (i = 0; i < ATOM_NUM_PARTITIONS - 1; i++)
+            partReadyQ[i] = NULL;
+        part_active = 0;
+        part_table = NULL;
+    }
+#endif
 
     /* Create the idle thread */
     status = atomThreadCreate(&idle_tcb,
@@ -728,7 +2267,7 @@ void atomOSStart (void)
      * the idle thread (the lowest priority allowed to be scheduled is the
      * idle thread's priority, 255).
      */
-    new_tcb = tcbDequeuePriority (&tcbReadyQ, 255);
+    new_tcb = tcbDequeuePriority (tcbReadyQueue (), 255);
     if (new_tcb)
     {
         /* Set the new currently-running thread pointer */
@@ -773,6 +2312,39 @@ static void atomIdleThread (uint32_t param)
 }
 
 
+/**
+ * \b tcbReadyQueue
+ *
+ * This is an internal function not for use by application code.
+ *
+ * Returns the ready queue whose head should be scheduled next. This is
+ * always tcbReadyQ unless time partitioning is enabled, in which case the
+ * active partition's ready queue is returned if its head is ahead of the
+ * system partition's head.
+ *
+ * \b NOTE: Assumes that the caller is already in a critical section.
+ *
+ * @return Pointer to the ready queue head pointer
+ */
+static ATOM_TCB **tcbReadyQueue (void)
+{
+#ifdef ATOM_NUM_PARTITIONS
+    ATOM_TCB **part_queue_ptr;
+
+    if (part_active != 0)
+    {
+        part_queue_ptr = &partReadyQ[part_active - 1];
+        if (*part_queue_ptr && ((tcbReadyQ == NULL) || TCB_BEFORE(*part_queue_ptr, tcbReadyQ)))
+        {
+            return (part_queue_ptr);
+        }
+    }
+#endif
+
+    return (&tcbReadyQ);
+}
+
+
 /**
  * \b tcbEnqueuePriority
  *
@@ -784,6 +2356,15 @@ static void atomIdleThread (uint32_t param)
  * placed at the end of the same-priority TCBs. Calls to tcbDequeuePriority()
  * will dequeue same-priority TCBs in FIFO order.
  *
+ * If ATOM_EDF is enabled, TCBs within the EDF priority band are ordered
+ * amongst themselves by absolute deadline (FIFO for equal deadlines)
+ * regardless of their individual priorities.
+ *
+ * If ATOM_EDF is enabled, a suspended thread being made ready is starting
+ * a new job. If it has a relative deadline (see
+ * atomThreadSetRelativeDeadline()) its absolute deadline is derived from
+ * the current time before it is queued.
+ *
  * \c tcb_queue_ptr may be modified by the routine if the enqueued TCB becomes
  * the new list head. It is valid for tcb_queue_ptr to point to a NULL pointer,
  * which is the case if the queue is currently empty.
@@ -797,6 +2378,40 @@ static void atomIdleThread (uint32_t param)
  * @retval ATOM_ERR_PARAM Bad parameters
  */
 uint8_t tcbEnqueuePriority (ATOM_TCB **tcb_queue_ptr, ATOM_TCB *tcb_ptr)
+{
+#ifdef ATOM_EDF
+    /* Derive the deadline of a thread released with a relative deadline */
+    if ((tcb_queue_ptr == &tcbReadyQ) && tcb_ptr && (tcb_ptr->suspended == TRUE)
+        && (tcb_ptr->relative_deadline != 0))
+    {
+        tcb_ptr->deadline = atomTimeGet() + tcb_ptr->relative_deadline;
+    }
+#endif
+
+    /* Queue the thread */
+    return (tcbInsertPriority (tcb_queue_ptr, tcb_ptr));
+}
+
+
+/**
+ * \b tcbInsertPriority
+ *
+ * This is an internal function not for use by application code.
+ *
+ * Enqueues a TCB as for tcbEnqueuePriority(), but without treating a
+ * suspended thread as released. Used to requeue a thread which is already
+ * ready or suspended after changing its scheduling parameters, so that its
+ * deadline is left as it is.
+ *
+ * \b NOTE: Assumes that the caller is already in a critical section.
+ *
+ * @param[in,out] tcb_queue_ptr Pointer to TCB queue head pointer
+ * @param[in] tcb_ptr Pointer to TCB to enqueue
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_PARAM Bad parameters
+ */
+static uint8_t tcbInsertPriority (ATOM_TCB **tcb_queue_ptr, ATOM_TCB *tcb_ptr)
 {
     uint8_t status;
     ATOM_TCB *prev_ptr, *next_ptr;
@@ -809,15 +2424,24 @@ uint8_t tcbEnqueuePriority (ATOM_TCB **tcb_queue_ptr, ATOM_TCB *tcb_ptr)
     }
     else
     {
+#ifdef ATOM_NUM_PARTITIONS
+        /* Ready threads outside the system partition go on their partition's queue */
+        if ((tcb_queue_ptr == &tcbReadyQ) && (tcb_ptr->partition != 0))
+        {
+            tcb_queue_ptr = &partReadyQ[tcb_ptr->partition - 1];
+        }
+#endif
+
         /* Walk the list and enqueue at the end of the TCBs at this priority */
         prev_ptr = next_ptr = *tcb_queue_ptr;
         do
         {
             /* Insert if:
              *   next_ptr = NULL (we're at the head of an empty queue or at the tail)
-             *   the next TCB in the list is lower priority than the one we're enqueuing.
+             *   the next TCB in the list is lower priority than the one we're enqueuing
+             *   (or has a later deadline, if both are in the EDF band).
              */
-            if ((next_ptr == NULL) || (next_ptr->priority > tcb_ptr->priority))
+            if ((next_ptr == NULL) || TCB_BEFORE(tcb_ptr, next_ptr))
             {
                 /* Make this TCB the new listhead */
                 if (next_ptr == *tcb_queue_ptr)
@@ -851,6 +2475,9 @@ uint8_t tcbEnqueuePriority (ATOM_TCB **tcb_queue_ptr, ATOM_TCB *tcb_ptr)
         }
         while (prev_ptr != NULL);
 
+        /* Remember which queue the TCB is on, for atomThreadSetPriority() */
+        tcb_ptr->tcb_queue = tcb_queue_ptr;
+
         /* Successful */
         status = ATOM_OK;
     }
@@ -905,6 +2532,7 @@ ATOM_TCB *tcbDequeueHead (ATOM_TCB **tcb_queue_ptr)
         if (*tcb_queue_ptr)
             (*tcb_queue_ptr)->prev_tcb = NULL;
         ret_ptr->next_tcb = ret_ptr->prev_tcb = NULL;
+        ret_ptr->tcb_queue = NULL;
     }
 
     return (ret_ptr);
@@ -974,6 +2602,7 @@ ATOM_TCB *tcbDequeueEntry (ATOM_TCB **tcb_queue_ptr, ATOM_TCB *tcb_ptr)
                 }
                 ret_ptr = next_ptr;
                 ret_ptr->prev_tcb = ret_ptr->next_tcb = NULL;
+                ret_ptr->tcb_queue = NULL;
                 break;
             }
 
@@ -1040,6 +2669,7 @@ ATOM_TCB *tcbDequeuePriority (ATOM_TCB **tcb_queue_ptr, uint8_t priority)
             (*tcb_queue_ptr)->prev_tcb = NULL;
             ret_ptr->next_tcb = NULL;
         }
+        ret_ptr->tcb_queue = NULL;
     }
     else
     {
@@ -1049,3 +2679,66 @@ ATOM_TCB *tcbDequeuePriority (ATOM_TCB **tcb_queue_ptr, uint8_t priority)
 
     return (ret_ptr);
 }
+
+
+/**
+ * \b tcbWakeAll
+ *
+ * This is an internal function not for use by application code.
+ *
+ * Wakes every thread on the suspend queue pointed to by \c tcb_queue_ptr.
+ * The whole list is detached from the object at once, then each thread is
+ * given the status \c wake_status, has any suspension timeout removed from
+ * the timer list and is put on the ready queue.
+ *
+ * Suspension timeouts are removed using atomTimerDequeue(), so the cost is
+ * proportional to the number of woken threads, with no timer list walks.
+ * This is used by object delete and flush operations to wake all waiting
+ * threads in a single critical section. The scheduler is not called, the
+ * caller should call it once if any threads were woken.
+ *
+ * \b NOTE: Assumes that the caller is already in a critical section.
+ *
+ * @param[in,out] tcb_queue_ptr Pointer to TCB queue head pointer
+ * @param[in] wake_status Status to return to the woken threads
+ *
+ * @retval TRUE Threads were woken
+ * @retval FALSE The queue was empty
+ */
+uint8_t tcbWakeAll (ATOM_TCB **tcb_queue_ptr, uint8_t wake_status)
+{
+    ATOM_TCB *tcb_ptr, *next_ptr;
+    uint8_t woken_threads = FALSE;
+
+    /* Detach the whole list from the suspend queue */
+    tcb_ptr = *tcb_queue_ptr;
+    *tcb_queue_ptr = NULL;
+
+    /* Wake each of the detached threads */
+    while (tcb_ptr)
+    {
+        /* Save the next TCB, the ready queue insertion relinks this one */
+        next_ptr = tcb_ptr->next_tcb;
+        tcb_ptr->prev_tcb = tcb_ptr->next_tcb = NULL;
+        tcb_ptr->tcb_queue = NULL;
+
+        /* Set the status to be returned to the waiting thread */
+        tcb_ptr->suspend_wake_status = wake_status;
+
+        /* If there's a timeout on this suspension, remove it */
+        if (tcb_ptr->suspend_timo_cb)
+        {
+            atomTimerDequeue (tcb_ptr->suspend_timo_cb);
+            tcb_ptr->suspend_timo_cb = NULL;
+        }
+
+        /* Put the thread on the ready queue */
+        (void)tcbEnqueuePriority (&tcbReadyQ, tcb_ptr);
+
+        /* Move on to the next suspended thread */
+        woken_threads = TRUE;
+        tcb_ptr = next_ptr;
+    }
+
+    return (woken_threads);
+}
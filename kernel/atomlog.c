@@ -0,0 +1,444 @@
+/*
+ * Copyright (c) 2022, Matt Liss
+ * Copyright (c) 2010, Kelvin Lawson. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. No personal names or organizations' names associated with the
+ *    Atomthreads project may be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE ATOMTHREADS PROJECT AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/**
+ * \file
+ * Deferred binary logging library.
+ *
+ *
+ * This module implements a logging facility in which formatting the
+ * messages is left to a host computer, with the following features:
+ *
+ * \par Cheap logging calls
+ * atomLogWrite() only stores the address of the format string, a timestamp
+ * and up to four raw arguments into a RAM ring, inside a short critical
+ * section. No formatting or output is done by the caller, so logging from
+ * hot loops and interrupt handlers costs tens of cycles rather than the
+ * thousands needed to format a string and write it to a UART.
+ *
+ * \par Background output
+ * A log thread, created at a priority chosen by the application, sends the
+ * records in binary form to an application-supplied output function (for
+ * example a UART write routine). It only runs when there are records to
+ * send and nothing more important to do.
+ *
+ * \par Host-side formatting
+ * Each record carries the address of its format string rather than the
+ * string itself. The host script \c tools/atomlog-decode.py looks the
+ * strings up in the application's ELF file and rebuilds the messages.
+ * Format strings must therefore be string literals (or other data held in
+ * the ELF image), and \c %s arguments must also point to strings in the
+ * image.
+ *
+ * \par Overflow handling
+ * If the ring is full the record is dropped rather than blocking the
+ * caller. The number of records dropped is sent after the records logged
+ * before the first drop, stamped with the time of that drop, so that gaps
+ * show up in the decoded log where they occurred.
+ *
+ *
+ * \n <b> Usage instructions: </b> \n
+ *
+ * A log is created with atomLogCreate(), passing an array of
+ * ATOM_LOG_RECORD structures (whose number of entries is a power of two),
+ * the output function and the priority and stack of the log thread.
+ * Records are then written with atomLogWrite(), passing unused arguments
+ * as zero. Arguments are stored as 32-bit values, so 64-bit types cannot
+ * be logged.
+ *
+ * Each record is sent to the output function as the sync bytes
+ * ATOM_LOG_SYNC0 and ATOM_LOG_SYNC1, followed by the format string address
+ * (four bytes, or eight if pointers are wider), the timestamp and the ATOM_LOG_NUM_ARGS
+ * arguments (four bytes each), all least significant byte first. A record
+ * with a format address of zero reports dropped records, the number of
+ * which is its first argument.
+ *
+ */
+
+
+#include "atom.h"
+#include "atomlog.h"
+#include "atomsem.h"
+#include "atomtimer.h"
+
+
+/* Size of the format address in a binary record (4 bytes unless pointers are wider) */
+#define ATOM_LOG_ADDR_SIZE      ((sizeof(const char *) > 4) ? 8 : 4)
+
+/* Size of a binary record sent to the output function */
+#define ATOM_LOG_FRAME_SIZE     (2 + ATOM_LOG_ADDR_SIZE + (4 * (1 + ATOM_LOG_NUM_ARGS)))
+
+
+/* Forward declarations */
+
+static void atomLogThread (uint32_t param);
+static uint8_t *atomLogPut32 (uint8_t *ptr, uint32_t value);
+
+
+/**
+ * \b atomLogCreate
+ *
+ * Initialises a log object and starts its log thread.
+ *
+ * Must be called before calling any other logging library routines on the
+ * log. Objects can be deleted later using atomLogDelete().
+ *
+ * The ring of pending records is stored in the array \c records, whose
+ * number of entries \c max_records must be a power of two. The log thread
+ * calls \c output with each binary record, and may block in it.
+ *
+ * This function cannot be called from interrupt context.
+ *
+ * @param[in] log Pointer to log object
+ * @param[in] records Pointer to the array for pending records
+ * @param[in] max_records Number of entries in the array (a power of two)
+ * @param[in] output Function which sends binary records to the host
+ * @param[in] priority Priority of the log thread
+ * @param[in] stack_bottom Pointer to the log thread's stack
+ * @param[in] stack_size Size of the log thread's stack in bytes
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_PARAM Bad parameters
+ * @retval ATOM_ERROR Error creating the semaphore or log thread
+ */
+uint8_t atomLogCreate (ATOM_LOG *log, ATOM_LOG_RECORD *records, uint32_t max_records, void (*output)(const uint8_t *data, uint32_t len), uint8_t priority, void *stack_bottom, uint32_t stack_size)
+{
+    uint8_t status;
+
+    /* Parameter check */
+    if ((log == NULL) || (records == NULL) || (output == NULL)
+        || (stack_bottom == NULL) || (stack_size == 0))
+    {
+        /* Bad parameters */
+        status = ATOM_ERR_PARAM;
+    }
+    else if ((max_records == 0) || ((max_records & (max_records - 1)) != 0))
+    {
+        /* Capacity must be a non-zero power of two */
+        status = ATOM_ERR_PARAM;
+    }
+    else if (atomSemCreate (&log->sem, 0) != ATOM_OK)
+    {
+        /* Error creating the semaphore */
+        status = ATOM_ERROR;
+    }
+    else
+    {
+        /* Store the log details */
+        log->records = records;
+        log->index_mask = max_records - 1;
+        log->output = output;
+
+        /* Ring starts out empty */
+        log->insert_count = 0;
+        log->remove_count = 0;
+        log->dropped = 0;
+        log->drop_index = 0;
+        log->drop_time = 0;
+        log->waiting = FALSE;
+
+        /**
+         * Start the log thread. It finds its log object via its TCB, which
+         * is the first member of the ATOM_LOG structure.
+         */
+        if (atomThreadCreate (&log->tcb, priority, atomLogThread, 0,
+                stack_bottom, stack_size, TRUE) != ATOM_OK)
+        {
+            /* Error starting the thread */
+            log->records = NULL;
+            (void)atomSemDelete (&log->sem);
+            status = ATOM_ERROR;
+        }
+        else
+        {
+            /* Successful */
+            status = ATOM_OK;
+        }
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomLogDelete
+ *
+ * Deletes a log object.
+ *
+ * The log thread is terminated and any records which have not yet been
+ * sent are discarded. Later calls to atomLogWrite() on the log return
+ * ATOM_ERR_DELETED.
+ *
+ * This function must not be called from the output function, and cannot
+ * be called from interrupt context.
+ *
+ * @param[in] log Pointer to log object
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_PARAM Bad parameters
+ * @retval ATOM_ERR_CONTEXT Called from interrupt context
+ */
+uint8_t atomLogDelete (ATOM_LOG *log)
+{
+    CRITICAL_STORE;
+    uint8_t status;
+
+    /* Parameter check */
+    if ((log == NULL) || (log->records == NULL))
+    {
+        /* Bad parameters */
+        status = ATOM_ERR_PARAM;
+    }
+
+    /* Check we are in thread context */
+    else if (atomCurrentContext() == NULL)
+    {
+        /* Not supported from interrupt context */
+        status = ATOM_ERR_CONTEXT;
+    }
+    else
+    {
+        /* Terminate the log thread, removing it from the semaphore */
+        (void)atomThreadTerminate (&log->tcb);
+
+        /* Stop any further records being written */
+        CRITICAL_START ();
+        log->records = NULL;
+        log->waiting = FALSE;
+        CRITICAL_END ();
+
+        /* Delete the semaphore, there are no threads left waiting on it */
+        status = atomSemDelete (&log->sem);
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomLogWrite
+ *
+ * Writes a record to a log.
+ *
+ * Stores the address of the format string, the current system tick count
+ * and the arguments in the log's ring, and wakes the log thread if it is
+ * waiting. The message is formatted on the host, so \c fmt must be a string
+ * held in the application image, such as a string literal. Arguments not
+ * used by the format string should be passed as zero.
+ *
+ * Never blocks. If the ring is full the record is dropped and counted, and
+ * the count is sent once the records already in the ring have been sent.
+ *
+ * This function can be called from interrupt context.
+ *
+ * @param[in] log Pointer to log object
+ * @param[in] fmt Format string
+ * @param[in] arg0 First argument
+ * @param[in] arg1 Second argument
+ * @param[in] arg2 Third argument
+ * @param[in] arg3 Fourth argument
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_WOULDBLOCK Ring full, record dropped
+ * @retval ATOM_ERR_PARAM Bad parameters
+ * @retval ATOM_ERR_DELETED Log was deleted
+ */
+uint8_t atomLogWrite (ATOM_LOG *log, const char *fmt, uint32_t arg0, uint32_t arg1, uint32_t arg2, uint32_t arg3)
+{
+    CRITICAL_STORE;
+    uint8_t status;
+    ATOM_LOG_RECORD *record;
+
+    /* Parameter check */
+    if ((log == NULL) || (fmt == NULL))
+    {
+        /* Bad parameters */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Protect access to the ring */
+        CRITICAL_START ();
+
+        if (log->records == NULL)
+        {
+            /* Log was deleted */
+            status = ATOM_ERR_DELETED;
+        }
+        else if ((log->insert_count - log->remove_count) > log->index_mask)
+        {
+            /* Ring full, drop the record, noting where the gap starts */
+            if (log->dropped++ == 0)
+            {
+                log->drop_index = log->insert_count;
+                log->drop_time = atomTimeGet();
+            }
+            status = ATOM_WOULDBLOCK;
+        }
+        else
+        {
+            /* Fill in the next free record */
+            record = &log->records[log->insert_count & log->index_mask];
+            record->fmt = fmt;
+            record->timestamp = atomTimeGet();
+            record->args[0] = arg0;
+            record->args[1] = arg1;
+            record->args[2] = arg2;
+            record->args[3] = arg3;
+            log->insert_count++;
+
+            /* Wake the log thread if it is waiting for records */
+            if (log->waiting == TRUE)
+            {
+                log->waiting = FALSE;
+                (void)atomSemPut (&log->sem);
+            }
+
+            /* Successful */
+            status = ATOM_OK;
+        }
+
+        /* Exit critical region */
+        CRITICAL_END ();
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomLogThread
+ *
+ * This is an internal function not for use by application code.
+ *
+ * Entry point for log threads. Waits for records on the ring and sends
+ * them in binary form to the log's output function.
+ *
+ * Records are copied out of the ring inside a critical section so that
+ * the output function, which may be slow or block, is called with the
+ * ring free for writers.
+ *
+ * @param[in] param Unused (the log is found via the thread's TCB)
+ *
+ * @return None
+ */
+static void atomLogThread (uint32_t param)
+{
+    CRITICAL_STORE;
+    ATOM_LOG *log;
+    ATOM_LOG_RECORD record;
+    uint8_t frame[ATOM_LOG_FRAME_SIZE];
+    uint8_t *ptr;
+    unsigned long fmt;
+    unsigned int i;
+
+    /* Our TCB is the first member of our ATOM_LOG structure */
+    log = (ATOM_LOG *)atomCurrentContext();
+
+    /* Avoid compiler warning due to unused parameter */
+    param = param;
+
+    /* Send records until the log is deleted (this thread is terminated) */
+    while (1)
+    {
+        /* Take the count of dropped records, or the next record */
+        CRITICAL_START ();
+        if (log->dropped && (log->remove_count == log->drop_index))
+        {
+            /**
+             * Every record logged before the first drop has been sent, so
+             * report the drops here. The report is a record with no format
+             * string and the count as its first argument.
+             */
+            record.fmt = NULL;
+            record.timestamp = log->drop_time;
+            record.args[0] = log->dropped;
+            for (i = 1; i < ATOM_LOG_NUM_ARGS; i++)
+            {
+                record.args[i] = 0;
+            }
+            log->dropped = 0;
+        }
+        else if (log->insert_count == log->remove_count)
+        {
+            /* Ring empty, wait for atomLogWrite() to wake us */
+            log->waiting = TRUE;
+            CRITICAL_END ();
+            (void)atomSemGet (&log->sem, 0);
+            continue;
+        }
+        else
+        {
+            record = log->records[log->remove_count & log->index_mask];
+            log->remove_count++;
+        }
+        CRITICAL_END ();
+
+        /* Send the record, least significant byte first */
+        frame[0] = ATOM_LOG_SYNC0;
+        frame[1] = ATOM_LOG_SYNC1;
+        ptr = &frame[2];
+        fmt = (unsigned long)record.fmt;
+        for (i = 0; i < ATOM_LOG_ADDR_SIZE; i++)
+        {
+            *ptr++ = (uint8_t)(fmt & 0xFF);
+            fmt >>= 8;
+        }
+        ptr = atomLogPut32 (ptr, record.timestamp);
+        for (i = 0; i < ATOM_LOG_NUM_ARGS; i++)
+        {
+            ptr = atomLogPut32 (ptr, record.args[i]);
+        }
+        log->output (frame, ATOM_LOG_FRAME_SIZE);
+    }
+}
+
+
+/**
+ * \b atomLogPut32
+ *
+ * This is an internal function not for use by application code.
+ *
+ * Stores a 32-bit value least significant byte first.
+ *
+ * @param[in] ptr Pointer to the destination
+ * @param[in] value Value to store
+ *
+ * @return Pointer to the byte following the value
+ */
+static uint8_t *atomLogPut32 (uint8_t *ptr, uint32_t value)
+{
+    *ptr++ = (uint8_t)(value);
+    *ptr++ = (uint8_t)(value >> 8);
+    *ptr++ = (uint8_t)(value >> 16);
+    *ptr++ = (uint8_t)(value >> 24);
+    return (ptr);
+}
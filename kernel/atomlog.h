@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) 2022, Matt Liss
+ * Copyright (c) 2010, Kelvin Lawson. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. No personal names or organizations' names associated with the
+ *    Atomthreads project may be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE ATOMTHREADS PROJECT AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __ATOM_LOG_H
+#define __ATOM_LOG_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "atom.h"
+#include "atomsem.h"
+
+/* Number of raw arguments stored with each log record */
+#define ATOM_LOG_NUM_ARGS       4
+
+/* Sync bytes which start each binary record sent to the output */
+#define ATOM_LOG_SYNC0          0xA5
+#define ATOM_LOG_SYNC1          0x5A
+
+typedef struct atom_log_record
+{
+    const char *fmt;                /* Format string (its address is sent) */
+    uint32_t    timestamp;          /* System tick count when logged */
+    uint32_t    args[ATOM_LOG_NUM_ARGS]; /* Raw arguments */
+} ATOM_LOG_RECORD;
+
+typedef struct atom_log
+{
+    ATOM_TCB    tcb;                /* Output thread TCB (must be first) */
+    ATOM_SEM    sem;                /* Wakes the output thread */
+    ATOM_LOG_RECORD *records;       /* Ring of pending records */
+    uint32_t    index_mask;         /* Capacity - 1 (capacity is a power of two) */
+    uint32_t    insert_count;       /* Free-running count of records logged */
+    uint32_t    remove_count;       /* Free-running count of records sent */
+    uint32_t    dropped;            /* Records lost and not yet reported */
+    uint32_t    drop_index;         /* insert_count when the first of them was lost */
+    uint32_t    drop_time;          /* System tick count when the first was lost */
+    uint8_t     waiting;            /* TRUE if the output thread is waiting */
+    void        (*output)(const uint8_t *data, uint32_t len); /* Output function */
+} ATOM_LOG;
+
+extern uint8_t atomLogCreate (ATOM_LOG *log, ATOM_LOG_RECORD *records, uint32_t max_records, void (*output)(const uint8_t *data, uint32_t len), uint8_t priority, void *stack_bottom, uint32_t stack_size);
+extern uint8_t atomLogDelete (ATOM_LOG *log);
+extern uint8_t atomLogWrite (ATOM_LOG *log, const char *fmt, uint32_t arg0, uint32_t arg1, uint32_t arg2, uint32_t arg3);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __ATOM_LOG_H */
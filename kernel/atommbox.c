@@ -0,0 +1,593 @@
+/*
+ * Copyright (c) 2022, Matt Liss
+ * Copyright (c) 2010, Kelvin Lawson. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. No personal names or organizations' names associated with the
+ *    Atomthreads project may be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE ATOMTHREADS PROJECT AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/**
+ * \file
+ * Mailbox library.
+ *
+ *
+ * This module implements a single-slot "latest value" mailbox with the
+ * following features:
+ *
+ * \par Overwriting puts
+ * A mailbox stores exactly one value. Posting a new value always succeeds
+ * and simply overwrites the previous one, so producers never block and
+ * never fail because a consumer has fallen behind. This suits data such as
+ * sensor samples where only the newest value is of interest.
+ *
+ * \par Sequence numbers
+ * Every put increments the mailbox sequence number. Readers pass in the
+ * sequence number of the last value they saw and are only returned a value
+ * which is newer than that. A sequence number of zero is never assigned to
+ * a stored value, so readers can pass zero to get whatever value is
+ * currently held.
+ *
+ * \par Non-consuming reads
+ * Reading a value does not remove it from the mailbox. Any number of
+ * threads can read the same value, and all threads waiting for a newer
+ * value are woken together when one is posted.
+ *
+ * \par Flexible blocking APIs
+ * Readers can choose whether to block, block with timeout, or not block
+ * and return a relevant status code if no newer value is available.
+ *
+ * \par Interrupt-safe calls
+ * All APIs can be called from interrupt context. Any calls which could
+ * potentially block have optional parameters to prevent blocking if you
+ * wish to call them from interrupt context. Any attempt to make a call
+ * which would block from interrupt context will be automatically and
+ * safely prevented.
+ *
+ * \par Smart mailbox deletion
+ * Where a mailbox is deleted while threads are blocking on it, all blocking
+ * threads are woken and returned a status code to indicate the reason for
+ * being woken.
+ *
+ *
+ * \n <b> Usage instructions: </b> \n
+ *
+ * All mailbox objects must be initialised before use by calling
+ * atomMboxCreate(). Once initialised atomMboxPut() is used to post a new
+ * value and atomMboxGet() to read the latest value.
+ *
+ * Each reader keeps a local copy of the sequence number returned with the
+ * last value it read, and passes it back in on the next call to
+ * atomMboxGet(). If the mailbox already holds a newer value it is copied out
+ * immediately, otherwise the call blocks until atomMboxPut() posts one
+ * (unless the calling parameters request no blocking). If several values are
+ * posted while a reader is not looking, the reader only sees the latest.
+ *
+ * The value copy is carried out with interrupts locked out, so mailboxes are
+ * intended for small values. Larger data can be passed by reference.
+ *
+ * A mailbox which is no longer required can be deleted using
+ * atomMboxDelete(). This function automatically wakes up any threads which
+ * are waiting on the deleted mailbox.
+ *
+ */
+
+
+#include <string.h>
+
+#include "atom.h"
+#include "atommbox.h"
+#include "atomtimer.h"
+
+
+/* Local data types */
+
+typedef struct mbox_timer
+{
+    ATOM_TCB  *tcb_ptr;     /* Thread which is suspended with timeout */
+    ATOM_MBOX *mbox_ptr;    /* Mailbox the thread is suspended on */
+} MBOX_TIMER;
+
+
+/* Forward declarations */
+
+static void atomMboxTimerCallback (POINTER cb_data);
+
+
+/**
+ * \b atomMboxCreate
+ *
+ * Initialises a mailbox object.
+ *
+ * Must be called before calling any other mailbox library routines on a
+ * mailbox. Objects can be deleted later using atomMboxDelete().
+ *
+ * Does not allocate storage, the caller provides the mailbox object and
+ * a storage area of \c unit_size bytes for the current value. The mailbox
+ * starts out empty (sequence number zero).
+ *
+ * This function can be called from interrupt context.
+ *
+ * @param[in] mbox Pointer to mailbox object
+ * @param[in] buff_ptr Pointer to value storage area
+ * @param[in] unit_size Size in bytes of the mailbox value
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_PARAM Bad parameters
+ */
+uint8_t atomMboxCreate (ATOM_MBOX *mbox, uint8_t *buff_ptr, uint32_t unit_size)
+{
+    uint8_t status;
+
+    /* Parameter check */
+    if ((mbox == NULL) || (buff_ptr == NULL) || (unit_size == 0))
+    {
+        /* Bad parameters */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Store the mailbox details */
+        mbox->buff_ptr = buff_ptr;
+        mbox->unit_size = unit_size;
+
+        /* No value posted yet */
+        mbox->seq = 0;
+
+        /* Initialise the suspended threads queue */
+        mbox->suspQ = NULL;
+
+        /* Successful */
+        status = ATOM_OK;
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomMboxDelete
+ *
+ * Deletes a mailbox object.
+ *
+ * Any threads currently suspended on the mailbox will be woken up with
+ * return status ATOM_ERR_DELETED. If called at thread context then the
+ * scheduler will be called during this function which may schedule in one
+ * of the woken threads depending on relative priorities.
+ *
+ * This function can be called from interrupt context. All threads blocking
+ * on the mailbox are woken in a single critical section, without searching
+ * the timer list for their timeouts.
+ *
+ * @param[in] mbox Pointer to mailbox object
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_PARAM Bad parameter
+ */
+uint8_t atomMboxDelete (ATOM_MBOX *mbox)
+{
+    uint8_t status;
+    CRITICAL_STORE;
+    uint8_t woken_threads = FALSE;
+
+    /* Parameter check */
+    if (mbox == NULL)
+    {
+        /* Bad pointer */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Protect access to the mailbox object and OS queues */
+        CRITICAL_START ();
+
+        /* Wake up all suspended tasks in one go */
+        woken_threads = tcbWakeAll (&mbox->suspQ, ATOM_ERR_DELETED);
+
+        /* Exit critical region */
+        CRITICAL_END ();
+
+        /* Successful */
+        status = ATOM_OK;
+
+        /* Call scheduler if any threads were woken up */
+        if (woken_threads == TRUE)
+        {
+            /**
+             * Only call the scheduler if we are in thread context, otherwise
+             * it will be called on exiting the ISR by atomIntExit().
+             */
+            if (atomCurrentContext())
+                atomSched (FALSE);
+        }
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomMboxGet
+ *
+ * Read the latest value from a mailbox.
+ *
+ * On entry \c seq should contain the sequence number of the last value
+ * read by the caller (or zero if no value has been read yet). If the
+ * mailbox holds a value with a different sequence number then it is newer,
+ * and is copied into the passed \c msgptr storage area which should be
+ * large enough to contain \c unit_size bytes. The sequence number of the
+ * value returned is written back to \c seq ready for the next call.
+ *
+ * The value is not consumed, other readers will also see it.
+ *
+ * If no newer value is available, the call will do one of the following
+ * depending on the \c timeout value specified:
+ *
+ * \c timeout == 0 : Call will block until a newer value is posted \n
+ * \c timeout > 0 : Call will block until a newer value or the specified timeout \n
+ * \c timeout == -1 : Return immediately if no newer value is available \n
+ *
+ * If a maximum timeout value is specified (\c timeout > 0), and no newer
+ * value is posted for the specified number of system ticks, the call will
+ * return with \c ATOM_TIMEOUT.
+ *
+ * If several values are posted before a woken reader is scheduled in, the
+ * reader is returned the latest of them.
+ *
+ * This function can only be called from interrupt context if the \c timeout
+ * parameter is -1 (in which case it does not block).
+ *
+ * @param[in] mbox Pointer to mailbox object
+ * @param[in] timeout Max system ticks to block (0 = forever, -1 = no block)
+ * @param[in,out] seq Last sequence number seen, updated with the one returned
+ * @param[out] msgptr Pointer to which the value will be copied
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_TIMEOUT Mailbox wait timed out before being woken
+ * @retval ATOM_WOULDBLOCK Called with timeout == -1 but no newer value
+ * @retval ATOM_ERR_DELETED Mailbox was deleted while suspended
+ * @retval ATOM_ERR_CONTEXT Not called in thread context and attempted to block
+ * @retval ATOM_ERR_PARAM Bad parameter
+ * @retval ATOM_ERR_QUEUE Problem putting the thread on the suspend queue
+ * @retval ATOM_ERR_TIMER Problem registering the timeout
+ */
+uint8_t atomMboxGet (ATOM_MBOX *mbox, int32_t timeout, uint32_t *seq, uint8_t *msgptr)
+{
+    CRITICAL_STORE;
+    uint8_t status;
+    MBOX_TIMER timer_data;
+    ATOM_TIMER timer_cb;
+    ATOM_TCB *curr_tcb_ptr;
+
+    /* Check parameters */
+    if ((mbox == NULL) || (seq == NULL) || (msgptr == NULL))
+    {
+        /* Bad pointer */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Protect access to the mailbox object and OS queues */
+        CRITICAL_START ();
+
+        /* If there is no newer value, block the calling thread */
+        if (mbox->seq == *seq)
+        {
+            /* If called with timeout >= 0, we should block */
+            if (timeout >= 0)
+            {
+                /* No newer value, block the calling thread */
+
+                /* Get the current TCB */
+                curr_tcb_ptr = atomCurrentContext();
+
+                /* Check we are actually in thread context */
+                if (curr_tcb_ptr)
+                {
+                    /* Add current thread to the list waiting for a new value */
+                    if (tcbEnqueuePriority (&mbox->suspQ, curr_tcb_ptr) == ATOM_OK)
+                    {
+                        /* Set suspended status for the current thread */
+                        curr_tcb_ptr->suspended = TRUE;
+
+                        /* Track errors */
+                        status = ATOM_OK;
+
+                        /* Register a timer callback if requested */
+                        if (timeout)
+                        {
+                            /**
+                             * Fill out the data needed by the callback to
+                             * wake us up.
+                             */
+                            timer_data.tcb_ptr = curr_tcb_ptr;
+                            timer_data.mbox_ptr = mbox;
+
+                            /* Fill out the timer callback request structure */
+                            timer_cb.cb_func = atomMboxTimerCallback;
+                            timer_cb.cb_data = (POINTER)&timer_data;
+                            timer_cb.cb_ticks = timeout;
+
+                            /**
+                             * Store the timer details in the TCB so that we
+                             * can cancel the timer callback if a value is
+                             * posted before the timeout occurs.
+                             */
+                            curr_tcb_ptr->suspend_timo_cb = &timer_cb;
+
+                            /* Register a callback on timeout */
+                            if (atomTimerRegister (&timer_cb) != ATOM_OK)
+                            {
+                                /* Timer registration failed */
+                                status = ATOM_ERR_TIMER;
+
+                                /* Clean up and return to the caller */
+                                (void)tcbDequeueEntry (&mbox->suspQ, curr_tcb_ptr);
+                                curr_tcb_ptr->suspended = FALSE;
+                                curr_tcb_ptr->suspend_timo_cb = NULL;
+                            }
+                        }
+
+                        /* Set no timeout requested */
+                        else
+                        {
+                            /* No need to cancel timeouts on this one */
+                            curr_tcb_ptr->suspend_timo_cb = NULL;
+                        }
+
+                        /* Exit critical region */
+                        CRITICAL_END ();
+
+                        /* Check no errors occurred */
+                        if (status == ATOM_OK)
+                        {
+                            /**
+                             * Current thread now blocking, schedule in a new
+                             * one. We already know we are in thread context
+                             * so can call the scheduler from here.
+                             */
+                            atomSched (FALSE);
+
+                            /**
+                             * Normal atomMboxPut() wakeups will set ATOM_OK
+                             * status, while timeouts will set ATOM_TIMEOUT
+                             * and mailbox deletions will set ATOM_ERR_DELETED.
+                             */
+                            status = curr_tcb_ptr->suspend_wake_status;
+
+                            /**
+                             * If we were woken with ATOM_OK then a newer
+                             * value has been posted. Copy out whatever is
+                             * latest now, which may have been overwritten
+                             * again since we were woken.
+                             */
+                            if (status == ATOM_OK)
+                            {
+                                /* Enter critical region */
+                                CRITICAL_START ();
+
+                                /* Copy the value out of the mailbox */
+                                memcpy (msgptr, mbox->buff_ptr, mbox->unit_size);
+                                *seq = mbox->seq;
+
+                                /* Exit critical region */
+                                CRITICAL_END ();
+                            }
+                        }
+                    }
+                    else
+                    {
+                        /* There was an error putting this thread on the suspend list */
+                        CRITICAL_END ();
+                        status = ATOM_ERR_QUEUE;
+                    }
+                }
+                else
+                {
+                    /* Not currently in thread context, can't suspend */
+                    CRITICAL_END ();
+                    status = ATOM_ERR_CONTEXT;
+                }
+            }
+            else
+            {
+                /* timeout == -1, requested not to block and no newer value */
+                CRITICAL_END ();
+                status = ATOM_WOULDBLOCK;
+            }
+        }
+        else
+        {
+            /* No need to block, there is a newer value to copy out */
+            memcpy (msgptr, mbox->buff_ptr, mbox->unit_size);
+            *seq = mbox->seq;
+
+            /* Exit critical region */
+            CRITICAL_END ();
+
+            /* Successful */
+            status = ATOM_OK;
+        }
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomMboxPut
+ *
+ * Post a new value to a mailbox.
+ *
+ * The value is copied from the passed \c msgptr storage area which should
+ * contain \c unit_size bytes, overwriting any previous value. This call
+ * never blocks and never fails due to a slow reader.
+ *
+ * The mailbox sequence number is incremented, and all threads waiting for
+ * a newer value are woken. If called at thread context then the scheduler
+ * will be called which may schedule in one of the woken threads depending
+ * on relative priorities.
+ *
+ * This function can be called from interrupt context, but loops internally
+ * waking up all threads blocking on the mailbox, so the potential
+ * execution cycles cannot be determined in advance.
+ *
+ * @param[in] mbox Pointer to mailbox object
+ * @param[in] msgptr Pointer from which the value should be copied
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_PARAM Bad parameter
+ * @retval ATOM_ERR_QUEUE Problem putting a woken thread on the ready queue
+ */
+uint8_t atomMboxPut (ATOM_MBOX *mbox, uint8_t *msgptr)
+{
+    uint8_t status;
+    CRITICAL_STORE;
+    ATOM_TCB *tcb_ptr;
+    uint8_t woken_threads = FALSE;
+
+    /* Check parameters */
+    if ((mbox == NULL) || (msgptr == NULL))
+    {
+        /* Bad pointer */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Default to success status unless errors occur during wakeup */
+        status = ATOM_OK;
+
+        /* Protect access to the mailbox object and OS queues */
+        CRITICAL_START ();
+
+        /* Overwrite the stored value */
+        memcpy (mbox->buff_ptr, msgptr, mbox->unit_size);
+
+        /* Move on to the next sequence number, skipping zero on wrap */
+        if (++mbox->seq == 0)
+            mbox->seq = 1;
+
+        /**
+         * Wake up all threads waiting for a newer value. Reads do not
+         * consume the value so every waiting thread can be satisfied.
+         * A thread whose timeout cannot be cancelled is already being
+         * called back, so it is left for the callback to wake with
+         * ATOM_TIMEOUT and the remaining threads are still woken.
+         */
+        while ((tcb_ptr = tcbDequeueHead (&mbox->suspQ)) != NULL)
+        {
+            /* If there's a timeout on this suspension, cancel it */
+            if ((tcb_ptr->suspend_timo_cb != NULL)
+                && (atomTimerCancel (tcb_ptr->suspend_timo_cb) != ATOM_OK))
+            {
+                /* The timeout callback will wake this thread */
+                continue;
+            }
+
+            /* Flag as no timeout registered */
+            tcb_ptr->suspend_timo_cb = NULL;
+
+            /* Set OK status to be returned to the waiting thread */
+            tcb_ptr->suspend_wake_status = ATOM_OK;
+
+            /* Move the waiting thread to the ready queue */
+            if (tcbEnqueuePriority (&tcbReadyQ, tcb_ptr) != ATOM_OK)
+            {
+                /* There was a problem putting the thread on the ready queue */
+                status = ATOM_ERR_QUEUE;
+                break;
+            }
+
+            /* Request a reschedule */
+            woken_threads = TRUE;
+        }
+
+        /* Exit critical region */
+        CRITICAL_END ();
+
+        /**
+         * The scheduler may now make a policy decision to thread switch if
+         * we are currently in thread context. If we are in interrupt
+         * context it will be handled by atomIntExit().
+         */
+        if (woken_threads && atomCurrentContext())
+            atomSched (FALSE);
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomMboxTimerCallback
+ *
+ * This is an internal function not for use by application code.
+ *
+ * Timeouts on suspended threads are notified by the timer system through
+ * this generic callback. The timer system calls us back with a pointer to
+ * the relevant \c MBOX_TIMER object which is used to retrieve the
+ * mailbox details.
+ *
+ * @param[in] cb_data Pointer to a MBOX_TIMER object
+ */
+static void atomMboxTimerCallback (POINTER cb_data)
+{
+    MBOX_TIMER *timer_data_ptr;
+    CRITICAL_STORE;
+
+    /* Get the MBOX_TIMER structure pointer */
+    timer_data_ptr = (MBOX_TIMER *)cb_data;
+
+    /* Check parameter is valid */
+    if (timer_data_ptr)
+    {
+        /* Enter critical region */
+        CRITICAL_START ();
+
+        /* Only act if the thread was not woken before we got here */
+        if (timer_data_ptr->tcb_ptr->suspend_timo_cb)
+        {
+            /* Set status to indicate to the waiting thread that it timed out */
+            timer_data_ptr->tcb_ptr->suspend_wake_status = ATOM_TIMEOUT;
+
+            /* Flag as no timeout registered */
+            timer_data_ptr->tcb_ptr->suspend_timo_cb = NULL;
+
+            /* Remove this thread from the mailbox's suspend list */
+            (void)tcbDequeueEntry (&timer_data_ptr->mbox_ptr->suspQ, timer_data_ptr->tcb_ptr);
+
+            /* Put the thread on the ready queue */
+            (void)tcbEnqueuePriority (&tcbReadyQ, timer_data_ptr->tcb_ptr);
+        }
+
+        /* Exit critical region */
+        CRITICAL_END ();
+
+        /**
+         * Note that we don't call the scheduler now as it will be called
+         * when we exit the ISR by atomIntExit().
+         */
+    }
+}
@@ -0,0 +1,55 @@
+/*
+ * Copyright (c) 2022, Matt Liss
+ * Copyright (c) 2010, Kelvin Lawson. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. No personal names or organizations' names associated with the
+ *    Atomthreads project may be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE ATOMTHREADS PROJECT AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __ATOM_MBOX_H
+#define __ATOM_MBOX_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct atom_mbox
+{
+    ATOM_TCB *  suspQ;      /* Queue of threads waiting for a newer value */
+    uint8_t *   buff_ptr;   /* Pointer to value storage area */
+    uint32_t    unit_size;  /* Size of the stored value */
+    uint32_t    seq;        /* Sequence number of stored value (0 = empty) */
+} ATOM_MBOX;
+
+extern uint8_t atomMboxCreate (ATOM_MBOX *mbox, uint8_t *buff_ptr, uint32_t unit_size);
+extern uint8_t atomMboxDelete (ATOM_MBOX *mbox);
+extern uint8_t atomMboxGet (ATOM_MBOX *mbox, int32_t timeout, uint32_t *seq, uint8_t *msgptr);
+extern uint8_t atomMboxPut (ATOM_MBOX *mbox, uint8_t *msgptr);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __ATOM_MBOX_H */
@@ -179,21 +179,18 @@ uint8_t atomMutexCreate (ATOM_MUTEX *mutex)
  * scheduler will be called during this function which may schedule in one
  * of the woken threads depending on relative priorities.
  *
- * This function can be called from interrupt context, but loops internally
- * waking up all threads blocking on the mutex, so the potential
- * execution cycles cannot be determined in advance.
+ * This function can be called from interrupt context. All threads blocking
+ * on the mutex are woken in a single critical section, without searching
+ * the timer list for their timeouts.
  *
  * @param[in] mutex Pointer to mutex object
  *
  * @retval ATOM_OK Success
- * @retval ATOM_ERR_QUEUE Problem putting a woken thread on the ready queue
- * @retval ATOM_ERR_TIMER Problem cancelling a timeout on a woken thread
  */
 uint8_t atomMutexDelete (ATOM_MUTEX *mutex)
 {
     uint8_t status;
     CRITICAL_STORE;
-    ATOM_TCB *tcb_ptr;
     uint8_t woken_threads = FALSE;
 
     /* Parameter check */
@@ -204,69 +201,17 @@ uint8_t atomMutexDelete (ATOM_MUTEX *mutex)
     }
     else
     {
-        /* Default to success status unless errors occur during wakeup */
-        status = ATOM_OK;
-
-        /* Wake up all suspended tasks */
-        while (1)
-        {
-            /* Enter critical region */
-            CRITICAL_START ();
-
-            /* Check if any threads are suspended */
-            tcb_ptr = tcbDequeueHead (&mutex->suspQ);
-
-            /* A thread is suspended on the mutex */
-            if (tcb_ptr)
-            {
-                /* Return error status to the waiting thread */
-                tcb_ptr->suspend_wake_status = ATOM_ERR_DELETED;
-
-                /* Put the thread on the ready queue */
-                if (tcbEnqueuePriority (&tcbReadyQ, tcb_ptr) != ATOM_OK)
-                {
-                    /* Exit critical region */
-                    CRITICAL_END ();
-
-                    /* Quit the loop, returning error */
-                    status = ATOM_ERR_QUEUE;
-                    break;
-                }
-
-                /* If there's a timeout on this suspension, cancel it */
-                if (tcb_ptr->suspend_timo_cb)
-                {
-                    /* Cancel the callback */
-                    if (atomTimerCancel (tcb_ptr->suspend_timo_cb) != ATOM_OK)
-                    {
-                        /* Exit critical region */
-                        CRITICAL_END ();
-
-                        /* Quit the loop, returning error */
-                        status = ATOM_ERR_TIMER;
-                        break;
-                    }
-
-                    /* Flag as no timeout registered */
-                    tcb_ptr->suspend_timo_cb = NULL;
-
-                }
+        /* Protect access to the mutex object and OS queues */
+        CRITICAL_START ();
 
-                /* Exit critical region */
-                CRITICAL_END ();
+        /* Wake up all suspended tasks in one go */
+        woken_threads = tcbWakeAll (&mutex->suspQ, ATOM_ERR_DELETED);
 
-                /* Request a reschedule */
-                woken_threads = TRUE;
-            }
+        /* Exit critical region */
+        CRITICAL_END ();
 
-            /* No more suspended threads */
-            else
-            {
-                /* Exit critical region and quit the loop */
-                CRITICAL_END ();
-                break;
-            }
-        }
+        /* Successful */
+        status = ATOM_OK;
 
         /* Call scheduler if any threads were woken up */
         if (woken_threads == TRUE)
@@ -613,6 +558,13 @@ uint8_t atomMutexPut (ATOM_MUTEX * mutex)
                         {
                             /* There was a problem cancelling a timeout on this mutex */
                             status = ATOM_ERR_TIMER;
+
+                            /**
+                             * The timeout is already being called back. The thread has
+                             * been woken here, so clear the flag to stop the callback
+                             * from acting on it.
+                             */
+                            tcb_ptr->suspend_timo_cb = NULL;
                         }
                         else
                         {
@@ -694,17 +646,21 @@ static void atomMutexTimerCallback (POINTER cb_data)
         /* Enter critical region */
         CRITICAL_START ();
 
-        /* Set status to indicate to the waiting thread that it timed out */
-        timer_data_ptr->tcb_ptr->suspend_wake_status = ATOM_TIMEOUT;
+        /* Only act if the thread was not woken before we got here */
+        if (timer_data_ptr->tcb_ptr->suspend_timo_cb)
+        {
+            /* Set status to indicate to the waiting thread that it timed out */
+            timer_data_ptr->tcb_ptr->suspend_wake_status = ATOM_TIMEOUT;
 
-        /* Flag as no timeout registered */
-        timer_data_ptr->tcb_ptr->suspend_timo_cb = NULL;
+            /* Flag as no timeout registered */
+            timer_data_ptr->tcb_ptr->suspend_timo_cb = NULL;
 
-        /* Remove this thread from the mutex's suspend list */
-        (void)tcbDequeueEntry (&timer_data_ptr->mutex_ptr->suspQ, timer_data_ptr->tcb_ptr);
+            /* Remove this thread from the mutex's suspend list */
+            (void)tcbDequeueEntry (&timer_data_ptr->mutex_ptr->suspQ, timer_data_ptr->tcb_ptr);
 
-        /* Put the thread on the ready queue */
-        (void)tcbEnqueuePriority (&tcbReadyQ, timer_data_ptr->tcb_ptr);
+            /* Put the thread on the ready queue */
+            (void)tcbEnqueuePriority (&tcbReadyQ, timer_data_ptr->tcb_ptr);
+        }
 
         /* Exit critical region */
         CRITICAL_END ();
@@ -0,0 +1,728 @@
+/*
+ * Copyright (c) 2022, Matt Liss
+ * Copyright (c) 2010, Kelvin Lawson. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. No personal names or organizations' names associated with the
+ *    Atomthreads project may be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE ATOMTHREADS PROJECT AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/**
+ * \file
+ * Buffer pool library.
+ *
+ *
+ * This module implements pools of fixed-size, reference-counted message
+ * buffers with the following features:
+ *
+ * \par Zero-copy message passing
+ * Buffers are passed between threads by queueing a pointer to the buffer
+ * rather than copying its contents, so large messages (e.g. video frames)
+ * are never copied by the kernel.
+ *
+ * \par Reference counting
+ * Each buffer carries a reference count. A producer can hand the same
+ * buffer to several consumers, each of which holds its own reference, and
+ * the buffer is returned to its pool automatically when the last reference
+ * is released.
+ *
+ * \par Flexible blocking APIs
+ * Threads which wish to allocate a buffer when the pool is exhausted can
+ * choose whether to block, block with timeout, or not block and return a
+ * relevant status code.
+ *
+ * \par Interrupt-safe calls
+ * All APIs can be called from interrupt context. Any calls which could
+ * potentially block have optional parameters to prevent blocking if you
+ * wish to call them from interrupt context. Any attempt to make a call
+ * which would block from interrupt context will be automatically and
+ * safely prevented.
+ *
+ * \par Priority-based queueing
+ * Where multiple threads are blocking waiting for a buffer, they are handed
+ * freed buffers in order of the threads' priorities. Where multiple threads
+ * of the same priority are blocking, they are served in FIFO order.
+ *
+ * \par Smart pool deletion
+ * Where a pool is deleted while threads are blocking on it, all blocking
+ * threads are woken and returned a status code to indicate the reason for
+ * being woken.
+ *
+ *
+ * \n <b> Usage instructions: </b> \n
+ *
+ * All pool objects must be initialised before use by calling
+ * atomPoolCreate(). The caller provides a storage area large enough for
+ * the buffers plus a small header for each, which can be sized using the
+ * ATOM_POOL_STORAGE_SIZE() macro. The storage area must be aligned
+ * suitably for the messages to be stored in the buffers, for example by
+ * declaring it as an array of \c uint32_t.
+ *
+ * A buffer is obtained by calling atomPoolAlloc(), which returns a pointer
+ * to the buffer holding a single reference. If the pool is empty the caller
+ * will block until a buffer is released (by default), or can request not to
+ * block.
+ *
+ * Buffers are passed through ordinary queues (see atomqueue.c) created with
+ * \c unit_size of \c sizeof(void *), by posting the address of the buffer
+ * pointer with atomQueuePut(). Each consumer takes ownership of one
+ * reference with the buffer, and calls atomPoolRelease() once it has
+ * finished with it. To send one buffer to several consumers the producer
+ * calls atomPoolRetain() once per queue before posting to it, then releases
+ * its own reference after posting to all of them:
+ *
+ * \code
+ * if (atomPoolAlloc (&pool, 0, &buff) == ATOM_OK)
+ * {
+ *     fill_frame (buff);
+ *     for (i = 0; i < NUM_CONSUMERS; i++)
+ *     {
+ *         atomPoolRetain (buff);
+ *         if (atomQueuePut (&consumer_q[i], -1, (uint8_t *)&buff) != ATOM_OK)
+ *             atomPoolRelease (buff);
+ *     }
+ *     atomPoolRelease (buff);
+ * }
+ * \endcode
+ *
+ * Buffers shared between several consumers should be treated as read-only
+ * by them, as there is no locking of the buffer contents.
+ *
+ * A pool which is no longer required can be deleted using atomPoolDelete().
+ * This function automatically wakes up any threads which are waiting on the
+ * deleted pool. The application must ensure that no buffers from a deleted
+ * pool are still in use.
+ *
+ */
+
+
+#include "atom.h"
+#include "atompool.h"
+#include "atomtimer.h"
+
+
+/* Local data types */
+
+typedef struct pool_timer
+{
+    ATOM_TCB  *tcb_ptr;     /* Thread which is suspended with timeout */
+    ATOM_POOL *pool_ptr;    /* Pool the thread is suspended on */
+} POOL_TIMER;
+
+
+/* Constants */
+
+/** Largest number of references which can be held on one buffer */
+#define POOL_MAX_REF_COUNT      0xFFFF
+
+
+/* Forward declarations */
+
+static void atomPoolTimerCallback (POINTER cb_data);
+
+
+/**
+ * \b atomPoolCreate
+ *
+ * Initialises a buffer pool object.
+ *
+ * Must be called before calling any other pool library routines on a pool.
+ * Objects can be deleted later using atomPoolDelete().
+ *
+ * Does not allocate storage, the caller provides the pool object and a
+ * storage area of at least ATOM_POOL_STORAGE_SIZE(\c buff_size,
+ * \c num_buffs) bytes, which is carved up into \c num_buffs buffers each
+ * of \c buff_size usable bytes. All buffers start out free.
+ *
+ * This function can be called from interrupt context.
+ *
+ * @param[in] pool Pointer to pool object
+ * @param[in] storage Pointer to buffer storage area
+ * @param[in] buff_size Usable size in bytes of each buffer
+ * @param[in] num_buffs Number of buffers in the pool
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_PARAM Bad parameters
+ */
+uint8_t atomPoolCreate (ATOM_POOL *pool, void *storage, uint32_t buff_size, uint32_t num_buffs)
+{
+    uint8_t status;
+    uint8_t *next_ptr;
+    ATOM_POOL_HDR *hdr_ptr;
+
+    /* Parameter check */
+    if ((pool == NULL) || (storage == NULL) || (buff_size == 0) || (num_buffs == 0))
+    {
+        /* Bad parameters */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Store the pool details */
+        pool->buff_size = buff_size;
+        pool->num_free = num_buffs;
+
+        /* Initialise the suspended threads queue */
+        pool->suspQ = NULL;
+
+        /**
+         * Carve the storage area into buffers, each preceded by its header,
+         * and chain them all onto the free list.
+         */
+        pool->free_list = NULL;
+        next_ptr = (uint8_t *)storage;
+        while (num_buffs--)
+        {
+            hdr_ptr = (ATOM_POOL_HDR *)next_ptr;
+            hdr_ptr->pool = pool;
+            hdr_ptr->ref_count = 0;
+            hdr_ptr->next_free = pool->free_list;
+            pool->free_list = hdr_ptr;
+            next_ptr += sizeof(ATOM_POOL_HDR) + ATOM_POOL_BUFF_ALIGN(buff_size);
+        }
+
+        /* Successful */
+        status = ATOM_OK;
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomPoolDelete
+ *
+ * Deletes a buffer pool object.
+ *
+ * Any threads currently suspended on the pool will be woken up with
+ * return status ATOM_ERR_DELETED. If called at thread context then the
+ * scheduler will be called during this function which may schedule in one
+ * of the woken threads depending on relative priorities.
+ *
+ * Buffers still held by the application are not tracked, the application
+ * must not use them after the pool is deleted.
+ *
+ * This function can be called from interrupt context. All threads blocking
+ * on the pool are woken in a single critical section, without searching
+ * the timer list for their timeouts.
+ *
+ * @param[in] pool Pointer to pool object
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_PARAM Bad parameter
+ */
+uint8_t atomPoolDelete (ATOM_POOL *pool)
+{
+    uint8_t status;
+    CRITICAL_STORE;
+    uint8_t woken_threads = FALSE;
+
+    /* Parameter check */
+    if (pool == NULL)
+    {
+        /* Bad pointer */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Protect access to the pool object and OS queues */
+        CRITICAL_START ();
+
+        /* Wake up all suspended tasks in one go */
+        woken_threads = tcbWakeAll (&pool->suspQ, ATOM_ERR_DELETED);
+
+        /* Exit critical region */
+        CRITICAL_END ();
+
+        /* Successful */
+        status = ATOM_OK;
+
+        /* Call scheduler if any threads were woken up */
+        if (woken_threads == TRUE)
+        {
+            /**
+             * Only call the scheduler if we are in thread context, otherwise
+             * it will be called on exiting the ISR by atomIntExit().
+             */
+            if (atomCurrentContext())
+                atomSched (FALSE);
+        }
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomPoolAlloc
+ *
+ * Allocate a buffer from a pool.
+ *
+ * On success a pointer to the usable area of the buffer is written to
+ * \c buff_ptr. The buffer is returned holding a single reference, owned by
+ * the caller, which must eventually be released by atomPoolRelease()
+ * (either by the caller or by whoever it passes the buffer on to).
+ *
+ * If the pool is currently empty, the call will do one of the following
+ * depending on the \c timeout value specified:
+ *
+ * \c timeout == 0 : Call will block until a buffer is released \n
+ * \c timeout > 0 : Call will block until a buffer or the specified timeout \n
+ * \c timeout == -1 : Return immediately if no buffer is free \n
+ *
+ * If a maximum timeout value is specified (\c timeout > 0), and no buffer
+ * is released for the specified number of system ticks, the call will
+ * return with \c ATOM_TIMEOUT.
+ *
+ * This function can only be called from interrupt context if the \c timeout
+ * parameter is -1 (in which case it does not block).
+ *
+ * @param[in] pool Pointer to pool object
+ * @param[in] timeout Max system ticks to block (0 = forever, -1 = no block)
+ * @param[out] buff_ptr Pointer to which the buffer address will be written
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_TIMEOUT Pool wait timed out before being woken
+ * @retval ATOM_WOULDBLOCK Called with timeout == -1 but pool was empty
+ * @retval ATOM_ERR_DELETED Pool was deleted while suspended
+ * @retval ATOM_ERR_CONTEXT Not called in thread context and attempted to block
+ * @retval ATOM_ERR_PARAM Bad parameter
+ * @retval ATOM_ERR_QUEUE Problem putting the thread on the suspend queue
+ * @retval ATOM_ERR_TIMER Problem registering the timeout
+ */
+uint8_t atomPoolAlloc (ATOM_POOL *pool, int32_t timeout, void **buff_ptr)
+{
+    CRITICAL_STORE;
+    uint8_t status;
+    POOL_TIMER timer_data;
+    ATOM_TIMER timer_cb;
+    ATOM_TCB *curr_tcb_ptr;
+    ATOM_POOL_HDR *hdr_ptr;
+
+    /* Check parameters */
+    if ((pool == NULL) || (buff_ptr == NULL))
+    {
+        /* Bad pointer */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Protect access to the pool object and OS queues */
+        CRITICAL_START ();
+
+        /* If no buffers are free, block the calling thread */
+        if (pool->free_list == NULL)
+        {
+            /* If called with timeout >= 0, we should block */
+            if (timeout >= 0)
+            {
+                /* Pool is empty, block the calling thread */
+
+                /* Get the current TCB */
+                curr_tcb_ptr = atomCurrentContext();
+
+                /* Check we are actually in thread context */
+                if (curr_tcb_ptr)
+                {
+                    /* Add current thread to the list waiting for a buffer */
+                    if (tcbEnqueuePriority (&pool->suspQ, curr_tcb_ptr) == ATOM_OK)
+                    {
+                        /* Set suspended status for the current thread */
+                        curr_tcb_ptr->suspended = TRUE;
+
+                        /* Track errors */
+                        status = ATOM_OK;
+
+                        /* Register a timer callback if requested */
+                        if (timeout)
+                        {
+                            /**
+                             * Fill out the data needed by the callback to
+                             * wake us up.
+                             */
+                            timer_data.tcb_ptr = curr_tcb_ptr;
+                            timer_data.pool_ptr = pool;
+
+                            /* Fill out the timer callback request structure */
+                            timer_cb.cb_func = atomPoolTimerCallback;
+                            timer_cb.cb_data = (POINTER)&timer_data;
+                            timer_cb.cb_ticks = timeout;
+
+                            /**
+                             * Store the timer details in the TCB so that we
+                             * can cancel the timer callback if a buffer is
+                             * released before the timeout occurs.
+                             */
+                            curr_tcb_ptr->suspend_timo_cb = &timer_cb;
+
+                            /* Register a callback on timeout */
+                            if (atomTimerRegister (&timer_cb) != ATOM_OK)
+                            {
+                                /* Timer registration failed */
+                                status = ATOM_ERR_TIMER;
+
+                                /* Clean up and return to the caller */
+                                (void)tcbDequeueEntry (&pool->suspQ, curr_tcb_ptr);
+                                curr_tcb_ptr->suspended = FALSE;
+                                curr_tcb_ptr->suspend_timo_cb = NULL;
+                            }
+                        }
+
+                        /* Set no timeout requested */
+                        else
+                        {
+                            /* No need to cancel timeouts on this one */
+                            curr_tcb_ptr->suspend_timo_cb = NULL;
+                        }
+
+                        /* Exit critical region */
+                        CRITICAL_END ();
+
+                        /* Check no errors occurred */
+                        if (status == ATOM_OK)
+                        {
+                            /**
+                             * Current thread now blocking, schedule in a new
+                             * one. We already know we are in thread context
+                             * so can call the scheduler from here.
+                             */
+                            atomSched (FALSE);
+
+                            /**
+                             * Normal atomPoolRelease() wakeups will set
+                             * ATOM_OK status, while timeouts will set
+                             * ATOM_TIMEOUT and pool deletions will set
+                             * ATOM_ERR_DELETED.
+                             */
+                            status = curr_tcb_ptr->suspend_wake_status;
+
+                            /**
+                             * If we were woken with ATOM_OK then the
+                             * releasing thread handed its buffer straight
+                             * to us (with a fresh reference) so that it
+                             * could not be taken by another thread before
+                             * we were scheduled in.
+                             */
+                            if (status == ATOM_OK)
+                            {
+                                *buff_ptr = curr_tcb_ptr->suspend_data;
+                            }
+                            curr_tcb_ptr->suspend_data = NULL;
+                        }
+                    }
+                    else
+                    {
+                        /* There was an error putting this thread on the suspend list */
+                        CRITICAL_END ();
+                        status = ATOM_ERR_QUEUE;
+                    }
+                }
+                else
+                {
+                    /* Not currently in thread context, can't suspend */
+                    CRITICAL_END ();
+                    status = ATOM_ERR_CONTEXT;
+                }
+            }
+            else
+            {
+                /* timeout == -1, requested not to block and pool is empty */
+                CRITICAL_END ();
+                status = ATOM_WOULDBLOCK;
+            }
+        }
+        else
+        {
+            /* No need to block, take the first free buffer */
+            hdr_ptr = pool->free_list;
+            pool->free_list = hdr_ptr->next_free;
+            pool->num_free--;
+            hdr_ptr->ref_count = 1;
+
+            /* Exit critical region */
+            CRITICAL_END ();
+
+            /* The usable area follows the buffer header */
+            *buff_ptr = (void *)(hdr_ptr + 1);
+
+            /* Successful */
+            status = ATOM_OK;
+        }
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomPoolRetain
+ *
+ * Take an additional reference on a buffer.
+ *
+ * Must be called on a buffer which is already allocated, by a holder of an
+ * existing reference, typically once for each extra consumer the buffer is
+ * to be passed to. Each reference taken must eventually be released using
+ * atomPoolRelease().
+ *
+ * This function can be called from interrupt context.
+ *
+ * @param[in] buff Pointer to a buffer returned by atomPoolAlloc()
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_PARAM Bad parameter or buffer is not allocated
+ * @retval ATOM_ERR_OVF The maximum reference count was exceeded
+ */
+uint8_t atomPoolRetain (void *buff)
+{
+    CRITICAL_STORE;
+    uint8_t status;
+    ATOM_POOL_HDR *hdr_ptr;
+
+    /* Check parameters */
+    if (buff == NULL)
+    {
+        /* Bad pointer */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* The buffer header sits immediately before the usable area */
+        hdr_ptr = ((ATOM_POOL_HDR *)buff) - 1;
+
+        /* Protect access to the reference count */
+        CRITICAL_START ();
+
+        /* Check the buffer is actually in use */
+        if (hdr_ptr->ref_count == 0)
+        {
+            /* Buffer is on the free list */
+            status = ATOM_ERR_PARAM;
+        }
+        else if (hdr_ptr->ref_count == POOL_MAX_REF_COUNT)
+        {
+            /* Reference count would overflow */
+            status = ATOM_ERR_OVF;
+        }
+        else
+        {
+            /* Add the reference */
+            hdr_ptr->ref_count++;
+
+            /* Successful */
+            status = ATOM_OK;
+        }
+
+        /* Exit critical region */
+        CRITICAL_END ();
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomPoolRelease
+ *
+ * Release a reference on a buffer.
+ *
+ * When the last reference is released the buffer is returned to its pool.
+ * If any threads are blocking in atomPoolAlloc() waiting for a buffer, it
+ * is handed directly to the highest priority waiting thread rather than
+ * going back on the free list. If called at thread context then the
+ * scheduler will then be called which may schedule in the woken thread
+ * depending on relative priorities.
+ *
+ * The caller must not access the buffer after releasing its reference.
+ *
+ * This function can be called from interrupt context.
+ *
+ * @param[in] buff Pointer to a buffer returned by atomPoolAlloc()
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_PARAM Bad parameter or buffer is not allocated
+ * @retval ATOM_ERR_QUEUE Problem putting a woken thread on the ready queue
+ */
+uint8_t atomPoolRelease (void *buff)
+{
+    CRITICAL_STORE;
+    uint8_t status;
+    ATOM_POOL_HDR *hdr_ptr;
+    ATOM_POOL *pool;
+    ATOM_TCB *tcb_ptr;
+    uint8_t woken_threads = FALSE;
+
+    /* Check parameters */
+    if (buff == NULL)
+    {
+        /* Bad pointer */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* The buffer header sits immediately before the usable area */
+        hdr_ptr = ((ATOM_POOL_HDR *)buff) - 1;
+        pool = hdr_ptr->pool;
+
+        /* Protect access to the pool object and OS queues */
+        CRITICAL_START ();
+
+        /* Check the buffer is actually in use */
+        if (hdr_ptr->ref_count == 0)
+        {
+            /* Buffer is already on the free list */
+            status = ATOM_ERR_PARAM;
+        }
+
+        /* Drop the reference, nothing more to do if others remain */
+        else if (--hdr_ptr->ref_count != 0)
+        {
+            /* Successful */
+            status = ATOM_OK;
+        }
+
+        /**
+         * Last reference released, hand to a waiting thread if any. The
+         * buffer is only handed over once the thread's timeout has been
+         * cancelled. A timeout which cannot be cancelled is already being
+         * called back and will wake the thread with ATOM_TIMEOUT, so that
+         * thread is passed over for the next waiting thread.
+         */
+        else
+        {
+            while ((tcb_ptr = tcbDequeueHead (&pool->suspQ)) != NULL)
+            {
+                if ((tcb_ptr->suspend_timo_cb == NULL)
+                    || (atomTimerCancel (tcb_ptr->suspend_timo_cb) == ATOM_OK))
+                {
+                    /* Flag as no timeout registered */
+                    tcb_ptr->suspend_timo_cb = NULL;
+                    break;
+                }
+            }
+
+            if (tcb_ptr)
+            {
+                /* The waiting thread takes a fresh reference on the buffer */
+                hdr_ptr->ref_count = 1;
+                tcb_ptr->suspend_data = buff;
+
+                /* Set OK status to be returned to the waiting thread */
+                tcb_ptr->suspend_wake_status = ATOM_OK;
+
+                /* Move the waiting thread to the ready queue */
+                if (tcbEnqueuePriority (&tcbReadyQ, tcb_ptr) != ATOM_OK)
+                {
+                    /* There was a problem putting the thread on the ready queue */
+                    status = ATOM_ERR_QUEUE;
+                }
+                else
+                {
+                    /* Successful */
+                    status = ATOM_OK;
+
+                    /* Request a reschedule */
+                    woken_threads = TRUE;
+                }
+            }
+
+            /* Nobody waiting, return the buffer to the free list */
+            else
+            {
+                hdr_ptr->next_free = pool->free_list;
+                pool->free_list = hdr_ptr;
+                pool->num_free++;
+
+                /* Successful */
+                status = ATOM_OK;
+            }
+        }
+
+        /* Exit critical region */
+        CRITICAL_END ();
+
+        /**
+         * The scheduler may now make a policy decision to thread switch if
+         * we are currently in thread context. If we are in interrupt
+         * context it will be handled by atomIntExit().
+         */
+        if (woken_threads && atomCurrentContext())
+            atomSched (FALSE);
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomPoolTimerCallback
+ *
+ * This is an internal function not for use by application code.
+ *
+ * Timeouts on suspended threads are notified by the timer system through
+ * this generic callback. The timer system calls us back with a pointer to
+ * the relevant \c POOL_TIMER object which is used to retrieve the
+ * pool details.
+ *
+ * @param[in] cb_data Pointer to a POOL_TIMER object
+ */
+static void atomPoolTimerCallback (POINTER cb_data)
+{
+    POOL_TIMER *timer_data_ptr;
+    CRITICAL_STORE;
+
+    /* Get the POOL_TIMER structure pointer */
+    timer_data_ptr = (POOL_TIMER *)cb_data;
+
+    /* Check parameter is valid */
+    if (timer_data_ptr)
+    {
+        /* Enter critical region */
+        CRITICAL_START ();
+
+        /* Only act if the thread was not woken before we got here */
+        if (timer_data_ptr->tcb_ptr->suspend_timo_cb)
+        {
+            /* Set status to indicate to the waiting thread that it timed out */
+            timer_data_ptr->tcb_ptr->suspend_wake_status = ATOM_TIMEOUT;
+
+            /* Flag as no timeout registered */
+            timer_data_ptr->tcb_ptr->suspend_timo_cb = NULL;
+
+            /* Remove this thread from the pool's suspend list */
+            (void)tcbDequeueEntry (&timer_data_ptr->pool_ptr->suspQ, timer_data_ptr->tcb_ptr);
+
+            /* Put the thread on the ready queue */
+            (void)tcbEnqueuePriority (&tcbReadyQ, timer_data_ptr->tcb_ptr);
+        }
+
+        /* Exit critical region */
+        CRITICAL_END ();
+
+        /**
+         * Note that we don't call the scheduler now as it will be called
+         * when we exit the ISR by atomIntExit().
+         */
+    }
+}
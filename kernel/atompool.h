@@ -0,0 +1,71 @@
+/*
+ * Copyright (c) 2022, Matt Liss
+ * Copyright (c) 2010, Kelvin Lawson. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. No personal names or organizations' names associated with the
+ *    Atomthreads project may be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE ATOMTHREADS PROJECT AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __ATOM_POOL_H
+#define __ATOM_POOL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct atom_pool_hdr
+{
+    struct atom_pool *pool;             /* Pool the buffer belongs to */
+    struct atom_pool_hdr *next_free;    /* Next buffer on the free list */
+    uint16_t    ref_count;              /* References held (0 = free) */
+} ATOM_POOL_HDR;
+
+typedef struct atom_pool
+{
+    ATOM_TCB *  suspQ;          /* Queue of threads waiting for a buffer */
+    ATOM_POOL_HDR *free_list;   /* List of free buffers */
+    uint32_t    buff_size;      /* Usable size of each buffer */
+    uint32_t    num_free;       /* Number of buffers on the free list */
+} ATOM_POOL;
+
+/* Buffer size rounded up so that each buffer header stays aligned */
+#define ATOM_POOL_BUFF_ALIGN(buff_size) \
+    (((buff_size) + sizeof(POINTER) - 1) & ~(sizeof(POINTER) - 1))
+
+/* Size in bytes of the storage area needed for a pool */
+#define ATOM_POOL_STORAGE_SIZE(buff_size, num_buffs) \
+    ((num_buffs) * (sizeof(ATOM_POOL_HDR) + ATOM_POOL_BUFF_ALIGN(buff_size)))
+
+extern uint8_t atomPoolCreate (ATOM_POOL *pool, void *storage, uint32_t buff_size, uint32_t num_buffs);
+extern uint8_t atomPoolDelete (ATOM_POOL *pool);
+extern uint8_t atomPoolAlloc (ATOM_POOL *pool, int32_t timeout, void **buff_ptr);
+extern uint8_t atomPoolRetain (void *buff);
+extern uint8_t atomPoolRelease (void *buff);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __ATOM_POOL_H */
@@ -75,4 +75,35 @@
 /* #define ATOM_STACK_CHECKING */
 
 
+/**
+ * Optional: earliest-deadline-first scheduling within a priority band.
+ * Threads with priorities from ATOM_EDF_PRIO_HIGH to ATOM_EDF_PRIO_LOW
+ * are ordered by the absolute deadline set with atomThreadSetDeadline()
+ * instead of by priority. Adds a deadline to each TCB.
+ */
+/* #define ATOM_EDF */
+/* #define ATOM_EDF_PRIO_HIGH           64 */
+/* #define ATOM_EDF_PRIO_LOW            127 */
+
+
+/**
+ * Optional: time partitioning. If defined, threads are assigned to one of
+ * ATOM_NUM_PARTITIONS partitions with atomThreadSetPartition(). Partition 0
+ * is the system partition and may always run, other partitions only run
+ * during their windows in the table set by atomPartitionScheduleSet().
+ */
+/* #define ATOM_NUM_PARTITIONS          4 */
+
+
+/**
+ * Optional: enable and disable interrupts around deferred interrupt
+ * handlers (soft IRQs), which are run from the outermost atomIntExit().
+ * Define these if interrupt handlers run with interrupts disabled and the
+ * port can safely allow nested interrupts at that point. If not defined,
+ * deferred handlers run with the interrupt state of the interrupt handler.
+ */
+/* #define ATOM_SOFTIRQ_INT_ENABLE()    sei() */
+/* #define ATOM_SOFTIRQ_INT_DISABLE()   cli() */
+
+
 #endif /* __ATOM_PORT_H */
@@ -0,0 +1,782 @@
+/*
+ * Copyright (c) 2022, Matt Liss
+ * Copyright (c) 2010, Kelvin Lawson. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. No personal names or organizations' names associated with the
+ *    Atomthreads project may be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE ATOMTHREADS PROJECT AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/**
+ * \file
+ * Pointer queue library.
+ *
+ *
+ * This module implements a lightweight variant of the queue library
+ * (atomqueue.c) specialised for the common case of passing a single
+ * pointer (or pointer-sized value) between threads, with the following
+ * features:
+ *
+ * \par Word-sized messages
+ * Each message is one \c POINTER, passed by value. Messages are stored in
+ * an array of \c POINTER and moved with single word assignments rather
+ * than a \c memcpy() of a run-time message size.
+ *
+ * \par Power-of-two capacity
+ * Queue capacity must be a power of two. The insert and remove positions
+ * are free-running counters masked down to an array index, so there is no
+ * byte offset arithmetic or wrap comparison, and the number of messages
+ * stored is simply the difference of the two counters.
+ *
+ * \par Direct handoff to waiting threads
+ * If a receiver is already blocked on an empty queue, a message being put
+ * is handed straight to the receiver without touching the queue buffer.
+ * Likewise when a message is removed from a full queue with a sender
+ * blocked on it, the blocked sender's message is moved into the queue
+ * immediately so that the sender's call has completed by the time it is
+ * woken, and message order is preserved.
+ *
+ * \par Flexible blocking APIs
+ * Threads which wish to make a call which may block can choose whether to
+ * block, block with timeout, or not block and return a relevent status
+ * code.
+ *
+ * \par Interrupt-safe calls
+ * All APIs can be called from interrupt context. Any calls which could
+ * potentially block have optional parameters to prevent blocking if you
+ * wish to call them from interrupt context. Any attempt to make a call
+ * which would block from interrupt context will be automatically and
+ * safely prevented.
+ *
+ * \par Priority-based queueing
+ * Where multiple threads are blocking on a queue, they are woken in order of
+ * the threads' priorities. Where multiple threads of the same priority are
+ * blocking, they are woken in FIFO order.
+ *
+ * \par Smart queue deletion
+ * Where a queue is deleted while threads are blocking on it, all blocking
+ * threads are woken and returned a status code to indicate the reason for
+ * being woken.
+ *
+ *
+ * \n <b> Usage instructions: </b> \n
+ *
+ * All pointer queue objects must be initialised before use by calling
+ * atomPtrQueueCreate(), passing an array of \c POINTER for the queue
+ * storage whose number of entries is a power of two. Once initialised
+ * atomPtrQueuePut() and atomPtrQueueGet() are used to send and receive
+ * messages via the queue respectively, with the same blocking behaviour
+ * as atomQueuePut() and atomQueueGet().
+ *
+ * Pointer queues suit passing buffer pointers (for example buffers from a
+ * buffer pool, see atompool.c) or small integer values cast to \c POINTER.
+ * Where larger messages, urgent or priority messages, or peeking are
+ * required, use the full queue library instead.
+ *
+ * A queue which is no longer required can be deleted using
+ * atomPtrQueueDelete(). This function automatically wakes up any threads
+ * which are waiting on the deleted queue.
+ *
+ */
+
+
+#include "atom.h"
+#include "atomptrqueue.h"
+#include "atomtimer.h"
+
+
+/* Local data types */
+
+typedef struct ptr_queue_timer
+{
+    ATOM_TCB   *tcb_ptr;    /* Thread which is suspended with timeout */
+    ATOM_TCB   **suspQ;     /* TCB queue which thread is suspended on */
+} PTR_QUEUE_TIMER;
+
+
+/* Forward declarations */
+
+static uint8_t ptr_queue_wake (ATOM_TCB *tcb_ptr, uint8_t wake_status);
+static void atomPtrQueueTimerCallback (POINTER cb_data);
+
+
+/**
+ * \b atomPtrQueueCreate
+ *
+ * Initialises a pointer queue object.
+ *
+ * Must be called before calling any other pointer queue library routines
+ * on a queue. Objects can be deleted later using atomPtrQueueDelete().
+ *
+ * Does not allocate storage, the caller provides the queue object and an
+ * array of \c max_num_msgs entries of type \c POINTER for the queue
+ * contents. \c max_num_msgs must be a power of two.
+ *
+ * This function can be called from interrupt context.
+ *
+ * @param[in] qptr Pointer to queue object
+ * @param[in] buff_ptr Pointer to queue storage array
+ * @param[in] max_num_msgs Number of entries in the storage array
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_PARAM Bad parameters
+ */
+uint8_t atomPtrQueueCreate (ATOM_PTR_QUEUE *qptr, POINTER *buff_ptr, uint32_t max_num_msgs)
+{
+    uint8_t status;
+
+    /* Parameter check */
+    if ((qptr == NULL) || (buff_ptr == NULL))
+    {
+        /* Bad pointers */
+        status = ATOM_ERR_PARAM;
+    }
+    else if ((max_num_msgs == 0) || ((max_num_msgs & (max_num_msgs - 1)) != 0))
+    {
+        /* Capacity must be a non-zero power of two */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Store the queue details */
+        qptr->buff_ptr = buff_ptr;
+        qptr->index_mask = max_num_msgs - 1;
+
+        /* Initialise the suspended threads queues */
+        qptr->putSuspQ = NULL;
+        qptr->getSuspQ = NULL;
+
+        /* Queue starts out empty */
+        qptr->insert_count = 0;
+        qptr->remove_count = 0;
+
+        /* Successful */
+        status = ATOM_OK;
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomPtrQueueDelete
+ *
+ * Deletes a pointer queue object.
+ *
+ * Any threads currently suspended on the queue will be woken up with
+ * return status ATOM_ERR_DELETED. If called at thread context then the
+ * scheduler will be called during this function which may schedule in one
+ * of the woken threads depending on relative priorities.
+ *
+ * This function can be called from interrupt context. All threads blocking
+ * on the queue are woken in a single critical section, without searching
+ * the timer list for their timeouts.
+ *
+ * @param[in] qptr Pointer to queue object
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_PARAM Bad parameter
+ */
+uint8_t atomPtrQueueDelete (ATOM_PTR_QUEUE *qptr)
+{
+    uint8_t status;
+    CRITICAL_STORE;
+    uint8_t woken_threads = FALSE;
+
+    /* Parameter check */
+    if (qptr == NULL)
+    {
+        /* Bad pointer */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Protect access to the queue object and OS queues */
+        CRITICAL_START ();
+
+        /* Wake up all suspended tasks in one go */
+        if (tcbWakeAll (&qptr->getSuspQ, ATOM_ERR_DELETED))
+            woken_threads = TRUE;
+        if (tcbWakeAll (&qptr->putSuspQ, ATOM_ERR_DELETED))
+            woken_threads = TRUE;
+
+        /* Exit critical region */
+        CRITICAL_END ();
+
+        /* Successful */
+        status = ATOM_OK;
+
+        /**
+         * Only call the scheduler if we are in thread context, otherwise
+         * it will be called on exiting the ISR by atomIntExit().
+         */
+        if (woken_threads && atomCurrentContext())
+            atomSched (FALSE);
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomPtrQueueGet
+ *
+ * Attempt to retrieve a message from a pointer queue.
+ *
+ * Retrieves one message at a time, in FIFO order, and writes it to the
+ * passed \c msgptr.
+ *
+ * If the queue is currently empty, the call will do one of the following
+ * depending on the \c timeout value specified:
+ *
+ * \c timeout == 0 : Call will block until a message is available \n
+ * \c timeout > 0 : Call will block until a message or the specified timeout \n
+ * \c timeout == -1 : Return immediately if no message is on the queue \n
+ *
+ * If a maximum timeout value is specified (\c timeout > 0), and no message
+ * is present on the queue for the specified number of system ticks, the
+ * call will return with \c ATOM_TIMEOUT.
+ *
+ * This function can only be called from interrupt context if the \c timeout
+ * parameter is -1 (in which case it does not block).
+ *
+ * @param[in] qptr Pointer to queue object
+ * @param[in] timeout Max system ticks to block (0 = forever, -1 = no block)
+ * @param[out] msgptr Pointer to which the received message will be written
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_TIMEOUT Queue wait timed out before being woken
+ * @retval ATOM_WOULDBLOCK Called with timeout == -1 but queue was empty
+ * @retval ATOM_ERR_DELETED Queue was deleted while suspended
+ * @retval ATOM_ERR_CONTEXT Not called in thread context and attempted to block
+ * @retval ATOM_ERR_PARAM Bad parameter
+ * @retval ATOM_ERR_QUEUE Problem putting a thread on the suspend or ready queue
+ * @retval ATOM_ERR_TIMER Problem registering the timeout
+ */
+uint8_t atomPtrQueueGet (ATOM_PTR_QUEUE *qptr, int32_t timeout, POINTER *msgptr)
+{
+    CRITICAL_STORE;
+    uint8_t status;
+    PTR_QUEUE_TIMER timer_data;
+    ATOM_TIMER timer_cb;
+    ATOM_TCB *curr_tcb_ptr;
+    ATOM_TCB *tcb_ptr;
+
+    /* Check parameters */
+    if ((qptr == NULL) || (msgptr == NULL))
+    {
+        /* Bad pointer */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Protect access to the queue object and OS queues */
+        CRITICAL_START ();
+
+        /* If no messages on the queue, block the calling thread */
+        if (qptr->insert_count == qptr->remove_count)
+        {
+            /* If called with timeout >= 0, we should block */
+            if (timeout >= 0)
+            {
+                /* Get the current TCB */
+                curr_tcb_ptr = atomCurrentContext();
+
+                /* Check we are actually in thread context */
+                if (curr_tcb_ptr)
+                {
+                    /* Add current thread to the list suspended on receives */
+                    if (tcbEnqueuePriority (&qptr->getSuspQ, curr_tcb_ptr) == ATOM_OK)
+                    {
+                        /* Set suspended status for the current thread */
+                        curr_tcb_ptr->suspended = TRUE;
+
+                        /**
+                         * Store the destination so that a putting thread
+                         * can write its message straight to it.
+                         */
+                        curr_tcb_ptr->suspend_data = (POINTER)msgptr;
+
+                        /* Track errors */
+                        status = ATOM_OK;
+
+                        /* Register a timer callback if requested */
+                        if (timeout)
+                        {
+                            /**
+                             * Fill out the data needed by the callback to
+                             * wake us up.
+                             */
+                            timer_data.tcb_ptr = curr_tcb_ptr;
+                            timer_data.suspQ = &qptr->getSuspQ;
+
+                            /* Fill out the timer callback request structure */
+                            timer_cb.cb_func = atomPtrQueueTimerCallback;
+                            timer_cb.cb_data = (POINTER)&timer_data;
+                            timer_cb.cb_ticks = timeout;
+
+                            /**
+                             * Store the timer details in the TCB so that we
+                             * can cancel the timer callback if we are woken
+                             * before the timeout occurs.
+                             */
+                            curr_tcb_ptr->suspend_timo_cb = &timer_cb;
+
+                            /* Register a callback on timeout */
+                            if (atomTimerRegister (&timer_cb) != ATOM_OK)
+                            {
+                                /* Timer registration failed */
+                                status = ATOM_ERR_TIMER;
+
+                                /* Clean up and return to the caller */
+                                (void)tcbDequeueEntry (&qptr->getSuspQ, curr_tcb_ptr);
+                                curr_tcb_ptr->suspended = FALSE;
+                                curr_tcb_ptr->suspend_timo_cb = NULL;
+                                curr_tcb_ptr->suspend_data = NULL;
+                            }
+                        }
+
+                        /* Set no timeout requested */
+                        else
+                        {
+                            /* No need to cancel timeouts on this one */
+                            curr_tcb_ptr->suspend_timo_cb = NULL;
+                        }
+
+                        /* Exit critical region */
+                        CRITICAL_END ();
+
+                        /* Check no errors occurred */
+                        if (status == ATOM_OK)
+                        {
+                            /**
+                             * Current thread now blocking, schedule in a new
+                             * one. We already know we are in thread context
+                             * so can call the scheduler from here.
+                             */
+                            atomSched (FALSE);
+
+                            /**
+                             * Normal atomPtrQueuePut() wakeups will set
+                             * ATOM_OK status, having already written the
+                             * message to msgptr, while timeouts will set
+                             * ATOM_TIMEOUT and queue deletions will set
+                             * ATOM_ERR_DELETED.
+                             */
+                            status = curr_tcb_ptr->suspend_wake_status;
+                            curr_tcb_ptr->suspend_data = NULL;
+                        }
+                    }
+                    else
+                    {
+                        /* There was an error putting this thread on the suspend list */
+                        CRITICAL_END ();
+                        status = ATOM_ERR_QUEUE;
+                    }
+                }
+                else
+                {
+                    /* Not currently in thread context, can't suspend */
+                    CRITICAL_END ();
+                    status = ATOM_ERR_CONTEXT;
+                }
+            }
+            else
+            {
+                /* timeout == -1, requested not to block */
+                CRITICAL_END ();
+                status = ATOM_WOULDBLOCK;
+            }
+        }
+        else
+        {
+            /* Take the message at the head of the queue */
+            *msgptr = qptr->buff_ptr[qptr->remove_count & qptr->index_mask];
+            qptr->remove_count++;
+
+            /**
+             * If there are threads waiting to send, the queue was full.
+             * Move the highest priority sender's message into the space
+             * just made and wake it, so that its call has completed and
+             * message order is kept. Senders whose timeout is already being
+             * called back are passed over, as they will return ATOM_TIMEOUT.
+             */
+            while ((tcb_ptr = tcbDequeueHead (&qptr->putSuspQ)) != NULL)
+            {
+                if ((status = ptr_queue_wake (tcb_ptr, ATOM_OK)) != ATOM_ERR_TIMER)
+                    break;
+            }
+            if (tcb_ptr)
+            {
+                qptr->buff_ptr[qptr->insert_count & qptr->index_mask] = tcb_ptr->suspend_data;
+                qptr->insert_count++;
+            }
+            else
+            {
+                /* Successful */
+                status = ATOM_OK;
+            }
+
+            /* Exit critical region */
+            CRITICAL_END ();
+
+            /**
+             * The scheduler may now make a policy decision to thread
+             * switch if we are currently in thread context. If we are
+             * in interrupt context it will be handled by atomIntExit().
+             */
+            if (tcb_ptr && atomCurrentContext())
+                atomSched (FALSE);
+        }
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomPtrQueuePut
+ *
+ * Attempt to put a message onto a pointer queue.
+ *
+ * Sends one message at a time. The message \c msg is passed by value.
+ *
+ * If a thread is already blocking on the empty queue, the message is
+ * handed directly to it. Otherwise if the queue is currently full, the
+ * call will do one of the following depending on the \c timeout value
+ * specified:
+ *
+ * \c timeout == 0 : Call will block until space is available \n
+ * \c timeout > 0 : Call will block until space or the specified timeout \n
+ * \c timeout == -1 : Return immediately if the queue is full \n
+ *
+ * If a maximum timeout value is specified (\c timeout > 0), and no space
+ * is available for the specified number of system ticks, the call will
+ * return with \c ATOM_TIMEOUT.
+ *
+ * This function can only be called from interrupt context if the \c timeout
+ * parameter is -1 (in which case it does not block).
+ *
+ * @param[in] qptr Pointer to queue object
+ * @param[in] timeout Max system ticks to block (0 = forever, -1 = no block)
+ * @param[in] msg Message to be sent
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_TIMEOUT Queue wait timed out before being woken
+ * @retval ATOM_WOULDBLOCK Called with timeout == -1 but queue was full
+ * @retval ATOM_ERR_DELETED Queue was deleted while suspended
+ * @retval ATOM_ERR_CONTEXT Not called in thread context and attempted to block
+ * @retval ATOM_ERR_PARAM Bad parameter
+ * @retval ATOM_ERR_QUEUE Problem putting a thread on the suspend or ready queue
+ * @retval ATOM_ERR_TIMER Problem registering the timeout
+ */
+uint8_t atomPtrQueuePut (ATOM_PTR_QUEUE *qptr, int32_t timeout, POINTER msg)
+{
+    CRITICAL_STORE;
+    uint8_t status;
+    PTR_QUEUE_TIMER timer_data;
+    ATOM_TIMER timer_cb;
+    ATOM_TCB *curr_tcb_ptr;
+    ATOM_TCB *tcb_ptr;
+
+    /* Check parameters */
+    if (qptr == NULL)
+    {
+        /* Bad pointer */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Protect access to the queue object and OS queues */
+        CRITICAL_START ();
+
+        /**
+         * If there are threads waiting to receive, the queue is empty.
+         * Hand the message straight to the highest priority receiver
+         * without going through the queue buffer. Receivers whose timeout
+         * is already being called back are passed over, as they will
+         * return ATOM_TIMEOUT rather than the message.
+         */
+        while ((tcb_ptr = tcbDequeueHead (&qptr->getSuspQ)) != NULL)
+        {
+            if ((status = ptr_queue_wake (tcb_ptr, ATOM_OK)) != ATOM_ERR_TIMER)
+                break;
+        }
+        if (tcb_ptr)
+        {
+            *(POINTER *)tcb_ptr->suspend_data = msg;
+
+            /* Exit critical region */
+            CRITICAL_END ();
+
+            /**
+             * The scheduler may now make a policy decision to thread
+             * switch if we are currently in thread context. If we are
+             * in interrupt context it will be handled by atomIntExit().
+             */
+            if (atomCurrentContext())
+                atomSched (FALSE);
+        }
+
+        /* If queue is full, block the calling thread */
+        else if ((qptr->insert_count - qptr->remove_count) > qptr->index_mask)
+        {
+            /* If called with timeout >= 0, we should block */
+            if (timeout >= 0)
+            {
+                /* Get the current TCB */
+                curr_tcb_ptr = atomCurrentContext();
+
+                /* Check we are actually in thread context */
+                if (curr_tcb_ptr)
+                {
+                    /* Add current thread to the list suspended on sends */
+                    if (tcbEnqueuePriority (&qptr->putSuspQ, curr_tcb_ptr) == ATOM_OK)
+                    {
+                        /* Set suspended status for the current thread */
+                        curr_tcb_ptr->suspended = TRUE;
+
+                        /**
+                         * Leave the message with the TCB so that a getting
+                         * thread can move it into the queue.
+                         */
+                        curr_tcb_ptr->suspend_data = msg;
+
+                        /* Track errors */
+                        status = ATOM_OK;
+
+                        /* Register a timer callback if requested */
+                        if (timeout)
+                        {
+                            /**
+                             * Fill out the data needed by the callback to
+                             * wake us up.
+                             */
+                            timer_data.tcb_ptr = curr_tcb_ptr;
+                            timer_data.suspQ = &qptr->putSuspQ;
+
+                            /* Fill out the timer callback request structure */
+                            timer_cb.cb_func = atomPtrQueueTimerCallback;
+                            timer_cb.cb_data = (POINTER)&timer_data;
+                            timer_cb.cb_ticks = timeout;
+
+                            /**
+                             * Store the timer details in the TCB so that we
+                             * can cancel the timer callback if we are woken
+                             * before the timeout occurs.
+                             */
+                            curr_tcb_ptr->suspend_timo_cb = &timer_cb;
+
+                            /* Register a callback on timeout */
+                            if (atomTimerRegister (&timer_cb) != ATOM_OK)
+                            {
+                                /* Timer registration failed */
+                                status = ATOM_ERR_TIMER;
+
+                                /* Clean up and return to the caller */
+                                (void)tcbDequeueEntry (&qptr->putSuspQ, curr_tcb_ptr);
+                                curr_tcb_ptr->suspended = FALSE;
+                                curr_tcb_ptr->suspend_timo_cb = NULL;
+                                curr_tcb_ptr->suspend_data = NULL;
+                            }
+                        }
+
+                        /* Set no timeout requested */
+                        else
+                        {
+                            /* No need to cancel timeouts on this one */
+                            curr_tcb_ptr->suspend_timo_cb = NULL;
+                        }
+
+                        /* Exit critical region */
+                        CRITICAL_END ();
+
+                        /* Check no errors occurred */
+                        if (status == ATOM_OK)
+                        {
+                            /**
+                             * Current thread now blocking, schedule in a new
+                             * one. We already know we are in thread context
+                             * so can call the scheduler from here.
+                             */
+                            atomSched (FALSE);
+
+                            /**
+                             * Normal atomPtrQueueGet() wakeups will set
+                             * ATOM_OK status, having already moved our
+                             * message into the queue, while timeouts will
+                             * set ATOM_TIMEOUT and queue deletions will set
+                             * ATOM_ERR_DELETED.
+                             */
+                            status = curr_tcb_ptr->suspend_wake_status;
+                            curr_tcb_ptr->suspend_data = NULL;
+                        }
+                    }
+                    else
+                    {
+                        /* There was an error putting this thread on the suspend list */
+                        CRITICAL_END ();
+                        status = ATOM_ERR_QUEUE;
+                    }
+                }
+                else
+                {
+                    /* Not currently in thread context, can't suspend */
+                    CRITICAL_END ();
+                    status = ATOM_ERR_CONTEXT;
+                }
+            }
+            else
+            {
+                /* timeout == -1, requested not to block */
+                CRITICAL_END ();
+                status = ATOM_WOULDBLOCK;
+            }
+        }
+        else
+        {
+            /* There is space, append the message at the tail */
+            qptr->buff_ptr[qptr->insert_count & qptr->index_mask] = msg;
+            qptr->insert_count++;
+
+            /* Exit critical region */
+            CRITICAL_END ();
+
+            /* Successful */
+            status = ATOM_OK;
+        }
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b ptr_queue_wake
+ *
+ * This is an internal function not for use by application code.
+ *
+ * Wakes a thread which has already been removed from a suspend list:
+ * cancels any suspension timeout and puts it on the ready queue with the
+ * given wake status. If the timeout cannot be cancelled it is already
+ * being called back, and the thread is left for the callback to wake with
+ * ATOM_TIMEOUT. Does not call the scheduler.
+ *
+ * Assumes interrupts are already locked out.
+ *
+ * @param[in] tcb_ptr Pointer to the TCB of the thread to wake
+ * @param[in] wake_status Status to return to the woken thread
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_QUEUE Problem putting the thread on the ready queue
+ * @retval ATOM_ERR_TIMER Timeout already expired, thread not woken
+ */
+static uint8_t ptr_queue_wake (ATOM_TCB *tcb_ptr, uint8_t wake_status)
+{
+    uint8_t status;
+
+    /* If there's a timeout on this suspension, cancel it */
+    if ((tcb_ptr->suspend_timo_cb != NULL)
+        && (atomTimerCancel (tcb_ptr->suspend_timo_cb) != ATOM_OK))
+    {
+        /* The timeout callback will wake the thread */
+        status = ATOM_ERR_TIMER;
+    }
+    else
+    {
+        /* Flag as no timeout registered */
+        tcb_ptr->suspend_timo_cb = NULL;
+
+        /* Set the status to be returned to the waiting thread */
+        tcb_ptr->suspend_wake_status = wake_status;
+
+        /* Move the waiting thread to the ready queue */
+        if (tcbEnqueuePriority (&tcbReadyQ, tcb_ptr) != ATOM_OK)
+        {
+            /* There was a problem putting the thread on the ready queue */
+            status = ATOM_ERR_QUEUE;
+        }
+        else
+        {
+            /* Successful */
+            status = ATOM_OK;
+        }
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomPtrQueueTimerCallback
+ *
+ * This is an internal function not for use by application code.
+ *
+ * Timeouts on suspended threads are notified by the timer system through
+ * this generic callback. The timer system calls us back with a pointer to
+ * the relevant \c PTR_QUEUE_TIMER object which is used to retrieve the
+ * suspension details.
+ *
+ * @param[in] cb_data Pointer to a PTR_QUEUE_TIMER object
+ */
+static void atomPtrQueueTimerCallback (POINTER cb_data)
+{
+    PTR_QUEUE_TIMER *timer_data_ptr;
+    CRITICAL_STORE;
+
+    /* Get the PTR_QUEUE_TIMER structure pointer */
+    timer_data_ptr = (PTR_QUEUE_TIMER *)cb_data;
+
+    /* Check parameter is valid */
+    if (timer_data_ptr)
+    {
+        /* Enter critical region */
+        CRITICAL_START ();
+
+        /* Only act if the thread was not woken before we got here */
+        if (timer_data_ptr->tcb_ptr->suspend_timo_cb)
+        {
+            /* Set status to indicate to the waiting thread that it timed out */
+            timer_data_ptr->tcb_ptr->suspend_wake_status = ATOM_TIMEOUT;
+
+            /* Flag as no timeout registered */
+            timer_data_ptr->tcb_ptr->suspend_timo_cb = NULL;
+
+            /* Remove this thread from the suspend list it was waiting on */
+            (void)tcbDequeueEntry (timer_data_ptr->suspQ, timer_data_ptr->tcb_ptr);
+
+            /* Put the thread on the ready queue */
+            (void)tcbEnqueuePriority (&tcbReadyQ, timer_data_ptr->tcb_ptr);
+        }
+
+        /* Exit critical region */
+        CRITICAL_END ();
+
+        /**
+         * Note that we don't call the scheduler now as it will be called
+         * when we exit the ISR by atomIntExit().
+         */
+    }
+}
@@ -0,0 +1,57 @@
+/*
+ * Copyright (c) 2022, Matt Liss
+ * Copyright (c) 2010, Kelvin Lawson. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. No personal names or organizations' names associated with the
+ *    Atomthreads project may be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE ATOMTHREADS PROJECT AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __ATOM_PTR_QUEUE_H
+#define __ATOM_PTR_QUEUE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct atom_ptr_queue
+{
+    ATOM_TCB *  putSuspQ;       /* Queue of threads waiting to send */
+    ATOM_TCB *  getSuspQ;       /* Queue of threads waiting to receive */
+    POINTER *   buff_ptr;       /* Pointer to queue data area */
+    uint32_t    index_mask;     /* Capacity - 1 (capacity is a power of two) */
+    uint32_t    insert_count;   /* Free-running count of messages inserted */
+    uint32_t    remove_count;   /* Free-running count of messages removed */
+} ATOM_PTR_QUEUE;
+
+extern uint8_t atomPtrQueueCreate (ATOM_PTR_QUEUE *qptr, POINTER *buff_ptr, uint32_t max_num_msgs);
+extern uint8_t atomPtrQueueDelete (ATOM_PTR_QUEUE *qptr);
+extern uint8_t atomPtrQueueGet (ATOM_PTR_QUEUE *qptr, int32_t timeout, POINTER *msgptr);
+extern uint8_t atomPtrQueuePut (ATOM_PTR_QUEUE *qptr, int32_t timeout, POINTER msg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __ATOM_PTR_QUEUE_H */
@@ -57,10 +57,28 @@
  * Queues can be created with any sized message, and any number of stored
  * messages.
  *
+ * \par Urgent and priority messages
+ * Messages can be posted to the head of a queue so that they overtake any
+ * messages already waiting. Queues can also be created with a number of
+ * message priority levels, in which case the highest priority message
+ * waiting is always received first.
+ *
+ * \par Non-destructive peek
+ * Threads can inspect the next message without removing it from the queue,
+ * optionally blocking until one arrives, and can query the number of
+ * messages stored and the free space remaining.
+ *
+ * \par Optional statistics
+ * Queues can record their high-water mark, how often and for how long
+ * callers were blocked, and how long messages waited in the queue, to help
+ * size queues from measurements.
+ *
  * \par Smart queue deletion
  * Where a queue is deleted while threads are blocking on it, all blocking
  * threads are woken and returned a status code to indicate the reason for
- * being woken.
+ * being woken. A queue can also be flushed with atomQueueFlush(), which
+ * discards its messages and wakes all blocking threads in the same way but
+ * leaves the queue in use.
  *
  *
  * \n <b> Usage instructions: </b> \n
@@ -83,7 +101,40 @@
  * call can be made in which case the call will return with a status code
  * indicating that the queue is full. This allows messages to be received
  * by interrupt handlers or threads which you do not wish to block.
+ *
+ * Urgent messages (e.g. an emergency stop command) can be posted using
+ * atomQueuePutUrgent(). These are inserted at the head of the queue rather
+ * than the tail, and will be the next message received.
+ *
+ * Where several classes of message share a queue, the queue can instead be
+ * created using atomQueueCreatePriority() with a number of priority levels.
+ * Messages are posted at a given level using atomQueuePutPriority() and
+ * atomQueueGet() always returns the oldest message at the highest priority
+ * level (level 0) which has messages waiting. Messages posted with
+ * atomQueuePut() go to the lowest priority level. All levels share the one
+ * pool of \c max_num_msgs message slots, with each level holding a linked
+ * list of its slots, so posting takes constant time and receiving takes
+ * constant time plus a scan of the levels. The caller provides an array of
+ * slot links alongside the message storage.
  * 
+ * The next message can be examined without removing it from the queue by
+ * calling atomQueuePeek(). This has the same blocking options as
+ * atomQueueGet(), so dispatchers can wait for a message, inspect it, and
+ * leave it on the queue for the thread which will actually consume it.
+ * Where several threads block peeking an empty queue, all of them are woken
+ * with a copy of the first message posted. The current number of messages
+ * stored and free spaces can be read safely using atomQueueCount() and
+ * atomQueueSpace(), for example to size a batch of reads.
+ *
+ * Statistics are enabled on a queue by calling atomQueueStatsEnable() after
+ * creating it, before it is used. The caller provides an ATOM_QUEUE_STATS
+ * object to accumulate into, and optionally an array of timestamps (one per
+ * message slot) which is used to measure the latency from posting each
+ * message to receiving it. atomQueueStatsRead() takes a consistent copy of
+ * the statistics and can optionally reset them for the next measurement
+ * period. All times are measured in system ticks. Queues without statistics
+ * enabled only pay for a NULL pointer check.
+ *
  * A queue which is no longer required can be deleted using atomQueueDelete().
  * This function automatically wakes up any threads which are waiting on the
  * deleted queue.
@@ -107,11 +158,31 @@ typedef struct queue_timer
     ATOM_TCB   **suspQ;     /* TCB queue which thread is suspended on */
 } QUEUE_TIMER;
 
+typedef struct queue_put_wait
+{
+    uint8_t    *msgptr;     /* Message the suspended sender wishes to post */
+    uint8_t    priority;    /* Priority level to post at */
+    uint8_t    urgent;      /* TRUE to post at the head of the queue */
+} QUEUE_PUT_WAIT;
+
+
+/* Constants */
+
+/** Priority used by atomQueuePut(): the lowest level on priority queues */
+#define QUEUE_LOWEST_PRIORITY   0xFF
+
+/** End of a list of slots on priority queues */
+#define QUEUE_NO_SLOT           0xFFFFFFFF
+
 
 /* Forward declarations */
 
+static uint8_t queue_put (ATOM_QUEUE *qptr, int32_t timeout, uint8_t *msgptr, uint8_t priority, uint8_t urgent);
 static uint8_t queue_remove (ATOM_QUEUE *qptr, uint8_t* msgptr);
-static uint8_t queue_insert (ATOM_QUEUE *qptr, uint8_t* msgptr);
+static uint8_t *queue_head (ATOM_QUEUE *qptr);
+static uint8_t queue_insert (ATOM_QUEUE *qptr, uint8_t* msgptr, uint8_t priority, uint8_t urgent);
+static void queue_store (ATOM_QUEUE *qptr, uint8_t* msgptr, uint8_t priority, uint8_t urgent);
+static void queue_stats_add (uint32_t *total_ptr, uint32_t *max_ptr, uint32_t ticks);
 static void atomQueueTimerCallback (POINTER cb_data);
 
 
@@ -167,12 +238,22 @@ uint8_t atomQueueCreate (ATOM_QUEUE *qptr, uint8_t *buff_ptr, uint32_t unit_size
         /* Initialise the suspended threads queues */
         qptr->putSuspQ = NULL;
         qptr->getSuspQ = NULL;
+        qptr->peekSuspQ = NULL;
 
         /* Initialise the insert/remove pointers */
         qptr->insert_index = 0;
         qptr->remove_index = 0;
         qptr->num_msgs_stored = 0;
 
+        /* Plain FIFO queue, no priority levels */
+        qptr->levels = NULL;
+        qptr->num_levels = 0;
+        qptr->slot_links = NULL;
+
+        /* Statistics are not enabled until requested */
+        qptr->stats = NULL;
+        qptr->timestamps = NULL;
+
         /* Successful */
         status = ATOM_OK;
     }
@@ -181,6 +262,79 @@ uint8_t atomQueueCreate (ATOM_QUEUE *qptr, uint8_t *buff_ptr, uint32_t unit_size
 }
 
 
+/**
+ * \b atomQueueCreatePriority
+ *
+ * Initialises a priority queue object.
+ *
+ * Operates as atomQueueCreate(), but creates a queue which stores messages
+ * at \c num_levels different priority levels. Level 0 is the highest
+ * priority. atomQueueGet() returns the oldest message at the highest
+ * priority level which has any messages waiting.
+ *
+ * The queue holds at most \c max_num_msgs messages in total across all
+ * levels, in the same (\c unit_size * \c max_num_msgs) bytes of storage as
+ * a plain queue. The message slots are shared between the levels, and the
+ * messages at each level are chained through the \c slot_links array,
+ * which must have \c max_num_msgs entries.
+ *
+ * The caller also provides an array of \c num_levels ATOM_QUEUE_LEVEL
+ * objects used to track the messages stored at each level.
+ *
+ * This function can be called from interrupt context.
+ *
+ * @param[in] qptr Pointer to queue object
+ * @param[in] buff_ptr Pointer to buffer storage area
+ * @param[in] unit_size Size in bytes of each queue message
+ * @param[in] max_num_msgs Maximum number of messages in the queue
+ * @param[in] slot_links Pointer to array of \c max_num_msgs slot links
+ * @param[in] levels Pointer to array of \c num_levels level objects
+ * @param[in] num_levels Number of message priority levels
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_PARAM Bad parameters
+ */
+uint8_t atomQueueCreatePriority (ATOM_QUEUE *qptr, uint8_t *buff_ptr, uint32_t unit_size, uint32_t max_num_msgs, uint32_t *slot_links, ATOM_QUEUE_LEVEL *levels, uint8_t num_levels)
+{
+    uint8_t status;
+    uint8_t level;
+
+    /* Parameter check */
+    if ((slot_links == NULL) || (levels == NULL) || (num_levels == 0))
+    {
+        /* Bad level details */
+        status = ATOM_ERR_PARAM;
+    }
+
+    /* Set up the common queue details */
+    else if ((status = atomQueueCreate (qptr, buff_ptr, unit_size, max_num_msgs)) == ATOM_OK)
+    {
+        /* Start with every level empty */
+        for (level = 0; level < num_levels; level++)
+        {
+            levels[level].head_slot = 0;
+            levels[level].tail_slot = 0;
+            levels[level].num_msgs_stored = 0;
+        }
+
+        /**
+         * Start with all slots unused. Slots are handed out in order
+         * until all have been used, and from the free list after that,
+         * so the links do not need to be initialised here.
+         */
+        qptr->slot_links = slot_links;
+        qptr->free_slot = QUEUE_NO_SLOT;
+        qptr->unused_slot = 0;
+
+        /* Store the level details */
+        qptr->levels = levels;
+        qptr->num_levels = num_levels;
+    }
+
+    return (status);
+}
+
+
 /**
  * \b atomQueueDelete
  *
@@ -191,21 +345,18 @@ uint8_t atomQueueCreate (ATOM_QUEUE *qptr, uint8_t *buff_ptr, uint32_t unit_size
  * scheduler will be called during this function which may schedule in one
  * of the woken threads depending on relative priorities.
  *
- * This function can be called from interrupt context, but loops internally
- * waking up all threads blocking on the queue, so the potential
- * execution cycles cannot be determined in advance.
+ * This function can be called from interrupt context. All threads blocking
+ * on the queue are woken in a single critical section, without searching
+ * the timer list for their timeouts.
  *
  * @param[in] qptr Pointer to queue object
  *
  * @retval ATOM_OK Success
- * @retval ATOM_ERR_QUEUE Problem putting a woken thread on the ready queue
- * @retval ATOM_ERR_TIMER Problem cancelling a timeout on a woken thread
  */
 uint8_t atomQueueDelete (ATOM_QUEUE *qptr)
 {
     uint8_t status;
     CRITICAL_STORE;
-    ATOM_TCB *tcb_ptr;
     uint8_t woken_threads = FALSE;
 
     /* Parameter check */
@@ -216,69 +367,22 @@ uint8_t atomQueueDelete (ATOM_QUEUE *qptr)
     }
     else
     {
-        /* Default to success status unless errors occur during wakeup */
-        status = ATOM_OK;
-
-        /* Wake up all suspended tasks */
-        while (1)
-        {
-            /* Enter critical region */
-            CRITICAL_START ();
-
-            /* Check if any threads are suspended */
-            if (((tcb_ptr = tcbDequeueHead (&qptr->getSuspQ)) != NULL)
-                || ((tcb_ptr = tcbDequeueHead (&qptr->putSuspQ)) != NULL))
-            {
-                /* A thread is waiting on a suspend queue */
-
-                /* Return error status to the waiting thread */
-                tcb_ptr->suspend_wake_status = ATOM_ERR_DELETED;
-
-                /* Put the thread on the ready queue */
-                if (tcbEnqueuePriority (&tcbReadyQ, tcb_ptr) != ATOM_OK)
-                {
-                    /* Exit critical region */
-                    CRITICAL_END ();
-
-                    /* Quit the loop, returning error */
-                    status = ATOM_ERR_QUEUE;
-                    break;
-                }
-
-                /* If there's a timeout on this suspension, cancel it */
-                if (tcb_ptr->suspend_timo_cb)
-                {
-                    /* Cancel the callback */
-                    if (atomTimerCancel (tcb_ptr->suspend_timo_cb) != ATOM_OK)
-                    {
-                        /* Exit critical region */
-                        CRITICAL_END ();
-
-                        /* Quit the loop, returning error */
-                        status = ATOM_ERR_TIMER;
-                        break;
-                    }
-
-                    /* Flag as no timeout registered */
-                    tcb_ptr->suspend_timo_cb = NULL;
-
-                }
+        /* Protect access to the queue object and OS queues */
+        CRITICAL_START ();
 
-                /* Exit critical region */
-                CRITICAL_END ();
+        /* Wake up all suspended tasks in one go */
+        if (tcbWakeAll (&qptr->getSuspQ, ATOM_ERR_DELETED))
+            woken_threads = TRUE;
+        if (tcbWakeAll (&qptr->putSuspQ, ATOM_ERR_DELETED))
+            woken_threads = TRUE;
+        if (tcbWakeAll (&qptr->peekSuspQ, ATOM_ERR_DELETED))
+            woken_threads = TRUE;
 
-                /* Request a reschedule */
-                woken_threads = TRUE;
-            }
+        /* Exit critical region */
+        CRITICAL_END ();
 
-            /* No more suspended threads */
-            else
-            {
-                /* Exit critical region and quit the loop */
-                CRITICAL_END ();
-                break;
-            }
-        }
+        /* Successful */
+        status = ATOM_OK;
 
         /* Call scheduler if any threads were woken up */
         if (woken_threads == TRUE)
@@ -296,6 +400,85 @@ uint8_t atomQueueDelete (ATOM_QUEUE *qptr)
 }
 
 
+/**
+ * \b atomQueueFlush
+ *
+ * Flushes a queue object.
+ *
+ * Discards all messages stored in the queue, returning it to the empty
+ * state it was in when created. Any threads currently suspended on the
+ * queue will be woken up with return status ATOM_ERR_DELETED, including
+ * senders whose messages have not been posted. Unlike atomQueueDelete()
+ * the queue remains usable afterwards, which allows an application to
+ * reset its message flows (e.g. on a mode change) without tearing down
+ * and recreating the queue. If called at thread context then the
+ * scheduler will be called during this function which may schedule in one
+ * of the woken threads depending on relative priorities.
+ *
+ * This function can be called from interrupt context. All threads blocking
+ * on the queue are woken in a single critical section, without searching
+ * the timer list for their timeouts.
+ *
+ * @param[in] qptr Pointer to queue object
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_PARAM Bad parameter
+ */
+uint8_t atomQueueFlush (ATOM_QUEUE *qptr)
+{
+    uint8_t status;
+    CRITICAL_STORE;
+    uint8_t woken_threads = FALSE;
+    uint8_t level;
+
+    /* Parameter check */
+    if (qptr == NULL)
+    {
+        /* Bad pointer */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Protect access to the queue object and OS queues */
+        CRITICAL_START ();
+
+        /* Discard all stored messages */
+        qptr->insert_index = 0;
+        qptr->remove_index = 0;
+        qptr->num_msgs_stored = 0;
+        for (level = 0; level < qptr->num_levels; level++)
+        {
+            qptr->levels[level].num_msgs_stored = 0;
+        }
+        qptr->free_slot = QUEUE_NO_SLOT;
+        qptr->unused_slot = 0;
+
+        /* Wake up all suspended tasks in one go */
+        if (tcbWakeAll (&qptr->getSuspQ, ATOM_ERR_DELETED))
+            woken_threads = TRUE;
+        if (tcbWakeAll (&qptr->putSuspQ, ATOM_ERR_DELETED))
+            woken_threads = TRUE;
+        if (tcbWakeAll (&qptr->peekSuspQ, ATOM_ERR_DELETED))
+            woken_threads = TRUE;
+
+        /* Exit critical region */
+        CRITICAL_END ();
+
+        /* Successful */
+        status = ATOM_OK;
+
+        /**
+         * Only call the scheduler if we are in thread context, otherwise
+         * it will be called on exiting the ISR by atomIntExit().
+         */
+        if (woken_threads && atomCurrentContext())
+            atomSched (FALSE);
+    }
+
+    return (status);
+}
+
+
 /**
  * \b atomQueueGet
  *
@@ -304,7 +487,9 @@ uint8_t atomQueueDelete (ATOM_QUEUE *qptr)
  * Retrieves one message at a time. Messages are copied into the passed
  * \c msgptr storage area which should be large enough to contain one
  * message of \c unit_size bytes. Where multiple messages are in the queue,
- * messages are retrieved in FIFO order.
+ * messages are retrieved in FIFO order, except that urgent messages posted
+ * using atomQueuePutUrgent() are retrieved first. On priority queues the
+ * oldest message at the highest priority level is retrieved.
  *
  * If the queue is currently empty, the call will do one of the following
  * depending on the \c timeout value specified:
@@ -340,6 +525,7 @@ uint8_t atomQueueGet (ATOM_QUEUE *qptr, int32_t timeout, uint8_t *msgptr)
     QUEUE_TIMER timer_data;
     ATOM_TIMER timer_cb;
     ATOM_TCB *curr_tcb_ptr;
+    uint32_t start_time;
 
     /* Check parameters */
     if ((qptr == NULL) || (msgptr == NULL))
@@ -372,6 +558,13 @@ uint8_t atomQueueGet (ATOM_QUEUE *qptr, int32_t timeout, uint8_t *msgptr)
                         /* Set suspended status for the current thread */
                         curr_tcb_ptr->suspended = TRUE;
 
+                        /**
+                         * Store the destination so that the putting thread
+                         * can copy its message straight in, rather than
+                         * through the queue buffer.
+                         */
+                        curr_tcb_ptr->suspend_data = (POINTER)msgptr;
+
                         /* Track errors */
                         status = ATOM_OK;
 
@@ -408,6 +601,7 @@ uint8_t atomQueueGet (ATOM_QUEUE *qptr, int32_t timeout, uint8_t *msgptr)
                                 (void)tcbDequeueEntry (&qptr->getSuspQ, curr_tcb_ptr);
                                 curr_tcb_ptr->suspended = FALSE;
                                 curr_tcb_ptr->suspend_timo_cb = NULL;
+                                curr_tcb_ptr->suspend_data = NULL;
                             }
                         }
 
@@ -418,6 +612,11 @@ uint8_t atomQueueGet (ATOM_QUEUE *qptr, int32_t timeout, uint8_t *msgptr)
                             curr_tcb_ptr->suspend_timo_cb = NULL;
                         }
 
+                        /* Count the blocked call and note when it started */
+                        if ((status == ATOM_OK) && qptr->stats)
+                            qptr->stats->get_blocked++;
+                        start_time = atomTimeGet();
+
                         /* Exit critical region */
                         CRITICAL_END ();
 
@@ -433,29 +632,20 @@ uint8_t atomQueueGet (ATOM_QUEUE *qptr, int32_t timeout, uint8_t *msgptr)
 
                             /**
                              * Normal atomQueuePut() wakeups will set ATOM_OK
-                             * status, while timeouts will set ATOM_TIMEOUT
-                             * and queue deletions will set ATOM_ERR_DELETED.
+                             * status, having already copied the message
+                             * into msgptr, while timeouts will set
+                             * ATOM_TIMEOUT and queue deletions will set
+                             * ATOM_ERR_DELETED.
                              */
                             status = curr_tcb_ptr->suspend_wake_status;
+                            curr_tcb_ptr->suspend_data = NULL;
 
-                            /**
-                             * Check suspend_wake_status. If it is ATOM_OK
-                             * then we were woken because a message has been
-                             * put on the queue and we can now copy it out.
-                             * Otherwise we were woken because we timed out
-                             * waiting for a message, or the queue was
-                             * deleted, so we should just quit.
-                             */
-                            if (status == ATOM_OK)
+                            /* Record the time spent blocked */
+                            if (qptr->stats)
                             {
-                                /* Enter critical region */
-                                CRITICAL_START();
-
-                                /* Copy the message out of the queue */
-                                status = queue_remove (qptr, msgptr);
-
-                                /* Exit critical region */
-                                CRITICAL_END();
+                                CRITICAL_START ();
+                                queue_stats_add (&qptr->stats->get_wait_ticks, &qptr->stats->get_wait_max, atomTimeGet() - start_time);
+                                CRITICAL_END ();
                             }
                         }
                     }
@@ -476,6 +666,8 @@ uint8_t atomQueueGet (ATOM_QUEUE *qptr, int32_t timeout, uint8_t *msgptr)
             else
             {
                 /* timeout == -1, requested not to block and queue is empty */
+                if (qptr->stats)
+                    qptr->stats->get_wouldblock++;
                 CRITICAL_END();
                 status = ATOM_WOULDBLOCK;
             }
@@ -503,43 +695,44 @@ uint8_t atomQueueGet (ATOM_QUEUE *qptr, int32_t timeout, uint8_t *msgptr)
 
 
 /**
- * \b atomQueuePut
+ * \b atomQueuePeek
  *
- * Attempt to put a message onto a queue.
+ * Attempt to examine the next message on a queue without removing it.
  *
- * Sends one message at a time. Messages are copied from the passed
- * \c msgptr storage area which should contain a message of \c unit_size
- * bytes.
+ * Copies the message which would be returned by the next call to
+ * atomQueueGet() into the passed \c msgptr storage area, which should be
+ * large enough to contain one message of \c unit_size bytes. The message
+ * is left on the queue.
  *
- * If the queue is currently full, the call will do one of the following
+ * If the queue is currently empty, the call will do one of the following
  * depending on the \c timeout value specified:
  *
- * \c timeout == 0 : Call will block until space is available \n
- * \c timeout > 0 : Call will block until space or the specified timeout \n
- * \c timeout == -1 : Return immediately if the queue is full \n
+ * \c timeout == 0 : Call will block until a message is available \n
+ * \c timeout > 0 : Call will block until a message or the specified timeout \n
+ * \c timeout == -1 : Return immediately if no message is on the queue \n
  *
- * If a maximum timeout value is specified (\c timeout > 0), and no space
- * is available on the queue for the specified number of system ticks, the
- * call will return with \c ATOM_TIMEOUT.
+ * Threads blocking in atomQueuePeek() are all woken by the next message
+ * posted to the queue, and each receives a copy of that message. Another
+ * thread may of course have removed it from the queue by the time the
+ * peeking thread runs again.
  *
  * This function can only be called from interrupt context if the \c timeout
- * parameter is -1 (in which case it does not block and may fail to post a
- * message if the queue is full).
+ * parameter is -1 (in which case it does not block).
  *
  * @param[in] qptr Pointer to queue object
  * @param[in] timeout Max system ticks to block (0 = forever, -1 =  no block)
- * @param[out] msgptr Pointer from which the message should be copied out
+ * @param[out] msgptr Pointer to which the next message will be copied
  *
  * @retval ATOM_OK Success
- * @retval ATOM_WOULDBLOCK Called with timeout == -1 but queue was full
  * @retval ATOM_TIMEOUT Queue wait timed out before being woken
+ * @retval ATOM_WOULDBLOCK Called with timeout == -1 but queue was empty
  * @retval ATOM_ERR_DELETED Queue was deleted while suspended
  * @retval ATOM_ERR_CONTEXT Not called in thread context and attempted to block
  * @retval ATOM_ERR_PARAM Bad parameter
  * @retval ATOM_ERR_QUEUE Problem putting the thread on the suspend queue
  * @retval ATOM_ERR_TIMER Problem registering the timeout
  */
-uint8_t atomQueuePut (ATOM_QUEUE *qptr, int32_t timeout, uint8_t *msgptr)
+uint8_t atomQueuePeek (ATOM_QUEUE *qptr, int32_t timeout, uint8_t *msgptr)
 {
     CRITICAL_STORE;
     uint8_t status;
@@ -558,13 +751,13 @@ uint8_t atomQueuePut (ATOM_QUEUE *qptr, int32_t timeout, uint8_t *msgptr)
         /* Protect access to the queue object and OS queues */
         CRITICAL_START ();
 
-        /* If queue is full, block the calling thread */
-        if (qptr->num_msgs_stored == qptr->max_num_msgs)
+        /* If no messages on the queue, block the calling thread */
+        if (qptr->num_msgs_stored == 0)
         {
             /* If called with timeout >= 0, we should block */
             if (timeout >= 0)
             {
-                /* Queue is full, block the calling thread */
+                /* Queue is empty, block the calling thread */
 
                 /* Get the current TCB */
                 curr_tcb_ptr = atomCurrentContext();
@@ -572,12 +765,18 @@ uint8_t atomQueuePut (ATOM_QUEUE *qptr, int32_t timeout, uint8_t *msgptr)
                 /* Check we are actually in thread context */
                 if (curr_tcb_ptr)
                 {
-                    /* Add current thread to the suspend list on sends */
-                    if (tcbEnqueuePriority (&qptr->putSuspQ, curr_tcb_ptr) == ATOM_OK)
+                    /* Add current thread to the list suspended on peeks */
+                    if (tcbEnqueuePriority (&qptr->peekSuspQ, curr_tcb_ptr) == ATOM_OK)
                     {
                         /* Set suspended status for the current thread */
                         curr_tcb_ptr->suspended = TRUE;
 
+                        /**
+                         * Store the destination so that the message can be
+                         * copied straight in by the thread which posts it.
+                         */
+                        curr_tcb_ptr->suspend_data = (POINTER)msgptr;
+
                         /* Track errors */
                         status = ATOM_OK;
 
@@ -590,8 +789,7 @@ uint8_t atomQueuePut (ATOM_QUEUE *qptr, int32_t timeout, uint8_t *msgptr)
                              */
                             timer_data.tcb_ptr = curr_tcb_ptr;
                             timer_data.queue_ptr = qptr;
-                            timer_data.suspQ = &qptr->putSuspQ;
-
+                            timer_data.suspQ = &qptr->peekSuspQ;
 
                             /* Fill out the timer callback request structure */
                             timer_cb.cb_func = atomQueueTimerCallback;
@@ -601,8 +799,7 @@ uint8_t atomQueuePut (ATOM_QUEUE *qptr, int32_t timeout, uint8_t *msgptr)
                             /**
                              * Store the timer details in the TCB so that we
                              * can cancel the timer callback if a message is
-                             * removed from the queue before the timeout
-                             * occurs.
+                             * posted before the timeout occurs.
                              */
                             curr_tcb_ptr->suspend_timo_cb = &timer_cb;
 
@@ -613,9 +810,10 @@ uint8_t atomQueuePut (ATOM_QUEUE *qptr, int32_t timeout, uint8_t *msgptr)
                                 status = ATOM_ERR_TIMER;
 
                                 /* Clean up and return to the caller */
-                                (void)tcbDequeueEntry (&qptr->putSuspQ, curr_tcb_ptr);
+                                (void)tcbDequeueEntry (&qptr->peekSuspQ, curr_tcb_ptr);
                                 curr_tcb_ptr->suspended = FALSE;
                                 curr_tcb_ptr->suspend_timo_cb = NULL;
+                                curr_tcb_ptr->suspend_data = NULL;
                             }
                         }
 
@@ -629,7 +827,7 @@ uint8_t atomQueuePut (ATOM_QUEUE *qptr, int32_t timeout, uint8_t *msgptr)
                         /* Exit critical region */
                         CRITICAL_END ();
 
-                        /* Check timer registration was successful */
+                        /* Check no errors occurred */
                         if (status == ATOM_OK)
                         {
                             /**
@@ -640,31 +838,13 @@ uint8_t atomQueuePut (ATOM_QUEUE *qptr, int32_t timeout, uint8_t *msgptr)
                             atomSched (FALSE);
 
                             /**
-                             * Normal atomQueueGet() wakeups will set ATOM_OK
-                             * status, while timeouts will set ATOM_TIMEOUT
+                             * Normal atomQueuePut() wakeups will set ATOM_OK
+                             * status, having already copied the message into
+                             * msgptr, while timeouts will set ATOM_TIMEOUT
                              * and queue deletions will set ATOM_ERR_DELETED.
                              */
                             status = curr_tcb_ptr->suspend_wake_status;
-
-                            /**
-                             * Check suspend_wake_status. If it is ATOM_OK
-                             * then we were woken because a message has been
-                             * removed from the queue and we can now add ours.
-                             * Otherwise we were woken because we timed out
-                             * waiting for a message, or the queue was
-                             * deleted, so we should just quit.
-                             */
-                            if (status == ATOM_OK)
-                            {
-                                /* Enter critical region */
-                                CRITICAL_START();
-
-                                /* Copy the message into the queue */
-                                status = queue_insert (qptr, msgptr);
-
-                                /* Exit critical region */
-                                CRITICAL_END();
-                            }
+                            curr_tcb_ptr->suspend_data = NULL;
                         }
                     }
                     else
@@ -683,26 +863,21 @@ uint8_t atomQueuePut (ATOM_QUEUE *qptr, int32_t timeout, uint8_t *msgptr)
             }
             else
             {
-                /* timeout == -1, cannot block. Just return queue is full */
+                /* timeout == -1, requested not to block and queue is empty */
                 CRITICAL_END();
                 status = ATOM_WOULDBLOCK;
             }
         }
         else
         {
-            /* No need to block, there is space to copy into the queue */
-            status = queue_insert (qptr, msgptr);
+            /* There is a message, copy it out but leave it on the queue */
+            memcpy (msgptr, queue_head (qptr), qptr->unit_size);
 
             /* Exit critical region */
             CRITICAL_END ();
 
-            /**
-             * The scheduler may now make a policy decision to thread
-             * switch if we are currently in thread context. If we are
-             * in interrupt context it will be handled by atomIntExit().
-             */
-            if (atomCurrentContext())
-                atomSched (FALSE);
+            /* Successful */
+            status = ATOM_OK;
         }
     }
 
@@ -711,83 +886,658 @@ uint8_t atomQueuePut (ATOM_QUEUE *qptr, int32_t timeout, uint8_t *msgptr)
 
 
 /**
- * \b atomQueueTimerCallback
+ * \b atomQueueCount
  *
- * This is an internal function not for use by application code.
+ * Read the number of messages currently stored on a queue.
  *
- * Timeouts on suspended threads are notified by the timer system through
- * this generic callback. The timer system calls us back with a pointer to
- * the relevant \c QUEUE_TIMER object which is used to retrieve the
- * queue details.
+ * The count is read with interrupts locked out so is consistent at the
+ * time of the call, but may of course be changed immediately afterwards
+ * by other threads or interrupt handlers.
  *
- * @param[in] cb_data Pointer to a QUEUE_TIMER object
+ * This function can be called from interrupt context.
+ *
+ * @param[in] qptr Pointer to queue object
+ * @param[out] count Pointer to which the number of messages will be written
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_PARAM Bad parameter
  */
-static void atomQueueTimerCallback (POINTER cb_data)
+uint8_t atomQueueCount (ATOM_QUEUE *qptr, uint32_t *count)
 {
-    QUEUE_TIMER *timer_data_ptr;
     CRITICAL_STORE;
+    uint8_t status;
 
-    /* Get the QUEUE_TIMER structure pointer */
-    timer_data_ptr = (QUEUE_TIMER *)cb_data;
-
-    /* Check parameter is valid */
-    if (timer_data_ptr)
+    /* Check parameters */
+    if ((qptr == NULL) || (count == NULL))
     {
-        /* Enter critical region */
+        /* Bad pointer */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Read the count atomically (it may be wider than the CPU word) */
         CRITICAL_START ();
-
-        /* Set status to indicate to the waiting thread that it timed out */
-        timer_data_ptr->tcb_ptr->suspend_wake_status = ATOM_TIMEOUT;
-
-        /* Flag as no timeout registered */
-        timer_data_ptr->tcb_ptr->suspend_timo_cb = NULL;
-
-        /**
-         * Remove this thread from the queue's suspend list. Handles threads
-         * suspended on the receive list as well as the send list.
-         */
-        (void)tcbDequeueEntry (timer_data_ptr->suspQ, timer_data_ptr->tcb_ptr);
-
-        /* Put the thread on the ready queue */
-        (void)tcbEnqueuePriority (&tcbReadyQ, timer_data_ptr->tcb_ptr);
-
-        /* Exit critical region */
+        *count = qptr->num_msgs_stored;
         CRITICAL_END ();
 
-        /**
-         * Note that we don't call the scheduler now as it will be called
-         * when we exit the ISR by atomIntExit().
-         */
+        /* Successful */
+        status = ATOM_OK;
     }
+
+    return (status);
 }
 
 
 /**
- * \b queue_remove
- *
- * This is an internal function not for use by application code.
+ * \b atomQueueSpace
  *
- * Removes a message from a queue. Assumes that there is a message present,
- * which is already checked by the calling functions with interrupts locked
- * out.
+ * Read the number of further messages which can currently be posted to a
+ * queue without blocking.
  *
- * Also wakes up a suspended thread if there are any waiting to send on the
- * queue.
+ * On priority queues the space is shared between all priority levels. As
+ * with atomQueueCount() the value may be changed immediately afterwards by
+ * other threads or interrupt handlers.
  *
- * Assumes interrupts are already locked out.
+ * This function can be called from interrupt context.
  *
- * @param[in] qptr Pointer to an ATOM_QUEUE object
- * @param[in] msgptr Destination pointer for the message to be copied into
+ * @param[in] qptr Pointer to queue object
+ * @param[out] space Pointer to which the number of free spaces will be written
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_PARAM Bad parameter
+ */
+uint8_t atomQueueSpace (ATOM_QUEUE *qptr, uint32_t *space)
+{
+    CRITICAL_STORE;
+    uint8_t status;
+
+    /* Check parameters */
+    if ((qptr == NULL) || (space == NULL))
+    {
+        /* Bad pointer */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Read the count atomically (it may be wider than the CPU word) */
+        CRITICAL_START ();
+        *space = qptr->max_num_msgs - qptr->num_msgs_stored;
+        CRITICAL_END ();
+
+        /* Successful */
+        status = ATOM_OK;
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomQueuePut
+ *
+ * Attempt to put a message onto a queue.
+ *
+ * Sends one message at a time. Messages are copied from the passed
+ * \c msgptr storage area which should contain a message of \c unit_size
+ * bytes.
+ *
+ * If the queue is currently full, the call will do one of the following
+ * depending on the \c timeout value specified:
+ *
+ * \c timeout == 0 : Call will block until space is available \n
+ * \c timeout > 0 : Call will block until space or the specified timeout \n
+ * \c timeout == -1 : Return immediately if the queue is full \n
+ *
+ * If a maximum timeout value is specified (\c timeout > 0), and no space
+ * is available on the queue for the specified number of system ticks, the
+ * call will return with \c ATOM_TIMEOUT.
+ *
+ * This function can only be called from interrupt context if the \c timeout
+ * parameter is -1 (in which case it does not block and may fail to post a
+ * message if the queue is full).
+ *
+ * @param[in] qptr Pointer to queue object
+ * @param[in] timeout Max system ticks to block (0 = forever, -1 =  no block)
+ * @param[out] msgptr Pointer from which the message should be copied out
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_WOULDBLOCK Called with timeout == -1 but queue was full
+ * @retval ATOM_TIMEOUT Queue wait timed out before being woken
+ * @retval ATOM_ERR_DELETED Queue was deleted while suspended
+ * @retval ATOM_ERR_CONTEXT Not called in thread context and attempted to block
+ * @retval ATOM_ERR_PARAM Bad parameter
+ * @retval ATOM_ERR_QUEUE Problem putting the thread on the suspend queue
+ * @retval ATOM_ERR_TIMER Problem registering the timeout
+ */
+uint8_t atomQueuePut (ATOM_QUEUE *qptr, int32_t timeout, uint8_t *msgptr)
+{
+    /* Append to the tail of the queue (lowest level on priority queues) */
+    return (queue_put (qptr, timeout, msgptr, QUEUE_LOWEST_PRIORITY, FALSE));
+}
+
+
+/**
+ * \b atomQueuePutUrgent
+ *
+ * Attempt to put an urgent message onto the head of a queue.
+ *
+ * Operates as atomQueuePut(), except that the message is inserted at the
+ * head of the queue rather than the tail, so that it will be the next
+ * message received by atomQueueGet(). On priority queues the message is
+ * inserted at the head of the highest priority level.
+ *
+ * If several urgent messages are posted before any are received, they are
+ * received in LIFO order.
+ *
+ * Blocking behaviour and the \c timeout parameter are as for
+ * atomQueuePut(). The message can only overtake those already on the
+ * queue, so if the queue is full and the call blocks, the message is
+ * inserted at the head once space becomes available.
+ *
+ * This function can only be called from interrupt context if the \c timeout
+ * parameter is -1 (in which case it does not block and may fail to post a
+ * message if the queue is full).
+ *
+ * @param[in] qptr Pointer to queue object
+ * @param[in] timeout Max system ticks to block (0 = forever, -1 =  no block)
+ * @param[out] msgptr Pointer from which the message should be copied out
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_WOULDBLOCK Called with timeout == -1 but queue was full
+ * @retval ATOM_TIMEOUT Queue wait timed out before being woken
+ * @retval ATOM_ERR_DELETED Queue was deleted while suspended
+ * @retval ATOM_ERR_CONTEXT Not called in thread context and attempted to block
+ * @retval ATOM_ERR_PARAM Bad parameter
+ * @retval ATOM_ERR_QUEUE Problem putting the thread on the suspend queue
+ * @retval ATOM_ERR_TIMER Problem registering the timeout
+ */
+uint8_t atomQueuePutUrgent (ATOM_QUEUE *qptr, int32_t timeout, uint8_t *msgptr)
+{
+    /* Insert at the head of the queue (highest level on priority queues) */
+    return (queue_put (qptr, timeout, msgptr, 0, TRUE));
+}
+
+
+/**
+ * \b atomQueuePutPriority
+ *
+ * Attempt to put a message onto a priority queue at the given level.
+ *
+ * Operates as atomQueuePut(), except that on queues created using
+ * atomQueueCreatePriority() the message is appended to the tail of the
+ * given \c priority level (0 is the highest priority). atomQueueGet()
+ * receives messages from higher priority levels first.
+ *
+ * On plain FIFO queues created using atomQueueCreate() the \c priority
+ * parameter is ignored and the message is appended to the tail of the
+ * queue.
+ *
+ * Blocking behaviour and the \c timeout parameter are as for
+ * atomQueuePut().
+ *
+ * This function can only be called from interrupt context if the \c timeout
+ * parameter is -1 (in which case it does not block and may fail to post a
+ * message if the queue is full).
+ *
+ * @param[in] qptr Pointer to queue object
+ * @param[in] timeout Max system ticks to block (0 = forever, -1 =  no block)
+ * @param[in] priority Message priority level (0 = highest)
+ * @param[out] msgptr Pointer from which the message should be copied out
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_WOULDBLOCK Called with timeout == -1 but queue was full
+ * @retval ATOM_TIMEOUT Queue wait timed out before being woken
+ * @retval ATOM_ERR_DELETED Queue was deleted while suspended
+ * @retval ATOM_ERR_CONTEXT Not called in thread context and attempted to block
+ * @retval ATOM_ERR_PARAM Bad parameter (including out of range priority)
+ * @retval ATOM_ERR_QUEUE Problem putting the thread on the suspend queue
+ * @retval ATOM_ERR_TIMER Problem registering the timeout
+ */
+uint8_t atomQueuePutPriority (ATOM_QUEUE *qptr, int32_t timeout, uint8_t priority, uint8_t *msgptr)
+{
+    uint8_t status;
+
+    /* Check the priority level exists on priority queues */
+    if ((qptr != NULL) && (qptr->levels != NULL) && (priority >= qptr->num_levels))
+    {
+        /* Bad priority level */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Append to the tail of the requested level */
+        status = queue_put (qptr, timeout, msgptr, priority, FALSE);
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomQueueStatsEnable
+ *
+ * Enables statistics gathering on a queue.
+ *
+ * Should be called after the queue is created using atomQueueCreate() or
+ * atomQueueCreatePriority(), and before the queue is used. The caller
+ * provides the ATOM_QUEUE_STATS object \c stats which is zeroed and then
+ * updated on each queue operation, and can be read at any time using
+ * atomQueueStatsRead().
+ *
+ * If put-to-get latency is also to be measured, the caller provides the
+ * \c timestamps array, which must have one entry for each message slot in
+ * the queue storage (\c max_num_msgs entries). Messages handed directly to
+ * a waiting receiver are counted with zero latency. Pass NULL if latency is
+ * not required, which avoids the cost of stamping each message.
+ *
+ * Passing NULL for \c stats disables statistics on the queue.
+ *
+ * This function can be called from interrupt context.
+ *
+ * @param[in] qptr Pointer to queue object
+ * @param[in] stats Pointer to statistics object, or NULL to disable
+ * @param[in] timestamps Pointer to per-slot timestamp array, or NULL
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_PARAM Bad parameters
+ */
+uint8_t atomQueueStatsEnable (ATOM_QUEUE *qptr, ATOM_QUEUE_STATS *stats, uint32_t *timestamps)
+{
+    uint8_t status;
+    CRITICAL_STORE;
+
+    /* Parameter check */
+    if ((qptr == NULL) || ((stats == NULL) && (timestamps != NULL)))
+    {
+        /* Bad pointer */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Start from zeroed statistics */
+        if (stats)
+            memset (stats, 0, sizeof(ATOM_QUEUE_STATS));
+
+        /* Protect access to the queue object */
+        CRITICAL_START ();
+
+        /* Attach the statistics to the queue */
+        if (stats)
+            stats->max_msgs_stored = qptr->num_msgs_stored;
+        qptr->stats = stats;
+        qptr->timestamps = timestamps;
+
+        /* Exit critical region */
+        CRITICAL_END ();
+
+        /* Successful */
+        status = ATOM_OK;
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomQueueStatsRead
+ *
+ * Reads the statistics gathered on a queue.
+ *
+ * Copies the current statistics for a queue into the caller's \c stats
+ * object. The copy is taken with interrupts locked out, so all of the
+ * values are consistent with each other. If \c reset is TRUE the queue's
+ * statistics are zeroed at the same time, starting a new measurement
+ * period, except that the high-water mark starts again from the number of
+ * messages currently stored.
+ *
+ * This function can be called from interrupt context.
+ *
+ * @param[in] qptr Pointer to queue object
+ * @param[out] stats Pointer to storage for the statistics
+ * @param[in] reset TRUE to reset the statistics after reading
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_PARAM Bad parameters
+ * @retval ATOM_ERR_NOT_FOUND Statistics are not enabled on the queue
+ */
+uint8_t atomQueueStatsRead (ATOM_QUEUE *qptr, ATOM_QUEUE_STATS *stats, uint8_t reset)
+{
+    uint8_t status;
+    CRITICAL_STORE;
+
+    /* Parameter check */
+    if ((qptr == NULL) || (stats == NULL))
+    {
+        /* Bad pointer */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Protect access to the queue object */
+        CRITICAL_START ();
+
+        /* Check statistics are enabled */
+        if (qptr->stats == NULL)
+        {
+            status = ATOM_ERR_NOT_FOUND;
+        }
+        else
+        {
+            /* Take a copy, and reset for the next period if requested */
+            memcpy (stats, qptr->stats, sizeof(ATOM_QUEUE_STATS));
+            if (reset)
+            {
+                memset (qptr->stats, 0, sizeof(ATOM_QUEUE_STATS));
+                qptr->stats->max_msgs_stored = qptr->num_msgs_stored;
+            }
+
+            /* Successful */
+            status = ATOM_OK;
+        }
+
+        /* Exit critical region */
+        CRITICAL_END ();
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomQueueTimerCallback
+ *
+ * This is an internal function not for use by application code.
+ *
+ * Timeouts on suspended threads are notified by the timer system through
+ * this generic callback. The timer system calls us back with a pointer to
+ * the relevant \c QUEUE_TIMER object which is used to retrieve the
+ * queue details.
+ *
+ * @param[in] cb_data Pointer to a QUEUE_TIMER object
+ */
+static void atomQueueTimerCallback (POINTER cb_data)
+{
+    QUEUE_TIMER *timer_data_ptr;
+    CRITICAL_STORE;
+
+    /* Get the QUEUE_TIMER structure pointer */
+    timer_data_ptr = (QUEUE_TIMER *)cb_data;
+
+    /* Check parameter is valid */
+    if (timer_data_ptr)
+    {
+        /* Enter critical region */
+        CRITICAL_START ();
+
+        /* Only act if the thread was not woken before we got here */
+        if (timer_data_ptr->tcb_ptr->suspend_timo_cb)
+        {
+            /* Set status to indicate to the waiting thread that it timed out */
+            timer_data_ptr->tcb_ptr->suspend_wake_status = ATOM_TIMEOUT;
+
+            /* Flag as no timeout registered */
+            timer_data_ptr->tcb_ptr->suspend_timo_cb = NULL;
+
+            /**
+             * Remove this thread from the queue's suspend list. Handles threads
+             * suspended on the receive list as well as the send list.
+             */
+            (void)tcbDequeueEntry (timer_data_ptr->suspQ, timer_data_ptr->tcb_ptr);
+
+            /* Put the thread on the ready queue */
+            (void)tcbEnqueuePriority (&tcbReadyQ, timer_data_ptr->tcb_ptr);
+        }
+
+        /* Exit critical region */
+        CRITICAL_END ();
+
+        /**
+         * Note that we don't call the scheduler now as it will be called
+         * when we exit the ISR by atomIntExit().
+         */
+    }
+}
+
+
+/**
+ * \b queue_put
+ *
+ * This is an internal function not for use by application code.
+ *
+ * Common implementation of atomQueuePut(), atomQueuePutUrgent() and
+ * atomQueuePutPriority(). Blocks the calling thread if the queue is full
+ * (depending on \c timeout) and then inserts the message at the requested
+ * position.
+ *
+ * @param[in] qptr Pointer to queue object
+ * @param[in] timeout Max system ticks to block (0 = forever, -1 =  no block)
+ * @param[out] msgptr Pointer from which the message should be copied out
+ * @param[in] priority Priority level to insert at (priority queues only)
+ * @param[in] urgent TRUE to insert at the head rather than the tail
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_WOULDBLOCK Called with timeout == -1 but queue was full
+ * @retval ATOM_TIMEOUT Queue wait timed out before being woken
+ * @retval ATOM_ERR_DELETED Queue was deleted while suspended
+ * @retval ATOM_ERR_CONTEXT Not called in thread context and attempted to block
+ * @retval ATOM_ERR_PARAM Bad parameter
+ * @retval ATOM_ERR_QUEUE Problem putting the thread on the suspend queue
+ * @retval ATOM_ERR_TIMER Problem registering the timeout
+ */
+static uint8_t queue_put (ATOM_QUEUE *qptr, int32_t timeout, uint8_t *msgptr, uint8_t priority, uint8_t urgent)
+{
+    CRITICAL_STORE;
+    uint8_t status;
+    QUEUE_PUT_WAIT put_wait;
+    QUEUE_TIMER timer_data;
+    ATOM_TIMER timer_cb;
+    ATOM_TCB *curr_tcb_ptr;
+    uint32_t start_time;
+
+    /* Check parameters */
+    if ((qptr == NULL) || (msgptr == NULL))
+    {
+        /* Bad pointer */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Protect access to the queue object and OS queues */
+        CRITICAL_START ();
+
+        /* If queue is full, block the calling thread */
+        if (qptr->num_msgs_stored == qptr->max_num_msgs)
+        {
+            /* If called with timeout >= 0, we should block */
+            if (timeout >= 0)
+            {
+                /* Queue is full, block the calling thread */
+
+                /* Get the current TCB */
+                curr_tcb_ptr = atomCurrentContext();
+
+                /* Check we are actually in thread context */
+                if (curr_tcb_ptr)
+                {
+                    /* Add current thread to the suspend list on sends */
+                    if (tcbEnqueuePriority (&qptr->putSuspQ, curr_tcb_ptr) == ATOM_OK)
+                    {
+                        /* Set suspended status for the current thread */
+                        curr_tcb_ptr->suspended = TRUE;
+
+                        /**
+                         * Leave the message details with the TCB so that
+                         * the thread which next removes a message can post
+                         * ours into the space it makes.
+                         */
+                        put_wait.msgptr = msgptr;
+                        put_wait.priority = priority;
+                        put_wait.urgent = urgent;
+                        curr_tcb_ptr->suspend_data = (POINTER)&put_wait;
+
+                        /* Track errors */
+                        status = ATOM_OK;
+
+                        /* Register a timer callback if requested */
+                        if (timeout)
+                        {
+                            /**
+                             * Fill out the data needed by the callback to
+                             * wake us up.
+                             */
+                            timer_data.tcb_ptr = curr_tcb_ptr;
+                            timer_data.queue_ptr = qptr;
+                            timer_data.suspQ = &qptr->putSuspQ;
+
+
+                            /* Fill out the timer callback request structure */
+                            timer_cb.cb_func = atomQueueTimerCallback;
+                            timer_cb.cb_data = (POINTER)&timer_data;
+                            timer_cb.cb_ticks = timeout;
+
+                            /**
+                             * Store the timer details in the TCB so that we
+                             * can cancel the timer callback if a message is
+                             * removed from the queue before the timeout
+                             * occurs.
+                             */
+                            curr_tcb_ptr->suspend_timo_cb = &timer_cb;
+
+                            /* Register a callback on timeout */
+                            if (atomTimerRegister (&timer_cb) != ATOM_OK)
+                            {
+                                /* Timer registration failed */
+                                status = ATOM_ERR_TIMER;
+
+                                /* Clean up and return to the caller */
+                                (void)tcbDequeueEntry (&qptr->putSuspQ, curr_tcb_ptr);
+                                curr_tcb_ptr->suspended = FALSE;
+                                curr_tcb_ptr->suspend_timo_cb = NULL;
+                                curr_tcb_ptr->suspend_data = NULL;
+                            }
+                        }
+
+                        /* Set no timeout requested */
+                        else
+                        {
+                            /* No need to cancel timeouts on this one */
+                            curr_tcb_ptr->suspend_timo_cb = NULL;
+                        }
+
+                        /* Count the blocked call and note when it started */
+                        if ((status == ATOM_OK) && qptr->stats)
+                            qptr->stats->put_blocked++;
+                        start_time = atomTimeGet();
+
+                        /* Exit critical region */
+                        CRITICAL_END ();
+
+                        /* Check timer registration was successful */
+                        if (status == ATOM_OK)
+                        {
+                            /**
+                             * Current thread now blocking, schedule in a new
+                             * one. We already know we are in thread context
+                             * so can call the scheduler from here.
+                             */
+                            atomSched (FALSE);
+
+                            /**
+                             * Normal atomQueueGet() wakeups will set ATOM_OK
+                             * status, having already posted our message into
+                             * the space made on the queue, while timeouts
+                             * will set ATOM_TIMEOUT and queue deletions will
+                             * set ATOM_ERR_DELETED.
+                             */
+                            status = curr_tcb_ptr->suspend_wake_status;
+                            curr_tcb_ptr->suspend_data = NULL;
+
+                            /* Record the time spent blocked */
+                            if (qptr->stats)
+                            {
+                                CRITICAL_START ();
+                                queue_stats_add (&qptr->stats->put_wait_ticks, &qptr->stats->put_wait_max, atomTimeGet() - start_time);
+                                CRITICAL_END ();
+                            }
+                        }
+                    }
+                    else
+                    {
+                        /* There was an error putting this thread on the suspend list */
+                        CRITICAL_END ();
+                        status = ATOM_ERR_QUEUE;
+                    }
+                }
+                else
+                {
+                    /* Not currently in thread context, can't suspend */
+                    CRITICAL_END ();
+                    status = ATOM_ERR_CONTEXT;
+                }
+            }
+            else
+            {
+                /* timeout == -1, cannot block. Just return queue is full */
+                if (qptr->stats)
+                    qptr->stats->put_wouldblock++;
+                CRITICAL_END();
+                status = ATOM_WOULDBLOCK;
+            }
+        }
+        else
+        {
+            /* No need to block, there is space to copy into the queue */
+            status = queue_insert (qptr, msgptr, priority, urgent);
+
+            /* Exit critical region */
+            CRITICAL_END ();
+
+            /**
+             * The scheduler may now make a policy decision to thread
+             * switch if we are currently in thread context. If we are
+             * in interrupt context it will be handled by atomIntExit().
+             */
+            if (atomCurrentContext())
+                atomSched (FALSE);
+        }
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b queue_remove
+ *
+ * This is an internal function not for use by application code.
+ *
+ * Removes a message from a queue. Assumes that there is a message present,
+ * which is already checked by the calling functions with interrupts locked
+ * out. On priority queues the message is taken from the highest priority
+ * level which has messages waiting.
+ *
+ * Also completes the post for a suspended thread if there are any waiting
+ * to send on the queue: the waiting thread's message is copied into the
+ * space just made before the thread is woken, so that no other thread can
+ * take the space first.
+ *
+ * Assumes interrupts are already locked out.
+ *
+ * @param[in] qptr Pointer to an ATOM_QUEUE object
+ * @param[in] msgptr Destination pointer for the message to be copied into
  *
  * @retval ATOM_OK Success
  * @retval ATOM_ERR_PARAM Bad parameter
  * @retval ATOM_ERR_QUEUE Problem putting a thread on the ready queue
- * @retval ATOM_ERR_TIMER Problem cancelling a timeout
  */
 static uint8_t queue_remove (ATOM_QUEUE *qptr, uint8_t* msgptr)
 {
     uint8_t status;
     ATOM_TCB *tcb_ptr;
+    ATOM_QUEUE_LEVEL *level_ptr;
+    QUEUE_PUT_WAIT *put_wait_ptr;
+    uint8_t *slot_ptr;
+    uint32_t slot;
 
     /* Check parameters */
     if ((qptr == NULL) || (msgptr == NULL))
@@ -797,44 +1547,80 @@ static uint8_t queue_remove (ATOM_QUEUE *qptr, uint8_t* msgptr)
     }
     else
     {
+        /**
+         * Find the message to remove. Priority queues use the head slot of
+         * the highest priority level which has any messages waiting (there
+         * must be one because the total count is non-zero), and return the
+         * slot to the free list. Plain queues use the ring buffer indexes
+         * in the queue object itself.
+         */
+        if (qptr->levels)
+        {
+            level_ptr = qptr->levels;
+            while (level_ptr->num_msgs_stored == 0)
+                level_ptr++;
+            level_ptr->num_msgs_stored--;
+            slot = level_ptr->head_slot;
+            level_ptr->head_slot = qptr->slot_links[slot];
+            qptr->slot_links[slot] = qptr->free_slot;
+            qptr->free_slot = slot;
+            slot_ptr = qptr->buff_ptr + (slot * qptr->unit_size);
+        }
+        else
+        {
+            slot_ptr = qptr->buff_ptr + qptr->remove_index;
+            qptr->remove_index += qptr->unit_size;
+
+            /* Check if the remove index should now wrap to the beginning */
+            if (qptr->remove_index >= (qptr->unit_size * qptr->max_num_msgs))
+                qptr->remove_index = 0;
+        }
+
+        /* Record how long the message waited, if measuring latency */
+        if (qptr->timestamps)
+        {
+            slot = (uint32_t)(slot_ptr - qptr->buff_ptr) / qptr->unit_size;
+            qptr->stats->latency_count++;
+            queue_stats_add (&qptr->stats->latency_ticks, &qptr->stats->latency_max, atomTimeGet() - qptr->timestamps[slot]);
+        }
+
         /* There is a message on the queue, copy it out */
-        memcpy (msgptr, (qptr->buff_ptr + qptr->remove_index), qptr->unit_size);
-        qptr->remove_index += qptr->unit_size;
+        memcpy (msgptr, slot_ptr, qptr->unit_size);
         qptr->num_msgs_stored--;
 
-        /* Check if the remove index should now wrap to the beginning */
-        if (qptr->remove_index >= (qptr->unit_size * qptr->max_num_msgs))
-            qptr->remove_index = 0;
-
         /**
-         * If there are threads waiting to send, wake one up now. Waiting
-         * threads are woken up in priority order, with same-priority
-         * threads woken up in FIFO order.
+         * If there are threads waiting to send, post the message for the
+         * first one now and wake it up. Waiting threads are served in
+         * priority order, with same-priority threads served in FIFO order.
+         * A thread's message is only posted once its timeout has been
+         * cancelled. A timeout which cannot be cancelled is already being
+         * called back and will wake the thread with ATOM_TIMEOUT, so that
+         * thread is passed over for the next waiting sender.
          */
-        tcb_ptr = tcbDequeueHead (&qptr->putSuspQ);
+        while ((tcb_ptr = tcbDequeueHead (&qptr->putSuspQ)) != NULL)
+        {
+            if ((tcb_ptr->suspend_timo_cb == NULL)
+                || (atomTimerCancel (tcb_ptr->suspend_timo_cb) == ATOM_OK))
+            {
+                /* Flag as no timeout registered */
+                tcb_ptr->suspend_timo_cb = NULL;
+                break;
+            }
+        }
         if (tcb_ptr)
         {
+            /* Copy the waiting thread's message into the space just made */
+            put_wait_ptr = (QUEUE_PUT_WAIT *)tcb_ptr->suspend_data;
+            queue_store (qptr, put_wait_ptr->msgptr, put_wait_ptr->priority, put_wait_ptr->urgent);
+
+            /* Set OK status to be returned to the waiting thread */
+            tcb_ptr->suspend_wake_status = ATOM_OK;
+
             /* Move the waiting thread to the ready queue */
             if (tcbEnqueuePriority (&tcbReadyQ, tcb_ptr) == ATOM_OK)
             {
-                /* Set OK status to be returned to the waiting thread */
-                tcb_ptr->suspend_wake_status = ATOM_OK;
-
-                /* If there's a timeout on this suspension, cancel it */
-                if ((tcb_ptr->suspend_timo_cb != NULL)
-                    && (atomTimerCancel (tcb_ptr->suspend_timo_cb) != ATOM_OK))
-                {
-                    /* There was a problem cancelling a timeout */
-                    status = ATOM_ERR_TIMER;
-                }
-                else
-                {
-                    /* Flag as no timeout registered */
-                    tcb_ptr->suspend_timo_cb = NULL;
-
-                    /* Successful */
-                    status = ATOM_OK;
-                }
+                /* Successful */
+                status = ATOM_OK;
             }
             else
             {
@@ -856,32 +1642,78 @@ static uint8_t queue_remove (ATOM_QUEUE *qptr, uint8_t* msgptr)
 }
 
 
+/**
+ * \b queue_head
+ *
+ * This is an internal function not for use by application code.
+ *
+ * Locates the message at the head of a queue, i.e. the message which will
+ * be returned by the next queue_remove(). Assumes that there is a message
+ * present, which is already checked by the calling functions with
+ * interrupts locked out.
+ *
+ * Assumes interrupts are already locked out.
+ *
+ * @param[in] qptr Pointer to an ATOM_QUEUE object
+ *
+ * @return Pointer to the head message within the queue storage
+ */
+static uint8_t *queue_head (ATOM_QUEUE *qptr)
+{
+    ATOM_QUEUE_LEVEL *level_ptr;
+    uint8_t *msg_ptr;
+
+    /* Priority queues: find the highest level with messages waiting */
+    if (qptr->levels)
+    {
+        level_ptr = qptr->levels;
+        while (level_ptr->num_msgs_stored == 0)
+            level_ptr++;
+        msg_ptr = qptr->buff_ptr + (level_ptr->head_slot * qptr->unit_size);
+    }
+    else
+    {
+        msg_ptr = qptr->buff_ptr + qptr->remove_index;
+    }
+
+    return (msg_ptr);
+}
+
+
 /**
  * \b queue_insert
  *
  * This is an internal function not for use by application code.
  *
- * Inserts a message onto a queue. Assumes that the queue has space for one
+ * Posts a message to a queue. Assumes that the queue has space for one
  * message, which has already been checked by the calling function with
  * interrupts locked out.
  *
- * Also wakes up a suspended thread if there are any waiting to receive on the
- * queue.
+ * Threads waiting to peek or receive can only be present if the queue is
+ * empty. Any peeking threads are each given a copy of the message and
+ * woken. If a thread is waiting to receive, the message is copied
+ * straight into the receiving thread's destination and the thread woken,
+ * without the message passing through the queue buffer. Otherwise the
+ * message is stored on the queue. Messages are only handed to a waiting
+ * thread after its timeout has been cancelled, so they cannot be lost to
+ * a thread which is about to time out.
  *
  * Assumes interrupts are already locked out.
  *
  * @param[in] qptr Pointer to an ATOM_QUEUE object
  * @param[in] msgptr Source pointer for the message to be copied out of
+ * @param[in] priority Priority level to insert at (priority queues only)
+ * @param[in] urgent TRUE to insert at the head rather than the tail
  *
  * @retval ATOM_OK Success
  * @retval ATOM_ERR_PARAM Bad parameter
  * @retval ATOM_ERR_QUEUE Problem putting a thread on the ready queue
- * @retval ATOM_ERR_TIMER Problem cancelling a timeout
  */
-static uint8_t queue_insert (ATOM_QUEUE *qptr, uint8_t* msgptr)
+static uint8_t queue_insert (ATOM_QUEUE *qptr, uint8_t* msgptr, uint8_t priority, uint8_t urgent)
 {
     uint8_t status;
     ATOM_TCB *tcb_ptr;
+    ATOM_TCB *receiver_tcb_ptr;
 
     /* Check parameters */
     if ((qptr == NULL) || (msgptr == NULL))
@@ -891,46 +1723,87 @@ static uint8_t queue_insert (ATOM_QUEUE *qptr, uint8_t* msgptr)
     }
     else
     {
-        /* There is space in the queue, copy it in */
-        memcpy ((qptr->buff_ptr + qptr->insert_index), msgptr, qptr->unit_size);
-        qptr->insert_index += qptr->unit_size;
-        qptr->num_msgs_stored++;
+        /* Default to success unless errors occur during wakeups */
+        status = ATOM_OK;
 
-        /* Check if the insert index should now wrap to the beginning */
-        if (qptr->insert_index >= (qptr->unit_size * qptr->max_num_msgs))
-            qptr->insert_index = 0;
+        /**
+         * If there are threads waiting to receive, take the first now.
+         * Waiting threads are woken up in priority order, with
+         * same-priority threads woken up in FIFO order. The message is
+         * handed to it directly, otherwise it is stored on the queue.
+         *
+         * The message is only copied out once the receiver's timeout has
+         * been cancelled. A timeout which cannot be cancelled is already
+         * being called back and will wake the thread with ATOM_TIMEOUT,
+         * so that thread is passed over for the next waiting receiver.
+         */
+        while ((receiver_tcb_ptr = tcbDequeueHead (&qptr->getSuspQ)) != NULL)
+        {
+            if ((receiver_tcb_ptr->suspend_timo_cb == NULL)
+                || (atomTimerCancel (receiver_tcb_ptr->suspend_timo_cb) == ATOM_OK))
+            {
+                /* Flag as no timeout registered */
+                receiver_tcb_ptr->suspend_timo_cb = NULL;
+                break;
+            }
+        }
+        if (receiver_tcb_ptr)
+        {
+            memcpy (receiver_tcb_ptr->suspend_data, msgptr, qptr->unit_size);
+
+            /* The message was received without waiting in the queue */
+            if (qptr->timestamps)
+                qptr->stats->latency_count++;
+        }
+        else
+        {
+            queue_store (qptr, msgptr, priority, urgent);
+        }
 
         /**
-         * If there are threads waiting to receive, wake one up now. Waiting
-         * threads are woken up in priority order, with same-priority
-         * threads woken up in FIFO order.
+         * If there are threads waiting to peek, wake them all up now. Each
+         * is handed a copy of the message (which, as peekers only wait on
+         * an empty queue, is the new head message). As above, threads whose
+         * timeout is already being called back are left to time out.
          */
-        tcb_ptr = tcbDequeueHead (&qptr->getSuspQ);
-        if (tcb_ptr)
+        while ((tcb_ptr = tcbDequeueHead (&qptr->peekSuspQ)) != NULL)
         {
-            /* Move the waiting thread to the ready queue */
-            if (tcbEnqueuePriority (&tcbReadyQ, tcb_ptr) == ATOM_OK)
+            /* If there's a timeout on this suspension, cancel it */
+            if ((tcb_ptr->suspend_timo_cb != NULL)
+                && (atomTimerCancel (tcb_ptr->suspend_timo_cb) != ATOM_OK))
             {
-                /* Set OK status to be returned to the waiting thread */
-                tcb_ptr->suspend_wake_status = ATOM_OK;
+                /* The timeout callback will wake this thread */
+                continue;
+            }
 
-                /* If there's a timeout on this suspension, cancel it */
-                if ((tcb_ptr->suspend_timo_cb != NULL)
-                    && (atomTimerCancel (tcb_ptr->suspend_timo_cb) != ATOM_OK))
-                {
-                    /* There was a problem cancelling a timeout */
-                    status = ATOM_ERR_TIMER;
-                }
-                else
-                {
-                    /* Flag as no timeout registered */
-                    tcb_ptr->suspend_timo_cb = NULL;
+            /* Flag as no timeout registered */
+            tcb_ptr->suspend_timo_cb = NULL;
 
-                    /* Successful */
-                    status = ATOM_OK;
-                }
+            /* Copy the message into the peeking thread's storage */
+            memcpy (tcb_ptr->suspend_data, msgptr, qptr->unit_size);
+
+            /* Set OK status to be returned to the waiting thread */
+            tcb_ptr->suspend_wake_status = ATOM_OK;
+
+            /* Move the waiting thread to the ready queue */
+            if (tcbEnqueuePriority (&tcbReadyQ, tcb_ptr) != ATOM_OK)
+            {
+                /**
+                 * There was a problem putting the thread on the ready
+                 * queue.
+                 */
+                status = ATOM_ERR_QUEUE;
             }
-            else
+        }
+
+        /* Wake the receiving thread, which already has its message */
+        if ((tcb_ptr = receiver_tcb_ptr) != NULL)
+        {
+            /* Set OK status to be returned to the waiting thread */
+            tcb_ptr->suspend_wake_status = ATOM_OK;
+
+            /* Move the waiting thread to the ready queue */
+            if (tcbEnqueuePriority (&tcbReadyQ, tcb_ptr) != ATOM_OK)
             {
                 /**
                  * There was a problem putting the thread on the ready
@@ -939,12 +1812,141 @@ static uint8_t queue_insert (ATOM_QUEUE *qptr, uint8_t* msgptr)
                 status = ATOM_ERR_QUEUE;
             }
         }
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b queue_store
+ *
+ * This is an internal function not for use by application code.
+ *
+ * Copies a message into the queue buffer. Assumes that the queue has space
+ * for one message, which has already been checked by the calling function
+ * with interrupts locked out. Does not wake any threads.
+ *
+ * The message is appended at the tail, or inserted at the head if
+ * \c urgent is TRUE. On priority queues the message is placed in a free
+ * slot, which is linked into the list for the given \c priority level.
+ *
+ * Assumes interrupts are already locked out.
+ *
+ * @param[in] qptr Pointer to an ATOM_QUEUE object
+ * @param[in] msgptr Source pointer for the message to be copied out of
+ * @param[in] priority Priority level to insert at (priority queues only)
+ * @param[in] urgent TRUE to insert at the head rather than the tail
+ *
+ * @return None
+ */
+static void queue_store (ATOM_QUEUE *qptr, uint8_t* msgptr, uint8_t priority, uint8_t urgent)
+{
+    ATOM_QUEUE_LEVEL *level_ptr;
+    uint8_t *slot_ptr;
+    uint32_t slot;
+
+    /**
+     * Priority queues: use the requested level, with out of range
+     * priorities (as used by atomQueuePut()) going to the lowest priority
+     * level. There is space in the queue so there is a free slot, either
+     * on the free list or not yet used.
+     */
+    if (qptr->levels)
+    {
+        if (priority >= qptr->num_levels)
+            priority = qptr->num_levels - 1;
+        level_ptr = &qptr->levels[priority];
+        if (qptr->free_slot != QUEUE_NO_SLOT)
+        {
+            slot = qptr->free_slot;
+            qptr->free_slot = qptr->slot_links[slot];
+        }
         else
         {
-            /* There were no threads waiting to send */
-            status = ATOM_OK;
+            slot = qptr->unused_slot++;
+        }
+
+        /* Link the slot in at the head (urgent) or tail of the level */
+        if (urgent)
+        {
+            qptr->slot_links[slot] = level_ptr->head_slot;
+            level_ptr->head_slot = slot;
+            if (level_ptr->num_msgs_stored == 0)
+                level_ptr->tail_slot = slot;
+        }
+        else
+        {
+            if (level_ptr->num_msgs_stored == 0)
+                level_ptr->head_slot = slot;
+            else
+                qptr->slot_links[level_ptr->tail_slot] = slot;
+            level_ptr->tail_slot = slot;
         }
+        level_ptr->num_msgs_stored++;
+        slot_ptr = qptr->buff_ptr + (slot * qptr->unit_size);
     }
 
-    return (status);
+    /* Plain queues: urgent messages go in front of the current head */
+    else if (urgent)
+    {
+        /**
+         * Step the remove index back by one message (wrapping to the end
+         * of the buffer if necessary) and copy the message in there.
+         */
+        if (qptr->remove_index == 0)
+            qptr->remove_index = qptr->unit_size * qptr->max_num_msgs;
+        qptr->remove_index -= qptr->unit_size;
+        slot_ptr = qptr->buff_ptr + qptr->remove_index;
+    }
+    else
+    {
+        /* Normal messages are appended at the tail */
+        slot_ptr = qptr->buff_ptr + qptr->insert_index;
+        qptr->insert_index += qptr->unit_size;
+
+        /* Check if the insert index should now wrap to the beginning */
+        if (qptr->insert_index >= (qptr->unit_size * qptr->max_num_msgs))
+            qptr->insert_index = 0;
+    }
+
+    /* There is space in the queue, copy it in */
+    memcpy (slot_ptr, msgptr, qptr->unit_size);
+    qptr->num_msgs_stored++;
+
+    /* Update the statistics, if enabled on this queue */
+    if (qptr->stats)
+    {
+        /* Track the high-water mark */
+        if (qptr->num_msgs_stored > qptr->stats->max_msgs_stored)
+            qptr->stats->max_msgs_stored = qptr->num_msgs_stored;
+
+        /* Stamp the slot with the time the message was posted */
+        if (qptr->timestamps)
+            qptr->timestamps[(uint32_t)(slot_ptr - qptr->buff_ptr) / qptr->unit_size] = atomTimeGet();
+    }
+}
+
+
+/**
+ * \b queue_stats_add
+ *
+ * This is an internal function not for use by application code.
+ *
+ * Adds a measured number of ticks to a statistics total, and updates the
+ * corresponding maximum if this measurement is the largest yet.
+ *
+ * Assumes interrupts are already locked out.
+ *
+ * @param[in,out] total_ptr Pointer to the total to add to
+ * @param[in,out] max_ptr Pointer to the maximum to update
+ * @param[in] ticks Measured number of ticks
+ *
+ * @return None
+ */
+static void queue_stats_add (uint32_t *total_ptr, uint32_t *max_ptr, uint32_t ticks)
+{
+    *total_ptr += ticks;
+    if (ticks > *max_ptr)
+        *max_ptr = ticks;
 }
@@ -33,22 +33,62 @@
 extern "C" {
 #endif
 
+typedef struct atom_queue_level
+{
+    uint32_t    head_slot;      /* Slot holding the oldest message */
+    uint32_t    tail_slot;      /* Slot holding the newest message */
+    uint32_t    num_msgs_stored;/* Number of messages stored at this level */
+} ATOM_QUEUE_LEVEL;
+
+typedef struct atom_queue_stats
+{
+    uint32_t    max_msgs_stored;/* High-water mark of messages stored */
+    uint32_t    put_blocked;    /* Puts which blocked on a full queue */
+    uint32_t    put_wouldblock; /* Puts which returned ATOM_WOULDBLOCK */
+    uint32_t    put_wait_ticks; /* Total ticks spent blocked in puts */
+    uint32_t    put_wait_max;   /* Longest time blocked in a put (ticks) */
+    uint32_t    get_blocked;    /* Gets which blocked on an empty queue */
+    uint32_t    get_wouldblock; /* Gets which returned ATOM_WOULDBLOCK */
+    uint32_t    get_wait_ticks; /* Total ticks spent blocked in gets */
+    uint32_t    get_wait_max;   /* Longest time blocked in a get (ticks) */
+    uint32_t    latency_count;  /* Messages with put-to-get latency measured */
+    uint32_t    latency_ticks;  /* Total put-to-get latency (ticks) */
+    uint32_t    latency_max;    /* Longest put-to-get latency (ticks) */
+} ATOM_QUEUE_STATS;
+
 typedef struct atom_queue
 {
     ATOM_TCB *  putSuspQ;       /* Queue of threads waiting to send */
     ATOM_TCB *  getSuspQ;       /* Queue of threads waiting to receive */
+    ATOM_TCB *  peekSuspQ;      /* Queue of threads waiting to peek */
     uint8_t *   buff_ptr;       /* Pointer to queue data area */
     uint32_t    unit_size;      /* Size of each message */
     uint32_t    max_num_msgs;   /* Max number of storable messages */
     uint32_t    insert_index;   /* Next byte index to insert into */
     uint32_t    remove_index;   /* Next byte index to remove from */
     uint32_t    num_msgs_stored;/* Number of messages stored */
+    ATOM_QUEUE_LEVEL *levels;   /* Per-level lists (priority queues only) */
+    uint8_t     num_levels;     /* Number of priority levels (0 = FIFO queue) */
+    uint32_t *  slot_links;     /* Next slot in each slot's list (priority queues only) */
+    uint32_t    free_slot;      /* First slot on the free list (priority queues only) */
+    uint32_t    unused_slot;    /* First slot never yet used (priority queues only) */
+    ATOM_QUEUE_STATS *stats;    /* Statistics (NULL if not enabled) */
+    uint32_t *  timestamps;     /* Per-slot put times (NULL if not enabled) */
 } ATOM_QUEUE;
 
 extern uint8_t atomQueueCreate (ATOM_QUEUE *qptr, uint8_t *buff_ptr, uint32_t unit_size, uint32_t max_num_msgs);
+extern uint8_t atomQueueCreatePriority (ATOM_QUEUE *qptr, uint8_t *buff_ptr, uint32_t unit_size, uint32_t max_num_msgs, uint32_t *slot_links, ATOM_QUEUE_LEVEL *levels, uint8_t num_levels);
 extern uint8_t atomQueueDelete (ATOM_QUEUE *qptr);
+extern uint8_t atomQueueFlush (ATOM_QUEUE *qptr);
 extern uint8_t atomQueueGet (ATOM_QUEUE *qptr, int32_t timeout, uint8_t *msgptr);
+extern uint8_t atomQueuePeek (ATOM_QUEUE *qptr, int32_t timeout, uint8_t *msgptr);
+extern uint8_t atomQueueCount (ATOM_QUEUE *qptr, uint32_t *count);
+extern uint8_t atomQueueSpace (ATOM_QUEUE *qptr, uint32_t *space);
 extern uint8_t atomQueuePut (ATOM_QUEUE *qptr, int32_t timeout, uint8_t *msgptr);
+extern uint8_t atomQueuePutUrgent (ATOM_QUEUE *qptr, int32_t timeout, uint8_t *msgptr);
+extern uint8_t atomQueuePutPriority (ATOM_QUEUE *qptr, int32_t timeout, uint8_t priority, uint8_t *msgptr);
+extern uint8_t atomQueueStatsEnable (ATOM_QUEUE *qptr, ATOM_QUEUE_STATS *stats, uint32_t *timestamps);
+extern uint8_t atomQueueStatsRead (ATOM_QUEUE *qptr, ATOM_QUEUE_STATS *stats, uint8_t reset);
 
 #ifdef __cplusplus
 }
@@ -58,7 +58,9 @@
  * \par Smart semaphore deletion
  * Where a semaphore is deleted while threads are blocking on it, all blocking
  * threads are woken and returned a status code to indicate the reason for
- * being woken.
+ * being woken. A semaphore can also be flushed with atomSemFlush(), which
+ * wakes all blocking threads in the same way but leaves the semaphore in
+ * use.
  *
  *
  * \n <b> Usage instructions: </b> \n
@@ -161,21 +163,18 @@ uint8_t atomSemCreate (ATOM_SEM *sem, uint8_t initial_count)
  * scheduler will be called during this function which may schedule in one
  * of the woken threads depending on relative priorities.
  *
- * This function can be called from interrupt context, but loops internally
- * waking up all threads blocking on the semaphore, so the potential
- * execution cycles cannot be determined in advance.
+ * This function can be called from interrupt context. All threads blocking
+ * on the semaphore are woken in a single critical section, without searching
+ * the timer list for their timeouts.
  *
  * @param[in] sem Pointer to semaphore object
  *
  * @retval ATOM_OK Success
- * @retval ATOM_ERR_QUEUE Problem putting a woken thread on the ready queue
- * @retval ATOM_ERR_TIMER Problem cancelling a timeout on a woken thread
  */
 uint8_t atomSemDelete (ATOM_SEM *sem)
 {
     uint8_t status;
     CRITICAL_STORE;
-    ATOM_TCB *tcb_ptr;
     uint8_t woken_threads = FALSE;
 
     /* Parameter check */
@@ -186,69 +185,17 @@ uint8_t atomSemDelete (ATOM_SEM *sem)
     }
     else
     {
-        /* Default to success status unless errors occur during wakeup */
-        status = ATOM_OK;
-
-        /* Wake up all suspended tasks */
-        while (1)
-        {
-            /* Enter critical region */
-            CRITICAL_START ();
-
-            /* Check if any threads are suspended */
-            tcb_ptr = tcbDequeueHead (&sem->suspQ);
-
-            /* A thread is suspended on the semaphore */
-            if (tcb_ptr)
-            {
-                /* Return error status to the waiting thread */
-                tcb_ptr->suspend_wake_status = ATOM_ERR_DELETED;
-
-                /* Put the thread on the ready queue */
-                if (tcbEnqueuePriority (&tcbReadyQ, tcb_ptr) != ATOM_OK)
-                {
-                    /* Exit critical region */
-                    CRITICAL_END ();
-
-                    /* Quit the loop, returning error */
-                    status = ATOM_ERR_QUEUE;
-                    break;
-                }
-
-                /* If there's a timeout on this suspension, cancel it */
-                if (tcb_ptr->suspend_timo_cb)
-                {
-                    /* Cancel the callback */
-                    if (atomTimerCancel (tcb_ptr->suspend_timo_cb) != ATOM_OK)
-                    {
-                        /* Exit critical region */
-                        CRITICAL_END ();
-
-                        /* Quit the loop, returning error */
-                        status = ATOM_ERR_TIMER;
-                        break;
-                    }
-
-                    /* Flag as no timeout registered */
-                    tcb_ptr->suspend_timo_cb = NULL;
-
-                }
+        /* Protect access to the semaphore object and OS queues */
+        CRITICAL_START ();
 
-                /* Exit critical region */
-                CRITICAL_END ();
+        /* Wake up all suspended tasks in one go */
+        woken_threads = tcbWakeAll (&sem->suspQ, ATOM_ERR_DELETED);
 
-                /* Request a reschedule */
-                woken_threads = TRUE;
-            }
+        /* Exit critical region */
+        CRITICAL_END ();
 
-            /* No more suspended threads */
-            else
-            {
-                /* Exit critical region and quit the loop */
-                CRITICAL_END ();
-                break;
-            }
-        }
+        /* Successful */
+        status = ATOM_OK;
 
         /* Call scheduler if any threads were woken up */
         if (woken_threads == TRUE)
@@ -266,6 +213,70 @@ uint8_t atomSemDelete (ATOM_SEM *sem)
 }
 
 
+/**
+ * \b atomSemFlush
+ *
+ * Flushes a semaphore object and sets a new count.
+ *
+ * Any threads currently suspended on the semaphore will be woken up with
+ * return status ATOM_ERR_DELETED, then the semaphore count is set to
+ * \c count. Unlike atomSemDelete() the semaphore remains usable
+ * afterwards, and unlike atomSemResetCount() it is safe to use while
+ * threads are suspended on the semaphore. If called at thread context then
+ * the scheduler will be called during this function which may schedule in
+ * one of the woken threads depending on relative priorities.
+ *
+ * This function can be called from interrupt context. All threads blocking
+ * on the semaphore are woken in a single critical section, without
+ * searching the timer list for their timeouts.
+ *
+ * @param[in] sem Pointer to semaphore object
+ * @param[in] count New count value
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_PARAM Bad parameter
+ */
+uint8_t atomSemFlush (ATOM_SEM *sem, uint8_t count)
+{
+    uint8_t status;
+    CRITICAL_STORE;
+    uint8_t woken_threads;
+
+    /* Parameter check */
+    if (sem == NULL)
+    {
+        /* Bad semaphore pointer */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Protect access to the semaphore object and OS queues */
+        CRITICAL_START ();
+
+        /* Wake up all suspended tasks in one go */
+        woken_threads = tcbWakeAll (&sem->suspQ, ATOM_ERR_DELETED);
+
+        /* Set the new count */
+        sem->count = count;
+
+        /* Exit critical region */
+        CRITICAL_END ();
+
+        /* Successful */
+        status = ATOM_OK;
+
+        /**
+         * Only call the scheduler if we are in thread context, otherwise
+         * it will be called on exiting the ISR by atomIntExit().
+         */
+        if (woken_threads && atomCurrentContext())
+            atomSched (FALSE);
+    }
+
+    return (status);
+}
+
+
 /**
  * \b atomSemGet
  *
@@ -539,6 +550,13 @@ uint8_t atomSemPut (ATOM_SEM * sem)
                 {
                     /* There was a problem cancelling a timeout on this semaphore */
                     status = ATOM_ERR_TIMER;
+
+                    /**
+                     * The timeout is already being called back. The thread has
+                     * been woken here, so clear the flag to stop the callback
+                     * from acting on it.
+                     */
+                    tcb_ptr->suspend_timo_cb = NULL;
                 }
                 else
                 {
@@ -594,7 +612,8 @@ uint8_t atomSemPut (ATOM_SEM * sem)
  *
  * Care must be taken when using this function, as there may be threads
  * suspended on the semaphore. In general it should only be used once a
- * semaphore is out of use.
+ * semaphore is out of use. atomSemFlush() can be used instead to release
+ * any suspended threads while setting the count.
  *
  * This function can be called from interrupt context.
  *
@@ -654,17 +673,21 @@ static void atomSemTimerCallback (POINTER cb_data)
         /* Enter critical region */
         CRITICAL_START ();
 
-        /* Set status to indicate to the waiting thread that it timed out */
-        timer_data_ptr->tcb_ptr->suspend_wake_status = ATOM_TIMEOUT;
+        /* Only act if the thread was not woken before we got here */
+        if (timer_data_ptr->tcb_ptr->suspend_timo_cb)
+        {
+            /* Set status to indicate to the waiting thread that it timed out */
+            timer_data_ptr->tcb_ptr->suspend_wake_status = ATOM_TIMEOUT;
 
-        /* Flag as no timeout registered */
-        timer_data_ptr->tcb_ptr->suspend_timo_cb = NULL;
+            /* Flag as no timeout registered */
+            timer_data_ptr->tcb_ptr->suspend_timo_cb = NULL;
 
-        /* Remove this thread from the semaphore's suspend list */
-        (void)tcbDequeueEntry (&timer_data_ptr->sem_ptr->suspQ, timer_data_ptr->tcb_ptr);
+            /* Remove this thread from the semaphore's suspend list */
+            (void)tcbDequeueEntry (&timer_data_ptr->sem_ptr->suspQ, timer_data_ptr->tcb_ptr);
 
-        /* Put the thread on the ready queue */
-        (void)tcbEnqueuePriority (&tcbReadyQ, timer_data_ptr->tcb_ptr);
+            /* Put the thread on the ready queue */
+            (void)tcbEnqueuePriority (&tcbReadyQ, timer_data_ptr->tcb_ptr);
+        }
 
         /* Exit critical region */
         CRITICAL_END ();
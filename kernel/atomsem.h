@@ -45,6 +45,7 @@ extern uint8_t atomSemDelete (ATOM_SEM *sem);
 extern uint8_t atomSemGet (ATOM_SEM *sem, int32_t timeout);
 extern uint8_t atomSemPut (ATOM_SEM *sem);
 extern uint8_t atomSemResetCount (ATOM_SEM *sem, uint8_t count);
+extern uint8_t atomSemFlush (ATOM_SEM *sem, uint8_t count);
 
 #ifdef __cplusplus
 }
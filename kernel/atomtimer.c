@@ -64,10 +64,28 @@
  * interrupts which do not allow for round-robin rescheduling to occur, as
  * they should only occur on a new timer tick.
  *
+ * \par Lost ticks
+ * Ports which can detect that ticks were missed (for example while
+ * interrupts were masked for too long) call atomTimerAdvance() with the
+ * number of elapsed ticks instead, so that the system tick count and timers
+ * keep in step with real time.
+ *
+ * \par Timer list
+ * Registered timers are kept in a list sorted by deadline, in which each
+ * timer's \c cb_ticks holds the number of ticks after the previous timer
+ * in the list (a delta list). A tick therefore only needs to decrement the
+ * first timer, and timers fall due from the head of the list in deadline
+ * order, so the cost of a tick or of atomTimerAdvance() over any number of
+ * ticks depends on the number of timers which expire rather than on the
+ * number registered. Registering a timer walks the list to find its place.
+ *
  */
 
 
 #include "atom.h"
+#ifdef ATOM_CYCLIC
+#include "atomcyclic.h"
+#endif
 
 
 /* Data types */
@@ -87,6 +105,9 @@ typedef struct delay_timer
 /** Pointer to the head of the outstanding timers queue */
 static ATOM_TIMER *timer_queue = NULL;
 
+/** Pointer to the head of the queue of expired timers awaiting callbacks */
+static ATOM_TIMER *callback_queue = NULL;
+
 /** Current system tick count */
 static uint32_t system_ticks = 0;
 
@@ -117,6 +138,9 @@ static void atomTimerDelayCallback (POINTER cb_data);
  * through the time list, so the potential execution cycles cannot be
  * determined in advance.
  *
+ * While the timer is registered \c cb_ticks is used internally, and no
+ * longer holds the ticks until the callback.
+ *
  * @param[in] timer_ptr Pointer to timer descriptor
  *
  * @retval ATOM_OK Success
@@ -125,6 +149,7 @@ static void atomTimerDelayCallback (POINTER cb_data);
 uint8_t atomTimerRegister (ATOM_TIMER *timer_ptr)
 {
     uint8_t status;
+    ATOM_TIMER *prev_ptr, *next_ptr;
     CRITICAL_STORE;
 
     /* Parameter check */
@@ -142,23 +167,38 @@ uint8_t atomTimerRegister (ATOM_TIMER *timer_ptr)
         /*
          * Enqueue in the list of timers.
          *
-         * The list is not ordered, all timers are inserted at the start
-         * of the list. On each system tick increment the list is walked
-         * and the remaining ticks count for that timer is decremented.
-         * Once the remaining ticks reaches zero, the timer callback is
-         * made.
+         * The list is ordered by deadline and each entry holds its ticks
+         * relative to the entry before it. Walk past the timers due at or
+         * before the new one (so timers with the same deadline are called
+         * back in the order they were registered), converting the new
+         * timer's ticks to be relative to the last of them.
          */
-        if (timer_queue == NULL)
+        prev_ptr = NULL;
+        next_ptr = timer_queue;
+        while (next_ptr && (next_ptr->cb_ticks <= timer_ptr->cb_ticks))
         {
-            /* List is empty, insert new head */
-            timer_ptr->next_timer = NULL;
+            timer_ptr->cb_ticks -= next_ptr->cb_ticks;
+            prev_ptr = next_ptr;
+            next_ptr = next_ptr->next_timer;
+        }
+
+        /* Link the new timer in between prev_ptr and next_ptr */
+        timer_ptr->prev_timer = prev_ptr;
+        timer_ptr->next_timer = next_ptr;
+        if (prev_ptr == NULL)
+        {
+            /* Insert new head */
             timer_queue = timer_ptr;
         }
         else
         {
-            /* List has at least one entry, enqueue new timer before */
-            timer_ptr->next_timer = timer_queue;
-            timer_queue = timer_ptr;
+            prev_ptr->next_timer = timer_ptr;
+        }
+        if (next_ptr)
+        {
+            /* The following timer is now due relative to the new one */
+            next_ptr->cb_ticks -= timer_ptr->cb_ticks;
+            next_ptr->prev_timer = timer_ptr;
         }
 
         /* End of list protection */
@@ -177,6 +217,10 @@ uint8_t atomTimerRegister (ATOM_TIMER *timer_ptr)
  *
  * Cancel a timer callback previously registered using atomTimerRegister().
  *
+ * A timer which has expired but whose callback has not yet been made
+ * (because it expired on the same tick as a callback which is now
+ * running) can also be cancelled, and its callback will not be made.
+ *
  * This function can be called from interrupt context, but loops internally
  * through the time list, so the potential execution cycles cannot be
  * determined in advance.
@@ -190,7 +234,7 @@ uint8_t atomTimerRegister (ATOM_TIMER *timer_ptr)
 uint8_t atomTimerCancel (ATOM_TIMER *timer_ptr)
 {
     uint8_t status = ATOM_ERR_NOT_FOUND;
-    ATOM_TIMER *prev_ptr, *next_ptr;
+    ATOM_TIMER *next_ptr;
     CRITICAL_STORE;
 
     /* Parameter check */
@@ -204,33 +248,37 @@ uint8_t atomTimerCancel (ATOM_TIMER *timer_ptr)
         /* Protect the list */
         CRITICAL_START ();
 
-        /* Walk the list to find the relevant timer */
-        prev_ptr = next_ptr = timer_queue;
-        while (next_ptr)
+        /*
+         * Walk the lists to find the relevant timer. The walk is only
+         * needed to validate the timer passed in by the application, kernel
+         * code which knows that a timer is registered uses
+         * atomTimerDequeue().
+         */
+        next_ptr = timer_queue;
+        while (next_ptr && (next_ptr != timer_ptr))
+        {
+            /* Move on to the next in the list */
+            next_ptr = next_ptr->next_timer;
+        }
+
+        /* If not outstanding, look in the expired timers awaiting callbacks */
+        if (next_ptr == NULL)
         {
-            /* Is this entry the one we're looking for? */
-            if (next_ptr == timer_ptr)
+            next_ptr = callback_queue;
+            while (next_ptr && (next_ptr != timer_ptr))
             {
-                if (next_ptr == timer_queue)
-                {
-                    /* We're removing the list head */
-                    timer_queue = next_ptr->next_timer;
-                }
-                else
-                {
-                    /* We're removing a mid or tail TCB */
-                    prev_ptr->next_timer = next_ptr->next_timer;
-                }
-
-                /* Successful */
-                status = ATOM_OK;
-                break;
+                next_ptr = next_ptr->next_timer;
             }
+        }
 
-            /* Move on to the next in the list */
-            prev_ptr = next_ptr;
-            next_ptr = next_ptr->next_timer;
+        /* Is this entry the one we're looking for? */
+        if (next_ptr)
+        {
+            /* Remove it from the list */
+            atomTimerDequeue (timer_ptr);
 
+            /* Successful */
+            status = ATOM_OK;
         }
 
         /* End of list protection */
@@ -241,6 +289,65 @@ uint8_t atomTimerCancel (ATOM_TIMER *timer_ptr)
 }
 
 
+/**
+ * \b atomTimerDequeue
+ *
+ * This is an internal function not for use by application code.
+ *
+ * Removes a registered timer from the timer list without calling its
+ * callback. Unlike atomTimerCancel() the list is not searched, the timer
+ * is unlinked using its own list pointers, so this takes a fixed number of
+ * cycles. It is used by the kernel to cancel suspension timeouts.
+ *
+ * The timer's remaining ticks are handed on to the following timer, whose
+ * ticks are relative to it.
+ *
+ * A timer which has expired but whose callback has not been made yet is
+ * taken off the queue of pending callbacks instead, so its callback is not
+ * made. This happens when a callback wakes a thread whose own timeout
+ * expired on the same tick. Timers which are on neither queue (their
+ * callback has already been made) are left alone.
+ *
+ * \b NOTE: Assumes that the caller is already in a critical section.
+ *
+ * @param[in] timer_ptr Pointer to timer to remove
+ *
+ * @return None
+ */
+void atomTimerDequeue (ATOM_TIMER *timer_ptr)
+{
+    if (timer_ptr->prev_timer)
+    {
+        /* We're removing a mid or tail timer */
+        timer_ptr->prev_timer->next_timer = timer_ptr->next_timer;
+    }
+    else if (timer_queue == timer_ptr)
+    {
+        /* We're removing the list head */
+        timer_queue = timer_ptr->next_timer;
+    }
+    else if (callback_queue == timer_ptr)
+    {
+        /* We're removing the head of the pending callbacks */
+        callback_queue = timer_ptr->next_timer;
+    }
+    else
+    {
+        /* Not on either queue, nothing to remove */
+        return;
+    }
+
+    /* Hand the remaining ticks on (timers awaiting callbacks have none) */
+    if (timer_ptr->next_timer)
+    {
+        timer_ptr->next_timer->cb_ticks += timer_ptr->cb_ticks;
+        timer_ptr->next_timer->prev_timer = timer_ptr->prev_timer;
+    }
+
+    timer_ptr->prev_timer = timer_ptr->next_timer = NULL;
+}
+
+
 /**
  * \b atomTimeGet
  *
@@ -294,14 +401,76 @@ void atomTimeSet(uint32_t new_time)
  */
 void atomTimerTick (void)
 {
+    atomTimerAdvance (1);
+}
+
+
+/**
+ * \b atomTimerAdvance
+ *
+ * Multiple system tick handler.
+ *
+ * Accounts for a number of elapsed system ticks in one call, for ports which
+ * have detected that ticks were missed. The system tick count is advanced
+ * and timers due within the span are called back, in deadline order and
+ * with the system tick count at their deadline, so that they behave as if
+ * each tick had been handled by atomTimerTick().
+ *
+ * The timer list is stepped from one deadline to the next, so the cost
+ * depends on the number of timers which expire rather than on the number
+ * of ticks and registered timers. The other per-tick kernel accounting
+ * (execution budgets and, if enabled, partition windows and the cyclic
+ * executive) is charged a whole step at a time in the same way.
+ *
+ * Must be called from the timer interrupt, in place of atomTimerTick().
+ *
+ * @param[in] ticks Number of system ticks elapsed
+ *
+ * @return None
+ */
+void atomTimerAdvance (uint32_t ticks)
+{
+    uint32_t step;
+
     /* Only do anything if the OS is started */
     if (atomOSStarted)
     {
-        /* Increment the system tick count */
-        system_ticks++;
+        while (ticks > 0)
+        {
+            /* Advance to the next timer deadline, or by all remaining ticks */
+            step = ticks;
+            if (timer_queue && (timer_queue->cb_ticks < step))
+            {
+                step = timer_queue->cb_ticks;
+            }
+            ticks -= step;
+
+            /* Increment the system tick count */
+            system_ticks += step;
 
-        /* Check for any callbacks that are due */
-        atomTimerCallbacks ();
+            /* Charge the step to the running thread's execution budget */
+            atomBudgetTick (step);
+
+#ifdef ATOM_NUM_PARTITIONS
+            /* Move on through the partition windows which have ended */
+            atomPartitionTick (step);
+#endif
+
+#ifdef ATOM_CYCLIC
+            /* Release any cyclic executive jobs due within the step */
+            atomCyclicTick (step);
+#endif
+
+            /* Count down the first timer, and call back any now due */
+            if (timer_queue)
+            {
+                timer_queue->cb_ticks -= step;
+                if (timer_queue->cb_ticks == 0)
+                {
+                    atomTimerCallbacks ();
+                }
+            }
+        }
     }
 }
 
@@ -374,6 +543,9 @@ uint8_t atomTimerDelay (uint32_t ticks)
         /* Register the callback */
         if (atomTimerRegister (&timer_cb) != ATOM_OK)
         {
+            /* Clean up, no timeout registered */
+            curr_tcb_ptr->suspend_timo_cb = NULL;
+
             /* Exit critical region */
             CRITICAL_END ();
 
@@ -408,103 +580,84 @@ uint8_t atomTimerDelay (uint32_t ticks)
  */
 static void atomTimerCallbacks (void)
 {
-    ATOM_TIMER *prev_ptr, *next_ptr, *saved_next_ptr;
-    ATOM_TIMER *callback_list_tail = NULL, *callback_list_head = NULL;
+    ATOM_TIMER *next_ptr, *due_tail_ptr;
+    CRITICAL_STORE;
+
+    /* Protect the lists */
+    CRITICAL_START ();
 
     /*
-     * Walk the list decrementing each timer's remaining ticks count and
-     * looking for due callbacks.
+     * The due timers are those at the head of the list with no ticks
+     * remaining. Move them, still in deadline order, onto the tail of the
+     * queue of pending callbacks. We don't call callbacks while walking the
+     * timer list in case they want to register new timers and hence walk
+     * the list.
      */
-    prev_ptr = next_ptr = timer_queue;
-    while (next_ptr)
+    due_tail_ptr = NULL;
+    next_ptr = timer_queue;
+    while (next_ptr && (next_ptr->cb_ticks == 0))
     {
-        /* Save the next timer in the list (we adjust next_ptr for callbacks) */
-        saved_next_ptr = next_ptr->next_timer;
- 
-        /* Is this entry due? */
-        if (--(next_ptr->cb_ticks) == 0)
+        due_tail_ptr = next_ptr;
+        next_ptr = next_ptr->next_timer;
+    }
+    if (due_tail_ptr)
+    {
+        /* Detach the due timers from the timer list */
+        due_tail_ptr->next_timer = NULL;
+        if (next_ptr)
         {
-            /* Remove the entry from the timer list */
-            if (next_ptr == timer_queue)
-            {
-                /* We're removing the list head */
-                timer_queue = next_ptr->next_timer;
-            }
-            else
-            {
-                /* We're removing a mid or tail timer */
-                prev_ptr->next_timer = next_ptr->next_timer;
-            }
-
-            /*
-             * Add this timer to the list of callbacks to run later when
-             * we've finished walking the list (we shouldn't call callbacks
-             * now in case they want to register new timers and hence walk
-             * the timer list.
-             *
-             * We reuse the ATOM_TIMER structure's next_ptr to maintain the
-             * callback list.
-             */
-            if (callback_list_head == NULL)
-            {
-                /* First callback request in the list */ 
-                callback_list_head = callback_list_tail = next_ptr;
-            }
-            else
-            {
-                /* Add callback request to the list tail */
-                callback_list_tail->next_timer = next_ptr;
-                callback_list_tail = callback_list_tail->next_timer;
-            }
-
-            /* Mark this timer as the end of the callback list */
-            next_ptr->next_timer = NULL;
-
-            /* Do not update prev_ptr, we have just removed this one */
-
+            next_ptr->prev_timer = NULL;
         }
 
-        /* Entry is not due, leave it in there with its count decremented */
+        /* Append them to the pending callbacks */
+        if (callback_queue == NULL)
+        {
+            callback_queue = timer_queue;
+        }
         else
         {
-            /*
-             * Update prev_ptr to this entry. We will need it if we want
-             * to remove a mid or tail timer.
-             */
-            prev_ptr = next_ptr;
+            due_tail_ptr = callback_queue;
+            while (due_tail_ptr->next_timer)
+            {
+                due_tail_ptr = due_tail_ptr->next_timer;
+            }
+            due_tail_ptr->next_timer = timer_queue;
+            timer_queue->prev_timer = due_tail_ptr;
         }
 
-        /* Move on to the next in the list */
-        next_ptr = saved_next_ptr;
+        /* The first timer not due becomes the new list head */
+        timer_queue = next_ptr;
     }
 
     /*
-     * Check if any callbacks were due. We call them after we walk the list
-     * in case they want to register new timers (and hence walk the list).
+     * Make the pending callbacks, taking each off the queue before calling
+     * it. Pending timers stay on the queue until then, so that a callback
+     * which wakes a thread whose timeout also expired on this tick can
+     * remove the timeout with atomTimerDequeue() or atomTimerCancel(), and
+     * its callback is not made.
      */
-    if (callback_list_head)
+    while ((next_ptr = callback_queue) != NULL)
     {
-        /* Walk the callback list */
-        next_ptr = callback_list_head;
-        while (next_ptr)
+        /* Take the timer off the queue */
+        callback_queue = next_ptr->next_timer;
+        if (callback_queue)
         {
-            /*
-             *  Save the next timer in the list (in case the callback
-             *  modifies the list by registering again.
-             */
-            saved_next_ptr = next_ptr->next_timer;
-
-            /* Call the registered callback */
-            if (next_ptr->cb_func)
-            {
-                next_ptr->cb_func (next_ptr->cb_data);
-            }
+            callback_queue->prev_timer = NULL;
+        }
+        next_ptr->prev_timer = next_ptr->next_timer = NULL;
 
-            /* Move on to the next callback in the list */
-            next_ptr = saved_next_ptr;
+        /* Call the registered callback (it may register the timer again) */
+        CRITICAL_END ();
+        if (next_ptr->cb_func)
+        {
+            next_ptr->cb_func (next_ptr->cb_data);
         }
+        CRITICAL_START ();
     }
 
+    /* End of list protection */
+    CRITICAL_END ();
+
 }
 
 
@@ -533,8 +686,15 @@ static void atomTimerDelayCallback (POINTER cb_data)
         /* Enter critical region */
         CRITICAL_START ();
 
-        /* Put the thread on the ready queue */
-        (void)tcbEnqueuePriority (&tcbReadyQ, timer_data_ptr->tcb_ptr);
+        /* Only act if the thread was not woken before we got here */
+        if (timer_data_ptr->tcb_ptr->suspend_timo_cb)
+        {
+            /* Flag as no timeout registered */
+            timer_data_ptr->tcb_ptr->suspend_timo_cb = NULL;
+
+            /* Put the thread on the ready queue */
+            (void)tcbEnqueuePriority (&tcbReadyQ, timer_data_ptr->tcb_ptr);
+        }
 
         /* Exit critical region */
         CRITICAL_END ();
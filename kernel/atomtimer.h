@@ -47,9 +47,10 @@ typedef struct atom_timer
 {
     TIMER_CB_FUNC   cb_func;    /* Callback function */
     POINTER	        cb_data;    /* Pointer to callback parameter/data */
-    uint32_t	    cb_ticks;   /* Ticks until callback */
+    uint32_t	    cb_ticks;   /* Ticks until callback (relative to previous timer once registered) */
 
 	/* Internal data */
+    struct atom_timer *prev_timer;		/* Previous timer in doubly-linked list */
     struct atom_timer *next_timer;		/* Next timer in doubly-linked list */
 
 } ATOM_TIMER;
@@ -58,6 +59,7 @@ typedef struct atom_timer
 
 extern uint8_t atomTimerRegister (ATOM_TIMER *timer_ptr);
 extern uint8_t atomTimerCancel (ATOM_TIMER *timer_ptr);
+extern void atomTimerDequeue (ATOM_TIMER *timer_ptr);
 extern uint8_t atomTimerDelay (uint32_t ticks);
 extern uint32_t atomTimeGet (void);
 extern void atomTimeSet (uint32_t new_time);
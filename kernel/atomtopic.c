@@ -0,0 +1,1104 @@
+/*
+ * Copyright (c) 2022, Matt Liss
+ * Copyright (c) 2010, Kelvin Lawson. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. No personal names or organizations' names associated with the
+ *    Atomthreads project may be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE ATOMTHREADS PROJECT AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/**
+ * \file
+ * Publish/subscribe topic library.
+ *
+ *
+ * This module implements a publish/subscribe message bus with the
+ * following features:
+ *
+ * \par Fan-out delivery
+ * Publishers post a message to a topic once, and a copy is delivered to
+ * every subscriber of that topic. Producers and consumers do not need to
+ * know about each other, so subscribers can come and go at run-time
+ * without any change to the publishers.
+ *
+ * \par Per-subscriber inboxes
+ * Each subscriber has its own bounded inbox with storage provided by the
+ * subscriber, so a slow subscriber does not hold up the others (unless it
+ * asks to).
+ *
+ * \par Per-subscriber overflow policy
+ * Each subscriber chooses what happens when a message is published while
+ * its inbox is full: discard the oldest queued message, discard the new
+ * message, or block the publisher until there is space. The number of
+ * messages discarded is counted in the subscriber object.
+ *
+ * \par Single critical section delivery
+ * A message is delivered to all subscribers within one critical section,
+ * so all subscribers see messages from different publishers in the same
+ * order. Subscribers which are already waiting have the message copied
+ * straight into their receive buffer, and the scheduler is called once
+ * after all waiting subscribers have been woken.
+ *
+ * \par Flexible blocking APIs
+ * Threads which wish to make a call which may block can choose whether to
+ * block, block with timeout, or not block and return a relevant status
+ * code.
+ *
+ * \par Interrupt-safe calls
+ * All APIs can be called from interrupt context. Any calls which could
+ * potentially block have optional parameters to prevent blocking if you
+ * wish to call them from interrupt context. Any attempt to make a call
+ * which would block from interrupt context will be automatically and
+ * safely prevented.
+ *
+ * \par Smart topic deletion
+ * Where a topic is deleted or a subscriber unsubscribes while threads are
+ * blocking on them, the blocking threads are woken and returned a status
+ * code to indicate the reason for being woken.
+ *
+ *
+ * \n <b> Usage instructions: </b> \n
+ *
+ * All topic objects must be initialised before use by calling
+ * atomTopicCreate(), which sets the size of messages carried on the topic.
+ *
+ * Consumers subscribe to a topic by calling atomTopicSubscribe(), passing
+ * their own ATOM_TOPIC_SUB object, an inbox storage area large enough for
+ * \c max_num_msgs messages of the topic's message size, and the overflow
+ * policy to use. Messages are then read from the inbox in FIFO order using
+ * atomTopicReceive(), which blocks (by default) if the inbox is empty.
+ * Subscribers which are no longer interested call atomTopicUnsubscribe().
+ * Messages already in the inbox can still be read after unsubscribing.
+ *
+ * Messages are published using atomTopicPublish(). If any subscriber with
+ * the ATOM_TOPIC_BLOCK policy has a full inbox, the publisher blocks until
+ * all such subscribers have space (or returns immediately if requested not
+ * to block), and the message is not delivered to anyone until it can be
+ * delivered to every ATOM_TOPIC_BLOCK subscriber. Subscribers with the
+ * ATOM_TOPIC_DROP_OLDEST or ATOM_TOPIC_DROP_NEWEST policies never hold up
+ * a publisher. Publishing to a topic with no subscribers simply discards
+ * the message.
+ *
+ * As all deliveries for one message happen with interrupts locked out,
+ * messages should be kept small. Larger data can be passed by reference,
+ * for example by publishing pointers to buffers from a buffer pool (see
+ * atompool.c). Subscribers which receive references should use the
+ * ATOM_TOPIC_BLOCK policy so that no reference is silently discarded.
+ *
+ * A topic which is no longer required can be deleted using
+ * atomTopicDelete(). This function automatically unsubscribes all
+ * subscribers, and wakes up any publishers or subscribers which are
+ * waiting on the deleted topic.
+ *
+ */
+
+
+#include <string.h>
+
+#include "atom.h"
+#include "atomtopic.h"
+#include "atomtimer.h"
+
+
+/* Local data types */
+
+typedef struct topic_timer
+{
+    ATOM_TCB   *tcb_ptr;    /* Thread which is suspended with timeout */
+    ATOM_TCB   **suspQ;     /* TCB queue which thread is suspended on */
+} TOPIC_TIMER;
+
+
+/* Forward declarations */
+
+static uint8_t topic_has_space (ATOM_TOPIC *topic);
+static uint8_t topic_deliver (ATOM_TOPIC *topic, uint8_t *msgptr, uint8_t *woken_ptr);
+static void topic_remove (ATOM_TOPIC_SUB *sub, uint8_t *msgptr);
+static uint8_t topic_wake (ATOM_TCB *tcb_ptr, uint8_t wake_status);
+static uint8_t topic_wake_all (ATOM_TCB **suspQ, uint8_t wake_status, uint8_t *woken_ptr);
+static void atomTopicTimerCallback (POINTER cb_data);
+
+
+/**
+ * \b atomTopicCreate
+ *
+ * Initialises a topic object.
+ *
+ * Must be called before calling any other topic library routines on a
+ * topic. Objects can be deleted later using atomTopicDelete().
+ *
+ * Does not allocate storage, the caller provides the topic object and each
+ * subscriber provides its own inbox storage. The topic starts out with no
+ * subscribers.
+ *
+ * This function can be called from interrupt context.
+ *
+ * @param[in] topic Pointer to topic object
+ * @param[in] unit_size Size in bytes of each message published on the topic
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_PARAM Bad parameters
+ */
+uint8_t atomTopicCreate (ATOM_TOPIC *topic, uint32_t unit_size)
+{
+    uint8_t status;
+
+    /* Parameter check */
+    if ((topic == NULL) || (unit_size == 0))
+    {
+        /* Bad parameters */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Store the topic details */
+        topic->unit_size = unit_size;
+
+        /* No subscribers or suspended publishers yet */
+        topic->subs = NULL;
+        topic->putSuspQ = NULL;
+
+        /* Successful */
+        status = ATOM_OK;
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomTopicDelete
+ *
+ * Deletes a topic object.
+ *
+ * All subscribers are unsubscribed. Any publishers suspended on the topic,
+ * and any threads suspended receiving on its subscribers' inboxes, will be
+ * woken up with return status ATOM_ERR_DELETED. If called at thread
+ * context then the scheduler will be called during this function which may
+ * schedule in one of the woken threads depending on relative priorities.
+ *
+ * This function can be called from interrupt context. All threads blocking
+ * on the topic are woken in a single critical section, without searching
+ * the timer list for their timeouts.
+ *
+ * @param[in] topic Pointer to topic object
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_PARAM Bad parameter
+ */
+uint8_t atomTopicDelete (ATOM_TOPIC *topic)
+{
+    uint8_t status, wake_status;
+    CRITICAL_STORE;
+    ATOM_TOPIC_SUB *sub;
+    uint8_t woken_threads = FALSE;
+
+    /* Parameter check */
+    if (topic == NULL)
+    {
+        /* Bad pointer */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Protect access to the topic object and OS queues */
+        CRITICAL_START ();
+
+        /* Wake up all suspended publishers */
+        status = topic_wake_all (&topic->putSuspQ, ATOM_ERR_DELETED, &woken_threads);
+
+        /* Detach all subscribers, waking any threads waiting on them */
+        while ((sub = topic->subs) != NULL)
+        {
+            topic->subs = sub->next_sub;
+            sub->next_sub = NULL;
+            sub->topic = NULL;
+
+            wake_status = topic_wake_all (&sub->suspQ, ATOM_ERR_DELETED, &woken_threads);
+            if (wake_status != ATOM_OK)
+                status = wake_status;
+        }
+
+        /* Exit critical region */
+        CRITICAL_END ();
+
+        /**
+         * Only call the scheduler if we are in thread context, otherwise
+         * it will be called on exiting the ISR by atomIntExit().
+         */
+        if (woken_threads && atomCurrentContext())
+            atomSched (FALSE);
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomTopicSubscribe
+ *
+ * Subscribes to a topic.
+ *
+ * Initialises the subscriber object \c sub with an inbox of \c buff_ptr,
+ * which must be large enough to hold \c max_num_msgs messages of the
+ * topic's \c unit_size, and adds it to the topic. All messages published
+ * to the topic from now on are delivered to the inbox.
+ *
+ * \c policy selects what happens to a message published while the inbox
+ * is full: ATOM_TOPIC_DROP_OLDEST discards the oldest message in the inbox
+ * to make room, ATOM_TOPIC_DROP_NEWEST discards the new message, and
+ * ATOM_TOPIC_BLOCK makes the publisher wait until this subscriber has
+ * received a message. Discarded messages are counted in
+ * \c sub->num_dropped.
+ *
+ * A subscriber object must not be subscribed to more than one topic at a
+ * time.
+ *
+ * This function can be called from interrupt context.
+ *
+ * @param[in] topic Pointer to topic object
+ * @param[in] sub Pointer to subscriber object
+ * @param[in] buff_ptr Pointer to inbox storage area
+ * @param[in] max_num_msgs Maximum number of messages stored in the inbox
+ * @param[in] policy Overflow policy (ATOM_TOPIC_xxx)
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_PARAM Bad parameters
+ */
+uint8_t atomTopicSubscribe (ATOM_TOPIC *topic, ATOM_TOPIC_SUB *sub, uint8_t *buff_ptr, uint32_t max_num_msgs, uint8_t policy)
+{
+    uint8_t status;
+    CRITICAL_STORE;
+
+    /* Parameter check */
+    if ((topic == NULL) || (sub == NULL) || (buff_ptr == NULL))
+    {
+        /* Bad pointers */
+        status = ATOM_ERR_PARAM;
+    }
+    else if ((max_num_msgs == 0) || (policy > ATOM_TOPIC_BLOCK))
+    {
+        /* Bad values */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Store the inbox details */
+        sub->buff_ptr = buff_ptr;
+        sub->unit_size = topic->unit_size;
+        sub->max_num_msgs = max_num_msgs;
+        sub->policy = policy;
+
+        /* Initialise the inbox */
+        sub->suspQ = NULL;
+        sub->insert_index = 0;
+        sub->remove_index = 0;
+        sub->num_msgs_stored = 0;
+        sub->num_dropped = 0;
+
+        /* Add to the topic's subscriber list */
+        CRITICAL_START ();
+        sub->topic = topic;
+        sub->next_sub = topic->subs;
+        topic->subs = sub;
+        CRITICAL_END ();
+
+        /* Successful */
+        status = ATOM_OK;
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomTopicUnsubscribe
+ *
+ * Unsubscribes from a topic.
+ *
+ * No further messages will be delivered to the subscriber's inbox, but
+ * any messages already in it can still be read using atomTopicReceive().
+ * Any threads currently suspended waiting on the empty inbox will be woken
+ * up with return status ATOM_ERR_DELETED. If the subscriber was holding
+ * up publishers (ATOM_TOPIC_BLOCK policy) they are woken to try again.
+ *
+ * This function can be called from interrupt context, but loops internally
+ * waking up all threads blocking on the inbox, so the potential execution
+ * cycles cannot be determined in advance.
+ *
+ * @param[in] sub Pointer to subscriber object
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_PARAM Bad parameter
+ * @retval ATOM_ERR_NOT_FOUND Subscriber is not subscribed to a topic
+ * @retval ATOM_ERR_QUEUE Problem putting a woken thread on the ready queue
+ * @retval ATOM_ERR_TIMER Problem cancelling a timeout on a woken thread
+ */
+uint8_t atomTopicUnsubscribe (ATOM_TOPIC_SUB *sub)
+{
+    uint8_t status, wake_status;
+    CRITICAL_STORE;
+    ATOM_TOPIC_SUB **link_ptr;
+    uint8_t woken_threads = FALSE;
+
+    /* Parameter check */
+    if (sub == NULL)
+    {
+        /* Bad pointer */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Protect access to the topic object and OS queues */
+        CRITICAL_START ();
+
+        /* Find the link to this subscriber in the topic's list */
+        link_ptr = (sub->topic != NULL) ? &sub->topic->subs : NULL;
+        while ((link_ptr != NULL) && (*link_ptr != NULL) && (*link_ptr != sub))
+            link_ptr = &(*link_ptr)->next_sub;
+
+        if ((link_ptr == NULL) || (*link_ptr == NULL))
+        {
+            /* Not subscribed */
+            status = ATOM_ERR_NOT_FOUND;
+        }
+        else
+        {
+            /* Remove from the subscriber list */
+            *link_ptr = sub->next_sub;
+            sub->next_sub = NULL;
+
+            /* Blocked publishers may have been waiting on this inbox */
+            if (sub->policy == ATOM_TOPIC_BLOCK)
+                status = topic_wake_all (&sub->topic->putSuspQ, ATOM_OK, &woken_threads);
+            else
+                status = ATOM_OK;
+            sub->topic = NULL;
+
+            /* Wake up any threads waiting for messages */
+            wake_status = topic_wake_all (&sub->suspQ, ATOM_ERR_DELETED, &woken_threads);
+            if (wake_status != ATOM_OK)
+                status = wake_status;
+        }
+
+        /* Exit critical region */
+        CRITICAL_END ();
+
+        /**
+         * Only call the scheduler if we are in thread context, otherwise
+         * it will be called on exiting the ISR by atomIntExit().
+         */
+        if (woken_threads && atomCurrentContext())
+            atomSched (FALSE);
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomTopicPublish
+ *
+ * Publish a message to all subscribers of a topic.
+ *
+ * The message of the topic's \c unit_size bytes is copied from \c msgptr
+ * into each subscriber's inbox, or directly into the receive buffer of a
+ * subscriber thread which is already waiting. Subscribers whose inbox is
+ * full are handled according to their overflow policy.
+ *
+ * If any subscriber with the ATOM_TOPIC_BLOCK policy has a full inbox, the
+ * message is not delivered to any subscriber, and the call will do one of
+ * the following depending on the \c timeout value specified:
+ *
+ * \c timeout == 0 : Call will block until there is space \n
+ * \c timeout > 0 : Call will block until there is space or the specified timeout \n
+ * \c timeout == -1 : Return immediately \n
+ *
+ * If called at thread context then the scheduler will be called once after
+ * delivery, which may schedule in one of the woken subscribers depending on
+ * relative priorities.
+ *
+ * This function can only be called from interrupt context if the \c timeout
+ * parameter is -1 (in which case it does not block).
+ *
+ * @param[in] topic Pointer to topic object
+ * @param[in] timeout Max system ticks to block (0 = forever, -1 = no block)
+ * @param[in] msgptr Pointer from which the message should be copied
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_TIMEOUT Topic wait timed out before being woken
+ * @retval ATOM_WOULDBLOCK Called with timeout == -1 but a blocking inbox was full
+ * @retval ATOM_ERR_DELETED Topic was deleted while suspended
+ * @retval ATOM_ERR_CONTEXT Not called in thread context and attempted to block
+ * @retval ATOM_ERR_PARAM Bad parameter
+ * @retval ATOM_ERR_QUEUE Problem putting a thread on the suspend or ready queue
+ * @retval ATOM_ERR_TIMER Problem registering the timeout
+ */
+uint8_t atomTopicPublish (ATOM_TOPIC *topic, int32_t timeout, uint8_t *msgptr)
+{
+    CRITICAL_STORE;
+    uint8_t status;
+    TOPIC_TIMER timer_data;
+    ATOM_TIMER timer_cb;
+    ATOM_TCB *curr_tcb_ptr;
+    uint32_t deadline;
+    int32_t remaining;
+    uint8_t woken_threads = FALSE;
+
+    /* Check parameters */
+    if ((topic == NULL) || (msgptr == NULL))
+    {
+        /* Bad pointer */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /**
+         * A publisher may be woken several times before every blocking
+         * subscriber has space (e.g. when one of two full subscribers
+         * receives a message), so work out the absolute deadline now and
+         * block for the remaining time on each attempt.
+         */
+        deadline = atomTimeGet() + (uint32_t)timeout;
+
+        while (1)
+        {
+            /* Protect access to the topic object and OS queues */
+            CRITICAL_START ();
+
+            /* Deliver now if all blocking subscribers have space */
+            if (topic_has_space (topic))
+            {
+                status = topic_deliver (topic, msgptr, &woken_threads);
+                CRITICAL_END ();
+                break;
+            }
+
+            /* timeout == -1, requested not to block */
+            if (timeout < 0)
+            {
+                CRITICAL_END ();
+                status = ATOM_WOULDBLOCK;
+                break;
+            }
+
+            /* Get the current TCB */
+            curr_tcb_ptr = atomCurrentContext();
+
+            /* Check we are actually in thread context */
+            if (curr_tcb_ptr == NULL)
+            {
+                /* Not currently in thread context, can't suspend */
+                CRITICAL_END ();
+                status = ATOM_ERR_CONTEXT;
+                break;
+            }
+
+            /* Check the deadline has not already passed */
+            remaining = (int32_t)(deadline - atomTimeGet());
+            if (timeout && (remaining <= 0))
+            {
+                CRITICAL_END ();
+                status = ATOM_TIMEOUT;
+                break;
+            }
+
+            /* Add current thread to the list suspended on publishes */
+            if (tcbEnqueuePriority (&topic->putSuspQ, curr_tcb_ptr) != ATOM_OK)
+            {
+                /* There was an error putting this thread on the suspend list */
+                CRITICAL_END ();
+                status = ATOM_ERR_QUEUE;
+                break;
+            }
+
+            /* Set suspended status for the current thread */
+            curr_tcb_ptr->suspended = TRUE;
+
+            /* Track errors */
+            status = ATOM_OK;
+
+            /* Register a timer callback if requested */
+            if (timeout)
+            {
+                /* Fill out the data needed by the callback to wake us up */
+                timer_data.tcb_ptr = curr_tcb_ptr;
+                timer_data.suspQ = &topic->putSuspQ;
+
+                /* Fill out the timer callback request structure */
+                timer_cb.cb_func = atomTopicTimerCallback;
+                timer_cb.cb_data = (POINTER)&timer_data;
+                timer_cb.cb_ticks = (uint32_t)remaining;
+
+                /**
+                 * Store the timer details in the TCB so that we can cancel
+                 * the timer callback if space is made before the timeout
+                 * occurs.
+                 */
+                curr_tcb_ptr->suspend_timo_cb = &timer_cb;
+
+                /* Register a callback on timeout */
+                if (atomTimerRegister (&timer_cb) != ATOM_OK)
+                {
+                    /* Timer registration failed */
+                    status = ATOM_ERR_TIMER;
+
+                    /* Clean up and return to the caller */
+                    (void)tcbDequeueEntry (&topic->putSuspQ, curr_tcb_ptr);
+                    curr_tcb_ptr->suspended = FALSE;
+                    curr_tcb_ptr->suspend_timo_cb = NULL;
+                }
+            }
+
+            /* Set no timeout requested */
+            else
+            {
+                /* No need to cancel timeouts on this one */
+                curr_tcb_ptr->suspend_timo_cb = NULL;
+            }
+
+            /* Exit critical region */
+            CRITICAL_END ();
+
+            /* Check timer registration was successful */
+            if (status != ATOM_OK)
+                break;
+
+            /**
+             * Current thread now blocking, schedule in a new one. We
+             * already know we are in thread context so can call the
+             * scheduler from here.
+             */
+            atomSched (FALSE);
+
+            /**
+             * Subscribers receiving messages will wake us with ATOM_OK
+             * status to try again, while timeouts will set ATOM_TIMEOUT
+             * and topic deletions will set ATOM_ERR_DELETED.
+             */
+            status = curr_tcb_ptr->suspend_wake_status;
+            if (status != ATOM_OK)
+                break;
+        }
+
+        /**
+         * The scheduler may now make a policy decision to thread switch if
+         * we are currently in thread context. If we are in interrupt
+         * context it will be handled by atomIntExit().
+         */
+        if (woken_threads && atomCurrentContext())
+            atomSched (FALSE);
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomTopicReceive
+ *
+ * Attempt to retrieve a message from a subscriber's inbox.
+ *
+ * Retrieves one message at a time, in the order published. Messages are
+ * copied into the passed \c msgptr storage area which should be large
+ * enough to contain one message of the topic's \c unit_size bytes.
+ *
+ * If the inbox is currently empty, the call will do one of the following
+ * depending on the \c timeout value specified:
+ *
+ * \c timeout == 0 : Call will block until a message is available \n
+ * \c timeout > 0 : Call will block until a message or the specified timeout \n
+ * \c timeout == -1 : Return immediately if no message is in the inbox \n
+ *
+ * Calls on an empty inbox which is no longer subscribed to a topic return
+ * ATOM_ERR_DELETED rather than blocking.
+ *
+ * This function can only be called from interrupt context if the \c timeout
+ * parameter is -1 (in which case it does not block).
+ *
+ * @param[in] sub Pointer to subscriber object
+ * @param[in] timeout Max system ticks to block (0 = forever, -1 = no block)
+ * @param[out] msgptr Pointer to which the received message will be copied
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_TIMEOUT Inbox wait timed out before being woken
+ * @retval ATOM_WOULDBLOCK Called with timeout == -1 but inbox was empty
+ * @retval ATOM_ERR_DELETED Subscriber was unsubscribed or topic deleted
+ * @retval ATOM_ERR_CONTEXT Not called in thread context and attempted to block
+ * @retval ATOM_ERR_PARAM Bad parameter
+ * @retval ATOM_ERR_QUEUE Problem putting a thread on the suspend or ready queue
+ * @retval ATOM_ERR_TIMER Problem registering the timeout
+ */
+uint8_t atomTopicReceive (ATOM_TOPIC_SUB *sub, int32_t timeout, uint8_t *msgptr)
+{
+    CRITICAL_STORE;
+    uint8_t status;
+    TOPIC_TIMER timer_data;
+    ATOM_TIMER timer_cb;
+    ATOM_TCB *curr_tcb_ptr;
+    uint8_t woken_threads = FALSE;
+
+    /* Check parameters */
+    if ((sub == NULL) || (msgptr == NULL))
+    {
+        /* Bad pointer */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Protect access to the inbox and OS queues */
+        CRITICAL_START ();
+
+        /* If no messages in the inbox, block the calling thread */
+        if (sub->num_msgs_stored == 0)
+        {
+            /* Nothing more will arrive if no longer subscribed */
+            if (sub->topic == NULL)
+            {
+                CRITICAL_END ();
+                status = ATOM_ERR_DELETED;
+            }
+
+            /* If called with timeout >= 0, we should block */
+            else if (timeout >= 0)
+            {
+                /* Inbox is empty, block the calling thread */
+
+                /* Get the current TCB */
+                curr_tcb_ptr = atomCurrentContext();
+
+                /* Check we are actually in thread context */
+                if (curr_tcb_ptr)
+                {
+                    /* Add current thread to the list suspended on receives */
+                    if (tcbEnqueuePriority (&sub->suspQ, curr_tcb_ptr) == ATOM_OK)
+                    {
+                        /* Set suspended status for the current thread */
+                        curr_tcb_ptr->suspended = TRUE;
+
+                        /**
+                         * Store the destination so that the publisher can
+                         * copy the message straight in.
+                         */
+                        curr_tcb_ptr->suspend_data = (POINTER)msgptr;
+
+                        /* Track errors */
+                        status = ATOM_OK;
+
+                        /* Register a timer callback if requested */
+                        if (timeout)
+                        {
+                            /**
+                             * Fill out the data needed by the callback to
+                             * wake us up.
+                             */
+                            timer_data.tcb_ptr = curr_tcb_ptr;
+                            timer_data.suspQ = &sub->suspQ;
+
+                            /* Fill out the timer callback request structure */
+                            timer_cb.cb_func = atomTopicTimerCallback;
+                            timer_cb.cb_data = (POINTER)&timer_data;
+                            timer_cb.cb_ticks = timeout;
+
+                            /**
+                             * Store the timer details in the TCB so that we
+                             * can cancel the timer callback if a message is
+                             * published before the timeout occurs.
+                             */
+                            curr_tcb_ptr->suspend_timo_cb = &timer_cb;
+
+                            /* Register a callback on timeout */
+                            if (atomTimerRegister (&timer_cb) != ATOM_OK)
+                            {
+                                /* Timer registration failed */
+                                status = ATOM_ERR_TIMER;
+
+                                /* Clean up and return to the caller */
+                                (void)tcbDequeueEntry (&sub->suspQ, curr_tcb_ptr);
+                                curr_tcb_ptr->suspended = FALSE;
+                                curr_tcb_ptr->suspend_timo_cb = NULL;
+                                curr_tcb_ptr->suspend_data = NULL;
+                            }
+                        }
+
+                        /* Set no timeout requested */
+                        else
+                        {
+                            /* No need to cancel timeouts on this one */
+                            curr_tcb_ptr->suspend_timo_cb = NULL;
+                        }
+
+                        /* Exit critical region */
+                        CRITICAL_END ();
+
+                        /* Check no errors occurred */
+                        if (status == ATOM_OK)
+                        {
+                            /**
+                             * Current thread now blocking, schedule in a new
+                             * one. We already know we are in thread context
+                             * so can call the scheduler from here.
+                             */
+                            atomSched (FALSE);
+
+                            /**
+                             * Normal atomTopicPublish() wakeups will set
+                             * ATOM_OK status, having already copied the
+                             * message into msgptr, while timeouts will set
+                             * ATOM_TIMEOUT and unsubscribing or topic
+                             * deletion will set ATOM_ERR_DELETED.
+                             */
+                            status = curr_tcb_ptr->suspend_wake_status;
+                            curr_tcb_ptr->suspend_data = NULL;
+                        }
+                    }
+                    else
+                    {
+                        /* There was an error putting this thread on the suspend list */
+                        CRITICAL_END ();
+                        status = ATOM_ERR_QUEUE;
+                    }
+                }
+                else
+                {
+                    /* Not currently in thread context, can't suspend */
+                    CRITICAL_END ();
+                    status = ATOM_ERR_CONTEXT;
+                }
+            }
+            else
+            {
+                /* timeout == -1, requested not to block and inbox is empty */
+                CRITICAL_END ();
+                status = ATOM_WOULDBLOCK;
+            }
+        }
+        else
+        {
+            /* No need to block, there is a message to copy out */
+            topic_remove (sub, msgptr);
+
+            /* Let publishers blocked on this inbox try again */
+            if ((sub->policy == ATOM_TOPIC_BLOCK) && (sub->topic != NULL))
+                status = topic_wake_all (&sub->topic->putSuspQ, ATOM_OK, &woken_threads);
+            else
+                status = ATOM_OK;
+
+            /* Exit critical region */
+            CRITICAL_END ();
+
+            /**
+             * The scheduler may now make a policy decision to thread
+             * switch if we are currently in thread context. If we are
+             * in interrupt context it will be handled by atomIntExit().
+             */
+            if (woken_threads && atomCurrentContext())
+                atomSched (FALSE);
+        }
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomTopicTimerCallback
+ *
+ * This is an internal function not for use by application code.
+ *
+ * Timeouts on suspended threads are notified by the timer system through
+ * this generic callback. The timer system calls us back with a pointer to
+ * the relevant \c TOPIC_TIMER object which is used to retrieve the
+ * suspension details.
+ *
+ * @param[in] cb_data Pointer to a TOPIC_TIMER object
+ */
+static void atomTopicTimerCallback (POINTER cb_data)
+{
+    TOPIC_TIMER *timer_data_ptr;
+    CRITICAL_STORE;
+
+    /* Get the TOPIC_TIMER structure pointer */
+    timer_data_ptr = (TOPIC_TIMER *)cb_data;
+
+    /* Check parameter is valid */
+    if (timer_data_ptr)
+    {
+        /* Enter critical region */
+        CRITICAL_START ();
+
+        /* Only act if the thread was not woken before we got here */
+        if (timer_data_ptr->tcb_ptr->suspend_timo_cb)
+        {
+            /* Set status to indicate to the waiting thread that it timed out */
+            timer_data_ptr->tcb_ptr->suspend_wake_status = ATOM_TIMEOUT;
+
+            /* Flag as no timeout registered */
+            timer_data_ptr->tcb_ptr->suspend_timo_cb = NULL;
+
+            /* Remove this thread from the suspend list it was waiting on */
+            (void)tcbDequeueEntry (timer_data_ptr->suspQ, timer_data_ptr->tcb_ptr);
+
+            /* Put the thread on the ready queue */
+            (void)tcbEnqueuePriority (&tcbReadyQ, timer_data_ptr->tcb_ptr);
+        }
+
+        /* Exit critical region */
+        CRITICAL_END ();
+
+        /**
+         * Note that we don't call the scheduler now as it will be called
+         * when we exit the ISR by atomIntExit().
+         */
+    }
+}
+
+
+/**
+ * \b topic_has_space
+ *
+ * This is an internal function not for use by application code.
+ *
+ * Checks whether a message can be published to a topic without blocking,
+ * i.e. whether every subscriber using the ATOM_TOPIC_BLOCK policy has
+ * space in its inbox.
+ *
+ * Assumes interrupts are already locked out.
+ *
+ * @param[in] topic Pointer to topic object
+ *
+ * @retval TRUE All blocking subscribers have space
+ * @retval FALSE At least one blocking subscriber is full
+ */
+static uint8_t topic_has_space (ATOM_TOPIC *topic)
+{
+    ATOM_TOPIC_SUB *sub;
+
+    for (sub = topic->subs; sub != NULL; sub = sub->next_sub)
+    {
+        if ((sub->policy == ATOM_TOPIC_BLOCK)
+            && (sub->num_msgs_stored == sub->max_num_msgs))
+        {
+            return (FALSE);
+        }
+    }
+
+    return (TRUE);
+}
+
+
+/**
+ * \b topic_deliver
+ *
+ * This is an internal function not for use by application code.
+ *
+ * Delivers a message to every subscriber of a topic. Subscribers with a
+ * thread already waiting (which implies an empty inbox) have the message
+ * copied directly into the waiting thread's buffer and the thread is made
+ * ready. Otherwise the message is appended to the subscriber's inbox,
+ * applying the subscriber's overflow policy if the inbox is full.
+ *
+ * Assumes that blocking subscribers have space (checked by the caller) and
+ * that interrupts are already locked out. Does not call the scheduler,
+ * instead \c woken_ptr is set to TRUE if any threads were woken.
+ *
+ * @param[in] topic Pointer to topic object
+ * @param[in] msgptr Pointer from which the message should be copied
+ * @param[out] woken_ptr Set to TRUE if any threads were woken
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_QUEUE Problem putting a woken thread on the ready queue
+ */
+static uint8_t topic_deliver (ATOM_TOPIC *topic, uint8_t *msgptr, uint8_t *woken_ptr)
+{
+    uint8_t status, wake_status;
+    ATOM_TOPIC_SUB *sub;
+    ATOM_TCB *tcb_ptr;
+    uint32_t buff_size;
+
+    /* Default to success unless errors occur during wakeups */
+    status = ATOM_OK;
+
+    for (sub = topic->subs; sub != NULL; sub = sub->next_sub)
+    {
+        /**
+         * Hand the message straight to a waiting receiver if there is one.
+         * Receivers whose timeout is already being called back are passed
+         * over, as they will wake with ATOM_TIMEOUT rather than the message.
+         */
+        while ((tcb_ptr = tcbDequeueHead (&sub->suspQ)) != NULL)
+        {
+            wake_status = topic_wake (tcb_ptr, ATOM_OK);
+            if (wake_status != ATOM_ERR_TIMER)
+                break;
+        }
+        if (tcb_ptr)
+        {
+            memcpy (tcb_ptr->suspend_data, msgptr, topic->unit_size);
+            if (wake_status != ATOM_OK)
+                status = wake_status;
+            *woken_ptr = TRUE;
+            continue;
+        }
+
+        buff_size = sub->unit_size * sub->max_num_msgs;
+
+        /* Apply the overflow policy if the inbox is full */
+        if (sub->num_msgs_stored == sub->max_num_msgs)
+        {
+            sub->num_dropped++;
+
+            /* Discard the new message */
+            if (sub->policy == ATOM_TOPIC_DROP_NEWEST)
+                continue;
+
+            /* Discard the oldest message to make room */
+            sub->remove_index += sub->unit_size;
+            if (sub->remove_index >= buff_size)
+                sub->remove_index = 0;
+            sub->num_msgs_stored--;
+        }
+
+        /* Append the message to the inbox */
+        memcpy ((sub->buff_ptr + sub->insert_index), msgptr, sub->unit_size);
+        sub->insert_index += sub->unit_size;
+        if (sub->insert_index >= buff_size)
+            sub->insert_index = 0;
+        sub->num_msgs_stored++;
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b topic_remove
+ *
+ * This is an internal function not for use by application code.
+ *
+ * Removes the oldest message from a subscriber's inbox. Assumes that there
+ * is a message present, which is already checked by the calling function.
+ *
+ * Assumes interrupts are already locked out.
+ *
+ * @param[in] sub Pointer to subscriber object
+ * @param[out] msgptr Pointer to which the message will be copied
+ *
+ * @return None
+ */
+static void topic_remove (ATOM_TOPIC_SUB *sub, uint8_t *msgptr)
+{
+    /* Copy the message out of the inbox */
+    memcpy (msgptr, (sub->buff_ptr + sub->remove_index), sub->unit_size);
+    sub->remove_index += sub->unit_size;
+    sub->num_msgs_stored--;
+
+    /* Check if the remove index should now wrap to the beginning */
+    if (sub->remove_index >= (sub->unit_size * sub->max_num_msgs))
+        sub->remove_index = 0;
+}
+
+
+/**
+ * \b topic_wake
+ *
+ * This is an internal function not for use by application code.
+ *
+ * Wakes a thread which has already been removed from a suspend queue:
+ * cancels any suspension timeout and puts it on the ready queue with the
+ * given wake status. If the timeout cannot be cancelled it is already
+ * being called back, and the thread is left for the callback to wake with
+ * ATOM_TIMEOUT. Does not call the scheduler.
+ *
+ * Assumes interrupts are already locked out.
+ *
+ * @param[in] tcb_ptr Pointer to the TCB of the thread to wake
+ * @param[in] wake_status Status to return to the woken thread
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_QUEUE Problem putting the thread on the ready queue
+ * @retval ATOM_ERR_TIMER Timeout already expired, thread not woken
+ */
+static uint8_t topic_wake (ATOM_TCB *tcb_ptr, uint8_t wake_status)
+{
+    uint8_t status;
+
+    /* If there's a timeout on this suspension, cancel it */
+    if ((tcb_ptr->suspend_timo_cb != NULL)
+        && (atomTimerCancel (tcb_ptr->suspend_timo_cb) != ATOM_OK))
+    {
+        /* The timeout callback will wake the thread */
+        status = ATOM_ERR_TIMER;
+    }
+    else
+    {
+        /* Flag as no timeout registered */
+        tcb_ptr->suspend_timo_cb = NULL;
+
+        /* Set the status to be returned to the waiting thread */
+        tcb_ptr->suspend_wake_status = wake_status;
+
+        /* Move the waiting thread to the ready queue */
+        if (tcbEnqueuePriority (&tcbReadyQ, tcb_ptr) != ATOM_OK)
+        {
+            /* There was a problem putting the thread on the ready queue */
+            status = ATOM_ERR_QUEUE;
+        }
+        else
+        {
+            /* Successful */
+            status = ATOM_OK;
+        }
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b topic_wake_all
+ *
+ * This is an internal function not for use by application code.
+ *
+ * Wakes every thread on a suspend queue with the given wake status, in
+ * one go using tcbWakeAll(). Does not call the scheduler, instead
+ * \c woken_ptr is set to TRUE if any threads were woken.
+ *
+ * Assumes interrupts are already locked out.
+ *
+ * @param[in] suspQ Pointer to the suspend queue
+ * @param[in] wake_status Status to return to the woken threads
+ * @param[out] woken_ptr Set to TRUE if any threads were woken
+ *
+ * @retval ATOM_OK Success
+ */
+static uint8_t topic_wake_all (ATOM_TCB **suspQ, uint8_t wake_status, uint8_t *woken_ptr)
+{
+    /* Detach and wake the whole suspend queue in one go */
+    if (tcbWakeAll (suspQ, wake_status))
+        *woken_ptr = TRUE;
+
+    return (ATOM_OK);
+}
@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2022, Matt Liss
+ * Copyright (c) 2010, Kelvin Lawson. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. No personal names or organizations' names associated with the
+ *    Atomthreads project may be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE ATOMTHREADS PROJECT AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __ATOM_TOPIC_H
+#define __ATOM_TOPIC_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Subscriber overflow policies */
+#define ATOM_TOPIC_DROP_OLDEST  0   /* Discard the oldest queued message */
+#define ATOM_TOPIC_DROP_NEWEST  1   /* Discard the message being published */
+#define ATOM_TOPIC_BLOCK        2   /* Block the publisher until there is space */
+
+/* Forward declaration */
+struct atom_topic;
+
+typedef struct atom_topic_sub
+{
+    struct atom_topic_sub *next_sub;    /* Next subscriber to the same topic */
+    struct atom_topic *topic;   /* Topic subscribed to (NULL = not subscribed) */
+    ATOM_TCB *  suspQ;          /* Queue of threads waiting to receive */
+    uint8_t *   buff_ptr;       /* Pointer to inbox data area */
+    uint32_t    unit_size;      /* Size of each message */
+    uint32_t    max_num_msgs;   /* Max number of storable messages */
+    uint32_t    insert_index;   /* Next byte index to insert into */
+    uint32_t    remove_index;   /* Next byte index to remove from */
+    uint32_t    num_msgs_stored;/* Number of messages stored */
+    uint32_t    num_dropped;    /* Number of messages discarded on overflow */
+    uint8_t     policy;         /* Overflow policy (ATOM_TOPIC_xxx) */
+} ATOM_TOPIC_SUB;
+
+typedef struct atom_topic
+{
+    ATOM_TOPIC_SUB *subs;       /* List of subscribers */
+    ATOM_TCB *  putSuspQ;       /* Queue of publishers waiting for space */
+    uint32_t    unit_size;      /* Size of each message */
+} ATOM_TOPIC;
+
+extern uint8_t atomTopicCreate (ATOM_TOPIC *topic, uint32_t unit_size);
+extern uint8_t atomTopicDelete (ATOM_TOPIC *topic);
+extern uint8_t atomTopicSubscribe (ATOM_TOPIC *topic, ATOM_TOPIC_SUB *sub, uint8_t *buff_ptr, uint32_t max_num_msgs, uint8_t policy);
+extern uint8_t atomTopicUnsubscribe (ATOM_TOPIC_SUB *sub);
+extern uint8_t atomTopicPublish (ATOM_TOPIC *topic, int32_t timeout, uint8_t *msgptr);
+extern uint8_t atomTopicReceive (ATOM_TOPIC_SUB *sub, int32_t timeout, uint8_t *msgptr);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __ATOM_TOPIC_H */
@@ -0,0 +1,675 @@
+/*
+ * Copyright (c) 2022, Matt Liss
+ * Copyright (c) 2010, Kelvin Lawson. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. No personal names or organizations' names associated with the
+ *    Atomthreads project may be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE ATOMTHREADS PROJECT AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/**
+ * \file
+ * Work queue library.
+ *
+ *
+ * This module implements deferred work queues, with the following features:
+ *
+ * \par Shared worker threads
+ * Work items (a function and a parameter) are submitted to a work queue and
+ * executed by one of a pool of worker threads belonging to the queue, at the
+ * queue's priority. Many infrequent jobs can share a few worker threads and
+ * stacks rather than each having a dedicated thread.
+ *
+ * \par Constant-time submission
+ * Submitted items are held in a pointer queue ring (see atomptrqueue.c), so
+ * submitting an item takes a constant number of cycles, and is handed
+ * straight to an idle worker if one is waiting.
+ *
+ * \par Interrupt-safe submission
+ * Work items can be submitted and cancelled from interrupt context, making
+ * work queues suitable for deferring interrupt processing to thread context
+ * where blocking kernel calls may be made.
+ *
+ * \par Delayed work
+ * Items can be submitted after a delay, using the timer facilities (see
+ * atomtimer.c). Delayed items are added to the work queue ring when their
+ * timer expires. If the ring is full at that point the item stays delayed
+ * and is retried on each following tick, so delayed work is not lost.
+ *
+ * \par Coalesced submissions
+ * Submitting an item which is already pending or delayed has no effect, so
+ * an interrupt which fires several times before the item runs results in a
+ * single execution.
+ *
+ *
+ * \n <b> Usage instructions: </b> \n
+ *
+ * A work queue is created with atomWorkQueueCreate(), passing the storage for
+ * the pending item ring (an array of \c POINTER whose number of entries is a
+ * power of two), an array of ATOM_WORKER structures and a single area of
+ * memory holding the stacks of all of the worker threads. The worker threads
+ * are started at the given priority and wait for work.
+ *
+ * Each work item is an ATOM_WORK structure provided by the caller and set up
+ * once with atomWorkInit(). It can then be submitted any number of times with
+ * atomWorkSubmit() or atomWorkSubmitDelayed(). An item is pending from when
+ * it is submitted until a worker starts to run it, so an item may resubmit
+ * itself from its work function. Where a queue has more than one worker,
+ * different items may run concurrently, and an item which is resubmitted
+ * while it is running may be started by another worker.
+ *
+ * Pending or delayed items can be withdrawn with atomWorkCancel(). A
+ * cancelled pending item is removed from the ring, freeing its entry
+ * straight away, so the ring need only be sized for the number of items
+ * which may be pending at once. Removal moves up the entries queued behind
+ * the item, so takes time proportional to the number of pending items.
+ *
+ * Work functions run in thread context and may make blocking kernel calls,
+ * though this holds up other items while the pool has no free worker.
+ *
+ */
+
+
+#include "atom.h"
+#include "atomwork.h"
+#include "atomtimer.h"
+
+
+/* Forward declarations */
+
+static void atomWorkerThread (uint32_t param);
+static void atomWorkTimerCallback (POINTER cb_data);
+
+
+/**
+ * \b atomWorkQueueCreate
+ *
+ * Initialises a work queue object and starts its worker threads.
+ *
+ * Must be called before calling any other work queue library routines on
+ * the queue. Objects can be deleted later using atomWorkQueueDelete().
+ *
+ * The ring of pending items is stored in the \c POINTER array \c buff_ptr,
+ * whose number of entries \c max_items must be a power of two. Worker
+ * threads use the TCBs in \c workers and the stacks in \c stacks, which must
+ * be \c num_workers times \c stack_size bytes long.
+ *
+ * Does not set the calling thread's priority. If the workers are higher
+ * priority than the caller they may be scheduled in before this function
+ * returns, and block waiting for work.
+ *
+ * This function cannot be called from interrupt context.
+ *
+ * @param[in] wq Pointer to work queue object
+ * @param[in] buff_ptr Pointer to the array for pending items
+ * @param[in] max_items Number of entries in the array (a power of two)
+ * @param[in] workers Array of \c num_workers worker structures
+ * @param[in] num_workers Number of worker threads (1 to 255)
+ * @param[in] priority Priority of the worker threads
+ * @param[in] stacks Pointer to the stack area for all workers
+ * @param[in] stack_size Size of each worker's stack in bytes
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_PARAM Bad parameters
+ * @retval ATOM_ERR_QUEUE Error starting a worker thread
+ */
+uint8_t atomWorkQueueCreate (ATOM_WORK_QUEUE *wq, POINTER *buff_ptr, uint32_t max_items, ATOM_WORKER *workers, uint8_t num_workers, uint8_t priority, uint8_t *stacks, uint32_t stack_size)
+{
+    uint8_t status;
+    uint8_t i;
+
+    /* Parameter check */
+    if ((wq == NULL) || (workers == NULL) || (num_workers == 0)
+        || (stacks == NULL) || (stack_size == 0))
+    {
+        /* Bad parameters */
+        status = ATOM_ERR_PARAM;
+    }
+
+    /* Set up the ring of pending items */
+    else if ((status = atomPtrQueueCreate (&wq->queue, buff_ptr, max_items)) == ATOM_OK)
+    {
+        /* Store the worker details */
+        wq->workers = workers;
+        wq->num_workers = num_workers;
+
+        /**
+         * Start the worker threads. Each worker finds its work queue from
+         * its ATOM_WORKER structure, which starts with its TCB.
+         */
+        for (i = 0; (i < num_workers) && (status == ATOM_OK); i++)
+        {
+            workers[i].wq = wq;
+            workers[i].item = NULL;
+            if (atomThreadCreate (&workers[i].tcb, priority, atomWorkerThread, 0,
+                    (void *)(stacks + (i * stack_size)), stack_size, TRUE) != ATOM_OK)
+            {
+                /* Error starting the thread */
+                status = ATOM_ERR_QUEUE;
+            }
+        }
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomWorkQueueDelete
+ *
+ * Deletes a work queue object.
+ *
+ * The worker threads are terminated and the ring of pending items is
+ * deleted. Items which were still pending are discarded without being run,
+ * and return to the idle state so that they can be submitted to another work
+ * queue. Delayed items must be cancelled by the caller before deleting the
+ * queue.
+ *
+ * Workers are terminated even if they are part way through running a work
+ * item, so the queue should normally only be deleted when it is idle. This
+ * function must not be called from a work item running on the same queue.
+ *
+ * This function cannot be called from interrupt context.
+ *
+ * @param[in] wq Pointer to work queue object
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_PARAM Bad parameters
+ * @retval ATOM_ERR_CONTEXT Called from interrupt context
+ */
+uint8_t atomWorkQueueDelete (ATOM_WORK_QUEUE *wq)
+{
+    CRITICAL_STORE;
+    uint8_t status;
+    uint8_t i;
+    uint32_t count;
+    ATOM_WORK *work;
+
+    /* Parameter check */
+    if (wq == NULL)
+    {
+        /* Bad parameters */
+        status = ATOM_ERR_PARAM;
+    }
+
+    /* Check we are in thread context */
+    else if (atomCurrentContext() == NULL)
+    {
+        /* Not supported from interrupt context */
+        status = ATOM_ERR_CONTEXT;
+    }
+    else
+    {
+        /* Terminate the workers, removing any blocked on the ring */
+        for (i = 0; i < wq->num_workers; i++)
+        {
+            (void)atomThreadTerminate (&wq->workers[i].tcb);
+        }
+
+        /* Protect access to the ring */
+        CRITICAL_START ();
+
+        /**
+         * Return any items handed to a worker which had not yet started
+         * them to the idle state. Items which were started are already
+         * idle.
+         */
+        for (i = 0; i < wq->num_workers; i++)
+        {
+            work = (ATOM_WORK *)wq->workers[i].item;
+            if (work && (work->state == ATOM_WORK_PENDING))
+            {
+                work->state = ATOM_WORK_IDLE;
+            }
+        }
+
+        /* Return any items still in the ring to the idle state */
+        for (count = wq->queue.remove_count; count != wq->queue.insert_count; count++)
+        {
+            work = (ATOM_WORK *)wq->queue.buff_ptr[count & wq->queue.index_mask];
+            if (work->state == ATOM_WORK_PENDING)
+            {
+                work->state = ATOM_WORK_IDLE;
+            }
+        }
+
+        /* Exit critical region */
+        CRITICAL_END ();
+
+        /* Delete the ring, there are no threads left waiting on it */
+        status = atomPtrQueueDelete (&wq->queue);
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomWorkInit
+ *
+ * Initialises a work item.
+ *
+ * Must be called before the item is first submitted, and must not be
+ * called again while the item is pending or delayed.
+ *
+ * @param[in] work Pointer to work item
+ * @param[in] func Function to be called by the worker thread
+ * @param[in] arg Parameter passed to \c func
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_PARAM Bad parameters
+ */
+uint8_t atomWorkInit (ATOM_WORK *work, void (*func)(POINTER), POINTER arg)
+{
+    uint8_t status;
+
+    /* Parameter check */
+    if ((work == NULL) || (func == NULL))
+    {
+        /* Bad parameters */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Set up the item */
+        work->func = func;
+        work->arg = arg;
+        work->wq = NULL;
+        work->state = ATOM_WORK_IDLE;
+
+        /* Successful */
+        status = ATOM_OK;
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomWorkSubmit
+ *
+ * Submits a work item to a work queue.
+ *
+ * The item is added to the ring of pending items, or handed straight to a
+ * worker thread if one is waiting. It will be run once by a worker thread.
+ * If the item is already pending or delayed this call has no effect.
+ *
+ * This function can be called from interrupt context.
+ *
+ * @param[in] wq Pointer to work queue object
+ * @param[in] work Pointer to work item
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_WOULDBLOCK The ring of pending items is full
+ * @retval ATOM_ERR_PARAM Bad parameters
+ */
+uint8_t atomWorkSubmit (ATOM_WORK_QUEUE *wq, ATOM_WORK *work)
+{
+    CRITICAL_STORE;
+    uint8_t status;
+    uint8_t submit;
+
+    /* Parameter check */
+    if ((wq == NULL) || (work == NULL))
+    {
+        /* Bad parameters */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Protect access to the item state */
+        CRITICAL_START ();
+
+        /* Only submit items which are not already pending or delayed */
+        submit = (work->state == ATOM_WORK_IDLE);
+        if (submit)
+        {
+            work->state = ATOM_WORK_PENDING;
+            work->wq = wq;
+        }
+
+        /* Exit critical region */
+        CRITICAL_END ();
+
+        /* Successful unless the item can't be added to the ring */
+        status = ATOM_OK;
+
+        /**
+         * Add the item to the ring outside of our critical region, as the
+         * pointer queue may call the scheduler to switch to a waiting
+         * worker. The item is already marked pending so cannot be added
+         * twice in the meantime.
+         */
+        if (submit)
+        {
+            status = atomPtrQueuePut (&wq->queue, -1, (POINTER)work);
+            if (status != ATOM_OK)
+            {
+                /* The ring is full, the item is no longer pending */
+                CRITICAL_START ();
+                work->state = ATOM_WORK_IDLE;
+                CRITICAL_END ();
+            }
+        }
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomWorkSubmitDelayed
+ *
+ * Submits a work item to a work queue after a delay.
+ *
+ * A timer is registered to submit the item to the work queue after
+ * \c ticks system ticks. A delay of zero submits the item immediately.
+ * If the item is already pending or delayed this call has no effect.
+ *
+ * If the ring of pending items is full when the delay expires, the item
+ * remains delayed and its submission is retried every tick until there is
+ * room in the ring, or the item is cancelled. The item may therefore start
+ * later than requested while the queue is backed up, but is not dropped.
+ *
+ * This function can be called from interrupt context.
+ *
+ * @param[in] wq Pointer to work queue object
+ * @param[in] work Pointer to work item
+ * @param[in] ticks Delay in system ticks
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_WOULDBLOCK The ring of pending items is full (zero delay)
+ * @retval ATOM_ERR_PARAM Bad parameters
+ * @retval ATOM_ERR_TIMER Problem registering the timer
+ */
+uint8_t atomWorkSubmitDelayed (ATOM_WORK_QUEUE *wq, ATOM_WORK *work, uint32_t ticks)
+{
+    CRITICAL_STORE;
+    uint8_t status;
+
+    /* Parameter check */
+    if ((wq == NULL) || (work == NULL))
+    {
+        /* Bad parameters */
+        status = ATOM_ERR_PARAM;
+    }
+
+    /* No delay, submit immediately */
+    else if (ticks == 0)
+    {
+        status = atomWorkSubmit (wq, work);
+    }
+    else
+    {
+        /* Protect access to the item state */
+        CRITICAL_START ();
+
+        /* Only submit items which are not already pending or delayed */
+        if (work->state != ATOM_WORK_IDLE)
+        {
+            /* Nothing to do */
+            status = ATOM_OK;
+        }
+        else
+        {
+            /* Fill out the timer callback request structure */
+            work->timer.cb_func = atomWorkTimerCallback;
+            work->timer.cb_data = (POINTER)work;
+            work->timer.cb_ticks = ticks;
+
+            /* Register the timer to submit the item on expiry */
+            if (atomTimerRegister (&work->timer) != ATOM_OK)
+            {
+                /* Timer registration failed */
+                status = ATOM_ERR_TIMER;
+            }
+            else
+            {
+                /* The item is now delayed */
+                work->state = ATOM_WORK_DELAYED;
+                work->wq = wq;
+
+                /* Successful */
+                status = ATOM_OK;
+            }
+        }
+
+        /* Exit critical region */
+        CRITICAL_END ();
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomWorkCancel
+ *
+ * Cancels a pending or delayed work item.
+ *
+ * A delayed item has its timer cancelled. A pending item is removed from
+ * the ring of pending items, or if it has already been handed to a worker
+ * thread which has not yet started it, will be skipped by that worker. Once
+ * cancelled the item is idle and may be submitted again.
+ *
+ * An item which has already been started by a worker thread cannot be
+ * cancelled, and this function does not wait for it to finish.
+ *
+ * This function can be called from interrupt context.
+ *
+ * @param[in] work Pointer to work item
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_PARAM Bad parameters
+ * @retval ATOM_ERR_NOT_FOUND The item was not pending or delayed
+ */
+uint8_t atomWorkCancel (ATOM_WORK *work)
+{
+    CRITICAL_STORE;
+    uint8_t status;
+    ATOM_PTR_QUEUE *qptr;
+    uint32_t count;
+
+    /* Parameter check */
+    if (work == NULL)
+    {
+        /* Bad parameters */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Protect access to the item state */
+        CRITICAL_START ();
+
+        /* Remove the timer for delayed items */
+        if (work->state == ATOM_WORK_DELAYED)
+        {
+            (void)atomTimerCancel (&work->timer);
+            work->state = ATOM_WORK_IDLE;
+            status = ATOM_OK;
+        }
+
+        /* Remove pending items from the ring */
+        else if (work->state == ATOM_WORK_PENDING)
+        {
+            /* Find the item in the ring */
+            qptr = &work->wq->queue;
+            for (count = qptr->remove_count; count != qptr->insert_count; count++)
+            {
+                if (qptr->buff_ptr[count & qptr->index_mask] == (POINTER)work)
+                {
+                    break;
+                }
+            }
+
+            /**
+             * Close the gap by moving up the items queued behind it. If the
+             * item is not in the ring it was already handed to a worker,
+             * which will skip it once it is idle.
+             */
+            if (count != qptr->insert_count)
+            {
+                for (count++; count != qptr->insert_count; count++)
+                {
+                    qptr->buff_ptr[(count - 1) & qptr->index_mask] =
+                        qptr->buff_ptr[count & qptr->index_mask];
+                }
+                qptr->insert_count--;
+            }
+
+            work->state = ATOM_WORK_IDLE;
+            status = ATOM_OK;
+        }
+
+        /* Not pending or delayed */
+        else
+        {
+            status = ATOM_ERR_NOT_FOUND;
+        }
+
+        /* Exit critical region */
+        CRITICAL_END ();
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomWorkerThread
+ *
+ * This is an internal function not for use by application code.
+ *
+ * Entry point for work queue worker threads. Waits for items on the ring of
+ * pending items and runs them. Items which were cancelled after being handed
+ * to the worker are skipped.
+ *
+ * @param[in] param Unused (the work queue is found via the worker's TCB)
+ *
+ * @return None
+ */
+static void atomWorkerThread (uint32_t param)
+{
+    CRITICAL_STORE;
+    ATOM_WORKER *worker;
+    ATOM_WORK *work;
+    uint8_t run;
+
+    /* Our TCB is the first member of our ATOM_WORKER structure */
+    worker = (ATOM_WORKER *)atomCurrentContext();
+
+    /* Avoid compiler warning due to unused parameter */
+    param = param;
+
+    /**
+     * Run items until the ring is deleted. Items are received into the
+     * worker structure so that atomWorkQueueDelete() can find an item
+     * which was handed to us but not yet started.
+     */
+    worker->item = NULL;
+    while (atomPtrQueueGet (&worker->wq->queue, 0, &worker->item) == ATOM_OK)
+    {
+        work = (ATOM_WORK *)worker->item;
+
+        /**
+         * Check the item is still pending, and mark it idle before running
+         * it so that it may be submitted again (including by itself).
+         */
+        CRITICAL_START ();
+        run = (work->state == ATOM_WORK_PENDING);
+        if (run)
+        {
+            work->state = ATOM_WORK_IDLE;
+        }
+        CRITICAL_END ();
+
+        /* Run the item */
+        if (run)
+        {
+            work->func (work->arg);
+        }
+    }
+
+    /* The ring was deleted, terminate this worker */
+    atomThreadExit ();
+}
+
+
+/**
+ * \b atomWorkTimerCallback
+ *
+ * This is an internal function not for use by application code.
+ *
+ * Timer callback for delayed work items. Called from the timer tick
+ * interrupt when the delay expires, and submits the item to its work queue.
+ * If the ring is full the timer is registered again to retry on the next
+ * tick.
+ *
+ * @param[in] cb_data Pointer to the ATOM_WORK item
+ */
+static void atomWorkTimerCallback (POINTER cb_data)
+{
+    ATOM_WORK *work;
+    CRITICAL_STORE;
+
+    /* Get the ATOM_WORK structure pointer */
+    work = (ATOM_WORK *)cb_data;
+
+    /* Check parameter is valid */
+    if (work)
+    {
+        /* Enter critical region */
+        CRITICAL_START ();
+
+        /* Only act if the item was not cancelled before we got here */
+        if (work->state == ATOM_WORK_DELAYED)
+        {
+            /**
+             * Submit the item. We are in interrupt context so the pointer
+             * queue will not switch threads, and the item can be added
+             * within our critical region. The scheduler will be called to
+             * switch to a woken worker when we exit the ISR by atomIntExit().
+             */
+            if (atomPtrQueuePut (&work->wq->queue, -1, (POINTER)work) == ATOM_OK)
+            {
+                /* The item is now pending */
+                work->state = ATOM_WORK_PENDING;
+            }
+            else
+            {
+                /* The ring is full, keep the item delayed and retry next tick */
+                work->timer.cb_ticks = 1;
+                if (atomTimerRegister (&work->timer) != ATOM_OK)
+                {
+                    /* Can't retry, the item is no longer delayed */
+                    work->state = ATOM_WORK_IDLE;
+                }
+            }
+        }
+
+        /* Exit critical region */
+        CRITICAL_END ();
+    }
+}
@@ -0,0 +1,81 @@
+/*
+ * Copyright (c) 2022, Matt Liss
+ * Copyright (c) 2010, Kelvin Lawson. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. No personal names or organizations' names associated with the
+ *    Atomthreads project may be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE ATOMTHREADS PROJECT AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef __ATOM_WORK_H
+#define __ATOM_WORK_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "atomptrqueue.h"
+
+/* Forward declaration */
+struct atom_work_queue;
+
+typedef struct atom_work
+{
+    void        (*func)(POINTER);   /* Work function */
+    POINTER     arg;                /* Parameter passed to the work function */
+    struct atom_work_queue *wq;     /* Work queue the item was last submitted to */
+    ATOM_TIMER  timer;              /* Timer used for delayed submission */
+    uint8_t     state;              /* ATOM_WORK_IDLE, _PENDING or _DELAYED */
+} ATOM_WORK;
+
+typedef struct atom_worker
+{
+    ATOM_TCB    tcb;                /* Worker thread TCB (must be first) */
+    struct atom_work_queue *wq;     /* Work queue served by this worker */
+    POINTER     item;               /* Last item taken from the ring */
+} ATOM_WORKER;
+
+typedef struct atom_work_queue
+{
+    ATOM_PTR_QUEUE  queue;          /* Ring of submitted work items */
+    ATOM_WORKER *   workers;        /* Array of worker threads */
+    uint8_t         num_workers;    /* Number of worker threads */
+} ATOM_WORK_QUEUE;
+
+/* Work item states */
+#define ATOM_WORK_IDLE          0
+#define ATOM_WORK_PENDING       1
+#define ATOM_WORK_DELAYED       2
+
+extern uint8_t atomWorkQueueCreate (ATOM_WORK_QUEUE *wq, POINTER *buff_ptr, uint32_t max_items, ATOM_WORKER *workers, uint8_t num_workers, uint8_t priority, uint8_t *stacks, uint32_t stack_size);
+extern uint8_t atomWorkQueueDelete (ATOM_WORK_QUEUE *wq);
+extern uint8_t atomWorkInit (ATOM_WORK *work, void (*func)(POINTER), POINTER arg);
+extern uint8_t atomWorkSubmit (ATOM_WORK_QUEUE *wq, ATOM_WORK *work);
+extern uint8_t atomWorkSubmitDelayed (ATOM_WORK_QUEUE *wq, ATOM_WORK *work, uint32_t ticks);
+extern uint8_t atomWorkCancel (ATOM_WORK *work);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __ATOM_WORK_H */
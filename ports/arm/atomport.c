@@ -96,9 +96,11 @@ static void thread_shell (void)
     fclose (stdout);
     _reclaim_reent (&(curr_tcb->port_priv.reent));
 
-    /* Thread has run to completion: remove it from the ready list */
-    curr_tcb->terminated = TRUE;
-    atomSched (FALSE);
+    /**
+     * Thread has run to completion: terminate it so that it is removed
+     * from the ready list and any joining threads are woken.
+     */
+    atomThreadExit ();
 }
 
 
@@ -95,6 +95,9 @@ low_level_init (void)
     board_timer_0->INTCLR = 1 ;
     board_pic->IRQ_ENABLESET |= ICP_PIC_IRQ_TIMERINT0 ;
 
+    /* UART interrupts are only raised once the driver enables them */
+    board_pic->IRQ_ENABLESET |= ICP_PIC_IRQ_UARTINT0 ;
+
     /* Set the timer to go off 100 times per second (input clock speed is 40MHz) */
     board_timer_0->LOAD = TIMER0_CLOCK_SPEED / SYSTEM_TICKS_PER_SEC ;
     board_timer_0->BGLOAD = TIMER0_CLOCK_SPEED / SYSTEM_TICKS_PER_SEC ;
@@ -113,7 +116,7 @@ low_level_init (void)
  * Interrupt dispatcher: determines the source of the IRQ and calls
  * the appropriate ISR.
  *
- * Currently only the OS system tick ISR is implemented.
+ * The OS system tick and UART 0 ISRs are implemented.
  *
  * Note that any ISRs which call Atomthreads OS routines that can
  * cause rescheduling of threads must be surrounded by calls to
@@ -129,7 +132,7 @@ __interrupt_dispatcher (void)
     status = board_pic->IRQ_STATUS;
 
     /* Timer tick interrupt (call Atomthreads timer tick ISR) */
-    if (status | ICP_PIC_IRQ_TIMERINT0)
+    if (status & ICP_PIC_IRQ_TIMERINT0)
     {
         /*
          * Let the Atomthreads kernel know we're about to enter an OS-aware
@@ -147,6 +150,18 @@ __interrupt_dispatcher (void)
         atomIntExit(TRUE);
     }
 
+    /* UART interrupt (transmit buffer draining) */
+    if (status & ICP_PIC_IRQ_UARTINT0)
+    {
+        atomIntEnter();
+
+        /* Call the UART driver, which may wake a writer */
+        uart_irq_handler();
+
+        /* Call the interrupt exit routine */
+        atomIntExit(FALSE);
+    }
+
 }
 
 
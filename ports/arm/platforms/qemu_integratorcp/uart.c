@@ -30,15 +30,21 @@
 
 /** 
  * \file
- * Simple polled UART implementation for non-hosted compiler toolchains.
+ * Simple UART implementation for non-hosted compiler toolchains.
  *
  *
  * This is only required for non-hosted toolchains which don't implement
  * stdout automatically for use within QEMU.
+ *
+ * Reads are polled. Writes are buffered: uart_write() copies the data into
+ * a transmit ring buffer and returns, and the UART transmit interrupt
+ * drains the ring into the UART FIFO. A writing thread only blocks if the
+ * ring is full, until the interrupt has made space.
  */
 
 #include "atom.h"
 #include "atommutex.h"
+#include "atomsem.h"
 #include "atomport.h"
 #include "uart.h"
 
@@ -52,18 +58,48 @@
 #define UART_FR_RXFE     0x10
 #define UART_FR_TXFF     0x20
 
+/** IMSC/ICR Register bits */
+#define UART_INT_TX      0x20
+
 /** UART register access macros */
-#define UART_DR(baseaddr) (*(unsigned int *)(baseaddr))
-#define UART_FR(baseaddr) (*(((unsigned int *)(baseaddr))+6))
+#define UART_DR(baseaddr) (*(volatile unsigned int *)(baseaddr))
+#define UART_FR(baseaddr) (*(((volatile unsigned int *)(baseaddr))+6))
+#define UART_IMSC(baseaddr) (*(((volatile unsigned int *)(baseaddr))+14))
+#define UART_ICR(baseaddr) (*(((volatile unsigned int *)(baseaddr))+17))
+
+/** Size of the transmit ring buffer */
+#ifndef UART_TX_BUF_SIZE
+#define UART_TX_BUF_SIZE 512
+#endif
 
 
 /* Local data */
 
 /*
- * Semaphore for single-threaded access to UART device
+ * Mutex for single-threaded access to UART device for reads
  */
 static ATOM_MUTEX uart_mutex;
 
+/*
+ * Mutex for single-threaded writes, so that each write is kept together
+ * in the transmit ring
+ */
+static ATOM_MUTEX uart_tx_mutex;
+
+/*
+ * Transmit ring buffer, drained by the transmit interrupt. The ring and
+ * its indices are only accessed with interrupts disabled.
+ */
+static char tx_buf[UART_TX_BUF_SIZE];
+static int tx_head;
+static int tx_count;
+
+/*
+ * Semaphore on which a writer waits for space in a full ring
+ */
+static ATOM_SEM uart_tx_sem;
+static volatile int tx_waiting = FALSE;
+
 /*
  * Initialised flag
  */
@@ -72,6 +108,7 @@ static int initialised = FALSE;
 
 /* Forward declarations */
 static int uart_init (void);
+static void uart_tx_fill (void);
 
 
 /**
@@ -79,11 +116,12 @@ static int uart_init (void);
  *
  * Initialisation of UART driver. Creates a mutex that enforces
  * single-threaded access to the UART. We poll register bits
- * to check when space is available, which would not otherwise
- * be thread-safe.
+ * to check when data is available, which would not otherwise
+ * be thread-safe. Also creates the mutex and semaphore used by
+ * the buffered transmit path.
  *
  * @retval ATOM_OK Success
- * @retval ATOM_ERROR Failed to create mutex
+ * @retval ATOM_ERROR Failed to create mutex or semaphore
  */
 static int uart_init (void)
 {
@@ -93,9 +131,11 @@ static int uart_init (void)
     if (initialised == FALSE)
     {
         /* Create a mutex for single-threaded UART access */
-        if (atomMutexCreate (&uart_mutex) != ATOM_OK)
+        if ((atomMutexCreate (&uart_mutex) != ATOM_OK)
+            || (atomMutexCreate (&uart_tx_mutex) != ATOM_OK)
+            || (atomSemCreate (&uart_tx_sem, 0) != ATOM_OK))
         {
-            /* Mutex creation failed */
+            /* Mutex or semaphore creation failed */
             status = ATOM_ERROR;
         }
         else
@@ -180,7 +220,12 @@ int uart_read (char *ptr, int len)
 /**
  * \b uart_write
  *
- * Simple polled UART write.
+ * Buffered UART write.
+ *
+ * Copies the data into the transmit ring buffer and returns without
+ * waiting for it to be sent. If the ring fills up, the calling thread
+ * blocks until the transmit interrupt has made space. Writes from
+ * different threads are not interleaved.
  *
  * @param[in] ptr Pointer to write buffer
  * @param[in] len Number of bytes to write
@@ -189,6 +234,7 @@ int uart_read (char *ptr, int len)
  */
 int uart_write (const char *ptr, int len)
 {
+    CRITICAL_STORE;
     int todo;
 
     /* Check we are initialised */
@@ -204,21 +250,39 @@ int uart_write (const char *ptr, int len)
     }
 
     /* Block thread on private access to the UART */
-    if (atomMutexGet(&uart_mutex, 0) == ATOM_OK)
+    if (atomMutexGet(&uart_tx_mutex, 0) == ATOM_OK)
     {
         /* Loop through all bytes to write */
-        for (todo = 0; todo < len; todo++)
+        todo = 0;
+        while (todo < len)
         {
-            /* Wait for empty */
-            while(UART_FR(UART0_ADDR) & UART_FR_TXFF)
-                ;
+            CRITICAL_START ();
 
-            /* Write byte to UART */
-            UART_DR(UART0_ADDR) = *ptr++;
+            /* Copy as much as will fit into the ring */
+            while ((todo < len) && (tx_count < UART_TX_BUF_SIZE))
+            {
+                tx_buf[(tx_head + tx_count) % UART_TX_BUF_SIZE] = ptr[todo++];
+                tx_count++;
+            }
+
+            /* Start sending, or keep the transmit interrupt enabled */
+            uart_tx_fill ();
+
+            /* If the ring is still full, wait for the interrupt to make space */
+            if (todo < len)
+            {
+                tx_waiting = TRUE;
+                CRITICAL_END ();
+                (void)atomSemGet (&uart_tx_sem, 0);
+            }
+            else
+            {
+                CRITICAL_END ();
+            }
         }
 
         /* Return mutex access */
-        atomMutexPut(&uart_mutex);
+        atomMutexPut(&uart_tx_mutex);
     }
 
     /* Return bytes-written count */
@@ -226,6 +290,61 @@ int uart_write (const char *ptr, int len)
 }
 
 
+/**
+ * \b uart_tx_fill
+ *
+ * Moves bytes from the transmit ring into the UART FIFO until either is
+ * exhausted. The transmit interrupt is enabled while there is data left
+ * in the ring, and disabled once it is empty.
+ *
+ * Must be called with interrupts disabled.
+ */
+static void uart_tx_fill (void)
+{
+    /* Fill the FIFO */
+    while ((tx_count > 0) && !(UART_FR(UART0_ADDR) & UART_FR_TXFF))
+    {
+        UART_DR(UART0_ADDR) = tx_buf[tx_head];
+        tx_head = (tx_head + 1) % UART_TX_BUF_SIZE;
+        tx_count--;
+    }
+
+    /* Only interrupt when there is more to send */
+    if (tx_count > 0)
+    {
+        UART_IMSC(UART0_ADDR) |= UART_INT_TX;
+    }
+    else
+    {
+        UART_IMSC(UART0_ADDR) &= ~UART_INT_TX;
+        UART_ICR(UART0_ADDR) = UART_INT_TX;
+    }
+}
+
+
+/**
+ * \b uart_irq_handler
+ *
+ * UART interrupt handler, called by the interrupt dispatcher between
+ * atomIntEnter() and atomIntExit().
+ *
+ * Refills the UART FIFO from the transmit ring, and wakes any writer
+ * waiting for space in the ring.
+ */
+void uart_irq_handler (void)
+{
+    /* Refill the FIFO (interrupts are disabled in the handler) */
+    uart_tx_fill ();
+
+    /* Wake a writer waiting for space */
+    if ((tx_waiting == TRUE) && (tx_count < UART_TX_BUF_SIZE))
+    {
+        tx_waiting = FALSE;
+        (void)atomSemPut (&uart_tx_sem);
+    }
+}
+
+
 /**
  * \b uart_write_halt
  *
@@ -234,12 +353,35 @@ int uart_write (const char *ptr, int len)
  * Can be called from interrupt (unlike the standard
  * uart_write()) but is not thread-safe because it cannot
  * take the thread-safety mutex, and hence is only useful for
- * a last-resort catastrophic debug message.
+ * a last-resort catastrophic debug message. Any data still
+ * in the transmit ring is sent first.
  *
  * @param[in] ptr Pointer to write string
  */
 void uart_write_halt (const char *ptr)
 {
+    CRITICAL_STORE;
+
+    /**
+     * Flush the transmit ring by polling the FIFO directly. Interrupts
+     * are disabled so that the transmit interrupt, which is also masked
+     * here, cannot take bytes from the ring at the same time.
+     */
+    CRITICAL_START ();
+    UART_IMSC(UART0_ADDR) &= ~UART_INT_TX;
+    while (tx_count > 0)
+    {
+        /* Wait for space in the FIFO */
+        while (UART_FR(UART0_ADDR) & UART_FR_TXFF)
+            ;
+
+        /* Write the next byte from the ring */
+        UART_DR(UART0_ADDR) = tx_buf[tx_head];
+        tx_head = (tx_head + 1) % UART_TX_BUF_SIZE;
+        tx_count--;
+    }
+    CRITICAL_END ();
+
     /* Check parameters */
     if (ptr != NULL)
     {
@@ -34,5 +34,6 @@
 extern int uart_read (char *ptr, int len);
 extern int uart_write (const char *ptr, int len);
 extern void uart_write_halt (const char *ptr);
+extern void uart_irq_handler (void);
 
 #endif /* __ATOM_UART_H */
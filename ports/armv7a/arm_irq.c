@@ -31,8 +31,10 @@
 #include <arm_config.h>
 #include <arm_pic.h>
 #include <arm_irq.h>
+#include <atomirq.h>
 
 arm_irq_handler_t irq_hndls[NR_IRQS_PBA8];
+static ATOM_IRQ_THREAD *irq_threads[NR_IRQS_PBA8];
 
 void do_undefined_instruction(pt_regs_t *regs)
 {
@@ -100,8 +102,11 @@ void do_irq(pt_regs_t *uregs)
 		}
 	}
 
-	/* Call the interrupt exit routine */
-	atomIntExit(TRUE);
+	/*
+	 * Call the interrupt exit routine. Only the timer interrupt is a
+	 * system tick, allowing round-robin between same-priority threads.
+	 */
+	atomIntExit(irq == IRQ_PBA8_TIMER0_1);
 }
 
 void do_fiq(pt_regs_t *uregs)
@@ -145,6 +150,7 @@ void arm_irq_init(void)
 	 */
 	for (vec = 0; vec < NR_IRQS_PBA8; vec++) {
 		irq_hndls[vec] = NULL;
+		irq_threads[vec] = NULL;
 	}
 
 	/*
@@ -170,6 +176,57 @@ void arm_irq_register(uint32_t irq, arm_irq_handler_t hndl)
 	}
 }
 
+static void arm_irq_thread_mask(uint32_t irq)
+{
+	(void)arm_pic_mask(irq);
+}
+
+static void arm_irq_thread_unmask(uint32_t irq)
+{
+	(void)arm_pic_unmask(irq);
+}
+
+/*
+ * Low-level handler for threaded interrupts: mask the source in the
+ * interrupt controller and wake the handler thread. The thread unmasks
+ * the source once the real handler has run.
+ */
+static int arm_irq_thread_handler(uint32_t irq, pt_regs_t *regs)
+{
+	(void)atomIrqThreadWake(irq_threads[irq]);
+
+	return 0;
+}
+
+/*
+ * Register a threaded interrupt handler. The handler runs in its own
+ * thread at the given priority, with the interrupt masked, and may make
+ * blocking kernel calls.
+ */
+uint8_t arm_irq_register_threaded(uint32_t irq,
+				  struct atom_irq_thread *irq_thread,
+				  void (*hndl)(POINTER), POINTER data,
+				  uint8_t priority, void *stack_bottom,
+				  uint32_t stack_size)
+{
+	uint8_t status;
+
+	if (irq >= NR_IRQS_PBA8) {
+		return ATOM_ERR_PARAM;
+	}
+
+	status = atomIrqThreadCreate(irq_thread, irq, hndl, data,
+				     arm_irq_thread_mask,
+				     arm_irq_thread_unmask,
+				     priority, stack_bottom, stack_size);
+	if (status == ATOM_OK) {
+		irq_threads[irq] = irq_thread;
+		arm_irq_register(irq, arm_irq_thread_handler);
+	}
+
+	return status;
+}
+
 void arm_irq_enable(void)
 {
 	__asm( "cpsie if" );
@@ -48,8 +48,15 @@ typedef int (*arm_irq_handler_t) (uint32_t irq_no, pt_regs_t * regs);
 #define ARM_EXTERNAL_IRQ				6
 #define ARM_EXTERNAL_FIQ				7
 
+struct atom_irq_thread;
+
 void arm_irq_init(void);
 void arm_irq_register(uint32_t irq_no, arm_irq_handler_t hndl);
+uint8_t arm_irq_register_threaded(uint32_t irq_no,
+				  struct atom_irq_thread *irq_thread,
+				  void (*hndl)(POINTER), POINTER data,
+				  uint8_t priority, void *stack_bottom,
+				  uint32_t stack_size);
 void arm_irq_enable(void);
 void arm_irq_disable(void);
 irq_flags_t arm_irq_save(void);
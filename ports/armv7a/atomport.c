@@ -65,7 +65,8 @@ void archThreadContextInit (ATOM_TCB *tcb_ptr, void *stack_top,
 		regs->gpr[i] = 0x0;
 	}
 	regs->sp = (uint32_t)stack_top - sizeof(pt_regs_t) - 1024;
-	regs->lr = (uint32_t)entry_point;
+	/* Threads returning from their entry point terminate themselves */
+	regs->lr = (uint32_t)atomThreadExit;
 	regs->pc = (uint32_t)entry_point;
 }
 
@@ -27,30 +27,130 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <atom.h>
+#include <atommutex.h>
+#include <atomsem.h>
 #include <arm_io.h>
+#include <arm_irq.h>
+#include <arm_config.h>
 #include <arm_uart.h>
 
+/*
+ * Transmit is interrupt driven: characters are copied into a ring buffer
+ * and the UART TX interrupt moves them into the FIFO. Writers only block
+ * (on tx_sem) if the ring is full. The ring is only accessed with
+ * interrupts disabled.
+ */
+#ifndef ARM_UART_TX_BUF_SIZE
+#define ARM_UART_TX_BUF_SIZE	512
+#endif
+
+static uint8_t tx_buf[ARM_UART_TX_BUF_SIZE];
+static uint32_t tx_head;
+static uint32_t tx_count;
+static volatile uint8_t tx_waiting;
+static ATOM_SEM tx_sem;
+static ATOM_MUTEX tx_mutex;
+static uint8_t tx_ready;
+
+/*
+ * Move characters from the ring into the FIFO, and leave the TX
+ * interrupt enabled only while there is more to send.
+ * Called with interrupts disabled.
+ */
+static void arm_uart_tx_fill(void)
+{
+	unsigned int base = REALVIEW_PBA8_UART0_BASE;
+	uint32_t imsc;
+
+	while (tx_count &&
+	       !(arm_readl((void*)(base + UART_PL01x_FR)) & UART_PL01x_FR_TXFF)) {
+		arm_writel(tx_buf[tx_head], (void*)(base + UART_PL01x_DR));
+		tx_head = (tx_head + 1) % ARM_UART_TX_BUF_SIZE;
+		tx_count--;
+	}
+
+	imsc = arm_readl((void*)(base + UART_PL011_IMSC));
+	if (tx_count) {
+		imsc |= UART_PL011_IMSC_TXIM;
+	} else {
+		imsc &= ~UART_PL011_IMSC_TXIM;
+		arm_writel(UART_PL011_IMSC_TXIM, (void*)(base + UART_PL011_ICR));
+	}
+	arm_writel(imsc, (void*)(base + UART_PL011_IMSC));
+}
+
+int arm_uart_irqhndl(uint32_t irq_no, pt_regs_t * regs)
+{
+	/* Refill the FIFO */
+	arm_uart_tx_fill();
+
+	/* Wake a writer waiting for space in the ring */
+	if (tx_waiting && (tx_count < ARM_UART_TX_BUF_SIZE)) {
+		tx_waiting = 0;
+		atomSemPut(&tx_sem);
+	}
+
+	return 0;
+}
+
+/*
+ * Queue one character, waiting for space if the ring is full. Threads
+ * sleep on tx_sem; before the OS is started, or from interrupt context,
+ * we can only poll the FIFO until space appears.
+ */
+static void arm_uart_tx_put(uint8_t ch)
+{
+	CRITICAL_STORE;
+
+	CRITICAL_START();
+	while (tx_count == ARM_UART_TX_BUF_SIZE) {
+		if (tx_ready && atomCurrentContext()) {
+			tx_waiting = 1;
+			CRITICAL_END();
+			atomSemGet(&tx_sem, 0);
+			CRITICAL_START();
+		} else {
+			arm_uart_tx_fill();
+		}
+	}
+
+	tx_buf[(tx_head + tx_count) % ARM_UART_TX_BUF_SIZE] = ch;
+	tx_count++;
+	arm_uart_tx_fill();
+	CRITICAL_END();
+}
+
 void arm_uart_putc(uint8_t ch)
 {
-	unsigned int base = 0x10009000;
 	if(ch=='\n') {
-		/* Wait until there is space in the FIFO */
-		while (arm_readl((void*)(base + UART_PL01x_FR)) & UART_PL01x_FR_TXFF);
+		arm_uart_tx_put('\r');
+	}
 
-		/* Send the character */
-		arm_writel('\r', (void*)(base + UART_PL01x_DR));
+	arm_uart_tx_put(ch);
+}
+
+void arm_uart_write(const uint8_t *ptr, int len)
+{
+	int i, locked = 0;
+
+	/* Keep each write together if called from a thread */
+	if (tx_ready && atomCurrentContext()) {
+		locked = (atomMutexGet(&tx_mutex, 0) == ATOM_OK);
 	}
 
-	/* Wait until there is space in the FIFO */
-	while (arm_readl((void*)(base + UART_PL01x_FR)) & UART_PL01x_FR_TXFF);
+	for (i = 0; i < len; i++) {
+		arm_uart_putc(ptr[i]);
+	}
 
-	/* Send the character */
-	arm_writel(ch, (void*)(base + UART_PL01x_DR));
+	if (locked) {
+		atomMutexPut(&tx_mutex);
+	}
 }
 
 uint8_t arm_uart_getc(void)
 {
-	unsigned int base = 0x10009000;
+	unsigned int base = REALVIEW_PBA8_UART0_BASE;
 	uint8_t data;
 
 	/* Wait until there is data in the FIFO */
@@ -70,7 +170,7 @@ uint8_t arm_uart_getc(void)
 
 void arm_uart_init(void)
 {
-	unsigned int base = 0x10009000;
+	unsigned int base = REALVIEW_PBA8_UART0_BASE;
 	unsigned int baudrate = 115200;
 	unsigned int input_clock = 24000000;
 	unsigned int divider;
@@ -108,5 +208,12 @@ void arm_uart_init(void)
 			UART_PL011_CR_TXE | 
 			UART_PL011_CR_RXE),
 		(void*)(base + UART_PL011_CR));
+
+	/* Set up the interrupt-driven transmit path */
+	if ((atomSemCreate(&tx_sem, 0) == ATOM_OK) &&
+	    (atomMutexCreate(&tx_mutex) == ATOM_OK)) {
+		tx_ready = 1;
+	}
+	arm_irq_register(IRQ_PBA8_UART0, &arm_uart_irqhndl);
 }
 
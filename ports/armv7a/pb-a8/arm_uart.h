@@ -65,6 +65,7 @@
 #define UART_PL011_LCRH                 0x2C
 #define UART_PL011_CR                   0x30
 #define UART_PL011_IMSC                 0x38
+#define UART_PL011_ICR                  0x44
 #define UART_PL011_PERIPH_ID0           0xFE0
 
 #define UART_PL011_LCRH_SPS             (1 << 7)
@@ -105,6 +106,7 @@
 
 uint8_t arm_uart_getc(void);
 void arm_uart_putc(uint8_t ch);
+void arm_uart_write(const uint8_t *ptr, int len);
 void arm_uart_init(void);
 
 #endif /* __ARM_UART_H_ */
@@ -39,11 +39,7 @@ static int8_t buf[2048];
 /* Uses the above routine to output a string... */
 void puts(const uint8_t *text)
 {
-	int32_t i;
-
-	for (i = 0; i < strlen((const int8_t *)text); i++) {
-		arm_uart_putc(text[i]);
-	}
+	arm_uart_write(text, strlen((const int8_t *)text));
 }
 
 void printk(const char *format, ...)
@@ -108,9 +108,11 @@ static void thread_shell (void)
         curr_tcb->entry_point(curr_tcb->entry_param);
     }
 
-    /* Thread has run to completion: remove it from the ready list */
-    curr_tcb->terminated = TRUE;
-    atomSched (FALSE);
+    /**
+     * Thread has run to completion: terminate it so that it is removed
+     * from the ready list and any joining threads are woken.
+     */
+    atomThreadExit ();
 }
 
 
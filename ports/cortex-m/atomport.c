@@ -37,6 +37,7 @@
 
 #include "atomport.h"
 #include "atomport-private.h"
+#include "atomirq.h"
 #include "asm_offsets.h"
 
 static void thread_shell(void);
@@ -100,6 +101,55 @@ void sys_tick_handler(void)
     atomIntExit(TRUE);
 }
 
+static void cm_irq_mask(uint32_t irqn)
+{
+    nvic_disable_irq((uint8_t) irqn);
+}
+
+static void cm_irq_unmask(uint32_t irqn)
+{
+    nvic_enable_irq((uint8_t) irqn);
+}
+
+/**
+ * Register a threaded interrupt handler. The handler runs in its own thread
+ * at the given priority, with the interrupt disabled in the NVIC, and may
+ * make blocking kernel calls. The vector function for the interrupt must
+ * call cm_irq_threaded_isr().
+ */
+uint8_t cm_irq_register_threaded(uint8_t irqn,
+                                 struct atom_irq_thread *irq_thread,
+                                 void (*handler)(POINTER), POINTER data,
+                                 uint8_t priority, void *stack_bottom,
+                                 uint32_t stack_size)
+{
+    uint8_t status;
+
+    status = atomIrqThreadCreate(irq_thread, irqn, handler, data,
+                                 cm_irq_mask, cm_irq_unmask,
+                                 priority, stack_bottom, stack_size);
+    if(status == ATOM_OK){
+        nvic_enable_irq(irqn);
+    }
+
+    return status;
+}
+
+/**
+ * Low-level handler for threaded interrupts, called from the interrupt's
+ * vector function. Disables the interrupt in the NVIC and wakes the handler
+ * thread, which is switched to on exception return if it is the highest
+ * priority ready thread.
+ */
+void cm_irq_threaded_isr(struct atom_irq_thread *irq_thread)
+{
+    atomIntEnter();
+
+    (void) atomIrqThreadWake(irq_thread);
+
+    atomIntExit(FALSE);
+}
+
 /**
  * Put chip into infinite loop if NMI or hard fault occurs
  */
@@ -139,11 +189,11 @@ static void thread_shell(void)
     }
 
     /**
-     * Thread returned or entry point was not valid.
-     * Should never happen... Maybe we should switch MCU into debug mode here
+     * Thread returned or entry point was not valid. Terminate the thread so
+     * that any joining threads are woken and its TCB and stack can be reused.
+     * This does not return.
      */
-    while(1)
-        ;
+    atomThreadExit();
 }
 
 /**
@@ -79,6 +79,19 @@ struct cortex_port_priv {
 #define THREAD_PORT_PRIV    struct cortex_port_priv port_priv
 #endif
 
+/**
+ * Threaded interrupt handlers. cm_irq_register_threaded() starts the
+ * handler thread and enables the interrupt in the NVIC. The interrupt's
+ * vector function must then call cm_irq_threaded_isr().
+ */
+struct atom_irq_thread;
+extern uint8_t cm_irq_register_threaded(uint8_t irqn,
+                                        struct atom_irq_thread *irq_thread,
+                                        void (*handler)(POINTER), POINTER data,
+                                        uint8_t priority, void *stack_bottom,
+                                        uint32_t stack_size);
+extern void cm_irq_threaded_isr(struct atom_irq_thread *irq_thread);
+
 /* Uncomment to enable stack-checking */
 /* #define ATOM_STACK_CHECKING */
 
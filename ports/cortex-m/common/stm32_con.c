@@ -30,16 +30,285 @@
 #include <errno.h>
 
 #include <libopencm3/cm3/cortex.h>
+#include <libopencm3/cm3/nvic.h>
 #include <libopencm3/stm32/usart.h>
 
+#include "atom.h"
+#include "atommutex.h"
+#include "atomsem.h"
+#include "atomport.h"
+
 /**
  * _read and _write for STM32
  *
  * _read and _write are used by newlib's I/O routines (think printf, etc.)
  * If you want to use this code in your binary, you will have to initialise
  * the UART in your board's setup code and define STD_CON to your UART's
- * name in your board's Makefile
+ * name in your board's Makefile.
+ *
+ * If the board Makefile also defines STD_CON_IRQ and STD_CON_ISR (the
+ * UART's NVIC interrupt number and libopencm3 vector function name, e.g.
+ * NVIC_USART2_IRQ and usart2_isr), the console is interrupt driven:
+ * _write copies into a TX ring buffer and returns, only blocking if the
+ * ring is full, and received characters are collected into an RX ring
+ * buffer from which _read takes them, blocking on a semaphore while it is
+ * empty. Otherwise the UART is polled.
+ */
+
+#if defined(STD_CON_IRQ) && defined(STD_CON_ISR)
+
+#ifndef STD_CON_TX_BUF_SIZE
+#define STD_CON_TX_BUF_SIZE     256
+#endif
+
+#ifndef STD_CON_RX_BUF_SIZE
+#define STD_CON_RX_BUF_SIZE     64
+#endif
+
+/* Status flags live in different registers on the F0 and F1/F4 USARTs */
+#if defined(STM32F0)
+#define CON_FLAG_TXE            USART_ISR_TXE
+#define CON_FLAG_RXNE           USART_ISR_RXNE
+#else
+#define CON_FLAG_TXE            USART_SR_TXE
+#define CON_FLAG_RXNE           USART_SR_RXNE
+#endif
+
+/*
+ * Ring buffers. Indices and counts are only modified with interrupts
+ * masked.
+ */
+static uint8_t tx_buf[STD_CON_TX_BUF_SIZE];
+static volatile uint32_t tx_head, tx_count;
+static uint8_t rx_buf[STD_CON_RX_BUF_SIZE];
+static volatile uint32_t rx_head, rx_count;
+
+/* Threads waiting for TX space or RX data */
+static volatile bool tx_waiting, rx_waiting;
+static ATOM_SEM tx_sem, rx_sem;
+
+/* Keeps each _write (and _read) from different threads together */
+static ATOM_MUTEX tx_mutex, rx_mutex;
+
+static bool initialised = false;
+
+/**
+ * Create the kernel objects and enable the UART's RX interrupt. Called
+ * on first use, the UART itself has been set up by the board code.
+ */
+static void con_init(void)
+{
+    CRITICAL_STORE;
+
+    CRITICAL_START();
+
+    if(initialised == false){
+        atomSemCreate(&tx_sem, 0);
+        atomSemCreate(&rx_sem, 0);
+        atomMutexCreate(&tx_mutex);
+        atomMutexCreate(&rx_mutex);
+
+        usart_enable_rx_interrupt(STD_CON);
+        nvic_enable_irq(STD_CON_IRQ);
+
+        initialised = true;
+    }
+
+    CRITICAL_END();
+}
+
+/**
+ * Move characters from the TX ring into the UART while it can take them.
+ * The TX interrupt stays enabled only while there is more to send.
+ * Must be called with interrupts masked.
+ */
+static void con_tx_fill(void)
+{
+    while(tx_count > 0 && usart_get_flag(STD_CON, CON_FLAG_TXE)){
+        usart_send(STD_CON, tx_buf[tx_head]);
+        tx_head = (tx_head + 1) % STD_CON_TX_BUF_SIZE;
+        --tx_count;
+    }
+
+    if(tx_count > 0){
+        usart_enable_tx_interrupt(STD_CON);
+    }else{
+        usart_disable_tx_interrupt(STD_CON);
+    }
+}
+
+/**
+ * Queue one character for transmission. If the ring is full a thread
+ * sleeps until the ISR has made space. Before the OS is running or in
+ * interrupt context we can not block, so the UART is polled instead.
+ */
+static void con_putc(uint8_t ch)
+{
+    CRITICAL_STORE;
+
+    CRITICAL_START();
+
+    while(tx_count == STD_CON_TX_BUF_SIZE){
+        if(atomOSStarted && atomCurrentContext() != NULL){
+            tx_waiting = true;
+            CRITICAL_END();
+            (void) atomSemGet(&tx_sem, 0);
+            CRITICAL_START();
+        }else{
+            con_tx_fill();
+        }
+    }
+
+    tx_buf[(tx_head + tx_count) % STD_CON_TX_BUF_SIZE] = ch;
+    ++tx_count;
+    con_tx_fill();
+
+    CRITICAL_END();
+}
+
+/**
+ * Console UART interrupt: refill the transmitter, collect received
+ * characters and wake any thread waiting on either ring.
+ */
+void STD_CON_ISR(void)
+{
+    uint8_t ch;
+
+    atomIntEnter();
+
+    while(usart_get_flag(STD_CON, CON_FLAG_RXNE)){
+        ch = usart_recv(STD_CON);
+
+        /* drop characters if nobody reads them */
+        if(rx_count < STD_CON_RX_BUF_SIZE){
+            rx_buf[(rx_head + rx_count) % STD_CON_RX_BUF_SIZE] = ch;
+            ++rx_count;
+        }
+    }
+
+#if defined(STM32F0)
+    /* an overrun keeps the RX interrupt asserted until cleared */
+    USART_ICR(STD_CON) = USART_ICR_ORECF;
+#endif
+
+    if(rx_waiting && rx_count > 0){
+        rx_waiting = false;
+        (void) atomSemPut(&rx_sem);
+    }
+
+    con_tx_fill();
+
+    if(tx_waiting && tx_count < STD_CON_TX_BUF_SIZE){
+        tx_waiting = false;
+        (void) atomSemPut(&tx_sem);
+    }
+
+    atomIntExit(FALSE);
+}
+
+/**
+ * Blocks until at least one character has been received, then returns
+ * as many buffered characters as are available, up to count.
  */
+int _read(int fd, void *buf, size_t count)
+{
+    int rcvd;
+    char *ptr;
+    bool locked;
+    CRITICAL_STORE;
+
+    if(fd <= 2){
+        if(unlikely(initialised == false)){
+            con_init();
+        }
+
+        /* reading only makes sense from a thread */
+        if(atomCurrentContext() == NULL){
+            errno = EIO;
+            return -1;
+        }
+
+        locked = (atomMutexGet(&rx_mutex, 0) == ATOM_OK);
+
+        ptr = (char *) buf;
+        rcvd = 0;
+
+        CRITICAL_START();
+
+        while(rx_count == 0){
+            rx_waiting = true;
+            CRITICAL_END();
+            (void) atomSemGet(&rx_sem, 0);
+            CRITICAL_START();
+        }
+
+        while(count > 0 && rx_count > 0){
+            *ptr = rx_buf[rx_head];
+            rx_head = (rx_head + 1) % STD_CON_RX_BUF_SIZE;
+            --rx_count;
+
+            if(*ptr == '\r'){
+                *ptr = '\n';
+            }
+            ++ptr;
+            ++rcvd;
+            --count;
+        }
+
+        CRITICAL_END();
+
+        if(locked){
+            atomMutexPut(&rx_mutex);
+        }
+    }else{
+        rcvd = -1;
+        errno = EIO;
+    }
+
+    return rcvd;
+}
+
+int _write(int fd, const void *buf, size_t count)
+{
+    int sent;
+    char *ptr;
+    bool locked;
+
+    if(fd <= 2){
+        if(unlikely(initialised == false)){
+            con_init();
+        }
+
+        locked = false;
+        if(atomOSStarted && atomCurrentContext() != NULL){
+            locked = (atomMutexGet(&tx_mutex, 0) == ATOM_OK);
+        }
+
+        sent = 0;
+        ptr = (char *) buf;
+
+        while(count > 0){
+            if(*ptr == '\n'){
+                con_putc('\r');
+            }
+            con_putc(*ptr++);
+            ++sent;
+            --count;
+        }
+
+        if(locked){
+            atomMutexPut(&tx_mutex);
+        }
+    }else{
+        errno = EIO;
+        sent = -1;
+    }
+
+    return sent;
+}
+
+#else /* polled console */
+
 int _read(int fd, void *buf, size_t count)
 {
     int rcvd;
@@ -53,6 +322,7 @@ int _read(int fd, void *buf, size_t count)
             if(*ptr == '\r'){
                 *ptr = '\n';
             }
+            ++ptr;
             ++rcvd;
             --count;
         }
@@ -70,7 +340,7 @@ int _write(int fd, const void *buf, size_t count)
     char *ptr;
 
     if(fd <= 2){
-        sent = count;
+        sent = 0;
         ptr = (char *) buf;
 
         while(count > 0){
@@ -90,3 +360,5 @@ int _write(int fd, const void *buf, size_t count)
     return sent;
 }
 
+
+#endif /* STD_CON_IRQ && STD_CON_ISR */
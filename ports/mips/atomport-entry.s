@@ -80,24 +80,20 @@ LEAF(_handle_tlbmiss)
 #endif
 END(_handle_tlbmiss)
 
-.extern handle_mips_systick
+.extern handle_mips_interrupt
 .extern _int_stack
 LEAF(_handle_interrupt)
 	disable_global_interrupts
-	mfc0 k0, CP0_CAUSE
-	lui k1, 0x4000
-	and k0, k1, k0
-	beq k0, zero, 1f
-	nop
 
 	move k0, sp
 	/* Calculate interrupt context base */
 	addi sp, sp, -(NUM_CTX_REGS * WORD_SIZE)
 	SAVE_INT_CONTEXT(sp)
-	bal handle_mips_systick
+	/* Dispatches timer and threaded hardware interrupts */
+	bal handle_mips_interrupt
 	nop
 	RESTORE_INT_CONTEXT(sp)
-1:
+
 	enable_global_interrupts
 	eret
 END(_handle_interrupt)
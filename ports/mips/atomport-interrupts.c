@@ -30,6 +30,14 @@
 #include <atomport-asm-macros.h>
 #include <atomport.h>
 #include <atom.h>
+#include <atomirq.h>
+#include <atomport-interrupts.h>
+
+/* Threaded handlers registered on each hardware interrupt line */
+static ATOM_IRQ_THREAD *irq_threads[MIPS_NR_HW_IRQS];
+
+/* Status IM bits of the unmasked hardware lines, applied by CRITICAL_END() */
+volatile uint32_t mips_irq_enabled;
 
 void mips_setup_interrupts()
 {
@@ -56,3 +64,101 @@ void mips_disable_global_interrupts(void)
 {
 	__asm__ __volatile__("di $0\t\n");
 }
+
+/*
+ * Mask or unmask a hardware interrupt line in the Status register IM
+ * bits. The mask is kept in mips_irq_enabled rather than only in Status,
+ * because every CRITICAL_END() writes back a saved copy of Status which
+ * may predate the change (e.g. one saved by a thread before it was
+ * switched out). CRITICAL_END() always applies the current mask.
+ */
+void mips_irq_mask(uint32_t line)
+{
+	CRITICAL_STORE;
+
+	CRITICAL_START();
+	mips_irq_enabled &= ~(0x01UL << (MIPS_HW_IRQ_SHIFT + line));
+	CRITICAL_END();
+}
+
+void mips_irq_unmask(uint32_t line)
+{
+	CRITICAL_STORE;
+
+	CRITICAL_START();
+	mips_irq_enabled |= (0x01UL << (MIPS_HW_IRQ_SHIFT + line));
+	CRITICAL_END();
+}
+
+/*
+ * Register a threaded interrupt handler on a hardware interrupt line. The
+ * handler runs in its own thread at the given priority, with the line
+ * masked, and may make blocking kernel calls.
+ */
+uint8_t mips_irq_register_threaded(uint32_t line,
+				   struct atom_irq_thread *irq_thread,
+				   void (*handler)(POINTER), POINTER data,
+				   uint8_t priority, void *stack_bottom,
+				   uint32_t stack_size)
+{
+	uint8_t status;
+
+	if (line >= MIPS_NR_HW_IRQS) {
+		return ATOM_ERR_PARAM;
+	}
+
+	status = atomIrqThreadCreate(irq_thread, line, handler, data,
+				     mips_irq_mask, mips_irq_unmask,
+				     priority, stack_bottom, stack_size);
+	if (status == ATOM_OK) {
+		irq_threads[line] = irq_thread;
+		mips_irq_unmask(line);
+	}
+
+	return status;
+}
+
+/*
+ * Common interrupt dispatch, called from _handle_interrupt with the
+ * interrupt context saved. Timer interrupts go to the system tick.
+ * Otherwise the first pending hardware line with a threaded handler is
+ * masked and its handler thread woken. Lines without a handler are masked
+ * so that they do not interrupt continuously. Any other pending lines
+ * interrupt again after the return from exception.
+ */
+void handle_mips_interrupt(void)
+{
+	uint32_t pending, line, sr;
+
+	if (read_c0_cause() & (0x01UL << 30)) {
+		handle_mips_systick();
+		return;
+	}
+
+	pending = (read_c0_cause() & read_c0_status()) >> MIPS_HW_IRQ_SHIFT;
+
+	for (line = 0; line < MIPS_NR_HW_IRQS; line++) {
+		if (!(pending & (0x01UL << line)))
+			continue;
+
+		if (irq_threads[line] == NULL) {
+			mips_irq_mask(line);
+			continue;
+		}
+
+		/* clear EXL from status */
+		sr = read_c0_status();
+		sr &= ~0x00000002;
+		write_c0_status(sr);
+
+		/* Call the interrupt entry routine */
+		atomIntEnter();
+
+		/* Mask the line and wake the handler thread */
+		(void)atomIrqThreadWake(irq_threads[line]);
+
+		/* Call the interrupt exit routine */
+		atomIntExit(FALSE);
+		return;
+	}
+}
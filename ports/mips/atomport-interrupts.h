@@ -30,9 +30,23 @@
 #ifndef __ATOMPORT_INTERRUPTS_H
 #define __ATOMPORT_INTERRUPTS_H
 
+/* Number of hardware interrupt lines (Cause IP2-IP7 / Status IM2-IM7) */
+#define MIPS_NR_HW_IRQS		6
+#define MIPS_HW_IRQ_SHIFT	10
+
+struct atom_irq_thread;
+
 void mips_setup_interrupts();
 void mips_enable_global_interrupts(void);
 void mips_disable_global_interrupts(void);
+void mips_irq_mask(uint32_t line);
+void mips_irq_unmask(uint32_t line);
+uint8_t mips_irq_register_threaded(uint32_t line,
+				   struct atom_irq_thread *irq_thread,
+				   void (*handler)(POINTER), POINTER data,
+				   uint8_t priority, void *stack_bottom,
+				   uint32_t stack_size);
+void handle_mips_interrupt(void);
 void handle_mips_systick(void);
 
 #endif /* __ATOMPORT_INTERRUPTS_H */
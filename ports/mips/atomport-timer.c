@@ -31,6 +31,7 @@
 #include <atomport.h>
 #include <atom.h>
 #include <atomport-private.h>
+#include <atomport-interrupts.h>
 
 /** CPU frequency in MHz */
 #define CPU_FREQ_MHZ					100
@@ -40,20 +41,28 @@
 
 unsigned long long jiffies;
 
+/**
+ * Count value of the next tick deadline. Each deadline is a whole number
+ * of periods after the first, so interrupt latency does not accumulate.
+ */
+static uint32_t next_compare;
+
 void mips_cpu_timer_enable(void)
 {
-	uint32_t sr = read_c0_status();
-	sr |= ((0x1UL << 7) << 8);
-	write_c0_status(sr);
+	/* The timer interrupts on IM7, hardware line 5 */
+	mips_irq_unmask(5);
 
 	uint32_t cause = read_c0_cause();
 	cause &= ~(0x1UL << 27);
 	write_c0_cause(cause);
-	write_c0_compare(read_c0_count() + COUNTER_TICK_COUNT);
+	next_compare = read_c0_count() + COUNTER_TICK_COUNT;
+	write_c0_compare(next_compare);
 }
 
 void handle_mips_systick(void)
 {
+	uint32_t ticks;
+
 	/* clear EXL from status */
 	uint32_t sr = read_c0_status();
 	sr &= ~0x00000002;
@@ -62,10 +71,23 @@ void handle_mips_systick(void)
 	/* Call the interrupt entry routine */
 	atomIntEnter();
 
-	/* Call the OS system tick handler */
-	atomTimerTick();
+	/*
+	 * Program the next deadline one period after the one which has just
+	 * passed, rather than one period from now. If that deadline has also
+	 * passed (interrupts were masked for more than a period, or it
+	 * passed while we were writing it) keep stepping on by whole periods,
+	 * counting each as an elapsed tick, otherwise Compare would not match
+	 * again until Count wraps.
+	 */
+	ticks = 0;
+	do {
+		ticks++;
+		next_compare += COUNTER_TICK_COUNT;
+		write_c0_compare(next_compare);
+	} while ((int32_t)(next_compare - read_c0_count()) <= 0);
 
-	write_c0_compare(read_c0_count() + COUNTER_TICK_COUNT);
+	/* Call the OS system tick handler for all elapsed ticks */
+	atomTimerAdvance(ticks);
 
 	/* Call the interrupt exit routine */
 	atomIntExit(TRUE);
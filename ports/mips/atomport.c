@@ -38,6 +38,25 @@
 /* Used for managing nesting of atomport.h critical sections */
 uint32_t at_preempt_count = 0;
 
+/**
+ * Shell routine which is used to call all thread entry points. The thread
+ * entry point and parameter are taken from the TCB. If the entry point
+ * returns, the thread is terminated so that any joining threads are woken
+ * and its TCB and stack can be reused.
+ */
+static void thread_shell (void)
+{
+	ATOM_TCB *curr_tcb = atomCurrentContext();
+
+	/* Call the thread entry point */
+	if (curr_tcb && curr_tcb->entry_point) {
+		curr_tcb->entry_point(curr_tcb->entry_param);
+	}
+
+	/* Thread has run to completion, this does not return */
+	atomThreadExit();
+}
+
 /**
  * This function initialises each thread's stack during creation, before the
  * thread is first run. New threads are scheduled in using the same
@@ -76,7 +95,7 @@ void archThreadContextInit (ATOM_TCB *tcb_ptr, void *stack_top,
 	STORE_VAL(stack_start, s6, 0);
 	STORE_VAL(stack_start, s7, 0);
 	STORE_VAL(stack_start, cp0_epc, 0);
-	STORE_VAL(stack_start, ra, entry_point);
+	STORE_VAL(stack_start, ra, thread_shell);
 	STORE_VAL(stack_start, a0, entry_param);
 }
 
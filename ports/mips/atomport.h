@@ -64,8 +64,16 @@
  * to protect OS data structures during modification. It must
  * allow nested calls, which means that interrupts should only
  * be re-enabled when the outer CRITICAL_END() is reached.
+ *
+ * The saved Status register may be restored long after it was
+ * saved (for example after a context switch), so the hardware
+ * interrupt mask bits (IM2-IM7) are not taken from the saved
+ * copy but from mips_irq_enabled, which holds the current mask
+ * set by mips_irq_mask() and mips_irq_unmask().
  */
+#define MIPS_HW_IRQ_BITS	(0x3FUL << 10)
 extern uint32_t at_preempt_count;
+extern volatile uint32_t mips_irq_enabled;
 #define CRITICAL_STORE	    uint32_t status_reg
 #define CRITICAL_START()					\
 	do {							\
@@ -79,7 +87,8 @@ extern uint32_t at_preempt_count;
 		__asm__ __volatile__("mtc0 %0, $12\t\n"			\
 				     "nop\t\n"				\
 				     "ehb\t\n"				\
-				     ::"r"(status_reg));		\
+				     ::"r"((status_reg & ~MIPS_HW_IRQ_BITS)	\
+					   | mips_irq_enabled));	\
 	}while(0);
 
 /* Uncomment to enable stack-checking */
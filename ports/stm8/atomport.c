@@ -105,7 +105,11 @@ static NO_REG_SAVE void thread_shell (void)
         curr_tcb->entry_point(curr_tcb->entry_param);
     }
 
-    /* Not reached - threads should never return from the entry point */
+    /**
+     * Thread has run to completion: terminate it so that it is removed
+     * from the ready list and any joining threads are woken.
+     */
+    atomThreadExit ();
 
 }
 
@@ -23,7 +23,7 @@ APP_ASM_OBJECTS = atomport-asm-sdcc.rel
 PERIPH_OBJECTS = stm8s_gpio.rel stm8s_tim1.rel stm8s_clk.rel stm8s_uart2.rel
 
 # Kernel object files
-KERNEL_OBJECTS = atomkernel.rel atomsem.rel atommutex.rel atomtimer.rel atomqueue.rel
+KERNEL_OBJECTS = atomkernel.rel atomsem.rel atommutex.rel atomtimer.rel atomqueue.rel atommbox.rel atompool.rel atomtopic.rel atomptrqueue.rel atomdbuf.rel atomwork.rel atomirq.rel atomcyclic.rel atomlog.rel
 
 # Collection of built objects (excluding test applications)
 ALL_OBJECTS = $(APP_OBJECTS) $(APP_ASM_OBJECTS) $(PERIPH_OBJECTS) $(KERNEL_OBJECTS)
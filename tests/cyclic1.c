@@ -0,0 +1,238 @@
+/*
+ * Copyright (c) 2022, Matt Liss
+ * Copyright (c) 2010, Kelvin Lawson. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. No personal names or organizations' names associated with the
+ *    Atomthreads project may be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE ATOMTHREADS PROJECT AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "atom.h"
+#include "atomcyclic.h"
+#include "atomtests.h"
+
+
+/* The test data and jobs are only needed if the cyclic executive is enabled */
+#ifdef ATOM_CYCLIC
+
+/* Test hyperperiod and number of hyperperiods to record */
+#define HYPERPERIOD           10
+#define NUM_HYPERPERIODS      2
+
+/* Number of jobs released per hyperperiod */
+#define NUM_ENTRIES           4
+
+
+/* Forward declarations */
+static void test_job (POINTER data);
+
+
+/* Test OS objects */
+static uint8_t test_thread_stack[TEST_THREAD_STACK_SIZE];
+
+
+/**
+ * Schedule table. Job 'B' runs for two ticks, so job 'C' released at the
+ * same offset must wait for it to complete.
+ */
+static const ATOM_CYCLIC_ENTRY schedule[NUM_ENTRIES] =
+{
+    { 0, test_job, (POINTER)"A" },
+    { 3, test_job, (POINTER)"B" },
+    { 3, test_job, (POINTER)"C" },
+    { 7, test_job, (POINTER)"A" }
+};
+
+/* Expected job order and start offsets within each hyperperiod */
+static const char expected_job[NUM_ENTRIES] = { 'A', 'B', 'C', 'A' };
+static const uint32_t expected_offset[NUM_ENTRIES] = { 0, 3, 5, 7 };
+
+
+/* Test global data */
+static volatile int job_count;
+static volatile char job_log[NUM_ENTRIES * NUM_HYPERPERIODS];
+static volatile uint32_t job_time[NUM_ENTRIES * NUM_HYPERPERIODS];
+static volatile int job_running;
+static volatile int job_overlap;
+
+#endif
+
+
+/**
+ * \b test_start
+ *
+ * Start kernel test.
+ *
+ * This tests the cyclic executive (only if ATOM_CYCLIC is enabled,
+ * otherwise the test trivially passes).
+ *
+ * A table of four job releases in a ten tick hyperperiod is run for two
+ * hyperperiods. The jobs record their order and start times, which must
+ * follow the table. One job takes two ticks, so the job released at the
+ * same offset must start only once it completes, and no job may start
+ * while another is running.
+ *
+ * @retval Number of failures
+ */
+uint32_t test_start (void)
+{
+    int failures;
+
+#ifdef ATOM_CYCLIC
+    int i;
+    uint32_t start;
+
+    /* Default to zero failures */
+    failures = 0;
+    job_count = 0;
+    job_running = FALSE;
+    job_overlap = FALSE;
+
+    /* Check parameter checks */
+    if ((atomCyclicStart (NULL, NUM_ENTRIES, HYPERPERIOD, TEST_THREAD_PRIO - 1,
+            &test_thread_stack[0], TEST_THREAD_STACK_SIZE) != ATOM_ERR_PARAM)
+        || (atomCyclicStart (schedule, NUM_ENTRIES, 5, TEST_THREAD_PRIO - 1,
+            &test_thread_stack[0], TEST_THREAD_STACK_SIZE) != ATOM_ERR_PARAM)
+        || (atomCyclicStop () != ATOM_ERROR))
+    {
+        ATOMLOG (_STR("Param check\n"));
+        failures++;
+    }
+
+    /* Start on a tick boundary so the recorded times are exact */
+    atomTimerDelay (1);
+    start = atomTimeGet();
+    if (atomCyclicStart (schedule, NUM_ENTRIES, HYPERPERIOD, TEST_THREAD_PRIO - 1,
+            &test_thread_stack[0], TEST_THREAD_STACK_SIZE) != ATOM_OK)
+    {
+        ATOMLOG (_STR("Start\n"));
+        failures++;
+    }
+    else
+    {
+        /* Only one executive can run */
+        if (atomCyclicStart (schedule, NUM_ENTRIES, HYPERPERIOD, TEST_THREAD_PRIO - 1,
+                &test_thread_stack[0], TEST_THREAD_STACK_SIZE) != ATOM_ERROR)
+        {
+            ATOMLOG (_STR("Second start\n"));
+            failures++;
+        }
+
+        /* Let it run for the test hyperperiods */
+        atomTimerDelay ((HYPERPERIOD * NUM_HYPERPERIODS) - 1);
+        if (atomCyclicStop () != ATOM_OK)
+        {
+            ATOMLOG (_STR("Stop\n"));
+            failures++;
+        }
+
+        /**
+         * Check the job order and start times. Offset 0 is released on the
+         * first tick after starting.
+         */
+        if (job_count != NUM_ENTRIES * NUM_HYPERPERIODS)
+        {
+            ATOMLOG (_STR("Job count %d\n"), job_count);
+            failures++;
+        }
+        else
+        {
+            for (i = 0; i < job_count; i++)
+            {
+                if ((job_log[i] != expected_job[i % NUM_ENTRIES])
+                    || (job_time[i] - start - 1 != expected_offset[i % NUM_ENTRIES] + (HYPERPERIOD * (i / NUM_ENTRIES))))
+                {
+                    ATOMLOG (_STR("Job %d: %c at %d\n"), i, job_log[i], (int)(job_time[i] - start - 1));
+                    failures++;
+                }
+            }
+        }
+
+        /* Jobs must run to completion */
+        if (job_overlap == TRUE)
+        {
+            ATOMLOG (_STR("Overlap\n"));
+            failures++;
+        }
+        if (atomCyclicOverruns() != 0)
+        {
+            ATOMLOG (_STR("Overruns\n"));
+            failures++;
+        }
+    }
+
+#else
+    /* Cyclic executive not enabled, nothing to test */
+    failures = 0;
+#endif
+
+    /* Quit */
+    return failures;
+
+}
+
+
+#ifdef ATOM_CYCLIC
+/**
+ * \b test_job
+ *
+ * Job function for all schedule entries.
+ *
+ * Records the job name and start time. Job 'B' busy-waits for two ticks.
+ *
+ * @param[in] data Job name string
+ *
+ * @return None
+ */
+static void test_job (POINTER data)
+{
+    char name = *(const char *)data;
+    uint32_t start;
+
+    /* Check no other job is part way through */
+    if (job_running == TRUE)
+    {
+        job_overlap = TRUE;
+    }
+    job_running = TRUE;
+
+    /* Record the job */
+    start = atomTimeGet();
+    if (job_count < NUM_ENTRIES * NUM_HYPERPERIODS)
+    {
+        job_log[job_count] = name;
+        job_time[job_count] = start;
+        job_count++;
+    }
+
+    /* Job B takes two ticks */
+    if (name == 'B')
+    {
+        while (atomTimeGet() - start < 2)
+            ;
+    }
+
+    job_running = FALSE;
+}
+#endif
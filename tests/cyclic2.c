@@ -0,0 +1,205 @@
+/*
+ * Copyright (c) 2022, Matt Liss
+ * Copyright (c) 2010, Kelvin Lawson. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. No personal names or organizations' names associated with the
+ *    Atomthreads project may be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE ATOMTHREADS PROJECT AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "atom.h"
+#include "atomcyclic.h"
+#include "atomtests.h"
+
+
+/* The test data and jobs are only needed if the cyclic executive is enabled */
+#ifdef ATOM_CYCLIC
+
+/* Test hyperperiod */
+#define HYPERPERIOD           6
+
+/* Number of jobs released per hyperperiod */
+#define NUM_ENTRIES           3
+
+/* Number of jobs to record */
+#define NUM_RECORDS           8
+
+/* Ticks taken by the first run of job 'A' */
+#define OVERRUN_TICKS         9
+
+
+/* Forward declarations */
+static void test_job (POINTER data);
+
+
+/* Test OS objects */
+static uint8_t test_thread_stack[TEST_THREAD_STACK_SIZE];
+
+
+/* Schedule table */
+static const ATOM_CYCLIC_ENTRY schedule[NUM_ENTRIES] =
+{
+    { 0, test_job, (POINTER)"A" },
+    { 2, test_job, (POINTER)"B" },
+    { 4, test_job, (POINTER)"C" }
+};
+
+/**
+ * Expected job order and start offsets. The first run of 'A' holds up the
+ * executive until offset 9. 'A' was released again at offset 6 after it
+ * had started, but 'B' was released again at offset 8 before its first
+ * release had started, so that release is dropped. The jobs then catch
+ * up in release order and continue on schedule.
+ */
+static const char expected_job[NUM_RECORDS] = { 'A', 'B', 'C', 'A', 'C', 'A', 'B', 'C' };
+static const uint32_t expected_offset[NUM_RECORDS] = { 0, 9, 9, 9, 10, 12, 14, 16 };
+
+
+/* Test global data */
+static volatile int job_count;
+static volatile char job_log[NUM_RECORDS];
+static volatile uint32_t job_time[NUM_RECORDS];
+
+#endif
+
+
+/**
+ * \b test_start
+ *
+ * Start kernel test.
+ *
+ * This tests overruns in the cyclic executive (only if ATOM_CYCLIC is
+ * enabled, otherwise the test trivially passes).
+ *
+ * The first job in the table runs for longer than the hyperperiod, so the
+ * other jobs fall behind and one release is dropped. The jobs must then
+ * run in the order they were released and carry on at their own offsets,
+ * rather than being shifted along the table by the dropped release.
+ *
+ * @retval Number of failures
+ */
+uint32_t test_start (void)
+{
+    int failures;
+
+#ifdef ATOM_CYCLIC
+    int i;
+    uint32_t start;
+
+    /* Default to zero failures */
+    failures = 0;
+    job_count = 0;
+
+    /* Start on a tick boundary so the recorded times are exact */
+    atomTimerDelay (1);
+    start = atomTimeGet();
+    if (atomCyclicStart (schedule, NUM_ENTRIES, HYPERPERIOD, TEST_THREAD_PRIO - 1,
+            &test_thread_stack[0], TEST_THREAD_STACK_SIZE) != ATOM_OK)
+    {
+        ATOMLOG (_STR("Start\n"));
+        failures++;
+    }
+    else
+    {
+        /* Let it run until all of the recorded jobs have started */
+        atomTimerDelay (expected_offset[NUM_RECORDS - 1] + 1);
+        if (atomCyclicStop () != ATOM_OK)
+        {
+            ATOMLOG (_STR("Stop\n"));
+            failures++;
+        }
+
+        /* Check the job order and start times */
+        if (job_count != NUM_RECORDS)
+        {
+            ATOMLOG (_STR("Job count %d\n"), job_count);
+            failures++;
+        }
+        else
+        {
+            for (i = 0; i < job_count; i++)
+            {
+                if ((job_log[i] != expected_job[i])
+                    || (job_time[i] - start - 1 != expected_offset[i]))
+                {
+                    ATOMLOG (_STR("Job %d: %c at %d\n"), i, job_log[i], (int)(job_time[i] - start - 1));
+                    failures++;
+                }
+            }
+        }
+
+        /* Only the second release of 'B' should have been dropped */
+        if (atomCyclicOverruns() != 1)
+        {
+            ATOMLOG (_STR("Overruns %d\n"), (int)atomCyclicOverruns());
+            failures++;
+        }
+    }
+
+#else
+    /* Cyclic executive not enabled, nothing to test */
+    failures = 0;
+#endif
+
+    /* Quit */
+    return failures;
+
+}
+
+
+#ifdef ATOM_CYCLIC
+/**
+ * \b test_job
+ *
+ * Job function for all schedule entries.
+ *
+ * Records the job name and start time. The first run of job 'A' busy-waits
+ * for OVERRUN_TICKS.
+ *
+ * @param[in] data Job name string
+ *
+ * @return None
+ */
+static void test_job (POINTER data)
+{
+    char name = *(const char *)data;
+    uint32_t start;
+
+    /* Record the job */
+    start = atomTimeGet();
+    if (job_count < NUM_RECORDS)
+    {
+        job_log[job_count] = name;
+        job_time[job_count] = start;
+        job_count++;
+    }
+
+    /* The first run of job A overruns */
+    if ((name == 'A') && (job_count == 1))
+    {
+        while (atomTimeGet() - start < OVERRUN_TICKS)
+            ;
+    }
+}
+#endif
@@ -0,0 +1,229 @@
+/*
+ * Copyright (c) 2022, Matt Liss
+ * Copyright (c) 2010, Kelvin Lawson. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. No personal names or organizations' names associated with the
+ *    Atomthreads project may be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE ATOMTHREADS PROJECT AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "atom.h"
+#include "atomtimer.h"
+#include "atomcyclic.h"
+#include "atomtests.h"
+
+
+/* The test data and jobs are only needed if the cyclic executive is enabled */
+#ifdef ATOM_CYCLIC
+
+/* Test hyperperiod */
+#define HYPERPERIOD           6
+
+/* Number of jobs released per hyperperiod */
+#define NUM_ENTRIES           3
+
+/* Number of jobs to record */
+#define NUM_RECORDS           6
+
+/* Ticks accounted in one call to atomTimerAdvance() */
+#define ADVANCE_TICKS         ((3 * HYPERPERIOD) + 2)
+
+
+/* Forward declarations */
+static void test_job (POINTER data);
+static void triggerCallback (POINTER cb_data);
+
+
+/* Test OS objects */
+static uint8_t test_thread_stack[TEST_THREAD_STACK_SIZE];
+static ATOM_TIMER trigger_timer;
+
+
+/* Schedule table */
+static const ATOM_CYCLIC_ENTRY schedule[NUM_ENTRIES] =
+{
+    { 0, test_job, (POINTER)"A" },
+    { 2, test_job, (POINTER)"B" },
+    { 4, test_job, (POINTER)"C" }
+};
+
+/**
+ * Expected job order and start times. 'A' is released on the first tick,
+ * then the trigger timer accounts for ADVANCE_TICKS more ticks in one go
+ * (offsets 1 to 20) before the executive can run. Each job then runs once
+ * for the releases in that span, and the schedule carries on from offset
+ * 21, which is offset 3 of the hyperperiod.
+ */
+static const char expected_job[NUM_RECORDS] = { 'A', 'B', 'C', 'C', 'A', 'B' };
+static const uint32_t expected_time[NUM_RECORDS] = { 21, 21, 21, 23, 25, 27 };
+
+/**
+ * Releases dropped within the span: 'A' at offsets 6, 12 and 18, 'B' at
+ * 8, 14 and 20 and 'C' at 10 and 16.
+ */
+#define EXPECTED_OVERRUNS     8
+
+
+/* Test global data */
+static volatile int job_count;
+static volatile char job_log[NUM_RECORDS];
+static volatile uint32_t job_time[NUM_RECORDS];
+
+#endif
+
+
+/**
+ * \b test_start
+ *
+ * Start kernel test.
+ *
+ * This tests the cyclic executive when several hyperperiods are accounted
+ * for in one call to atomTimerAdvance(), as for a port which has detected
+ * missed ticks (only if ATOM_CYCLIC is enabled, otherwise the test
+ * trivially passes).
+ *
+ * Each job must be released once and its other releases in the span
+ * counted as overruns, exactly as if each tick had been handled
+ * separately, and the schedule must carry on at the right offset after
+ * the span.
+ *
+ * @retval Number of failures
+ */
+uint32_t test_start (void)
+{
+    int failures;
+
+#ifdef ATOM_CYCLIC
+    int i;
+    uint32_t start;
+
+    /* Default to zero failures */
+    failures = 0;
+    job_count = 0;
+
+    /* Start on a tick boundary so the recorded times are exact */
+    atomTimerDelay (1);
+    start = atomTimeGet();
+    if (atomCyclicStart (schedule, NUM_ENTRIES, HYPERPERIOD, TEST_THREAD_PRIO - 1,
+            &test_thread_stack[0], TEST_THREAD_STACK_SIZE) != ATOM_OK)
+    {
+        ATOMLOG (_STR("Start\n"));
+        failures++;
+    }
+    else
+    {
+        /* Account for the missed ticks on the tick which releases 'A' */
+        trigger_timer.cb_func = triggerCallback;
+        trigger_timer.cb_data = NULL;
+        trigger_timer.cb_ticks = 1;
+        if (atomTimerRegister (&trigger_timer) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Timer register\n"));
+            failures++;
+        }
+
+        /* Let it run until all of the recorded jobs have started */
+        atomTimerDelay (expected_time[NUM_RECORDS - 1] + 1);
+        if (atomCyclicStop () != ATOM_OK)
+        {
+            ATOMLOG (_STR("Stop\n"));
+            failures++;
+        }
+
+        /* Check the job order and start times */
+        if (job_count != NUM_RECORDS)
+        {
+            ATOMLOG (_STR("Job count %d\n"), job_count);
+            failures++;
+        }
+        else
+        {
+            for (i = 0; i < job_count; i++)
+            {
+                if ((job_log[i] != expected_job[i])
+                    || (job_time[i] - start != expected_time[i]))
+                {
+                    ATOMLOG (_STR("Job %d: %c at %d\n"), i, job_log[i], (int)(job_time[i] - start));
+                    failures++;
+                }
+            }
+        }
+
+        /* Check the releases dropped within the span */
+        if (atomCyclicOverruns() != EXPECTED_OVERRUNS)
+        {
+            ATOMLOG (_STR("Overruns %d\n"), (int)atomCyclicOverruns());
+            failures++;
+        }
+    }
+
+#else
+    /* Cyclic executive not enabled, nothing to test */
+    failures = 0;
+#endif
+
+    /* Quit */
+    return failures;
+
+}
+
+
+#ifdef ATOM_CYCLIC
+/**
+ * \b test_job
+ *
+ * Job function for all schedule entries.
+ *
+ * Records the job name and start time.
+ *
+ * @param[in] data Job name string
+ *
+ * @return None
+ */
+static void test_job (POINTER data)
+{
+    /* Record the job */
+    if (job_count < NUM_RECORDS)
+    {
+        job_log[job_count] = *(const char *)data;
+        job_time[job_count] = atomTimeGet();
+        job_count++;
+    }
+}
+
+
+/**
+ * \b triggerCallback
+ *
+ * Timer callback which accounts for ADVANCE_TICKS missed ticks.
+ *
+ * @param[in] cb_data Unused
+ *
+ * @return None
+ */
+static void triggerCallback (POINTER cb_data)
+{
+    atomTimerAdvance (ADVANCE_TICKS);
+}
+#endif
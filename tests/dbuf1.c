@@ -0,0 +1,180 @@
+/*
+ * Copyright (c) 2022, Matt Liss
+ * Copyright (c) 2010, Kelvin Lawson. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. No personal names or organizations' names associated with the
+ *    Atomthreads project may be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE ATOMTHREADS PROJECT AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "atom.h"
+#include "atomdbuf.h"
+#include "atomtests.h"
+
+
+/* Test OS objects */
+static ATOM_DBUF dbuf1;
+static uint8_t buff_storage[3][8];
+static void *buffs[3] = { buff_storage[0], buff_storage[1], buff_storage[2] };
+
+
+/**
+ * \b test_start
+ *
+ * Start double/triple buffer test.
+ *
+ * This tests the non-blocking behaviour of the buffer objects, swapping
+ * buffers from thread context: parameter checks, the order buffers are
+ * handed between producer and consumer, and the handling of overruns with
+ * both two and three buffers.
+ *
+ * @retval Number of failures
+ */
+uint32_t test_start (void)
+{
+    int failures;
+    void *fill, *full;
+    uint32_t overruns;
+
+    /* Default to zero failures */
+    failures = 0;
+
+    /* Test parameter checks */
+    if ((atomDbufCreate (NULL, buffs, 2) != ATOM_ERR_PARAM)
+        || (atomDbufCreate (&dbuf1, NULL, 2) != ATOM_ERR_PARAM)
+        || (atomDbufCreate (&dbuf1, buffs, 1) != ATOM_ERR_PARAM)
+        || (atomDbufCreate (&dbuf1, buffs, 4) != ATOM_ERR_PARAM)
+        || (atomDbufSwap (NULL, &fill) != ATOM_ERR_PARAM)
+        || (atomDbufGet (NULL, -1, &full) != ATOM_ERR_PARAM)
+        || (atomDbufRelease (NULL) != ATOM_ERR_PARAM)
+        || (atomDbufOverruns (NULL, &overruns, FALSE) != ATOM_ERR_PARAM))
+    {
+        ATOMLOG (_STR("Param\n"));
+        failures++;
+    }
+
+    /* Triple buffering */
+    if (atomDbufCreate (&dbuf1, buffs, 3) != ATOM_OK)
+    {
+        ATOMLOG (_STR("Create3\n"));
+        failures++;
+        return failures;
+    }
+
+    /* Nothing ready until the producer swaps */
+    if (atomDbufGet (&dbuf1, -1, &full) != ATOM_WOULDBLOCK)
+    {
+        ATOMLOG (_STR("Empty3\n"));
+        failures++;
+    }
+
+    /* The first block goes to the consumer */
+    if ((atomDbufSwap (&dbuf1, &fill) != ATOM_OK) || (fill != buffs[1])
+        || (atomDbufGet (&dbuf1, -1, &full) != ATOM_OK) || (full != buffs[0]))
+    {
+        ATOMLOG (_STR("First3\n"));
+        failures++;
+    }
+
+    /* One more block can complete while the consumer is busy */
+    if ((atomDbufSwap (&dbuf1, &fill) != ATOM_OK) || (fill != buffs[2]))
+    {
+        ATOMLOG (_STR("Second3\n"));
+        failures++;
+    }
+
+    /* A further block overruns, discarding the older ready block */
+    if ((atomDbufSwap (&dbuf1, &fill) != ATOM_ERR_OVF) || (fill != buffs[1]))
+    {
+        ATOMLOG (_STR("Overrun3\n"));
+        failures++;
+    }
+
+    /* The consumer gets the newest block, its old buffer becomes free */
+    if ((atomDbufGet (&dbuf1, -1, &full) != ATOM_OK) || (full != buffs[2])
+        || (atomDbufSwap (&dbuf1, &fill) != ATOM_OK) || (fill != buffs[0]))
+    {
+        ATOMLOG (_STR("Recover3\n"));
+        failures++;
+    }
+
+    /* Check and reset the overrun count */
+    if ((atomDbufOverruns (&dbuf1, &overruns, TRUE) != ATOM_OK) || (overruns != 1)
+        || (atomDbufOverruns (&dbuf1, &overruns, FALSE) != ATOM_OK) || (overruns != 0))
+    {
+        ATOMLOG (_STR("Count3\n"));
+        failures++;
+    }
+
+    /* Ping-pong buffering */
+    if (atomDbufCreate (&dbuf1, buffs, 2) != ATOM_OK)
+    {
+        ATOMLOG (_STR("Create2\n"));
+        failures++;
+        return failures;
+    }
+
+    /* The first block goes to the consumer */
+    if ((atomDbufSwap (&dbuf1, &fill) != ATOM_OK) || (fill != buffs[1])
+        || (atomDbufGet (&dbuf1, -1, &full) != ATOM_OK) || (full != buffs[0]))
+    {
+        ATOMLOG (_STR("First2\n"));
+        failures++;
+    }
+
+    /* The consumer still holds the other buffer, so the new block is lost */
+    if ((atomDbufSwap (&dbuf1, &fill) != ATOM_ERR_OVF) || (fill != buffs[1])
+        || (atomDbufGet (&dbuf1, -1, &full) != ATOM_WOULDBLOCK))
+    {
+        ATOMLOG (_STR("Overrun2\n"));
+        failures++;
+    }
+
+    /* Once released the buffers alternate again */
+    if ((atomDbufRelease (&dbuf1) != ATOM_OK)
+        || (atomDbufSwap (&dbuf1, &fill) != ATOM_OK) || (fill != buffs[0])
+        || (atomDbufGet (&dbuf1, -1, &full) != ATOM_OK) || (full != buffs[1]))
+    {
+        ATOMLOG (_STR("Recover2\n"));
+        failures++;
+    }
+
+    /* Check the overrun count */
+    if ((atomDbufOverruns (&dbuf1, &overruns, FALSE) != ATOM_OK) || (overruns != 1))
+    {
+        ATOMLOG (_STR("Count2\n"));
+        failures++;
+    }
+
+    /* Delete the object, test finished */
+    if (atomDbufDelete (&dbuf1) != ATOM_OK)
+    {
+        ATOMLOG (_STR("Delete\n"));
+        failures++;
+    }
+
+    /* Quit */
+    return failures;
+}
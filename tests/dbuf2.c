@@ -0,0 +1,271 @@
+/*
+ * Copyright (c) 2022, Matt Liss
+ * Copyright (c) 2010, Kelvin Lawson. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. No personal names or organizations' names associated with the
+ *    Atomthreads project may be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE ATOMTHREADS PROJECT AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "atom.h"
+#include "atomdbuf.h"
+#include "atomtests.h"
+
+
+/* Number of blocks produced */
+#define NUM_BLOCKS          6
+
+
+/* Number of test threads */
+#define NUM_TEST_THREADS    1
+
+
+/* Test OS objects */
+static ATOM_DBUF dbuf1;
+static ATOM_TIMER timer_cb;
+static uint8_t buff_storage[2][8];
+static void *buffs[2] = { buff_storage[0], buff_storage[1] };
+static ATOM_TCB tcb[NUM_TEST_THREADS];
+static uint8_t test_thread_stack[NUM_TEST_THREADS][TEST_THREAD_STACK_SIZE];
+
+
+/* Test result tracking */
+static volatile int num_swaps, num_received;
+static volatile uint8_t isr_status, final_status;
+static void * volatile received[NUM_BLOCKS];
+
+
+/* Forward declarations */
+static void test_thread_func (uint32_t param);
+static void testCallback (POINTER cb_data);
+
+
+/**
+ * \b test_start
+ *
+ * Start double/triple buffer test.
+ *
+ * This tests the blocking behaviour of the buffer objects with a producer
+ * in interrupt context. A timer callback acts as the DMA completion
+ * interrupt and swaps a ping-pong buffer every two ticks, while a consumer
+ * thread blocks waiting for each block. The consumer should be handed the
+ * two buffers alternately with no overruns. The test also checks that a
+ * blocking get cannot be made from interrupt context, that gets time out,
+ * and that deleting the object wakes the consumer.
+ *
+ * @retval Number of failures
+ */
+uint32_t test_start (void)
+{
+    int failures;
+    int i;
+    void *full;
+    uint32_t overruns;
+
+    /* Default to zero failures */
+    failures = 0;
+    num_swaps = num_received = 0;
+    isr_status = final_status = 0xFF;
+
+    /* Create the buffer object */
+    if (atomDbufCreate (&dbuf1, buffs, 2) != ATOM_OK)
+    {
+        ATOMLOG (_STR("Create\n"));
+        failures++;
+        return failures;
+    }
+
+    /* Create the consumer thread, which blocks straight away */
+    if (atomThreadCreate(&tcb[0], TEST_THREAD_PRIO - 1, test_thread_func, 0,
+          &test_thread_stack[0][0],
+          TEST_THREAD_STACK_SIZE, TRUE) != ATOM_OK)
+    {
+        ATOMLOG (_STR("Error creating test thread\n"));
+        failures++;
+    }
+
+    /* Start the producer */
+    timer_cb.cb_func = testCallback;
+    timer_cb.cb_data = NULL;
+    timer_cb.cb_ticks = 2;
+    if (atomTimerRegister (&timer_cb) != ATOM_OK)
+    {
+        ATOMLOG (_STR("Timer\n"));
+        failures++;
+    }
+
+    /* Wait for all blocks to be produced */
+    atomTimerDelay ((NUM_BLOCKS * 2) + (SYSTEM_TICKS_PER_SEC/10));
+
+    /* Check the consumer received each block in turn */
+    if ((num_swaps != NUM_BLOCKS) || (num_received != NUM_BLOCKS))
+    {
+        ATOMLOG (_STR("Blocks %d/%d\n"), num_swaps, num_received);
+        failures++;
+    }
+    for (i = 0; i < num_received; i++)
+    {
+        if (received[i] != buffs[i & 1])
+        {
+            ATOMLOG (_STR("Block %d\n"), i);
+            failures++;
+        }
+    }
+
+    /* No overruns should have occurred */
+    if ((atomDbufOverruns (&dbuf1, &overruns, FALSE) != ATOM_OK) || (overruns != 0))
+    {
+        ATOMLOG (_STR("Overruns %d\n"), (int)overruns);
+        failures++;
+    }
+
+    /* Blocking gets are not allowed in interrupt context */
+    if (isr_status != ATOM_ERR_CONTEXT)
+    {
+        ATOMLOG (_STR("Context %d\n"), isr_status);
+        failures++;
+    }
+
+    /* With the producer stopped, gets time out */
+    if (atomDbufGet (&dbuf1, SYSTEM_TICKS_PER_SEC/10, &full) != ATOM_TIMEOUT)
+    {
+        ATOMLOG (_STR("Timeout\n"));
+        failures++;
+    }
+
+    /* Delete the object, which wakes the consumer */
+    if (atomDbufDelete (&dbuf1) != ATOM_OK)
+    {
+        ATOMLOG (_STR("Delete\n"));
+        failures++;
+    }
+    if (final_status != ATOM_ERR_DELETED)
+    {
+        ATOMLOG (_STR("Deleted %d\n"), final_status);
+        failures++;
+    }
+
+    /* Check thread stack usage (if enabled) */
+#ifdef ATOM_STACK_CHECKING
+    {
+        uint32_t used_bytes, free_bytes;
+        int thread;
+
+        /* Check all threads */
+        for (thread = 0; thread < NUM_TEST_THREADS; thread++)
+        {
+            /* Check thread stack usage */
+            if (atomThreadStackCheck (&tcb[thread], &used_bytes, &free_bytes) != ATOM_OK)
+            {
+                ATOMLOG (_STR("StackCheck\n"));
+                failures++;
+            }
+            else
+            {
+                /* Check the thread did not use up to the end of stack */
+                if (free_bytes == 0)
+                {
+                    ATOMLOG (_STR("StackOverflow %d\n"), thread);
+                    failures++;
+                }
+
+                /* Log the stack usage */
+#ifdef TESTS_LOG_STACK_USAGE
+                ATOMLOG (_STR("StackUse:%d\n"), (int)used_bytes);
+#endif
+            }
+        }
+    }
+#endif
+
+    /* Quit */
+    return failures;
+}
+
+
+/**
+ * \b testCallback
+ *
+ * Timer callback, standing in for a DMA completion interrupt.
+ *
+ * @param[in] cb_data Unused
+ *
+ * @return None
+ */
+static void testCallback (POINTER cb_data)
+{
+    void *fill;
+
+    /* Compiler warnings */
+    cb_data = cb_data;
+
+    /* Check a blocking get is refused in interrupt context */
+    if (num_swaps == 0)
+        isr_status = atomDbufGet (&dbuf1, 0, &fill);
+
+    /* Hand over the "filled" buffer */
+    (void)atomDbufSwap (&dbuf1, &fill);
+
+    /* Schedule the next block */
+    if (++num_swaps < NUM_BLOCKS)
+    {
+        timer_cb.cb_ticks = 2;
+        (void)atomTimerRegister (&timer_cb);
+    }
+}
+
+
+/**
+ * \b test_thread_func
+ *
+ * Entry point for the consumer thread.
+ *
+ * @param[in] param Unused (optional thread entry parameter)
+ *
+ * @return None
+ */
+static void test_thread_func (uint32_t param)
+{
+    uint8_t status;
+    void *full;
+
+    /* Compiler warnings */
+    param = param;
+
+    /* Receive blocks until the object is deleted */
+    while ((status = atomDbufGet (&dbuf1, 0, &full)) == ATOM_OK)
+    {
+        if (num_received < NUM_BLOCKS)
+            received[num_received] = full;
+        num_received++;
+    }
+    final_status = status;
+
+    /* Loop forever */
+    while (1)
+    {
+        atomTimerDelay (SYSTEM_TICKS_PER_SEC);
+    }
+}
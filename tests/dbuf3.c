@@ -0,0 +1,181 @@
+/*
+ * Copyright (c) 2022, Matt Liss
+ * Copyright (c) 2010, Kelvin Lawson. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. No personal names or organizations' names associated with the
+ *    Atomthreads project may be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE ATOMTHREADS PROJECT AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "atom.h"
+#include "atomdbuf.h"
+#include "atomtests.h"
+
+
+/* Ticks until the producer's swap, and the consumer's timeout */
+#define TIMEOUT_TICKS       5
+
+
+/* Test OS objects */
+static ATOM_DBUF dbuf1;
+static ATOM_TIMER timer_cb;
+static uint8_t buff_storage[2][8];
+static void *buffs[2] = { buff_storage[0], buff_storage[1] };
+static ATOM_TCB tcb;
+static uint8_t test_thread_stack[TEST_THREAD_STACK_SIZE];
+
+
+/* Test result tracking */
+static volatile int num_received;
+static volatile uint8_t get_status;
+static void * volatile received;
+
+
+/* Forward declarations */
+static void test_thread_func (uint32_t param);
+static void testCallback (POINTER cb_data);
+
+
+/**
+ * \b test_start
+ *
+ * Start double/triple buffer test.
+ *
+ * This tests a swap made by a timer callback which expires on the same
+ * tick as the timeout of the consumer blocking for the buffer. Handing the
+ * buffer over must remove the consumer's expired timeout before its
+ * callback is made, so the consumer receives the buffer exactly once and
+ * the other outstanding timers (here our own delay) are unaffected.
+ *
+ * @retval Number of failures
+ */
+uint32_t test_start (void)
+{
+    int failures;
+
+    /* Default to zero failures */
+    failures = 0;
+    num_received = 0;
+    get_status = 0xFF;
+
+    /* Create the buffer object */
+    if (atomDbufCreate (&dbuf1, buffs, 2) != ATOM_OK)
+    {
+        ATOMLOG (_STR("Create\n"));
+        failures++;
+        return failures;
+    }
+
+    /* Start on a tick boundary so both timers are registered on one tick */
+    atomTimerDelay (1);
+
+    /* Register the producer first so it is called back first */
+    timer_cb.cb_func = testCallback;
+    timer_cb.cb_data = NULL;
+    timer_cb.cb_ticks = TIMEOUT_TICKS;
+    if (atomTimerRegister (&timer_cb) != ATOM_OK)
+    {
+        ATOMLOG (_STR("Timer\n"));
+        failures++;
+    }
+
+    /* Create the consumer thread, which blocks with the same timeout */
+    else if (atomThreadCreate(&tcb, TEST_THREAD_PRIO - 1, test_thread_func, 0,
+          &test_thread_stack[0],
+          TEST_THREAD_STACK_SIZE, TRUE) != ATOM_OK)
+    {
+        ATOMLOG (_STR("Error creating test thread\n"));
+        failures++;
+    }
+    else
+    {
+        /* Our delay must still expire after the swap */
+        if (atomTimerDelay (TIMEOUT_TICKS * 2) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Delay\n"));
+            failures++;
+        }
+
+        /* The consumer must have been handed the buffer, once */
+        if ((num_received != 1) || (get_status != ATOM_OK) || (received != buffs[0]))
+        {
+            ATOMLOG (_STR("Received %d status %d\n"), num_received, (int)get_status);
+            failures++;
+        }
+    }
+
+    /* Quit */
+    return failures;
+}
+
+
+/**
+ * \b testCallback
+ *
+ * Timer callback, standing in for a DMA completion interrupt.
+ *
+ * @param[in] cb_data Unused
+ *
+ * @return None
+ */
+static void testCallback (POINTER cb_data)
+{
+    void *fill;
+
+    /* Compiler warnings */
+    cb_data = cb_data;
+
+    /* Hand over the "filled" buffer */
+    (void)atomDbufSwap (&dbuf1, &fill);
+}
+
+
+/**
+ * \b test_thread_func
+ *
+ * Entry point for the consumer thread.
+ *
+ * @param[in] param Unused (optional thread entry parameter)
+ *
+ * @return None
+ */
+static void test_thread_func (uint32_t param)
+{
+    void *full;
+
+    /* Compiler warnings */
+    param = param;
+
+    /* Block for the buffer with the timeout */
+    get_status = atomDbufGet (&dbuf1, TIMEOUT_TICKS, &full);
+    received = full;
+    num_received++;
+
+    /* Loop forever */
+    while (1)
+    {
+        atomTimerDelay (SYSTEM_TICKS_PER_SEC);
+    }
+}
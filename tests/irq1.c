@@ -0,0 +1,260 @@
+/*
+ * Copyright (c) 2022, Matt Liss
+ * Copyright (c) 2010, Kelvin Lawson. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. No personal names or organizations' names associated with the
+ *    Atomthreads project may be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE ATOMTHREADS PROJECT AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "atom.h"
+#include "atomirq.h"
+#include "atomtests.h"
+
+
+/* Test OS objects */
+static ATOM_IRQ_THREAD irq_thread1;
+static ATOM_TIMER timer1;
+static uint8_t test_thread_stack[TEST_THREAD_STACK_SIZE];
+
+
+/* Test global data */
+static volatile int masked;
+static volatile int mask_calls, unmask_calls;
+static volatile int handler_calls;
+static volatile int handler_errors;
+static volatile uint8_t wake_status;
+
+
+/* Forward declarations */
+static void test_mask (uint32_t irq);
+static void test_unmask (uint32_t irq);
+static void test_handler (POINTER data);
+static void test_timer_cb (POINTER cb_data);
+
+
+/**
+ * \b test_start
+ *
+ * Start threaded interrupt handler test.
+ *
+ * A timer callback stands in for the low-level interrupt handler and wakes
+ * a threaded handler. The handler must run in thread context with the
+ * source masked, and be able to block. The source must be unmasked once
+ * the handler returns. Deleting the handler must mask the source and
+ * terminate the handler thread.
+ *
+ * @retval Number of failures
+ */
+uint32_t test_start (void)
+{
+    int failures;
+    int i;
+
+    /* Default to zero failures */
+    failures = 0;
+
+    /* Initialise global data */
+    masked = FALSE;
+    mask_calls = unmask_calls = 0;
+    handler_calls = handler_errors = 0;
+    wake_status = 0xFF;
+
+    /* Check parameter checks */
+    if (atomIrqThreadCreate (&irq_thread1, 5, NULL, NULL, test_mask, test_unmask,
+            TEST_THREAD_PRIO - 1, &test_thread_stack[0], TEST_THREAD_STACK_SIZE) != ATOM_ERR_PARAM)
+    {
+        ATOMLOG (_STR("Create param check\n"));
+        failures++;
+    }
+    if (atomIrqThreadWake (NULL) != ATOM_ERR_PARAM)
+    {
+        ATOMLOG (_STR("Wake param check\n"));
+        failures++;
+    }
+
+    /* Create a higher priority threaded handler */
+    if (atomIrqThreadCreate (&irq_thread1, 5, test_handler, (POINTER)&handler_calls,
+            test_mask, test_unmask, TEST_THREAD_PRIO - 1,
+            &test_thread_stack[0], TEST_THREAD_STACK_SIZE) != ATOM_OK)
+    {
+        ATOMLOG (_STR("Create\n"));
+        failures++;
+    }
+    else
+    {
+        /* Raise the "interrupt" twice, one after the other */
+        for (i = 1; i <= 2; i++)
+        {
+            timer1.cb_func = test_timer_cb;
+            timer1.cb_data = NULL;
+            timer1.cb_ticks = 1;
+            if (atomTimerRegister (&timer1) != ATOM_OK)
+            {
+                ATOMLOG (_STR("Timer register\n"));
+                failures++;
+                break;
+            }
+
+            /* Wait for the interrupt and the blocking handler */
+            atomTimerDelay (5);
+
+            if ((wake_status != ATOM_OK) || (handler_calls != i)
+                || (irq_thread1.count != (uint32_t)i))
+            {
+                ATOMLOG (_STR("Handler %d %d\n"), wake_status, handler_calls);
+                failures++;
+            }
+            if ((masked != FALSE) || (mask_calls != i) || (unmask_calls != i))
+            {
+                ATOMLOG (_STR("Mask %d %d %d\n"), masked, mask_calls, unmask_calls);
+                failures++;
+            }
+        }
+
+        /* Check the handler always ran masked and in thread context */
+        if (handler_errors)
+        {
+            ATOMLOG (_STR("Handler errors %d\n"), handler_errors);
+            failures++;
+        }
+
+        /* Delete the handler */
+        if (atomIrqThreadDelete (&irq_thread1) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Delete\n"));
+            failures++;
+        }
+        else if ((masked != TRUE) || (irq_thread1.tcb.terminated != TRUE))
+        {
+            ATOMLOG (_STR("Delete state\n"));
+            failures++;
+        }
+    }
+
+    /* Check thread stack usage (if enabled) */
+#ifdef ATOM_STACK_CHECKING
+    {
+        uint32_t used_bytes, free_bytes;
+
+        /* Check thread stack usage */
+        if (atomThreadStackCheck (&irq_thread1.tcb, &used_bytes, &free_bytes) != ATOM_OK)
+        {
+            ATOMLOG (_STR("StackCheck\n"));
+            failures++;
+        }
+        else
+        {
+            /* Check the thread did not use up to the end of stack */
+            if (free_bytes == 0)
+            {
+                ATOMLOG (_STR("StackOverflow\n"));
+                failures++;
+            }
+
+            /* Log the stack usage */
+#ifdef TESTS_LOG_STACK_USAGE
+            ATOMLOG (_STR("StackUse:%d\n"), (int)used_bytes);
+#endif
+        }
+    }
+#endif
+
+    /* Quit */
+    return failures;
+
+}
+
+
+/**
+ * \b test_mask
+ *
+ * Stand-in for a port routine masking the interrupt source.
+ *
+ * @param[in] irq Interrupt source number
+ *
+ * @return None
+ */
+static void test_mask (uint32_t irq)
+{
+    if (irq != 5)
+        handler_errors++;
+    masked = TRUE;
+    mask_calls++;
+}
+
+
+/**
+ * \b test_unmask
+ *
+ * Stand-in for a port routine unmasking the interrupt source.
+ *
+ * @param[in] irq Interrupt source number
+ *
+ * @return None
+ */
+static void test_unmask (uint32_t irq)
+{
+    if (irq != 5)
+        handler_errors++;
+    masked = FALSE;
+    unmask_calls++;
+}
+
+
+/**
+ * \b test_handler
+ *
+ * Threaded interrupt handler. Checks it runs in thread context with the
+ * source masked, and blocks briefly before counting its call.
+ *
+ * @param[in] data Pointer to the handler call count
+ *
+ * @return None
+ */
+static void test_handler (POINTER data)
+{
+    if ((atomCurrentContext() == NULL) || (masked != TRUE))
+        handler_errors++;
+
+    /* Threaded handlers may block */
+    atomTimerDelay (1);
+
+    (*(volatile int *)data)++;
+}
+
+
+/**
+ * \b test_timer_cb
+ *
+ * Timer callback standing in for the low-level interrupt handler.
+ *
+ * @param[in] cb_data Unused
+ *
+ * @return None
+ */
+static void test_timer_cb (POINTER cb_data)
+{
+    wake_status = atomIrqThreadWake (&irq_thread1);
+}
@@ -0,0 +1,291 @@
+/*
+ * Copyright (c) 2022, Matt Liss
+ * Copyright (c) 2010, Kelvin Lawson. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. No personal names or organizations' names associated with the
+ *    Atomthreads project may be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE ATOMTHREADS PROJECT AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "atom.h"
+#include "atomtests.h"
+
+
+/* Number of test threads */
+#define NUM_TEST_THREADS      2
+
+/* Budget and period used for both threads */
+#define TEST_BUDGET           5
+#define TEST_PERIOD           20
+
+
+/* Test OS objects */
+static ATOM_TCB tcb[NUM_TEST_THREADS];
+static ATOM_BUDGET budget[NUM_TEST_THREADS];
+static uint8_t test_thread_stack[NUM_TEST_THREADS][TEST_THREAD_STACK_SIZE];
+
+
+/* Test global data */
+static volatile uint32_t spin_count[NUM_TEST_THREADS];
+
+
+/* Forward declarations */
+static void test_thread_func (uint32_t param);
+static int start_spinner (int thread, uint8_t exhausted_priority, uint32_t *elapsed);
+
+
+/**
+ * \b test_start
+ *
+ * Start kernel test.
+ *
+ * This tests execution budgets set with atomThreadSetBudget().
+ *
+ * Two threads spin forever at a higher priority than this thread, but
+ * have a budget of TEST_BUDGET ticks in every TEST_PERIOD ticks. Thread 0
+ * is demoted below this thread when its budget is exhausted, and must
+ * regain its priority for another TEST_BUDGET ticks once the budget is
+ * replenished. Thread 1 is suspended when its budget is exhausted, so must
+ * not run at all (even with this thread sleeping) until replenished.
+ *
+ * @retval Number of failures
+ */
+uint32_t test_start (void)
+{
+    int failures;
+    uint32_t elapsed, start, count;
+
+    /* Default to zero failures */
+    failures = 0;
+
+    /* Check parameter checks */
+    if ((atomThreadSetBudget (NULL, &budget[0], TEST_BUDGET, TEST_PERIOD, ATOM_BUDGET_SUSPEND) != ATOM_ERR_PARAM)
+        || (atomThreadSetBudget (atomCurrentContext(), NULL, TEST_BUDGET, TEST_PERIOD, ATOM_BUDGET_SUSPEND) != ATOM_ERR_PARAM)
+        || (atomThreadSetBudget (atomCurrentContext(), &budget[0], 0, TEST_PERIOD, ATOM_BUDGET_SUSPEND) != ATOM_ERR_PARAM)
+        || (atomThreadSetBudget (atomCurrentContext(), &budget[0], TEST_PERIOD + 1, TEST_PERIOD, ATOM_BUDGET_SUSPEND) != ATOM_ERR_PARAM)
+        || (atomThreadClearBudget (NULL) != ATOM_ERR_PARAM)
+        || (atomThreadClearBudget (atomCurrentContext()) != ATOM_ERR_NOT_FOUND))
+    {
+        ATOMLOG (_STR("Param check\n"));
+        failures++;
+    }
+
+    /* Start thread 0, which is demoted when its budget runs out */
+    if (start_spinner (0, TEST_THREAD_PRIO + 2, &elapsed) != ATOM_OK)
+    {
+        failures++;
+    }
+    else
+    {
+        /* It should have run for its budget before we were scheduled back in */
+        if ((elapsed < TEST_BUDGET - 1) || (elapsed > TEST_BUDGET + 1))
+        {
+            ATOMLOG (_STR("Demote after %d\n"), (int)elapsed);
+            failures++;
+        }
+        if (tcb[0].priority != TEST_THREAD_PRIO + 2)
+        {
+            ATOMLOG (_STR("Not demoted\n"));
+            failures++;
+        }
+
+        /**
+         * Sleep until just after the replenishment. Thread 0 should then
+         * be back above us for another budget's worth of ticks.
+         */
+        start = atomTimeGet();
+        atomTimerDelay (TEST_PERIOD - elapsed + 1);
+        elapsed = atomTimeGet() - start;
+        if (elapsed < TEST_PERIOD - 1)
+        {
+            ATOMLOG (_STR("Not restored %d\n"), (int)elapsed);
+            failures++;
+        }
+        if (tcb[0].priority != TEST_THREAD_PRIO + 2)
+        {
+            ATOMLOG (_STR("Not demoted again\n"));
+            failures++;
+        }
+
+        /* Stop thread 0, which also stops its budget */
+        if (atomThreadTerminate (&tcb[0]) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Terminate 0\n"));
+            failures++;
+        }
+        else if (atomThreadClearBudget (&tcb[0]) != ATOM_ERR_NOT_FOUND)
+        {
+            ATOMLOG (_STR("Budget not cleared\n"));
+            failures++;
+        }
+    }
+
+    /* Start thread 1, which is suspended when its budget runs out */
+    if (start_spinner (1, ATOM_BUDGET_SUSPEND, &elapsed) != ATOM_OK)
+    {
+        failures++;
+    }
+    else
+    {
+        /* It should have run for its budget before we were scheduled back in */
+        if ((elapsed < TEST_BUDGET - 1) || (elapsed > TEST_BUDGET + 1))
+        {
+            ATOMLOG (_STR("Suspend after %d\n"), (int)elapsed);
+            failures++;
+        }
+
+        /* It must not run while we sleep until shortly before the replenishment */
+        count = spin_count[1];
+        atomTimerDelay (TEST_PERIOD - elapsed - 3);
+        if (spin_count[1] != count)
+        {
+            ATOMLOG (_STR("Ran while suspended\n"));
+            failures++;
+        }
+
+        /* It must run again after the replenishment */
+        atomTimerDelay (5);
+        if (spin_count[1] == count)
+        {
+            ATOMLOG (_STR("Not resumed\n"));
+            failures++;
+        }
+
+        /* Drop it below us, then clear the budget and stop it */
+        (void)atomThreadSetPriority (&tcb[1], TEST_THREAD_PRIO + 1);
+        if (atomThreadClearBudget (&tcb[1]) != ATOM_OK)
+        {
+            ATOMLOG (_STR("ClearBudget\n"));
+            failures++;
+        }
+        if (atomThreadTerminate (&tcb[1]) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Terminate 1\n"));
+            failures++;
+        }
+    }
+
+    /* Check thread stack usage (if enabled) */
+#ifdef ATOM_STACK_CHECKING
+    {
+        uint32_t used_bytes, free_bytes;
+        int thread;
+
+        /* Check all threads */
+        for (thread = 0; thread < NUM_TEST_THREADS; thread++)
+        {
+            /* Check thread stack usage */
+            if (atomThreadStackCheck (&tcb[thread], &used_bytes, &free_bytes) != ATOM_OK)
+            {
+                ATOMLOG (_STR("StackCheck\n"));
+                failures++;
+            }
+            else
+            {
+                /* Check the thread did not use up to the end of stack */
+                if (free_bytes == 0)
+                {
+                    ATOMLOG (_STR("StackOverflow %d\n"), thread);
+                    failures++;
+                }
+
+                /* Log the stack usage */
+#ifdef TESTS_LOG_STACK_USAGE
+                ATOMLOG (_STR("StackUse:%d\n"), (int)used_bytes);
+#endif
+            }
+        }
+    }
+#endif
+
+    /* Quit */
+    return failures;
+
+}
+
+
+/**
+ * \b start_spinner
+ *
+ * Creates a spinning test thread below this thread's priority, attaches
+ * its budget, then raises it above this thread so that it runs until its
+ * budget is exhausted.
+ *
+ * @param[in] thread Thread ID (0 to 1)
+ * @param[in] exhausted_priority Budget exhaustion priority or action
+ * @param[out] elapsed Ticks until this thread was scheduled back in
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERROR Failed to set up the thread
+ */
+static int start_spinner (int thread, uint8_t exhausted_priority, uint32_t *elapsed)
+{
+    uint32_t start;
+
+    if (atomThreadCreate (&tcb[thread], TEST_THREAD_PRIO + 1, test_thread_func, (uint32_t)thread,
+            &test_thread_stack[thread][0],
+            TEST_THREAD_STACK_SIZE, TRUE) != ATOM_OK)
+    {
+        ATOMLOG (_STR("Bad thread create\n"));
+        return ATOM_ERROR;
+    }
+
+    if (atomThreadSetBudget (&tcb[thread], &budget[thread], TEST_BUDGET, TEST_PERIOD, exhausted_priority) != ATOM_OK)
+    {
+        ATOMLOG (_STR("SetBudget %d\n"), thread);
+        return ATOM_ERROR;
+    }
+
+    /* Let it run, we get scheduled back in when its budget is used up */
+    start = atomTimeGet();
+    if (atomThreadSetPriority (&tcb[thread], TEST_THREAD_PRIO - 1) != ATOM_OK)
+    {
+        ATOMLOG (_STR("SetPriority %d\n"), thread);
+        return ATOM_ERROR;
+    }
+    *elapsed = atomTimeGet() - start;
+
+    return ATOM_OK;
+}
+
+
+/**
+ * \b test_thread_func
+ *
+ * Entry point for test threads.
+ *
+ * Spins forever, counting loops.
+ *
+ * @param[in] param Thread ID (0 to 1)
+ *
+ * @return None
+ */
+static void test_thread_func (uint32_t param)
+{
+    /* Spin forever */
+    while (1)
+    {
+        spin_count[param]++;
+    }
+}
@@ -0,0 +1,297 @@
+/*
+ * Copyright (c) 2022, Matt Liss
+ * Copyright (c) 2010, Kelvin Lawson. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. No personal names or organizations' names associated with the
+ *    Atomthreads project may be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE ATOMTHREADS PROJECT AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "atom.h"
+#include "atomsem.h"
+#include "atomtests.h"
+
+
+/* The test threads and data are only needed if time partitioning is enabled */
+#if defined(ATOM_NUM_PARTITIONS) && (ATOM_NUM_PARTITIONS >= 3)
+
+/* Number of test threads */
+#define NUM_TEST_THREADS      3
+
+/* Length of each partition window */
+#define WINDOW_TICKS          10
+
+
+/* Test OS objects */
+static ATOM_SEM sem1;
+static ATOM_TCB tcb[NUM_TEST_THREADS];
+static uint8_t test_thread_stack[NUM_TEST_THREADS][TEST_THREAD_STACK_SIZE];
+
+
+/* Major frame: partition 1 then partition 2 */
+static const ATOM_PARTITION_WINDOW major_frame[] =
+{
+    { 1, WINDOW_TICKS },
+    { 2, WINDOW_TICKS }
+};
+
+
+/* Test global data */
+static volatile uint32_t spin_count[2];
+static volatile int sem_woken;
+
+
+/* Forward declarations */
+static void test_spin_thread_func (uint32_t param);
+static void test_sem_thread_func (uint32_t param);
+
+#endif
+
+
+/**
+ * \b test_start
+ *
+ * Start kernel test.
+ *
+ * This tests time partitioning (only if ATOM_NUM_PARTITIONS is at least
+ * 3, otherwise the test trivially passes).
+ *
+ * Two threads in partitions 1 and 2 spin at a lower priority than this
+ * thread, which is in the system partition. With a major frame giving
+ * each partition alternate windows, this thread samples the spin counts
+ * and checks that only the active partition's thread runs in each window.
+ *
+ * A third thread in partition 2 with higher priority than this thread is
+ * woken during partition 1's window. It must not run until partition 2's
+ * window starts.
+ *
+ * @retval Number of failures
+ */
+uint32_t test_start (void)
+{
+    int failures;
+
+#if defined(ATOM_NUM_PARTITIONS) && (ATOM_NUM_PARTITIONS >= 3)
+    uint32_t count[2];
+    int i;
+
+    /* Default to zero failures */
+    failures = 0;
+    sem_woken = FALSE;
+
+    /* Check parameter checks */
+    if ((atomThreadSetPartition (NULL, 1) != ATOM_ERR_PARAM)
+        || (atomThreadSetPartition (atomCurrentContext(), ATOM_NUM_PARTITIONS) != ATOM_ERR_PARAM)
+        || (atomPartitionScheduleSet (major_frame, 0) != ATOM_ERR_PARAM))
+    {
+        ATOMLOG (_STR("Param check\n"));
+        failures++;
+    }
+
+    /* Create the spinning threads and move them into partitions 1 and 2 */
+    for (i = 0; i < 2; i++)
+    {
+        spin_count[i] = 0;
+        if (atomThreadCreate (&tcb[i], TEST_THREAD_PRIO + 1, test_spin_thread_func, (uint32_t)i,
+                &test_thread_stack[i][0],
+                TEST_THREAD_STACK_SIZE, TRUE) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Bad thread create\n"));
+            failures++;
+        }
+        else if (atomThreadSetPartition (&tcb[i], (uint8_t)(i + 1)) != ATOM_OK)
+        {
+            ATOMLOG (_STR("SetPartition %d\n"), i);
+            failures++;
+        }
+    }
+
+    /* Create the semaphore thread, it blocks immediately */
+    if (atomSemCreate (&sem1, 0) != ATOM_OK)
+    {
+        ATOMLOG (_STR("Error creating test semaphore\n"));
+        failures++;
+    }
+    else if (atomThreadCreate (&tcb[2], TEST_THREAD_PRIO - 1, test_sem_thread_func, 2,
+            &test_thread_stack[2][0],
+            TEST_THREAD_STACK_SIZE, TRUE) != ATOM_OK)
+    {
+        ATOMLOG (_STR("Bad thread create\n"));
+        failures++;
+    }
+    else if (atomThreadSetPartition (&tcb[2], 2) != ATOM_OK)
+    {
+        ATOMLOG (_STR("SetPartition 2\n"));
+        failures++;
+    }
+
+    /* Abort if the threads could not be set up */
+    if (failures)
+        return failures;
+
+    /* Start the major frame with partition 1's window */
+    if (atomPartitionScheduleSet (major_frame, 2) != ATOM_OK)
+    {
+        ATOMLOG (_STR("ScheduleSet\n"));
+        failures++;
+    }
+
+    /* Partition 1's window: only thread 0 should run */
+    atomTimerDelay (2);
+    count[0] = spin_count[0];
+    count[1] = spin_count[1];
+
+    /* Wake the partition 2 thread, it must not preempt us */
+    (void)atomSemPut (&sem1);
+    if (sem_woken == TRUE)
+    {
+        ATOMLOG (_STR("Woken outside window\n"));
+        failures++;
+    }
+
+    atomTimerDelay (WINDOW_TICKS - 4);
+    if ((spin_count[0] == count[0]) || (spin_count[1] != count[1]) || (sem_woken == TRUE))
+    {
+        ATOMLOG (_STR("Window 1\n"));
+        failures++;
+    }
+
+    /* Partition 2's window: now only thread 1 should run */
+    atomTimerDelay (4);
+    if (sem_woken == FALSE)
+    {
+        ATOMLOG (_STR("Not woken in window\n"));
+        failures++;
+    }
+    count[0] = spin_count[0];
+    count[1] = spin_count[1];
+    atomTimerDelay (WINDOW_TICKS - 4);
+    if ((spin_count[0] != count[0]) || (spin_count[1] == count[1]))
+    {
+        ATOMLOG (_STR("Window 2\n"));
+        failures++;
+    }
+
+    /* Stop the threads and the major frame */
+    for (i = 0; i < NUM_TEST_THREADS; i++)
+    {
+        (void)atomThreadTerminate (&tcb[i]);
+    }
+    if (atomPartitionScheduleSet (NULL, 0) != ATOM_OK)
+    {
+        ATOMLOG (_STR("ScheduleSet stop\n"));
+        failures++;
+    }
+
+    /* Check thread stack usage (if enabled) */
+#ifdef ATOM_STACK_CHECKING
+    {
+        uint32_t used_bytes, free_bytes;
+        int thread;
+
+        /* Check all threads */
+        for (thread = 0; thread < NUM_TEST_THREADS; thread++)
+        {
+            /* Check thread stack usage */
+            if (atomThreadStackCheck (&tcb[thread], &used_bytes, &free_bytes) != ATOM_OK)
+            {
+                ATOMLOG (_STR("StackCheck\n"));
+                failures++;
+            }
+            else
+            {
+                /* Check the thread did not use up to the end of stack */
+                if (free_bytes == 0)
+                {
+                    ATOMLOG (_STR("StackOverflow %d\n"), thread);
+                    failures++;
+                }
+
+                /* Log the stack usage */
+#ifdef TESTS_LOG_STACK_USAGE
+                ATOMLOG (_STR("StackUse:%d\n"), (int)used_bytes);
+#endif
+            }
+        }
+    }
+#endif
+
+#else
+    /* Time partitioning not enabled, nothing to test */
+    failures = 0;
+#endif
+
+    /* Quit */
+    return failures;
+
+}
+
+
+#if defined(ATOM_NUM_PARTITIONS) && (ATOM_NUM_PARTITIONS >= 3)
+/**
+ * \b test_spin_thread_func
+ *
+ * Entry point for the spinning test threads.
+ *
+ * @param[in] param Thread ID (0 to 1)
+ *
+ * @return None
+ */
+static void test_spin_thread_func (uint32_t param)
+{
+    /* Spin forever */
+    while (1)
+    {
+        spin_count[param]++;
+    }
+}
+
+
+/**
+ * \b test_sem_thread_func
+ *
+ * Entry point for the semaphore test thread.
+ *
+ * @param[in] param Unused (optional thread entry parameter)
+ *
+ * @return None
+ */
+static void test_sem_thread_func (uint32_t param)
+{
+    /* Compiler warnings */
+    param = param;
+
+    /* Flag when woken */
+    if (atomSemGet (&sem1, 0) == ATOM_OK)
+    {
+        sem_woken = TRUE;
+    }
+
+    /* Loop forever */
+    while (1)
+    {
+        atomTimerDelay (SYSTEM_TICKS_PER_SEC);
+    }
+}
+#endif
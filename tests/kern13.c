@@ -0,0 +1,278 @@
+/*
+ * Copyright (c) 2022, Matt Liss
+ * Copyright (c) 2010, Kelvin Lawson. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. No personal names or organizations' names associated with the
+ *    Atomthreads project may be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE ATOMTHREADS PROJECT AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "atom.h"
+#include "atomsem.h"
+#include "atomtests.h"
+
+
+/* The test threads and data are only needed if EDF scheduling is enabled */
+#ifdef ATOM_EDF
+
+/* Number of test threads */
+#define NUM_TEST_THREADS      2
+
+/* Number of times each thread is released */
+#define NUM_RELEASES          2
+
+/* Relative deadlines of the test threads */
+#define THREAD0_DEADLINE      300
+#define THREAD1_DEADLINE      100
+
+
+/* Test OS objects */
+static ATOM_SEM sem[NUM_TEST_THREADS];
+static ATOM_TCB tcb[NUM_TEST_THREADS];
+static uint8_t test_thread_stack[NUM_TEST_THREADS][TEST_THREAD_STACK_SIZE];
+
+
+/* Test global data */
+static volatile int run_order[NUM_TEST_THREADS * NUM_RELEASES];
+static volatile int run_count;
+
+
+/* Forward declarations */
+static void test_thread_func (uint32_t param);
+
+#endif /* ATOM_EDF */
+
+/**
+ * \b test_start
+ *
+ * Start kernel test.
+ *
+ * This tests relative deadlines for earliest-deadline-first scheduling
+ * (only if ATOM_EDF is enabled, otherwise the test trivially passes).
+ *
+ * Two threads in the EDF band have relative deadlines which order them
+ * against their priorities. Each time they are woken while this thread
+ * holds the earliest deadline, their absolute deadlines must be derived
+ * from the wake time, so that they run in relative deadline order once
+ * this thread gives up its deadline. An absolute deadline set on a woken
+ * thread before it runs must not be overridden by the derived one.
+ *
+ * @retval Number of failures
+ */
+uint32_t test_start (void)
+{
+    int failures;
+
+#ifdef ATOM_EDF
+    ATOM_TCB *curr_tcb_ptr;
+    uint32_t now;
+    int i, release;
+    static const int expected[NUM_TEST_THREADS * NUM_RELEASES] = { 0, 1, 1, 0 };
+
+    /* Default to zero failures */
+    failures = 0;
+
+    /* Initialise global data */
+    run_count = 0;
+    for (i = 0; i < NUM_TEST_THREADS * NUM_RELEASES; i++)
+        run_order[i] = -1;
+
+    /* Get this thread's TCB and move it into the EDF band */
+    curr_tcb_ptr = atomCurrentContext();
+    now = atomTimeGet();
+    if ((atomThreadSetPriority (curr_tcb_ptr, ATOM_EDF_PRIO_LOW) != ATOM_OK)
+        || (atomThreadSetDeadline (curr_tcb_ptr, now + 1000) != ATOM_OK))
+    {
+        ATOMLOG (_STR("Enter band\n"));
+        failures++;
+    }
+
+    /* Check parameter checks */
+    if (atomThreadSetRelativeDeadline (NULL, 1) != ATOM_ERR_PARAM)
+    {
+        ATOMLOG (_STR("Param check\n"));
+        failures++;
+    }
+
+    /**
+     * Create the test threads, thread 0 at the top of the band and thread
+     * 1 at the bottom. New threads are due now, so each one preempts us
+     * and immediately blocks on its own semaphore.
+     */
+    for (i = 0; i < NUM_TEST_THREADS; i++)
+    {
+        if (atomSemCreate (&sem[i], 0) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Error creating test semaphore %d\n"), i);
+            failures++;
+        }
+        else if (atomThreadCreate (&tcb[i], (i == 0) ? ATOM_EDF_PRIO_HIGH : ATOM_EDF_PRIO_LOW,
+                test_thread_func, (uint32_t)i,
+                &test_thread_stack[i][0],
+                TEST_THREAD_STACK_SIZE, TRUE) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Bad thread create\n"));
+            failures++;
+        }
+    }
+
+    /* Abort if the threads could not be set up */
+    if (failures)
+        return failures;
+
+    /* Set the relative deadlines, thread 1 is due before thread 0 */
+    if ((atomThreadSetRelativeDeadline (&tcb[0], THREAD0_DEADLINE) != ATOM_OK)
+        || (atomThreadSetRelativeDeadline (&tcb[1], THREAD1_DEADLINE) != ATOM_OK))
+    {
+        ATOMLOG (_STR("SetRelativeDeadline\n"));
+        failures++;
+    }
+
+    for (release = 0; release < NUM_RELEASES; release++)
+    {
+        /* Take the earliest deadline and wake both threads */
+        now = atomTimeGet();
+        (void)atomThreadSetDeadline (curr_tcb_ptr, now);
+        for (i = 0; i < NUM_TEST_THREADS; i++)
+        {
+            if (atomSemPut (&sem[i]) != ATOM_OK)
+            {
+                ATOMLOG (_STR("SemPut %d\n"), i);
+                failures++;
+            }
+        }
+
+        /* Check the deadlines were derived from the wake time */
+        if (((int32_t)(tcb[0].deadline - (now + THREAD0_DEADLINE)) < 0)
+            || ((int32_t)(tcb[1].deadline - (now + THREAD1_DEADLINE)) < 0)
+            || ((int32_t)(tcb[0].deadline - tcb[1].deadline) != (THREAD0_DEADLINE - THREAD1_DEADLINE)))
+        {
+            ATOMLOG (_STR("Derived deadlines %d %d\n"), (int)(tcb[0].deadline - now), (int)(tcb[1].deadline - now));
+            failures++;
+        }
+
+        /* On the first release, override thread 0's deadline for this job */
+        if (release == 0)
+        {
+            (void)atomThreadSetDeadline (&tcb[0], tcb[1].deadline - 1);
+        }
+
+        /* Give up our early deadline, both threads should now run */
+        (void)atomThreadSetDeadline (curr_tcb_ptr, now + 1000);
+        if (run_count != (release + 1) * NUM_TEST_THREADS)
+        {
+            ATOMLOG (_STR("Run count %d\n"), run_count);
+            failures++;
+        }
+    }
+
+    /* Check the threads ran in deadline order on each release */
+    for (i = 0; i < NUM_TEST_THREADS * NUM_RELEASES; i++)
+    {
+        if (run_order[i] != expected[i])
+        {
+            ATOMLOG (_STR("Run order %d: %d\n"), i, run_order[i]);
+            failures++;
+        }
+    }
+
+    /* Restore our own priority */
+    if (atomThreadSetPriority (curr_tcb_ptr, TEST_THREAD_PRIO) != ATOM_OK)
+    {
+        ATOMLOG (_STR("SetPriority restore\n"));
+        failures++;
+    }
+
+    /* Check thread stack usage (if enabled) */
+#ifdef ATOM_STACK_CHECKING
+    {
+        uint32_t used_bytes, free_bytes;
+        int thread;
+
+        /* Check all threads */
+        for (thread = 0; thread < NUM_TEST_THREADS; thread++)
+        {
+            /* Check thread stack usage */
+            if (atomThreadStackCheck (&tcb[thread], &used_bytes, &free_bytes) != ATOM_OK)
+            {
+                ATOMLOG (_STR("StackCheck\n"));
+                failures++;
+            }
+            else
+            {
+                /* Check the thread did not use up to the end of stack */
+                if (free_bytes == 0)
+                {
+                    ATOMLOG (_STR("StackOverflow %d\n"), thread);
+                    failures++;
+                }
+
+                /* Log the stack usage */
+#ifdef TESTS_LOG_STACK_USAGE
+                ATOMLOG (_STR("StackUse:%d\n"), (int)used_bytes);
+#endif
+            }
+        }
+    }
+#endif
+
+#else
+    /* EDF scheduling not enabled, nothing to test */
+    failures = 0;
+#endif
+
+    /* Quit */
+    return failures;
+
+}
+
+
+#ifdef ATOM_EDF
+/**
+ * \b test_thread_func
+ *
+ * Entry point for test threads.
+ *
+ * Blocks on its semaphore and records the order in which it was run, once
+ * for each release.
+ *
+ * @param[in] param Thread ID (0 or 1)
+ *
+ * @return None
+ */
+static void test_thread_func (uint32_t param)
+{
+    /* Block on the semaphore for each release and record the run order */
+    while (atomSemGet (&sem[param], 0) == ATOM_OK)
+    {
+        run_order[run_count++] = (int)param;
+    }
+
+    /* Loop forever */
+    while (1)
+    {
+        atomTimerDelay (SYSTEM_TICKS_PER_SEC);
+    }
+}
+#endif /* ATOM_EDF */
@@ -0,0 +1,293 @@
+/*
+ * Copyright (c) 2022, Matt Liss
+ * Copyright (c) 2010, Kelvin Lawson. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. No personal names or organizations' names associated with the
+ *    Atomthreads project may be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE ATOMTHREADS PROJECT AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "atom.h"
+#include "atomsem.h"
+#include "atomtests.h"
+
+
+/* Number of test threads */
+#define NUM_TEST_THREADS      4
+
+
+/* Test OS objects */
+static ATOM_SEM sem1;
+static ATOM_TCB tcb[NUM_TEST_THREADS];
+static uint8_t test_thread_stack[NUM_TEST_THREADS][TEST_THREAD_STACK_SIZE];
+
+
+/* Test global data */
+static volatile int wake_order[2];
+static volatile int wake_count;
+static volatile int ran_flag[NUM_TEST_THREADS];
+
+
+/* Forward declarations */
+static void test_sem_thread_func (uint32_t param);
+static void test_flag_thread_func (uint32_t param);
+
+
+/**
+ * \b test_start
+ *
+ * Start kernel test.
+ *
+ * This tests atomThreadSetPriority() on threads in each of the places a
+ * thread can be: blocking on an object's suspend queue, waiting on the
+ * ready queue, and the currently running thread.
+ *
+ * Two threads of the same priority block on a semaphore. The second one to
+ * block is raised in priority and must be woken first. A lower priority
+ * thread on the ready queue is then raised above this thread and must run
+ * before atomThreadSetPriority() returns. Finally this thread lowers its
+ * own priority below a ready thread, which must also run immediately.
+ *
+ * @retval Number of failures
+ */
+uint32_t test_start (void)
+{
+    int failures;
+    ATOM_TCB *curr_tcb_ptr;
+
+    /* Default to zero failures */
+    failures = 0;
+
+    /* Initialise global data */
+    wake_order[0] = wake_order[1] = -1;
+    wake_count = 0;
+    ran_flag[0] = ran_flag[1] = ran_flag[2] = ran_flag[3] = FALSE;
+
+    /* Get this thread's TCB */
+    curr_tcb_ptr = atomCurrentContext();
+
+    /* Check parameter checks */
+    if (atomThreadSetPriority (NULL, TEST_THREAD_PRIO) != ATOM_ERR_PARAM)
+    {
+        ATOMLOG (_STR("Param check\n"));
+        failures++;
+    }
+
+    /* Create the semaphore used by the blocking threads */
+    if (atomSemCreate (&sem1, 0) != ATOM_OK)
+    {
+        ATOMLOG (_STR("Error creating test semaphore 1\n"));
+        failures++;
+    }
+
+    /*
+     * Create two higher priority threads which immediately block on the
+     * semaphore, thread 0 first and then thread 1.
+     */
+    else if (atomThreadCreate (&tcb[0], TEST_THREAD_PRIO - 1, test_sem_thread_func, 0,
+            &test_thread_stack[0][0],
+            TEST_THREAD_STACK_SIZE, TRUE) != ATOM_OK)
+    {
+        ATOMLOG (_STR("Bad thread create\n"));
+        failures++;
+    }
+    else if (atomThreadCreate (&tcb[1], TEST_THREAD_PRIO - 1, test_sem_thread_func, 1,
+            &test_thread_stack[1][0],
+            TEST_THREAD_STACK_SIZE, TRUE) != ATOM_OK)
+    {
+        ATOMLOG (_STR("Bad thread create\n"));
+        failures++;
+    }
+    else
+    {
+        /* Raise thread 1, it should now be at the head of the suspend queue */
+        if (atomThreadSetPriority (&tcb[1], TEST_THREAD_PRIO - 2) != ATOM_OK)
+        {
+            ATOMLOG (_STR("SetPriority blocked\n"));
+            failures++;
+        }
+
+        /* Wake both threads, they preempt us on each put */
+        if ((atomSemPut (&sem1) != ATOM_OK) || (atomSemPut (&sem1) != ATOM_OK))
+        {
+            ATOMLOG (_STR("SemPut\n"));
+            failures++;
+        }
+
+        /* Check they were woken in their new priority order */
+        if ((wake_count != 2) || (wake_order[0] != 1) || (wake_order[1] != 0))
+        {
+            ATOMLOG (_STR("Wake order %d %d %d\n"), wake_count, wake_order[0], wake_order[1]);
+            failures++;
+        }
+    }
+
+    /* Create a lower priority thread which sits on the ready queue */
+    if (atomThreadCreate (&tcb[2], TEST_THREAD_PRIO + 1, test_flag_thread_func, 2,
+            &test_thread_stack[2][0],
+            TEST_THREAD_STACK_SIZE, TRUE) != ATOM_OK)
+    {
+        ATOMLOG (_STR("Bad thread create\n"));
+        failures++;
+    }
+    else if (ran_flag[2] == TRUE)
+    {
+        ATOMLOG (_STR("Thread 2 ran early\n"));
+        failures++;
+    }
+
+    /* Raise it above us, it should run before the call returns */
+    else if (atomThreadSetPriority (&tcb[2], TEST_THREAD_PRIO - 1) != ATOM_OK)
+    {
+        ATOMLOG (_STR("SetPriority ready\n"));
+        failures++;
+    }
+    else if (ran_flag[2] == FALSE)
+    {
+        ATOMLOG (_STR("Thread 2 not scheduled\n"));
+        failures++;
+    }
+
+    /* Create another lower priority thread which sits on the ready queue */
+    if (atomThreadCreate (&tcb[3], TEST_THREAD_PRIO + 1, test_flag_thread_func, 3,
+            &test_thread_stack[3][0],
+            TEST_THREAD_STACK_SIZE, TRUE) != ATOM_OK)
+    {
+        ATOMLOG (_STR("Bad thread create\n"));
+        failures++;
+    }
+
+    /* Lower our own priority below it, it should run before the call returns */
+    else if (atomThreadSetPriority (curr_tcb_ptr, TEST_THREAD_PRIO + 2) != ATOM_OK)
+    {
+        ATOMLOG (_STR("SetPriority self\n"));
+        failures++;
+    }
+    else if (ran_flag[3] == FALSE)
+    {
+        ATOMLOG (_STR("Thread 3 not scheduled\n"));
+        failures++;
+    }
+
+    /* Restore our own priority */
+    if (atomThreadSetPriority (curr_tcb_ptr, TEST_THREAD_PRIO) != ATOM_OK)
+    {
+        ATOMLOG (_STR("SetPriority restore\n"));
+        failures++;
+    }
+    else if (curr_tcb_ptr->priority != TEST_THREAD_PRIO)
+    {
+        ATOMLOG (_STR("Priority not restored\n"));
+        failures++;
+    }
+
+    /* Check thread stack usage (if enabled) */
+#ifdef ATOM_STACK_CHECKING
+    {
+        uint32_t used_bytes, free_bytes;
+        int thread;
+
+        /* Check all threads */
+        for (thread = 0; thread < NUM_TEST_THREADS; thread++)
+        {
+            /* Check thread stack usage */
+            if (atomThreadStackCheck (&tcb[thread], &used_bytes, &free_bytes) != ATOM_OK)
+            {
+                ATOMLOG (_STR("StackCheck\n"));
+                failures++;
+            }
+            else
+            {
+                /* Check the thread did not use up to the end of stack */
+                if (free_bytes == 0)
+                {
+                    ATOMLOG (_STR("StackOverflow %d\n"), thread);
+                    failures++;
+                }
+
+                /* Log the stack usage */
+#ifdef TESTS_LOG_STACK_USAGE
+                ATOMLOG (_STR("StackUse:%d\n"), (int)used_bytes);
+#endif
+            }
+        }
+    }
+#endif
+
+    /* Quit */
+    return failures;
+
+}
+
+
+/**
+ * \b test_sem_thread_func
+ *
+ * Entry point for the semaphore test threads.
+ *
+ * Blocks on the semaphore and records the order in which it was woken.
+ *
+ * @param[in] param Thread ID (0 to 1)
+ *
+ * @return None
+ */
+static void test_sem_thread_func (uint32_t param)
+{
+    /* Block on the semaphore */
+    if (atomSemGet (&sem1, 0) == ATOM_OK)
+    {
+        /* Record the wake order */
+        wake_order[wake_count++] = (int)param;
+    }
+
+    /* Loop forever */
+    while (1)
+    {
+        atomTimerDelay (SYSTEM_TICKS_PER_SEC);
+    }
+}
+
+
+/**
+ * \b test_flag_thread_func
+ *
+ * Entry point for the ready queue test threads.
+ *
+ * Flags that the thread has been scheduled in.
+ *
+ * @param[in] param Thread ID (2 to 3)
+ *
+ * @return None
+ */
+static void test_flag_thread_func (uint32_t param)
+{
+    /* Flag that this thread ran */
+    ran_flag[param] = TRUE;
+
+    /* Loop forever */
+    while (1)
+    {
+        atomTimerDelay (SYSTEM_TICKS_PER_SEC);
+    }
+}
@@ -0,0 +1,436 @@
+/*
+ * Copyright (c) 2022, Matt Liss
+ * Copyright (c) 2010, Kelvin Lawson. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. No personal names or organizations' names associated with the
+ *    Atomthreads project may be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE ATOMTHREADS PROJECT AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "atom.h"
+#include "atomsem.h"
+#include "atomevent.h"
+#include "atomtests.h"
+
+
+/* Number of test threads */
+#define NUM_TEST_THREADS      6
+
+
+/* Test OS objects */
+static ATOM_SEM sem1;
+static ATOM_EVENT event1;
+static ATOM_TCB tcb[NUM_TEST_THREADS];
+static uint8_t test_thread_stack[NUM_TEST_THREADS][TEST_THREAD_STACK_SIZE];
+
+
+/* Test global data */
+static volatile int run_count;
+static volatile int ran_flag[NUM_TEST_THREADS];
+static volatile uint8_t join_status;
+
+
+/* Forward declarations */
+static void test_return_thread_func (uint32_t param);
+static void test_sem_thread_func (uint32_t param);
+static void test_delay_thread_func (uint32_t param);
+static void test_join_thread_func (uint32_t param);
+static void test_event_thread_func (uint32_t param);
+
+
+/**
+ * \b test_start
+ *
+ * Start kernel test.
+ *
+ * This tests thread termination and joining, and reuse of the TCB and
+ * stack of a terminated thread.
+ *
+ * A thread which returns from its entry point is joined, then its TCB and
+ * stack are used to start it again. Threads blocking on a semaphore (with
+ * a timeout) and an event, and a thread which has never run, are terminated
+ * and must never be woken or scheduled. A thread in a timer delay is joined
+ * with a timeout, then terminated while another thread is joining it.
+ *
+ * @retval Number of failures
+ */
+uint32_t test_start (void)
+{
+    int failures;
+    int i;
+
+    /* Default to zero failures */
+    failures = 0;
+
+    /* Initialise global data */
+    run_count = 0;
+    for (i = 0; i < NUM_TEST_THREADS; i++)
+    {
+        ran_flag[i] = FALSE;
+    }
+    join_status = 0xFF;
+
+    /* Check parameter checks */
+    if (atomThreadTerminate (NULL) != ATOM_ERR_PARAM)
+    {
+        ATOMLOG (_STR("Terminate param check\n"));
+        failures++;
+    }
+    if (atomThreadJoin (NULL, 0) != ATOM_ERR_PARAM)
+    {
+        ATOMLOG (_STR("Join param check\n"));
+        failures++;
+    }
+    if (atomThreadJoin (atomCurrentContext(), 0) != ATOM_ERR_PARAM)
+    {
+        ATOMLOG (_STR("Join self check\n"));
+        failures++;
+    }
+
+    /* Create the test objects */
+    if (atomSemCreate (&sem1, 0) != ATOM_OK)
+    {
+        ATOMLOG (_STR("Error creating test semaphore 1\n"));
+        failures++;
+    }
+    else if (atomEventCreate (&event1) != ATOM_OK)
+    {
+        ATOMLOG (_STR("Error creating test event 1\n"));
+        failures++;
+    }
+
+    /* Test 1: thread returning from its entry point, and TCB reuse */
+    else
+    {
+        for (i = 1; i <= 2; i++)
+        {
+            /* Higher priority thread, runs to completion immediately */
+            if (atomThreadCreate (&tcb[0], TEST_THREAD_PRIO - 1, test_return_thread_func, 0,
+                    &test_thread_stack[0][0],
+                    TEST_THREAD_STACK_SIZE, TRUE) != ATOM_OK)
+            {
+                ATOMLOG (_STR("Bad thread create\n"));
+                failures++;
+            }
+            else if ((run_count != i) || (tcb[0].terminated != TRUE))
+            {
+                ATOMLOG (_STR("Thread not terminated %d\n"), run_count);
+                failures++;
+            }
+            else if (atomThreadJoin (&tcb[0], -1) != ATOM_OK)
+            {
+                ATOMLOG (_STR("Join finished thread\n"));
+                failures++;
+            }
+        }
+    }
+
+    /* Test 2: terminate a thread blocking on a semaphore with a timeout */
+    if (atomThreadCreate (&tcb[1], TEST_THREAD_PRIO - 1, test_sem_thread_func, 1,
+            &test_thread_stack[1][0],
+            TEST_THREAD_STACK_SIZE, TRUE) != ATOM_OK)
+    {
+        ATOMLOG (_STR("Bad thread create\n"));
+        failures++;
+    }
+    else if (atomThreadTerminate (&tcb[1]) != ATOM_OK)
+    {
+        ATOMLOG (_STR("Terminate sem\n"));
+        failures++;
+    }
+    else
+    {
+        /* The put must not wake the terminated thread */
+        if (atomSemPut (&sem1) != ATOM_OK)
+        {
+            ATOMLOG (_STR("SemPut\n"));
+            failures++;
+        }
+        else if (atomSemGet (&sem1, -1) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Sem count not incremented\n"));
+            failures++;
+        }
+
+        /* Wait past the timeout, the thread must not wake up */
+        atomTimerDelay (SYSTEM_TICKS_PER_SEC/2);
+        if (ran_flag[1] != FALSE)
+        {
+            ATOMLOG (_STR("Terminated thread woke\n"));
+            failures++;
+        }
+    }
+
+    /* Test 3: terminate a thread blocking on an event */
+    if (atomThreadCreate (&tcb[4], TEST_THREAD_PRIO - 1, test_event_thread_func, 4,
+            &test_thread_stack[4][0],
+            TEST_THREAD_STACK_SIZE, TRUE) != ATOM_OK)
+    {
+        ATOMLOG (_STR("Bad thread create\n"));
+        failures++;
+    }
+    else if (atomThreadTerminate (&tcb[4]) != ATOM_OK)
+    {
+        ATOMLOG (_STR("Terminate event\n"));
+        failures++;
+    }
+    else if (event1.tcb_ptr != NULL)
+    {
+        ATOMLOG (_STR("Event waiter not removed\n"));
+        failures++;
+    }
+    else if ((atomEventSet (&event1, 1) != ATOM_OK) || (ran_flag[4] != FALSE))
+    {
+        ATOMLOG (_STR("Terminated thread woke\n"));
+        failures++;
+    }
+
+    /* Test 4: terminate a thread which has never run */
+    if (atomThreadCreate (&tcb[5], TEST_THREAD_PRIO + 1, test_return_thread_func, 5,
+            &test_thread_stack[5][0],
+            TEST_THREAD_STACK_SIZE, TRUE) != ATOM_OK)
+    {
+        ATOMLOG (_STR("Bad thread create\n"));
+        failures++;
+    }
+    else if (atomThreadTerminate (&tcb[5]) != ATOM_OK)
+    {
+        ATOMLOG (_STR("Terminate ready\n"));
+        failures++;
+    }
+    else
+    {
+        /* Give the thread a chance to run */
+        atomTimerDelay (2);
+        if (ran_flag[5] != FALSE)
+        {
+            ATOMLOG (_STR("Terminated thread ran\n"));
+            failures++;
+        }
+    }
+
+    /* Test 5: join a delaying thread, then terminate it */
+    if (atomThreadCreate (&tcb[2], TEST_THREAD_PRIO - 1, test_delay_thread_func, 2,
+            &test_thread_stack[2][0],
+            TEST_THREAD_STACK_SIZE, TRUE) != ATOM_OK)
+    {
+        ATOMLOG (_STR("Bad thread create\n"));
+        failures++;
+    }
+    else if (atomThreadJoin (&tcb[2], -1) != ATOM_WOULDBLOCK)
+    {
+        ATOMLOG (_STR("Join wouldblock\n"));
+        failures++;
+    }
+    else if (atomThreadJoin (&tcb[2], SYSTEM_TICKS_PER_SEC/10) != ATOM_TIMEOUT)
+    {
+        ATOMLOG (_STR("Join timeout\n"));
+        failures++;
+    }
+
+    /* Create a higher priority thread which blocks joining it */
+    else if (atomThreadCreate (&tcb[3], TEST_THREAD_PRIO - 1, test_join_thread_func, 3,
+            &test_thread_stack[3][0],
+            TEST_THREAD_STACK_SIZE, TRUE) != ATOM_OK)
+    {
+        ATOMLOG (_STR("Bad thread create\n"));
+        failures++;
+    }
+    else if (join_status != 0xFF)
+    {
+        ATOMLOG (_STR("Joiner did not block\n"));
+        failures++;
+    }
+
+    /* Terminate the delaying thread, the joiner should run and exit */
+    else if (atomThreadTerminate (&tcb[2]) != ATOM_OK)
+    {
+        ATOMLOG (_STR("Terminate delay\n"));
+        failures++;
+    }
+    else if (join_status != ATOM_OK)
+    {
+        ATOMLOG (_STR("Joiner status %d\n"), join_status);
+        failures++;
+    }
+    else if (atomThreadJoin (&tcb[3], 0) != ATOM_OK)
+    {
+        ATOMLOG (_STR("Join joiner\n"));
+        failures++;
+    }
+    else
+    {
+        /* Wait past the delay period, the thread must not wake up */
+        ran_flag[2] = FALSE;
+        atomTimerDelay (SYSTEM_TICKS_PER_SEC/5);
+        if (ran_flag[2] != FALSE)
+        {
+            ATOMLOG (_STR("Terminated thread woke\n"));
+            failures++;
+        }
+    }
+
+    /* Check thread stack usage (if enabled) */
+#ifdef ATOM_STACK_CHECKING
+    {
+        uint32_t used_bytes, free_bytes;
+        int thread;
+
+        /* Check all threads */
+        for (thread = 0; thread < NUM_TEST_THREADS; thread++)
+        {
+            /* Check thread stack usage */
+            if (atomThreadStackCheck (&tcb[thread], &used_bytes, &free_bytes) != ATOM_OK)
+            {
+                ATOMLOG (_STR("StackCheck\n"));
+                failures++;
+            }
+            else
+            {
+                /* Check the thread did not use up to the end of stack */
+                if (free_bytes == 0)
+                {
+                    ATOMLOG (_STR("StackOverflow %d\n"), thread);
+                    failures++;
+                }
+
+                /* Log the stack usage */
+#ifdef TESTS_LOG_STACK_USAGE
+                ATOMLOG (_STR("StackUse:%d\n"), (int)used_bytes);
+#endif
+            }
+        }
+    }
+#endif
+
+    /* Quit */
+    return failures;
+
+}
+
+
+/**
+ * \b test_return_thread_func
+ *
+ * Entry point for threads which run to completion.
+ *
+ * @param[in] param Thread ID
+ *
+ * @return None
+ */
+static void test_return_thread_func (uint32_t param)
+{
+    /* Flag that this thread ran */
+    ran_flag[param] = TRUE;
+    run_count++;
+
+    /* Return from the entry point, terminating the thread */
+}
+
+
+/**
+ * \b test_sem_thread_func
+ *
+ * Entry point for the semaphore test thread.
+ *
+ * @param[in] param Thread ID
+ *
+ * @return None
+ */
+static void test_sem_thread_func (uint32_t param)
+{
+    /* Block on the semaphore, flag if we ever wake */
+    (void)atomSemGet (&sem1, SYSTEM_TICKS_PER_SEC/4);
+    ran_flag[param] = TRUE;
+
+    /* Loop forever */
+    while (1)
+    {
+        atomTimerDelay (SYSTEM_TICKS_PER_SEC);
+    }
+}
+
+
+/**
+ * \b test_event_thread_func
+ *
+ * Entry point for the event test thread.
+ *
+ * @param[in] param Thread ID
+ *
+ * @return None
+ */
+static void test_event_thread_func (uint32_t param)
+{
+    /* Block on the event, flag if we ever wake */
+    (void)atomEventWait (&event1, 1, NULL, 0);
+    ran_flag[param] = TRUE;
+
+    /* Loop forever */
+    while (1)
+    {
+        atomTimerDelay (SYSTEM_TICKS_PER_SEC);
+    }
+}
+
+
+/**
+ * \b test_delay_thread_func
+ *
+ * Entry point for the delaying test thread.
+ *
+ * @param[in] param Thread ID
+ *
+ * @return None
+ */
+static void test_delay_thread_func (uint32_t param)
+{
+    /* Loop forever, flagging each time we wake */
+    while (1)
+    {
+        atomTimerDelay (SYSTEM_TICKS_PER_SEC/20);
+        ran_flag[param] = TRUE;
+    }
+}
+
+
+/**
+ * \b test_join_thread_func
+ *
+ * Entry point for the joining test thread.
+ *
+ * Joins the delaying thread, records the status and exits.
+ *
+ * @param[in] param Thread ID
+ *
+ * @return None
+ */
+static void test_join_thread_func (uint32_t param)
+{
+    /* Wait for the delaying thread to terminate */
+    join_status = atomThreadJoin (&tcb[2], 0);
+
+    /* Terminate ourselves */
+    atomThreadExit ();
+}
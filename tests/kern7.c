@@ -0,0 +1,302 @@
+/*
+ * Copyright (c) 2022, Matt Liss
+ * Copyright (c) 2010, Kelvin Lawson. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. No personal names or organizations' names associated with the
+ *    Atomthreads project may be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE ATOMTHREADS PROJECT AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "atom.h"
+#include "atomsem.h"
+#include "atomtests.h"
+
+
+/* Number of test threads */
+#define NUM_TEST_THREADS      1
+
+
+/* Test OS objects */
+static ATOM_SEM sem1;
+static ATOM_TIMER timer1;
+static ATOM_TCB tcb[NUM_TEST_THREADS];
+static uint8_t test_thread_stack[NUM_TEST_THREADS][TEST_THREAD_STACK_SIZE];
+
+
+/* Test global data */
+static volatile int run_order[4];
+static volatile int run_count;
+static volatile int context_errors;
+static volatile int runs_when_woken;
+
+
+/* Forward declarations */
+static void test_thread_func (uint32_t param);
+static void test_softirq0 (void);
+static void test_softirq1 (void);
+static void test_timer_cb (POINTER cb_data);
+
+
+/**
+ * \b test_start
+ *
+ * Start kernel test.
+ *
+ * This tests deferred interrupt handlers (soft IRQs).
+ *
+ * Two deferred handlers are raised in reverse order from a timer callback
+ * (interrupt context). They must run in handler number order, in interrupt
+ * context, before the interrupt exits. The first handler wakes a higher
+ * priority thread, which must only be scheduled in after both handlers
+ * have run. Raising a handler from thread context must run it before the
+ * call returns.
+ *
+ * @retval Number of failures
+ */
+uint32_t test_start (void)
+{
+    int failures;
+
+    /* Default to zero failures */
+    failures = 0;
+
+    /* Initialise global data */
+    run_order[0] = run_order[1] = run_order[2] = run_order[3] = -1;
+    run_count = 0;
+    context_errors = 0;
+    runs_when_woken = -1;
+
+    /* Check parameter checks */
+    if (atomSoftIrqRegister (ATOM_NUM_SOFTIRQS, test_softirq0) != ATOM_ERR_PARAM)
+    {
+        ATOMLOG (_STR("Register param check\n"));
+        failures++;
+    }
+    if (atomSoftIrqRaise (ATOM_NUM_SOFTIRQS) != ATOM_ERR_PARAM)
+    {
+        ATOMLOG (_STR("Raise param check\n"));
+        failures++;
+    }
+    if (atomSoftIrqRaise (0) != ATOM_ERR_PARAM)
+    {
+        ATOMLOG (_STR("Raise unregistered check\n"));
+        failures++;
+    }
+
+    /* Register the handlers */
+    if ((atomSoftIrqRegister (0, test_softirq0) != ATOM_OK)
+        || (atomSoftIrqRegister (1, test_softirq1) != ATOM_OK))
+    {
+        ATOMLOG (_STR("Register\n"));
+        failures++;
+    }
+    else if (atomSemCreate (&sem1, 0) != ATOM_OK)
+    {
+        ATOMLOG (_STR("Error creating test semaphore 1\n"));
+        failures++;
+    }
+
+    /* Create a higher priority thread woken by the first handler */
+    else if (atomThreadCreate (&tcb[0], TEST_THREAD_PRIO - 1, test_thread_func, 0,
+            &test_thread_stack[0][0],
+            TEST_THREAD_STACK_SIZE, TRUE) != ATOM_OK)
+    {
+        ATOMLOG (_STR("Bad thread create\n"));
+        failures++;
+    }
+    else
+    {
+        /* Raise both handlers from interrupt context */
+        timer1.cb_func = test_timer_cb;
+        timer1.cb_data = NULL;
+        timer1.cb_ticks = 2;
+        if (atomTimerRegister (&timer1) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Timer register\n"));
+            failures++;
+        }
+        else
+        {
+            /* Wait for the timer and handlers */
+            atomTimerDelay (5);
+
+            /* Check they ran in number order */
+            if ((run_count != 2) || (run_order[0] != 0) || (run_order[1] != 1))
+            {
+                ATOMLOG (_STR("ISR order %d %d %d\n"), run_count, run_order[0], run_order[1]);
+                failures++;
+            }
+
+            /* Check the woken thread ran after both handlers */
+            if (runs_when_woken != 2)
+            {
+                ATOMLOG (_STR("Woken after %d\n"), runs_when_woken);
+                failures++;
+            }
+        }
+
+        /* Raise from thread context, should run before returning */
+        if (atomSoftIrqRaise (1) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Raise\n"));
+            failures++;
+        }
+        else if ((run_count != 3) || (run_order[2] != 1))
+        {
+            ATOMLOG (_STR("Thread raise %d\n"), run_count);
+            failures++;
+        }
+
+        /* Unregister, raising should now fail */
+        if ((atomSoftIrqRegister (0, NULL) != ATOM_OK)
+            || (atomSoftIrqRegister (1, NULL) != ATOM_OK)
+            || (atomSoftIrqRaise (1) != ATOM_ERR_PARAM))
+        {
+            ATOMLOG (_STR("Unregister\n"));
+            failures++;
+        }
+    }
+
+    /* Check handlers always ran in interrupt context */
+    if (context_errors)
+    {
+        ATOMLOG (_STR("Context errors %d\n"), context_errors);
+        failures++;
+    }
+
+    /* Check thread stack usage (if enabled) */
+#ifdef ATOM_STACK_CHECKING
+    {
+        uint32_t used_bytes, free_bytes;
+        int thread;
+
+        /* Check all threads */
+        for (thread = 0; thread < NUM_TEST_THREADS; thread++)
+        {
+            /* Check thread stack usage */
+            if (atomThreadStackCheck (&tcb[thread], &used_bytes, &free_bytes) != ATOM_OK)
+            {
+                ATOMLOG (_STR("StackCheck\n"));
+                failures++;
+            }
+            else
+            {
+                /* Check the thread did not use up to the end of stack */
+                if (free_bytes == 0)
+                {
+                    ATOMLOG (_STR("StackOverflow %d\n"), thread);
+                    failures++;
+                }
+
+                /* Log the stack usage */
+#ifdef TESTS_LOG_STACK_USAGE
+                ATOMLOG (_STR("StackUse:%d\n"), (int)used_bytes);
+#endif
+            }
+        }
+    }
+#endif
+
+    /* Quit */
+    return failures;
+
+}
+
+
+/**
+ * \b test_thread_func
+ *
+ * Entry point for test thread.
+ *
+ * Records how many deferred handlers had run when it was woken.
+ *
+ * @param[in] param Unused (optional thread entry parameter)
+ *
+ * @return None
+ */
+static void test_thread_func (uint32_t param)
+{
+    /* Wait to be woken by the first handler */
+    if (atomSemGet (&sem1, 0) == ATOM_OK)
+    {
+        runs_when_woken = run_count;
+    }
+
+    /* Loop forever */
+    while (1)
+    {
+        atomTimerDelay (SYSTEM_TICKS_PER_SEC);
+    }
+}
+
+
+/**
+ * \b test_softirq0
+ *
+ * Deferred handler 0, records its run and wakes the test thread.
+ *
+ * @return None
+ */
+static void test_softirq0 (void)
+{
+    if (atomCurrentContext() != NULL)
+        context_errors++;
+    run_order[run_count++] = 0;
+    (void)atomSemPut (&sem1);
+}
+
+
+/**
+ * \b test_softirq1
+ *
+ * Deferred handler 1, records its run.
+ *
+ * @return None
+ */
+static void test_softirq1 (void)
+{
+    if (atomCurrentContext() != NULL)
+        context_errors++;
+    run_order[run_count++] = 1;
+}
+
+
+/**
+ * \b test_timer_cb
+ *
+ * Timer callback which raises the handlers in reverse order.
+ *
+ * @param[in] cb_data Unused
+ *
+ * @return None
+ */
+static void test_timer_cb (POINTER cb_data)
+{
+    (void)atomSoftIrqRaise (1);
+    (void)atomSoftIrqRaise (0);
+
+    /* The handlers must not run until the interrupt exits */
+    if (run_count != 0)
+        context_errors++;
+}
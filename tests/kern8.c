@@ -0,0 +1,269 @@
+/*
+ * Copyright (c) 2022, Matt Liss
+ * Copyright (c) 2010, Kelvin Lawson. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. No personal names or organizations' names associated with the
+ *    Atomthreads project may be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE ATOMTHREADS PROJECT AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "atom.h"
+#include "atomsem.h"
+#include "atomtests.h"
+
+
+/* The test threads and data are only needed if EDF scheduling is enabled */
+#ifdef ATOM_EDF
+
+/* Number of test threads */
+#define NUM_TEST_THREADS      4
+
+
+/* Test OS objects */
+static ATOM_SEM sem[NUM_TEST_THREADS];
+static ATOM_TCB tcb[NUM_TEST_THREADS];
+static uint8_t test_thread_stack[NUM_TEST_THREADS][TEST_THREAD_STACK_SIZE];
+
+
+/* Test global data */
+static volatile int run_order[NUM_TEST_THREADS];
+static volatile int run_count;
+
+
+/* Forward declarations */
+static void test_thread_func (uint32_t param);
+
+#endif /* ATOM_EDF */
+
+/**
+ * \b test_start
+ *
+ * Start kernel test.
+ *
+ * This tests earliest-deadline-first scheduling within the EDF priority
+ * band (only if ATOM_EDF is enabled, otherwise the test trivially passes).
+ *
+ * This thread moves itself into the band. Three threads in the band, some
+ * with higher priority than others, are woken in an order which does not
+ * match their deadlines while this thread has the earliest deadline. When
+ * this thread moves its own deadline later, they must run in deadline
+ * order regardless of their priorities.
+ *
+ * A fourth, higher priority thread in the band is then woken with a
+ * deadline later than this thread's and must not preempt it until this
+ * thread's deadline is moved beyond it.
+ *
+ * @retval Number of failures
+ */
+uint32_t test_start (void)
+{
+    int failures;
+
+#ifdef ATOM_EDF
+    ATOM_TCB *curr_tcb_ptr;
+    uint32_t now;
+    int i;
+
+    /* Default to zero failures */
+    failures = 0;
+
+    /* Initialise global data */
+    run_count = 0;
+    for (i = 0; i < NUM_TEST_THREADS; i++)
+        run_order[i] = -1;
+
+    /* Get this thread's TCB and move it into the EDF band */
+    curr_tcb_ptr = atomCurrentContext();
+    now = atomTimeGet();
+    if ((atomThreadSetPriority (curr_tcb_ptr, ATOM_EDF_PRIO_LOW) != ATOM_OK)
+        || (atomThreadSetDeadline (curr_tcb_ptr, now + 1000) != ATOM_OK))
+    {
+        ATOMLOG (_STR("Enter band\n"));
+        failures++;
+    }
+
+    /* Check parameter checks */
+    if (atomThreadSetDeadline (NULL, now) != ATOM_ERR_PARAM)
+    {
+        ATOMLOG (_STR("Param check\n"));
+        failures++;
+    }
+
+    /*
+     * Create the test threads. Threads 0, 2 and 3 are at the top of the
+     * band and thread 1 at the bottom. New threads are due now, so each
+     * one preempts us and immediately blocks on its own semaphore.
+     */
+    for (i = 0; i < NUM_TEST_THREADS; i++)
+    {
+        if (atomSemCreate (&sem[i], 0) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Error creating test semaphore %d\n"), i);
+            failures++;
+        }
+        else if (atomThreadCreate (&tcb[i], (i == 1) ? ATOM_EDF_PRIO_LOW : ATOM_EDF_PRIO_HIGH,
+                test_thread_func, (uint32_t)i,
+                &test_thread_stack[i][0],
+                TEST_THREAD_STACK_SIZE, TRUE) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Bad thread create\n"));
+            failures++;
+        }
+    }
+
+    /* Abort if the threads could not be set up */
+    if (failures)
+        return failures;
+
+    /* Set deadlines so that the required order is 1, 2, 0 */
+    (void)atomThreadSetDeadline (&tcb[0], now + 300);
+    (void)atomThreadSetDeadline (&tcb[1], now + 100);
+    (void)atomThreadSetDeadline (&tcb[2], now + 200);
+
+    /* Take the earliest deadline and make all three ready in order 0, 1, 2 */
+    (void)atomThreadSetDeadline (curr_tcb_ptr, now);
+    for (i = 0; i < 3; i++)
+    {
+        if (atomSemPut (&sem[i]) != ATOM_OK)
+        {
+            ATOMLOG (_STR("SemPut %d\n"), i);
+            failures++;
+        }
+    }
+
+    /* None should have preempted us */
+    if (run_count != 0)
+    {
+        ATOMLOG (_STR("Preempted early %d\n"), run_count);
+        failures++;
+    }
+
+    /* Give up our early deadline, all three should now run in deadline order */
+    (void)atomThreadSetDeadline (curr_tcb_ptr, now + 1000);
+    if ((run_count != 3) || (run_order[0] != 1) || (run_order[1] != 2) || (run_order[2] != 0))
+    {
+        ATOMLOG (_STR("Run order %d: %d %d %d\n"), run_count, run_order[0], run_order[1], run_order[2]);
+        failures++;
+    }
+
+    /* Wake thread 3 with a later deadline than ours, it must not preempt */
+    (void)atomThreadSetDeadline (&tcb[3], now + 1100);
+    if (atomSemPut (&sem[3]) != ATOM_OK)
+    {
+        ATOMLOG (_STR("SemPut 3\n"));
+        failures++;
+    }
+    else if (run_count != 3)
+    {
+        ATOMLOG (_STR("Later deadline preempted\n"));
+        failures++;
+    }
+
+    /* Move our deadline beyond thread 3's, it should run before the call returns */
+    else if ((atomThreadSetDeadline (curr_tcb_ptr, now + 1200) != ATOM_OK)
+        || (run_count != 4) || (run_order[3] != 3))
+    {
+        ATOMLOG (_STR("Earlier deadline not scheduled\n"));
+        failures++;
+    }
+
+    /* Restore our own priority */
+    if (atomThreadSetPriority (curr_tcb_ptr, TEST_THREAD_PRIO) != ATOM_OK)
+    {
+        ATOMLOG (_STR("SetPriority restore\n"));
+        failures++;
+    }
+
+    /* Check thread stack usage (if enabled) */
+#ifdef ATOM_STACK_CHECKING
+    {
+        uint32_t used_bytes, free_bytes;
+        int thread;
+
+        /* Check all threads */
+        for (thread = 0; thread < NUM_TEST_THREADS; thread++)
+        {
+            /* Check thread stack usage */
+            if (atomThreadStackCheck (&tcb[thread], &used_bytes, &free_bytes) != ATOM_OK)
+            {
+                ATOMLOG (_STR("StackCheck\n"));
+                failures++;
+            }
+            else
+            {
+                /* Check the thread did not use up to the end of stack */
+                if (free_bytes == 0)
+                {
+                    ATOMLOG (_STR("StackOverflow %d\n"), thread);
+                    failures++;
+                }
+
+                /* Log the stack usage */
+#ifdef TESTS_LOG_STACK_USAGE
+                ATOMLOG (_STR("StackUse:%d\n"), (int)used_bytes);
+#endif
+            }
+        }
+    }
+#endif
+
+#else
+    /* EDF scheduling not enabled, nothing to test */
+    failures = 0;
+#endif
+
+    /* Quit */
+    return failures;
+
+}
+
+
+#ifdef ATOM_EDF
+/**
+ * \b test_thread_func
+ *
+ * Entry point for test threads.
+ *
+ * Blocks on its semaphore and records the order in which it was run.
+ *
+ * @param[in] param Thread ID (0 to 3)
+ *
+ * @return None
+ */
+static void test_thread_func (uint32_t param)
+{
+    /* Block on the semaphore */
+    if (atomSemGet (&sem[param], 0) == ATOM_OK)
+    {
+        /* Record the run order */
+        run_order[run_count++] = (int)param;
+    }
+
+    /* Loop forever */
+    while (1)
+    {
+        atomTimerDelay (SYSTEM_TICKS_PER_SEC);
+    }
+}
+#endif /* ATOM_EDF */
@@ -0,0 +1,234 @@
+/*
+ * Copyright (c) 2022, Matt Liss
+ * Copyright (c) 2010, Kelvin Lawson. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. No personal names or organizations' names associated with the
+ *    Atomthreads project may be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE ATOMTHREADS PROJECT AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "atom.h"
+#include "atomsem.h"
+#include "atomtests.h"
+
+
+/* Number of test threads */
+#define NUM_TEST_THREADS      2
+
+/* Number of semaphore posts */
+#define NUM_POSTS             5
+
+
+/* Test OS objects */
+static ATOM_SEM sem[NUM_TEST_THREADS];
+static ATOM_TCB tcb[NUM_TEST_THREADS];
+static uint8_t test_thread_stack[NUM_TEST_THREADS][TEST_THREAD_STACK_SIZE];
+
+
+/* Test global data */
+static volatile int wake_count[NUM_TEST_THREADS];
+
+
+/* Forward declarations */
+static void test_thread_func (uint32_t param);
+
+
+/**
+ * \b test_start
+ *
+ * Start kernel test.
+ *
+ * This tests preemption thresholds set with atomThreadSetThreshold().
+ *
+ * Thread 0 is one priority level above this thread and counts posts on a
+ * semaphore. Without a threshold, each post preempts this thread so the
+ * posts cost one context switch each. With this thread's threshold raised
+ * above thread 0, the posts must not preempt and thread 0 must then handle
+ * them all in a single context switch once the threshold is removed.
+ *
+ * Thread 1 is above the threshold and must still preempt immediately.
+ *
+ * @retval Number of failures
+ */
+uint32_t test_start (void)
+{
+    int failures, i, switches;
+    ATOM_TCB *curr_tcb_ptr;
+
+    /* Default to zero failures */
+    failures = 0;
+
+    /* Get this thread's TCB */
+    curr_tcb_ptr = atomCurrentContext();
+
+    /* Check parameter checks */
+    if (atomThreadSetThreshold (NULL, TEST_THREAD_PRIO) != ATOM_ERR_PARAM)
+    {
+        ATOMLOG (_STR("Param check\n"));
+        failures++;
+    }
+
+    /* Create the test threads, which immediately block on their semaphores */
+    for (i = 0; i < NUM_TEST_THREADS; i++)
+    {
+        wake_count[i] = 0;
+        if (atomSemCreate (&sem[i], 0) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Error creating test semaphore %d\n"), i);
+            failures++;
+        }
+        else if (atomThreadCreate (&tcb[i], TEST_THREAD_PRIO - 1 - (2 * i),
+                test_thread_func, (uint32_t)i,
+                &test_thread_stack[i][0],
+                TEST_THREAD_STACK_SIZE, TRUE) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Bad thread create\n"));
+            failures++;
+        }
+    }
+
+    /* Abort if the threads could not be set up */
+    if (failures)
+        return failures;
+
+    /* Without a threshold, each post should switch to thread 0 */
+    switches = 0;
+    for (i = 0; i < NUM_POSTS; i++)
+    {
+        (void)atomSemPut (&sem[0]);
+        if (wake_count[0] == i + 1)
+            switches++;
+    }
+    if (switches != NUM_POSTS)
+    {
+        ATOMLOG (_STR("No threshold switches %d\n"), switches);
+        failures++;
+    }
+
+    /* Raise our threshold above thread 0 but below thread 1 */
+    if (atomThreadSetThreshold (curr_tcb_ptr, TEST_THREAD_PRIO - 2) != ATOM_OK)
+    {
+        ATOMLOG (_STR("SetThreshold\n"));
+        failures++;
+    }
+
+    /* Now the posts should not switch to thread 0 at all */
+    wake_count[0] = 0;
+    switches = 0;
+    for (i = 0; i < NUM_POSTS; i++)
+    {
+        (void)atomSemPut (&sem[0]);
+        if (wake_count[0] != 0)
+            switches++;
+    }
+    if (switches != 0)
+    {
+        ATOMLOG (_STR("Threshold switches %d\n"), switches);
+        failures++;
+    }
+
+    /* Thread 1 is above the threshold and should still preempt */
+    (void)atomSemPut (&sem[1]);
+    if (wake_count[1] != 1)
+    {
+        ATOMLOG (_STR("Thread 1 not scheduled\n"));
+        failures++;
+    }
+
+    /* Remove the threshold, thread 0 should handle all posts before this returns */
+    if (atomThreadSetThreshold (curr_tcb_ptr, IDLE_THREAD_PRIORITY) != ATOM_OK)
+    {
+        ATOMLOG (_STR("SetThreshold restore\n"));
+        failures++;
+    }
+    else if (wake_count[0] != NUM_POSTS)
+    {
+        ATOMLOG (_STR("Thread 0 count %d\n"), wake_count[0]);
+        failures++;
+    }
+
+    /* Check thread stack usage (if enabled) */
+#ifdef ATOM_STACK_CHECKING
+    {
+        uint32_t used_bytes, free_bytes;
+        int thread;
+
+        /* Check all threads */
+        for (thread = 0; thread < NUM_TEST_THREADS; thread++)
+        {
+            /* Check thread stack usage */
+            if (atomThreadStackCheck (&tcb[thread], &used_bytes, &free_bytes) != ATOM_OK)
+            {
+                ATOMLOG (_STR("StackCheck\n"));
+                failures++;
+            }
+            else
+            {
+                /* Check the thread did not use up to the end of stack */
+                if (free_bytes == 0)
+                {
+                    ATOMLOG (_STR("StackOverflow %d\n"), thread);
+                    failures++;
+                }
+
+                /* Log the stack usage */
+#ifdef TESTS_LOG_STACK_USAGE
+                ATOMLOG (_STR("StackUse:%d\n"), (int)used_bytes);
+#endif
+            }
+        }
+    }
+#endif
+
+    /* Quit */
+    return failures;
+
+}
+
+
+/**
+ * \b test_thread_func
+ *
+ * Entry point for test threads.
+ *
+ * Counts the posts on its semaphore.
+ *
+ * @param[in] param Thread ID (0 to 1)
+ *
+ * @return None
+ */
+static void test_thread_func (uint32_t param)
+{
+    /* Count posts until the semaphore is deleted */
+    while (atomSemGet (&sem[param], 0) == ATOM_OK)
+    {
+        wake_count[param]++;
+    }
+
+    /* Loop forever */
+    while (1)
+    {
+        atomTimerDelay (SYSTEM_TICKS_PER_SEC);
+    }
+}
@@ -0,0 +1,366 @@
+/*
+ * Copyright (c) 2022, Matt Liss
+ * Copyright (c) 2010, Kelvin Lawson. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. No personal names or organizations' names associated with the
+ *    Atomthreads project may be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE ATOMTHREADS PROJECT AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "atom.h"
+#include "atomlog.h"
+#include "atomtimer.h"
+#include "atomtests.h"
+
+
+/* Number of records in the test ring */
+#define NUM_RECORDS           8
+
+/* Size of the captured output buffer */
+#define OUTPUT_SIZE           1024
+
+
+/* Forward declarations */
+static void test_output (const uint8_t *data, uint32_t len);
+static void test_callback (POINTER cb_data);
+static int check_frame (int frame, const char *fmt, uint32_t arg0, uint32_t arg1);
+static uint32_t frame_time (int frame);
+
+
+/* Test OS objects */
+static ATOM_LOG test_log;
+static ATOM_LOG_RECORD records[NUM_RECORDS];
+static ATOM_TIMER timer;
+static uint8_t test_thread_stack[TEST_THREAD_STACK_SIZE];
+
+
+/* Test format strings */
+static const char fmt_thread[] = "thread %u %u\n";
+static const char fmt_isr[] = "isr %u\n";
+
+
+/* Captured output */
+static uint8_t output[OUTPUT_SIZE];
+static volatile uint32_t output_len;
+static uint32_t frame_size;
+
+
+/**
+ * \b test_start
+ *
+ * Start deferred logging test.
+ *
+ * Records are written from thread and interrupt (timer callback) context
+ * to a log whose thread has lower priority than the test thread, so no
+ * output is produced until the test thread sleeps. The binary records
+ * captured from the output function are then checked against what was
+ * logged. Writing more records than fit in the ring must drop the excess
+ * without blocking, and report the number dropped after the records which
+ * fitted, stamped with the time of the first drop.
+ *
+ * @retval Number of failures
+ */
+uint32_t test_start (void)
+{
+    int failures;
+    uint32_t i, drop_time;
+
+    /* Default to zero failures */
+    failures = 0;
+    output_len = 0;
+
+    /* Binary record size: sync, address, timestamp and arguments */
+    frame_size = 2 + ((sizeof(const char *) > 4) ? 8 : 4) + (4 * (1 + ATOM_LOG_NUM_ARGS));
+
+    /* Check parameter checks */
+    if ((atomLogCreate (&test_log, records, 6, test_output, TEST_THREAD_PRIO + 1,
+            &test_thread_stack[0], TEST_THREAD_STACK_SIZE) != ATOM_ERR_PARAM)
+        || (atomLogCreate (&test_log, records, NUM_RECORDS, NULL, TEST_THREAD_PRIO + 1,
+            &test_thread_stack[0], TEST_THREAD_STACK_SIZE) != ATOM_ERR_PARAM)
+        || (atomLogWrite (NULL, fmt_thread, 0, 0, 0, 0) != ATOM_ERR_PARAM))
+    {
+        ATOMLOG (_STR("Param check\n"));
+        failures++;
+    }
+
+    /* Create the test_log, with its thread below the test thread */
+    if (atomLogCreate (&test_log, records, NUM_RECORDS, test_output, TEST_THREAD_PRIO + 1,
+            &test_thread_stack[0], TEST_THREAD_STACK_SIZE) != ATOM_OK)
+    {
+        ATOMLOG (_STR("Create\n"));
+        failures++;
+    }
+    else
+    {
+        /* Log a few records, nothing is sent until we sleep */
+        for (i = 0; i < 3; i++)
+        {
+            if (atomLogWrite (&test_log, fmt_thread, i, i * 100, 0, 0) != ATOM_OK)
+            {
+                ATOMLOG (_STR("Write %d\n"), (int)i);
+                failures++;
+            }
+        }
+        if (output_len != 0)
+        {
+            ATOMLOG (_STR("Early output\n"));
+            failures++;
+        }
+        atomTimerDelay (2);
+        if (output_len != 3 * frame_size)
+        {
+            ATOMLOG (_STR("Output len %d\n"), (int)output_len);
+            failures++;
+        }
+        else
+        {
+            for (i = 0; i < 3; i++)
+            {
+                failures += check_frame (i, fmt_thread, i, i * 100);
+            }
+        }
+
+        /**
+         * Overfill the ring: the extra records are dropped without
+         * blocking. The last is dropped on a later tick than the first.
+         */
+        output_len = 0;
+        atomTimerDelay (1);
+        drop_time = atomTimeGet();
+        for (i = 0; i < NUM_RECORDS + 2; i++)
+        {
+            if (i == NUM_RECORDS + 1)
+            {
+                while (atomTimeGet() == drop_time)
+                    ;
+            }
+            if (atomLogWrite (&test_log, fmt_thread, i, 0, 0, 0) != ((i < NUM_RECORDS) ? ATOM_OK : ATOM_WOULDBLOCK))
+            {
+                ATOMLOG (_STR("Overfill %d\n"), (int)i);
+                failures++;
+            }
+        }
+        atomTimerDelay (2);
+
+        /* Expect the records that fitted followed by the dropped count */
+        if (output_len != (NUM_RECORDS + 1) * frame_size)
+        {
+            ATOMLOG (_STR("Overfill len %d\n"), (int)output_len);
+            failures++;
+        }
+        else
+        {
+            for (i = 0; i < NUM_RECORDS; i++)
+            {
+                failures += check_frame (i, fmt_thread, i, 0);
+            }
+            failures += check_frame (NUM_RECORDS, NULL, 2, 0);
+
+            /* The dropped count has the time of the first drop */
+            if (frame_time (NUM_RECORDS) != drop_time)
+            {
+                ATOMLOG (_STR("Drop time\n"));
+                failures++;
+            }
+        }
+
+        /* Log from interrupt context via a timer callback */
+        output_len = 0;
+        timer.cb_func = test_callback;
+        timer.cb_data = (POINTER)&test_log;
+        timer.cb_ticks = 1;
+        if (atomTimerRegister (&timer) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Timer\n"));
+            failures++;
+        }
+        else
+        {
+            atomTimerDelay (3);
+            if (output_len != frame_size)
+            {
+                ATOMLOG (_STR("ISR len %d\n"), (int)output_len);
+                failures++;
+            }
+            else
+            {
+                failures += check_frame (0, fmt_isr, 42, 0);
+            }
+        }
+
+        /* Delete the test_log, further writes fail */
+        if ((atomLogDelete (&test_log) != ATOM_OK)
+            || (atomLogWrite (&test_log, fmt_thread, 0, 0, 0, 0) != ATOM_ERR_DELETED))
+        {
+            ATOMLOG (_STR("Delete\n"));
+            failures++;
+        }
+    }
+
+    /* Check thread stack usage (if enabled) */
+#ifdef ATOM_STACK_CHECKING
+    {
+        uint32_t used_bytes, free_bytes;
+
+        /* Check the log thread's stack usage */
+        if (atomThreadStackCheck (&test_log.tcb, &used_bytes, &free_bytes) != ATOM_OK)
+        {
+            ATOMLOG (_STR("StackCheck\n"));
+            failures++;
+        }
+        else
+        {
+            /* Check the thread did not use up to the end of stack */
+            if (free_bytes == 0)
+            {
+                ATOMLOG (_STR("StackOverflow\n"));
+                failures++;
+            }
+
+#ifdef TESTS_LOG_STACK_USAGE
+            /* Log stack usage */
+            ATOMLOG (_STR("StackUse:%d\n"), (int)used_bytes);
+#endif
+        }
+    }
+#endif
+
+    /* Quit */
+    return failures;
+
+}
+
+
+/**
+ * \b test_output
+ *
+ * Log output function. Captures the binary records for checking.
+ *
+ * @param[in] data Pointer to the record
+ * @param[in] len Length of the record
+ *
+ * @return None
+ */
+static void test_output (const uint8_t *data, uint32_t len)
+{
+    uint32_t i;
+
+    for (i = 0; (i < len) && (output_len < OUTPUT_SIZE); i++)
+    {
+        output[output_len++] = data[i];
+    }
+}
+
+
+/**
+ * \b test_callback
+ *
+ * Timer callback which writes a record from interrupt context.
+ *
+ * @param[in] cb_data Pointer to the log
+ *
+ * @return None
+ */
+static void test_callback (POINTER cb_data)
+{
+    (void)atomLogWrite ((ATOM_LOG *)cb_data, fmt_isr, 42, 0, 0, 0);
+}
+
+
+/**
+ * \b check_frame
+ *
+ * Checks a captured binary record.
+ *
+ * @param[in] frame Index of the record in the captured output
+ * @param[in] fmt Expected format string (NULL for a dropped count)
+ * @param[in] arg0 Expected first argument
+ * @param[in] arg1 Expected second argument
+ *
+ * @retval Number of failures
+ */
+static int check_frame (int frame, const char *fmt, uint32_t arg0, uint32_t arg1)
+{
+    const uint8_t *ptr;
+    unsigned long addr;
+    uint32_t args[2];
+    int i, addr_size;
+
+    ptr = &output[frame * frame_size];
+    addr_size = (sizeof(const char *) > 4) ? 8 : 4;
+
+    /* Check the sync bytes */
+    if ((ptr[0] != ATOM_LOG_SYNC0) || (ptr[1] != ATOM_LOG_SYNC1))
+    {
+        ATOMLOG (_STR("Sync %d\n"), frame);
+        return 1;
+    }
+    ptr += 2;
+
+    /* Decode the format address, least significant byte first */
+    addr = 0;
+    for (i = addr_size - 1; i >= 0; i--)
+    {
+        addr = (addr << 8) | ptr[i];
+    }
+    ptr += addr_size;
+
+    /* Skip the timestamp and decode the first two arguments */
+    ptr += 4;
+    for (i = 0; i < 2; i++)
+    {
+        args[i] = (uint32_t)ptr[0] | ((uint32_t)ptr[1] << 8)
+                    | ((uint32_t)ptr[2] << 16) | ((uint32_t)ptr[3] << 24);
+        ptr += 4;
+    }
+
+    if ((addr != (unsigned long)fmt) || (args[0] != arg0) || (args[1] != arg1))
+    {
+        ATOMLOG (_STR("Frame %d\n"), frame);
+        return 1;
+    }
+
+    return 0;
+}
+
+
+/**
+ * \b frame_time
+ *
+ * Decodes the timestamp of a captured binary record.
+ *
+ * @param[in] frame Index of the record in the captured output
+ *
+ * @return Timestamp
+ */
+static uint32_t frame_time (int frame)
+{
+    const uint8_t *ptr;
+
+    /* The timestamp follows the sync bytes and format address */
+    ptr = &output[frame * frame_size] + 2 + ((sizeof(const char *) > 4) ? 8 : 4);
+
+    return ((uint32_t)ptr[0] | ((uint32_t)ptr[1] << 8)
+            | ((uint32_t)ptr[2] << 16) | ((uint32_t)ptr[3] << 24));
+}
@@ -0,0 +1,210 @@
+/*
+ * Copyright (c) 2022, Matt Liss
+ * Copyright (c) 2010, Kelvin Lawson. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. No personal names or organizations' names associated with the
+ *    Atomthreads project may be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE ATOMTHREADS PROJECT AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "atom.h"
+#include "atommbox.h"
+#include "atomtests.h"
+
+
+/* Test OS objects */
+static ATOM_MBOX mbox1;
+static uint32_t mbox1_storage;
+
+
+/**
+ * \b test_start
+ *
+ * Start mailbox test.
+ *
+ * This test exercises the mailbox creation and deletion APIs, parameter
+ * checks and the sequence number / overwrite behaviour of puts and gets
+ * made without blocking.
+ *
+ * Testing of blocking reads is carried out in mbox2.c.
+ *
+ * @retval Number of failures
+ */
+uint32_t test_start (void)
+{
+    int failures;
+    uint32_t value, seq, seq1;
+    uint8_t status;
+
+    /* Default to zero failures */
+    failures = 0;
+
+    /* Test creation checks */
+    if (atomMboxCreate (NULL, (uint8_t *)&mbox1_storage, sizeof(mbox1_storage)) == ATOM_OK)
+    {
+        ATOMLOG (_STR("Bad mbox ptr check\n"));
+        failures++;
+    }
+    if (atomMboxCreate (&mbox1, NULL, sizeof(mbox1_storage)) == ATOM_OK)
+    {
+        ATOMLOG (_STR("Bad buff ptr check\n"));
+        failures++;
+    }
+    if (atomMboxCreate (&mbox1, (uint8_t *)&mbox1_storage, 0) == ATOM_OK)
+    {
+        ATOMLOG (_STR("Bad size check\n"));
+        failures++;
+    }
+
+    /* Test deletion checks */
+    if (atomMboxDelete (NULL) == ATOM_OK)
+    {
+        ATOMLOG (_STR("Bad mbox deletion check\n"));
+        failures++;
+    }
+
+    /* Create a mailbox for the remaining tests */
+    if (atomMboxCreate (&mbox1, (uint8_t *)&mbox1_storage, sizeof(mbox1_storage)) != ATOM_OK)
+    {
+        ATOMLOG (_STR("Error creating mbox\n"));
+        failures++;
+    }
+    else
+    {
+        /* Put/Get parameter checks */
+        value = 0x12345678;
+        seq = 0;
+        if (atomMboxPut (NULL, (uint8_t *)&value) == ATOM_OK)
+        {
+            ATOMLOG (_STR("Put mbox ptr check\n"));
+            failures++;
+        }
+        if (atomMboxPut (&mbox1, NULL) == ATOM_OK)
+        {
+            ATOMLOG (_STR("Put msg ptr check\n"));
+            failures++;
+        }
+        if (atomMboxGet (NULL, -1, &seq, (uint8_t *)&value) == ATOM_OK)
+        {
+            ATOMLOG (_STR("Get mbox ptr check\n"));
+            failures++;
+        }
+        if (atomMboxGet (&mbox1, -1, NULL, (uint8_t *)&value) == ATOM_OK)
+        {
+            ATOMLOG (_STR("Get seq ptr check\n"));
+            failures++;
+        }
+        if (atomMboxGet (&mbox1, -1, &seq, NULL) == ATOM_OK)
+        {
+            ATOMLOG (_STR("Get msg ptr check\n"));
+            failures++;
+        }
+
+        /* Empty mailbox should not return a value */
+        seq = 0;
+        if ((status = atomMboxGet (&mbox1, -1, &seq, (uint8_t *)&value)) != ATOM_WOULDBLOCK)
+        {
+            ATOMLOG (_STR("Empty get (%d)\n"), status);
+            failures++;
+        }
+
+        /* Post two values, only the latest should be read */
+        value = 0x11;
+        if (atomMboxPut (&mbox1, (uint8_t *)&value) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Put1 failed\n"));
+            failures++;
+        }
+        value = 0x22;
+        if (atomMboxPut (&mbox1, (uint8_t *)&value) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Put2 failed\n"));
+            failures++;
+        }
+        value = 0;
+        seq = 0;
+        if ((status = atomMboxGet (&mbox1, -1, &seq, (uint8_t *)&value)) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Get1 failed (%d)\n"), status);
+            failures++;
+        }
+        else if ((value != 0x22) || (seq == 0))
+        {
+            ATOMLOG (_STR("Get1 wrong value\n"));
+            failures++;
+        }
+
+        /* Same sequence number again should not return a value */
+        seq1 = seq;
+        if ((status = atomMboxGet (&mbox1, -1, &seq, (uint8_t *)&value)) != ATOM_WOULDBLOCK)
+        {
+            ATOMLOG (_STR("Stale get (%d)\n"), status);
+            failures++;
+        }
+
+        /* A second reader starting from zero still sees the value (non-consuming) */
+        value = 0;
+        seq = 0;
+        if ((status = atomMboxGet (&mbox1, -1, &seq, (uint8_t *)&value)) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Get2 failed (%d)\n"), status);
+            failures++;
+        }
+        else if ((value != 0x22) || (seq != seq1))
+        {
+            ATOMLOG (_STR("Get2 wrong value\n"));
+            failures++;
+        }
+
+        /* A further put should be newer than the last sequence seen */
+        value = 0x33;
+        if (atomMboxPut (&mbox1, (uint8_t *)&value) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Put3 failed\n"));
+            failures++;
+        }
+        value = 0;
+        if ((status = atomMboxGet (&mbox1, -1, &seq, (uint8_t *)&value)) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Get3 failed (%d)\n"), status);
+            failures++;
+        }
+        else if ((value != 0x33) || (seq == seq1))
+        {
+            ATOMLOG (_STR("Get3 wrong value\n"));
+            failures++;
+        }
+
+        /* Delete mailbox, test finished */
+        if (atomMboxDelete (&mbox1) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Delete failed\n"));
+            failures++;
+        }
+    }
+
+    /* Quit */
+    return failures;
+}
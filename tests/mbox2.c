@@ -0,0 +1,231 @@
+/*
+ * Copyright (c) 2022, Matt Liss
+ * Copyright (c) 2010, Kelvin Lawson. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. No personal names or organizations' names associated with the
+ *    Atomthreads project may be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE ATOMTHREADS PROJECT AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "atom.h"
+#include "atommbox.h"
+#include "atomtests.h"
+
+
+/* Number of test threads */
+#define NUM_TEST_THREADS      2
+
+
+/* Test OS objects */
+static ATOM_MBOX mbox1;
+static uint32_t mbox1_storage;
+static ATOM_TCB tcb[NUM_TEST_THREADS];
+static uint8_t test_thread_stack[NUM_TEST_THREADS][TEST_THREAD_STACK_SIZE];
+
+
+/* Test result tracking (one entry per reader thread) */
+static volatile uint32_t g_value[NUM_TEST_THREADS];
+static volatile int g_deleted[NUM_TEST_THREADS];
+
+
+/* Forward declarations */
+static void test_thread_func (uint32_t param);
+
+
+/**
+ * \b test_start
+ *
+ * Start mailbox test.
+ *
+ * This test exercises blocking reads on a mailbox. Two reader threads
+ * block waiting for a value, and a single atomMboxPut() must wake both of
+ * them with the same value (reads do not consume the value). The readers
+ * then wait for a newer value than the one they read, and must be woken
+ * by deletion of the mailbox.
+ *
+ * Timeouts on blocking reads are also checked.
+ *
+ * @retval Number of failures
+ */
+uint32_t test_start (void)
+{
+    int failures;
+    int i;
+    uint32_t value, seq;
+    uint8_t status;
+
+    /* Default to zero failures */
+    failures = 0;
+
+    /* Reset results */
+    for (i = 0; i < NUM_TEST_THREADS; i++)
+    {
+        g_value[i] = 0;
+        g_deleted[i] = FALSE;
+    }
+
+    /* Create mailbox */
+    if (atomMboxCreate (&mbox1, (uint8_t *)&mbox1_storage, sizeof(mbox1_storage)) != ATOM_OK)
+    {
+        ATOMLOG (_STR("Error creating mbox\n"));
+        failures++;
+    }
+    else
+    {
+        /* Check a blocking read times out on an empty mailbox */
+        seq = 0;
+        if ((status = atomMboxGet (&mbox1, SYSTEM_TICKS_PER_SEC/4, &seq, (uint8_t *)&value)) != ATOM_TIMEOUT)
+        {
+            ATOMLOG (_STR("Timeout fail (%d)\n"), status);
+            failures++;
+        }
+
+        /* Create the reader threads, they will block on the empty mailbox */
+        for (i = 0; i < NUM_TEST_THREADS; i++)
+        {
+            if (atomThreadCreate(&tcb[i], TEST_THREAD_PRIO - 1, test_thread_func, (uint32_t)i,
+                  &test_thread_stack[i][0],
+                  TEST_THREAD_STACK_SIZE, TRUE) != ATOM_OK)
+            {
+                /* Fail */
+                ATOMLOG (_STR("Error creating test thread\n"));
+                failures++;
+            }
+        }
+
+        /* Give the readers time to block */
+        atomTimerDelay (SYSTEM_TICKS_PER_SEC/4);
+
+        /* Post a single value, both readers should see it */
+        value = 0xA5;
+        if (atomMboxPut (&mbox1, (uint8_t *)&value) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Put failed\n"));
+            failures++;
+        }
+
+        /* Give the readers time to run */
+        atomTimerDelay (SYSTEM_TICKS_PER_SEC/4);
+        for (i = 0; i < NUM_TEST_THREADS; i++)
+        {
+            if (g_value[i] != 0xA5)
+            {
+                ATOMLOG (_STR("Reader %d missed value\n"), i);
+                failures++;
+            }
+        }
+
+        /* Readers are now waiting for a newer value, delete the mailbox */
+        if (atomMboxDelete (&mbox1) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Delete failed\n"));
+            failures++;
+        }
+
+        /* Give the readers time to run */
+        atomTimerDelay (SYSTEM_TICKS_PER_SEC/4);
+        for (i = 0; i < NUM_TEST_THREADS; i++)
+        {
+            if (g_deleted[i] == FALSE)
+            {
+                ATOMLOG (_STR("Reader %d not woken by delete\n"), i);
+                failures++;
+            }
+        }
+    }
+
+    /* Check thread stack usage (if enabled) */
+#ifdef ATOM_STACK_CHECKING
+    {
+        uint32_t used_bytes, free_bytes;
+        int thread;
+
+        /* Check all threads */
+        for (thread = 0; thread < NUM_TEST_THREADS; thread++)
+        {
+            /* Check thread stack usage */
+            if (atomThreadStackCheck (&tcb[thread], &used_bytes, &free_bytes) != ATOM_OK)
+            {
+                ATOMLOG (_STR("StackCheck\n"));
+                failures++;
+            }
+            else
+            {
+                /* Check the thread did not use up to the end of stack */
+                if (free_bytes == 0)
+                {
+                    ATOMLOG (_STR("StackOverflow %d\n"), thread);
+                    failures++;
+                }
+
+                /* Log the stack usage */
+#ifdef TESTS_LOG_STACK_USAGE
+                ATOMLOG (_STR("StackUse:%d\n"), (int)used_bytes);
+#endif
+            }
+        }
+    }
+#endif
+
+    /* Quit */
+    return failures;
+}
+
+
+/**
+ * \b test_thread_func
+ *
+ * Entry point for reader threads. Reads one value from the mailbox and
+ * then waits for a newer one, which should not arrive before the mailbox
+ * is deleted.
+ *
+ * @param[in] param Index of this reader thread
+ *
+ * @return None
+ */
+static void test_thread_func (uint32_t param)
+{
+    uint32_t value, seq;
+
+    /* Wait for the first value */
+    seq = 0;
+    if (atomMboxGet (&mbox1, 0, &seq, (uint8_t *)&value) == ATOM_OK)
+    {
+        /* Store the value for the main thread to check */
+        g_value[param] = value;
+
+        /* Wait for a newer value, expect deletion instead */
+        if (atomMboxGet (&mbox1, 0, &seq, (uint8_t *)&value) == ATOM_ERR_DELETED)
+        {
+            g_deleted[param] = TRUE;
+        }
+    }
+
+    /* Loop forever */
+    while (1)
+    {
+        atomTimerDelay (SYSTEM_TICKS_PER_SEC);
+    }
+}
@@ -0,0 +1,209 @@
+/*
+ * Copyright (c) 2022, Matt Liss
+ * Copyright (c) 2010, Kelvin Lawson. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. No personal names or organizations' names associated with the
+ *    Atomthreads project may be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE ATOMTHREADS PROJECT AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "atom.h"
+#include "atompool.h"
+#include "atomtests.h"
+
+
+/* Test pool dimensions (odd size to check buffer alignment) */
+#define POOL_BUFF_SIZE      13
+#define POOL_NUM_BUFFS      4
+
+
+/* Test OS objects */
+static ATOM_POOL pool1;
+static uint32_t pool1_storage[(ATOM_POOL_STORAGE_SIZE(POOL_BUFF_SIZE, POOL_NUM_BUFFS) + 3) / 4];
+
+
+/**
+ * \b test_start
+ *
+ * Start buffer pool test.
+ *
+ * This tests the basic allocation and reference counting behaviour of
+ * buffer pools from a single thread: parameter checks, exhausting the
+ * pool, and buffers only returning to the pool when the last reference
+ * is released.
+ *
+ * @retval Number of failures
+ */
+uint32_t test_start (void)
+{
+    int failures;
+    int i, j;
+    void *buff[POOL_NUM_BUFFS];
+    void *extra;
+
+    /* Default to zero failures */
+    failures = 0;
+
+    /* Parameter checks */
+    if ((atomPoolCreate (NULL, pool1_storage, POOL_BUFF_SIZE, POOL_NUM_BUFFS) != ATOM_ERR_PARAM)
+        || (atomPoolCreate (&pool1, NULL, POOL_BUFF_SIZE, POOL_NUM_BUFFS) != ATOM_ERR_PARAM)
+        || (atomPoolCreate (&pool1, pool1_storage, 0, POOL_NUM_BUFFS) != ATOM_ERR_PARAM)
+        || (atomPoolCreate (&pool1, pool1_storage, POOL_BUFF_SIZE, 0) != ATOM_ERR_PARAM))
+    {
+        ATOMLOG (_STR("Create param checks\n"));
+        failures++;
+    }
+
+    /* Create test pool */
+    if (atomPoolCreate (&pool1, pool1_storage, POOL_BUFF_SIZE, POOL_NUM_BUFFS) != ATOM_OK)
+    {
+        ATOMLOG (_STR("Error creating test pool\n"));
+        failures++;
+    }
+    else
+    {
+        /* Parameter checks */
+        if ((atomPoolAlloc (NULL, -1, &extra) != ATOM_ERR_PARAM)
+            || (atomPoolAlloc (&pool1, -1, NULL) != ATOM_ERR_PARAM)
+            || (atomPoolRetain (NULL) != ATOM_ERR_PARAM)
+            || (atomPoolRelease (NULL) != ATOM_ERR_PARAM))
+        {
+            ATOMLOG (_STR("Param checks\n"));
+            failures++;
+        }
+
+        /* Allocate every buffer in the pool */
+        for (i = 0; i < POOL_NUM_BUFFS; i++)
+        {
+            if (atomPoolAlloc (&pool1, -1, &buff[i]) != ATOM_OK)
+            {
+                ATOMLOG (_STR("Alloc %d\n"), i);
+                failures++;
+                buff[i] = NULL;
+            }
+
+            /* Check alignment and that buffers do not overlap the storage bounds */
+            else if ((((uint32_t)(buff[i]) & (sizeof(POINTER) - 1)) != 0)
+                || ((uint8_t *)buff[i] < (uint8_t *)pool1_storage)
+                || ((uint8_t *)buff[i] + POOL_BUFF_SIZE > (uint8_t *)pool1_storage + sizeof(pool1_storage)))
+            {
+                ATOMLOG (_STR("Buff %d bounds\n"), i);
+                failures++;
+            }
+            else
+            {
+                /* Fill the buffer with a pattern */
+                for (j = 0; j < POOL_BUFF_SIZE; j++)
+                    ((uint8_t *)buff[i])[j] = (uint8_t)(i + j);
+            }
+        }
+
+        /* Check that the buffers did not overwrite each other */
+        for (i = 0; i < POOL_NUM_BUFFS; i++)
+        {
+            for (j = 0; (buff[i] != NULL) && (j < POOL_BUFF_SIZE); j++)
+            {
+                if (((uint8_t *)buff[i])[j] != (uint8_t)(i + j))
+                {
+                    ATOMLOG (_STR("Buff %d corrupt\n"), i);
+                    failures++;
+                    break;
+                }
+            }
+        }
+
+        /* Pool is now empty */
+        if (atomPoolAlloc (&pool1, -1, &extra) != ATOM_WOULDBLOCK)
+        {
+            ATOMLOG (_STR("Empty pool check\n"));
+            failures++;
+        }
+
+        /* Take two extra references on the first buffer */
+        if ((atomPoolRetain (buff[0]) != ATOM_OK) || (atomPoolRetain (buff[0]) != ATOM_OK))
+        {
+            ATOMLOG (_STR("Retain\n"));
+            failures++;
+        }
+
+        /* The buffer must stay allocated until all three are released */
+        for (i = 0; i < 3; i++)
+        {
+            if (atomPoolAlloc (&pool1, -1, &extra) != ATOM_WOULDBLOCK)
+            {
+                ATOMLOG (_STR("Early free %d\n"), i);
+                failures++;
+            }
+            if (atomPoolRelease (buff[0]) != ATOM_OK)
+            {
+                ATOMLOG (_STR("Release %d\n"), i);
+                failures++;
+            }
+        }
+
+        /* Now it should be free, and releasing it again is an error */
+        if ((atomPoolRetain (buff[0]) != ATOM_ERR_PARAM)
+            || (atomPoolRelease (buff[0]) != ATOM_ERR_PARAM))
+        {
+            ATOMLOG (_STR("Free buffer checks\n"));
+            failures++;
+        }
+
+        /* It can be allocated again */
+        if ((atomPoolAlloc (&pool1, -1, &extra) != ATOM_OK) || (extra != buff[0]))
+        {
+            ATOMLOG (_STR("Realloc\n"));
+            failures++;
+        }
+
+        /* Release everything and check the whole pool can be allocated */
+        for (i = 0; i < POOL_NUM_BUFFS; i++)
+        {
+            if (atomPoolRelease (buff[i]) != ATOM_OK)
+            {
+                ATOMLOG (_STR("Final release %d\n"), i);
+                failures++;
+            }
+        }
+        for (i = 0; i < POOL_NUM_BUFFS; i++)
+        {
+            if (atomPoolAlloc (&pool1, -1, &buff[i]) != ATOM_OK)
+            {
+                ATOMLOG (_STR("Realloc %d\n"), i);
+                failures++;
+            }
+        }
+
+        /* Delete pool, test finished */
+        if (atomPoolDelete (&pool1) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Delete failed\n"));
+            failures++;
+        }
+    }
+
+    /* Quit */
+    return failures;
+}
@@ -0,0 +1,334 @@
+/*
+ * Copyright (c) 2022, Matt Liss
+ * Copyright (c) 2010, Kelvin Lawson. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. No personal names or organizations' names associated with the
+ *    Atomthreads project may be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE ATOMTHREADS PROJECT AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "atom.h"
+#include "atompool.h"
+#include "atomqueue.h"
+#include "atomtests.h"
+
+
+/* Test pool dimensions */
+#define POOL_BUFF_SIZE      64
+#define POOL_NUM_BUFFS      2
+
+
+/* Number of consumer threads (plus one thread blocking on the pool) */
+#define NUM_CONSUMERS       2
+#define NUM_TEST_THREADS    (NUM_CONSUMERS + 1)
+
+
+/* Test OS objects */
+static ATOM_POOL pool1;
+static uint32_t pool1_storage[(ATOM_POOL_STORAGE_SIZE(POOL_BUFF_SIZE, POOL_NUM_BUFFS) + 3) / 4];
+static ATOM_QUEUE queue[NUM_CONSUMERS];
+static void *queue_storage[NUM_CONSUMERS][POOL_NUM_BUFFS];
+static ATOM_TCB tcb[NUM_TEST_THREADS];
+static uint8_t test_thread_stack[NUM_TEST_THREADS][TEST_THREAD_STACK_SIZE];
+
+
+/* Test result tracking */
+static volatile int g_received[NUM_CONSUMERS];
+static volatile int g_errors;
+static volatile uint8_t g_alloc_status;
+static void * volatile g_alloc_buff;
+
+
+/* Forward declarations */
+static void consumer_thread_func (uint32_t param);
+static void alloc_thread_func (uint32_t param);
+
+
+/**
+ * \b test_start
+ *
+ * Start buffer pool test.
+ *
+ * This tests zero-copy fan-out of buffers through queues: each buffer is
+ * posted to two consumer threads which check the contents and release
+ * their reference, with the buffer only returning to the pool after both
+ * have finished with it. Also checks that a thread blocking on an empty
+ * pool is handed the next buffer released, that allocation timeouts work,
+ * and that deleting the pool wakes blocked threads.
+ *
+ * @retval Number of failures
+ */
+uint32_t test_start (void)
+{
+    int failures;
+    int i, frame;
+    void *buff;
+    void *buff2;
+    void *extra;
+
+    /* Default to zero failures */
+    failures = 0;
+    g_errors = 0;
+
+    /* Create test pool and consumer queues */
+    if (atomPoolCreate (&pool1, pool1_storage, POOL_BUFF_SIZE, POOL_NUM_BUFFS) != ATOM_OK)
+    {
+        ATOMLOG (_STR("Error creating test pool\n"));
+        failures++;
+        return failures;
+    }
+    for (i = 0; i < NUM_CONSUMERS; i++)
+    {
+        if (atomQueueCreate (&queue[i], (uint8_t *)&queue_storage[i][0], sizeof(void *), POOL_NUM_BUFFS) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Error creating queue %d\n"), i);
+            failures++;
+            return failures;
+        }
+    }
+
+    /* Create the consumer threads at higher priority */
+    for (i = 0; i < NUM_CONSUMERS; i++)
+    {
+        if (atomThreadCreate(&tcb[i], TEST_THREAD_PRIO - 1, consumer_thread_func, i,
+              &test_thread_stack[i][0],
+              TEST_THREAD_STACK_SIZE, TRUE) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Error creating consumer %d\n"), i);
+            failures++;
+        }
+    }
+
+    /* Send a number of frames, each to all consumers */
+    for (frame = 0; frame < 10; frame++)
+    {
+        /* Block until a buffer is free (consumers release them) */
+        if (atomPoolAlloc (&pool1, SYSTEM_TICKS_PER_SEC, &buff) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Alloc frame %d\n"), frame);
+            failures++;
+            break;
+        }
+
+        /* Fill the frame */
+        for (i = 0; i < POOL_BUFF_SIZE; i++)
+            ((uint8_t *)buff)[i] = (uint8_t)(frame + i);
+
+        /* Post the same buffer to every consumer, one reference each */
+        for (i = 0; i < NUM_CONSUMERS; i++)
+        {
+            if ((atomPoolRetain (buff) != ATOM_OK)
+                || (atomQueuePut (&queue[i], 0, (uint8_t *)&buff) != ATOM_OK))
+            {
+                ATOMLOG (_STR("Post frame %d\n"), frame);
+                failures++;
+            }
+        }
+
+        /* Drop our own reference */
+        if (atomPoolRelease (buff) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Release frame %d\n"), frame);
+            failures++;
+        }
+    }
+
+    /* Let the consumers finish */
+    atomTimerDelay (SYSTEM_TICKS_PER_SEC/4);
+    for (i = 0; i < NUM_CONSUMERS; i++)
+    {
+        if (g_received[i] != 10)
+        {
+            ATOMLOG (_STR("Consumer %d got %d\n"), i, g_received[i]);
+            failures++;
+        }
+    }
+    if (g_errors)
+    {
+        ATOMLOG (_STR("Consumer errors %d\n"), g_errors);
+        failures++;
+    }
+
+    /* All buffers should be back in the pool: take them all */
+    if ((atomPoolAlloc (&pool1, -1, &buff) != ATOM_OK)
+        || (atomPoolAlloc (&pool1, -1, &buff2) != ATOM_OK))
+    {
+        ATOMLOG (_STR("Buffers not returned\n"));
+        failures++;
+    }
+
+    /* Allocation timeout on an empty pool */
+    if (atomPoolAlloc (&pool1, SYSTEM_TICKS_PER_SEC/10, &extra) != ATOM_TIMEOUT)
+    {
+        ATOMLOG (_STR("Alloc timeout\n"));
+        failures++;
+    }
+
+    /* A higher priority thread blocks on the empty pool */
+    g_alloc_status = 0xFF;
+    if (atomThreadCreate(&tcb[NUM_CONSUMERS], TEST_THREAD_PRIO - 1, alloc_thread_func, 0,
+          &test_thread_stack[NUM_CONSUMERS][0],
+          TEST_THREAD_STACK_SIZE, TRUE) != ATOM_OK)
+    {
+        ATOMLOG (_STR("Error creating alloc thread\n"));
+        failures++;
+    }
+    atomTimerDelay (SYSTEM_TICKS_PER_SEC/10);
+
+    /* Releasing a buffer should hand it straight to the waiting thread */
+    (void)atomPoolRelease (buff);
+    if ((g_alloc_status != ATOM_OK) || (g_alloc_buff != buff))
+    {
+        ATOMLOG (_STR("Handoff %d\n"), g_alloc_status);
+        failures++;
+    }
+
+    /* The buffer went to the thread, not back to the pool */
+    if (atomPoolAlloc (&pool1, -1, &buff) != ATOM_WOULDBLOCK)
+    {
+        ATOMLOG (_STR("Handoff leaked\n"));
+        failures++;
+    }
+
+    /* The thread blocks again, deleting the pool should wake it */
+    atomTimerDelay (SYSTEM_TICKS_PER_SEC/10);
+    if (atomPoolDelete (&pool1) != ATOM_OK)
+    {
+        ATOMLOG (_STR("Delete failed\n"));
+        failures++;
+    }
+    if (g_alloc_status != ATOM_ERR_DELETED)
+    {
+        ATOMLOG (_STR("Delete wake %d\n"), g_alloc_status);
+        failures++;
+    }
+
+    /* Check thread stack usage (if enabled) */
+#ifdef ATOM_STACK_CHECKING
+    {
+        uint32_t used_bytes, free_bytes;
+        int thread;
+
+        /* Check all threads */
+        for (thread = 0; thread < NUM_TEST_THREADS; thread++)
+        {
+            /* Check thread stack usage */
+            if (atomThreadStackCheck (&tcb[thread], &used_bytes, &free_bytes) != ATOM_OK)
+            {
+                ATOMLOG (_STR("StackCheck\n"));
+                failures++;
+            }
+            else
+            {
+                /* Check the thread did not use up to the end of stack */
+                if (free_bytes == 0)
+                {
+                    ATOMLOG (_STR("StackOverflow %d\n"), thread);
+                    failures++;
+                }
+
+                /* Log the stack usage */
+#ifdef TESTS_LOG_STACK_USAGE
+                ATOMLOG (_STR("StackUse:%d\n"), (int)used_bytes);
+#endif
+            }
+        }
+    }
+#endif
+
+    /* Quit */
+    return failures;
+}
+
+
+/**
+ * \b consumer_thread_func
+ *
+ * Entry point for consumer threads. Receives buffer pointers from its
+ * queue, checks the frame contents and releases its reference.
+ *
+ * @param[in] param Consumer index
+ *
+ * @return None
+ */
+static void consumer_thread_func (uint32_t param)
+{
+    void *buff;
+    int i;
+
+    /* Loop forever */
+    while (1)
+    {
+        if (atomQueueGet (&queue[param], 0, (uint8_t *)&buff) == ATOM_OK)
+        {
+            /* Check the frame contents */
+            for (i = 0; i < POOL_BUFF_SIZE; i++)
+            {
+                if (((uint8_t *)buff)[i] != (uint8_t)(g_received[param] + i))
+                {
+                    g_errors++;
+                    break;
+                }
+            }
+            g_received[param]++;
+
+            /* Hold on to the buffer for a while, then release it */
+            atomTimerDelay (1);
+            if (atomPoolRelease (buff) != ATOM_OK)
+                g_errors++;
+        }
+    }
+}
+
+
+/**
+ * \b alloc_thread_func
+ *
+ * Entry point for the thread which blocks on the empty pool.
+ *
+ * @param[in] param Unused (optional thread entry parameter)
+ *
+ * @return None
+ */
+static void alloc_thread_func (uint32_t param)
+{
+    void *buff;
+
+    /* Compiler warnings */
+    param = param;
+
+    /* Block until handed a buffer */
+    g_alloc_status = atomPoolAlloc (&pool1, 0, &buff);
+    g_alloc_buff = buff;
+
+    /* Block again until the pool is deleted */
+    g_alloc_status = atomPoolAlloc (&pool1, 0, &buff);
+
+    /* Loop forever */
+    while (1)
+    {
+        atomTimerDelay (SYSTEM_TICKS_PER_SEC);
+    }
+}
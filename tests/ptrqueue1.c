@@ -0,0 +1,160 @@
+/*
+ * Copyright (c) 2022, Matt Liss
+ * Copyright (c) 2010, Kelvin Lawson. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. No personal names or organizations' names associated with the
+ *    Atomthreads project may be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE ATOMTHREADS PROJECT AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "atom.h"
+#include "atomptrqueue.h"
+#include "atomtests.h"
+
+
+/* Test queue size (must be a power of two) */
+#define QUEUE_ENTRIES       4
+
+
+/* Test OS objects */
+static ATOM_PTR_QUEUE queue1;
+static POINTER queue1_storage[QUEUE_ENTRIES];
+
+
+/**
+ * \b test_start
+ *
+ * Start pointer queue test.
+ *
+ * This tests pointer queues from a single thread: parameter checks
+ * (including rejection of capacities which are not a power of two),
+ * filling and emptying the queue, and FIFO ordering across many
+ * wraps of the masked insert/remove counters.
+ *
+ * @retval Number of failures
+ */
+uint32_t test_start (void)
+{
+    int failures;
+    uint32_t i, next_put, next_get;
+    POINTER msg;
+
+    /* Default to zero failures */
+    failures = 0;
+
+    /* Parameter checks */
+    if ((atomPtrQueueCreate (NULL, queue1_storage, QUEUE_ENTRIES) != ATOM_ERR_PARAM)
+        || (atomPtrQueueCreate (&queue1, NULL, QUEUE_ENTRIES) != ATOM_ERR_PARAM)
+        || (atomPtrQueueCreate (&queue1, queue1_storage, 0) != ATOM_ERR_PARAM)
+        || (atomPtrQueueCreate (&queue1, queue1_storage, 3) != ATOM_ERR_PARAM))
+    {
+        ATOMLOG (_STR("Create param checks\n"));
+        failures++;
+    }
+
+    /* Create test queue */
+    if (atomPtrQueueCreate (&queue1, queue1_storage, QUEUE_ENTRIES) != ATOM_OK)
+    {
+        ATOMLOG (_STR("Error creating test queue\n"));
+        failures++;
+    }
+    else
+    {
+        /* Parameter checks */
+        if ((atomPtrQueueGet (NULL, -1, &msg) != ATOM_ERR_PARAM)
+            || (atomPtrQueueGet (&queue1, -1, NULL) != ATOM_ERR_PARAM)
+            || (atomPtrQueuePut (NULL, -1, NULL) != ATOM_ERR_PARAM))
+        {
+            ATOMLOG (_STR("Param checks\n"));
+            failures++;
+        }
+
+        /* Empty queue */
+        if (atomPtrQueueGet (&queue1, -1, &msg) != ATOM_WOULDBLOCK)
+        {
+            ATOMLOG (_STR("Empty check\n"));
+            failures++;
+        }
+
+        /* Fill the queue */
+        for (i = 0; i < QUEUE_ENTRIES; i++)
+        {
+            if (atomPtrQueuePut (&queue1, -1, (POINTER)(i + 1)) != ATOM_OK)
+            {
+                ATOMLOG (_STR("Put %d\n"), (int)i);
+                failures++;
+            }
+        }
+
+        /* Full queue */
+        if (atomPtrQueuePut (&queue1, -1, (POINTER)0x55) != ATOM_WOULDBLOCK)
+        {
+            ATOMLOG (_STR("Full check\n"));
+            failures++;
+        }
+
+        /* Empty it again in order */
+        for (i = 0; i < QUEUE_ENTRIES; i++)
+        {
+            if ((atomPtrQueueGet (&queue1, -1, &msg) != ATOM_OK) || (msg != (POINTER)(i + 1)))
+            {
+                ATOMLOG (_STR("Get %d\n"), (int)i);
+                failures++;
+            }
+        }
+
+        /**
+         * Keep the queue partly full while many messages pass through,
+         * checking ordering as the indexes wrap round repeatedly.
+         */
+        next_put = next_get = 1;
+        for (i = 0; (i < 1000) && (failures == 0); i++)
+        {
+            /* Put two, get one, until full, then drain by one */
+            while (atomPtrQueuePut (&queue1, -1, (POINTER)next_put) == ATOM_OK)
+            {
+                next_put++;
+                if ((next_put - next_get) >= 3)
+                    break;
+            }
+            if ((atomPtrQueueGet (&queue1, -1, &msg) != ATOM_OK) || (msg != (POINTER)next_get))
+            {
+                ATOMLOG (_STR("Wrap get %d\n"), (int)next_get);
+                failures++;
+            }
+            next_get++;
+        }
+
+        /* Delete queue, test finished */
+        if (atomPtrQueueDelete (&queue1) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Delete failed\n"));
+            failures++;
+        }
+    }
+
+    /* Quit */
+    return failures;
+}
@@ -0,0 +1,287 @@
+/*
+ * Copyright (c) 2022, Matt Liss
+ * Copyright (c) 2010, Kelvin Lawson. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. No personal names or organizations' names associated with the
+ *    Atomthreads project may be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE ATOMTHREADS PROJECT AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "atom.h"
+#include "atomptrqueue.h"
+#include "atomtests.h"
+
+
+/* Test queue size (must be a power of two) */
+#define QUEUE_ENTRIES       2
+
+
+/* Number of test threads */
+#define NUM_TEST_THREADS    2
+
+
+/* Test OS objects */
+static ATOM_PTR_QUEUE queue1;
+static POINTER queue1_storage[QUEUE_ENTRIES];
+static ATOM_TCB tcb[NUM_TEST_THREADS];
+static uint8_t test_thread_stack[NUM_TEST_THREADS][TEST_THREAD_STACK_SIZE];
+
+
+/* Test result tracking */
+static volatile uint8_t g_get_status, g_put_status;
+static POINTER volatile g_get_msg;
+static volatile int g_put_done;
+
+
+/* Forward declarations */
+static void get_thread_func (uint32_t param);
+static void put_thread_func (uint32_t param);
+
+
+/**
+ * \b test_start
+ *
+ * Start pointer queue test.
+ *
+ * This tests the direct handoff paths of pointer queues. A receiver
+ * blocked on an empty queue must be handed a put message directly, and a
+ * sender blocked on a full queue must have its message placed in the
+ * queue (after those already queued) as soon as a get makes space. Also
+ * checks get timeouts and that deletion wakes blocked receivers.
+ *
+ * @retval Number of failures
+ */
+uint32_t test_start (void)
+{
+    int failures;
+    POINTER msg;
+
+    /* Default to zero failures */
+    failures = 0;
+    g_get_status = g_put_status = 0xFF;
+    g_put_done = FALSE;
+
+    /* Create test queue */
+    if (atomPtrQueueCreate (&queue1, queue1_storage, QUEUE_ENTRIES) != ATOM_OK)
+    {
+        ATOMLOG (_STR("Error creating test queue\n"));
+        failures++;
+        return failures;
+    }
+
+    /* Get timeout on an empty queue */
+    if (atomPtrQueueGet (&queue1, SYSTEM_TICKS_PER_SEC/10, &msg) != ATOM_TIMEOUT)
+    {
+        ATOMLOG (_STR("Get timeout\n"));
+        failures++;
+    }
+
+    /* Create a higher priority receiver which blocks on the empty queue */
+    if (atomThreadCreate(&tcb[0], TEST_THREAD_PRIO - 1, get_thread_func, 0,
+          &test_thread_stack[0][0],
+          TEST_THREAD_STACK_SIZE, TRUE) != ATOM_OK)
+    {
+        ATOMLOG (_STR("Error creating get thread\n"));
+        failures++;
+    }
+
+    /* Put should go straight to the receiver (which runs immediately) */
+    if (atomPtrQueuePut (&queue1, -1, (POINTER)&queue1) != ATOM_OK)
+    {
+        ATOMLOG (_STR("Put to receiver\n"));
+        failures++;
+    }
+    if ((g_get_status != ATOM_OK) || (g_get_msg != (POINTER)&queue1))
+    {
+        ATOMLOG (_STR("Receiver handoff %d\n"), g_get_status);
+        failures++;
+    }
+
+    /* Receiver is now blocking again, this goes straight to it... */
+    if ((atomPtrQueuePut (&queue1, -1, (POINTER)1) != ATOM_OK)
+        || (atomPtrQueuePut (&queue1, -1, (POINTER)2) != ATOM_OK)
+        || (atomPtrQueuePut (&queue1, -1, (POINTER)3) != ATOM_OK))
+    {
+        ATOMLOG (_STR("Fill\n"));
+        failures++;
+    }
+
+    /* ...and the rest fill the queue, which now holds 2, 3 */
+    if (g_get_msg != (POINTER)1)
+    {
+        ATOMLOG (_STR("Receiver second handoff\n"));
+        failures++;
+    }
+
+    /* A higher priority sender now blocks on the full queue */
+    if (atomThreadCreate(&tcb[1], TEST_THREAD_PRIO - 1, put_thread_func, 0,
+          &test_thread_stack[1][0],
+          TEST_THREAD_STACK_SIZE, TRUE) != ATOM_OK)
+    {
+        ATOMLOG (_STR("Error creating put thread\n"));
+        failures++;
+    }
+    if (g_put_done)
+    {
+        ATOMLOG (_STR("Sender did not block\n"));
+        failures++;
+    }
+
+    /* Removing a message should complete the sender's put */
+    if ((atomPtrQueueGet (&queue1, -1, &msg) != ATOM_OK) || (msg != (POINTER)2))
+    {
+        ATOMLOG (_STR("Get 2\n"));
+        failures++;
+    }
+    if (!g_put_done || (g_put_status != ATOM_OK))
+    {
+        ATOMLOG (_STR("Sender handoff %d\n"), g_put_status);
+        failures++;
+    }
+
+    /* Queue is full again, holding 3 then the sender's message */
+    if ((atomPtrQueuePut (&queue1, -1, (POINTER)5) != ATOM_WOULDBLOCK)
+        || (atomPtrQueueGet (&queue1, -1, &msg) != ATOM_OK) || (msg != (POINTER)3)
+        || (atomPtrQueueGet (&queue1, -1, &msg) != ATOM_OK) || (msg != (POINTER)4))
+    {
+        ATOMLOG (_STR("Sender ordering\n"));
+        failures++;
+    }
+
+    /* Let the receiver block again, then delete the queue */
+    atomTimerDelay (SYSTEM_TICKS_PER_SEC/2);
+    if (atomPtrQueueDelete (&queue1) != ATOM_OK)
+    {
+        ATOMLOG (_STR("Delete failed\n"));
+        failures++;
+    }
+    if (g_get_status != ATOM_ERR_DELETED)
+    {
+        ATOMLOG (_STR("Delete wake %d\n"), g_get_status);
+        failures++;
+    }
+
+    /* Check thread stack usage (if enabled) */
+#ifdef ATOM_STACK_CHECKING
+    {
+        uint32_t used_bytes, free_bytes;
+        int thread;
+
+        /* Check all threads */
+        for (thread = 0; thread < NUM_TEST_THREADS; thread++)
+        {
+            /* Check thread stack usage */
+            if (atomThreadStackCheck (&tcb[thread], &used_bytes, &free_bytes) != ATOM_OK)
+            {
+                ATOMLOG (_STR("StackCheck\n"));
+                failures++;
+            }
+            else
+            {
+                /* Check the thread did not use up to the end of stack */
+                if (free_bytes == 0)
+                {
+                    ATOMLOG (_STR("StackOverflow %d\n"), thread);
+                    failures++;
+                }
+
+                /* Log the stack usage */
+#ifdef TESTS_LOG_STACK_USAGE
+                ATOMLOG (_STR("StackUse:%d\n"), (int)used_bytes);
+#endif
+            }
+        }
+    }
+#endif
+
+    /* Quit */
+    return failures;
+}
+
+
+/**
+ * \b get_thread_func
+ *
+ * Entry point for the receiver thread. Receives twice, then waits for
+ * the queue to be deleted.
+ *
+ * @param[in] param Unused (optional thread entry parameter)
+ *
+ * @return None
+ */
+static void get_thread_func (uint32_t param)
+{
+    POINTER msg;
+    int i;
+
+    /* Compiler warnings */
+    param = param;
+
+    /* Receive two messages */
+    for (i = 0; i < 2; i++)
+    {
+        g_get_status = atomPtrQueueGet (&queue1, 0, &msg);
+        if (g_get_status == ATOM_OK)
+            g_get_msg = msg;
+    }
+
+    /* Stay out of the way while the main thread fills the queue */
+    atomTimerDelay (SYSTEM_TICKS_PER_SEC/5);
+
+    /* Block until deletion */
+    g_get_status = atomPtrQueueGet (&queue1, 0, &msg);
+
+    /* Loop forever */
+    while (1)
+    {
+        atomTimerDelay (SYSTEM_TICKS_PER_SEC);
+    }
+}
+
+
+/**
+ * \b put_thread_func
+ *
+ * Entry point for the sender thread.
+ *
+ * @param[in] param Unused (optional thread entry parameter)
+ *
+ * @return None
+ */
+static void put_thread_func (uint32_t param)
+{
+    /* Compiler warnings */
+    param = param;
+
+    /* Block on the full queue */
+    g_put_status = atomPtrQueuePut (&queue1, 0, (POINTER)4);
+    g_put_done = TRUE;
+
+    /* Loop forever */
+    while (1)
+    {
+        atomTimerDelay (SYSTEM_TICKS_PER_SEC);
+    }
+}
@@ -0,0 +1,192 @@
+/*
+ * Copyright (c) 2022, Matt Liss
+ * Copyright (c) 2010, Kelvin Lawson. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. No personal names or organizations' names associated with the
+ *    Atomthreads project may be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE ATOMTHREADS PROJECT AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "atom.h"
+#include "atomqueue.h"
+#include "atomtests.h"
+
+
+/* Test queue size */
+#define QUEUE_ENTRIES       4
+
+
+/* Test OS objects */
+static ATOM_QUEUE queue1;
+static uint8_t queue1_storage[QUEUE_ENTRIES];
+
+
+/**
+ * \b test_start
+ *
+ * Start queue test.
+ *
+ * This test exercises atomQueuePutUrgent(). Urgent messages must overtake
+ * messages already on the queue, including when the head has wrapped
+ * around the end of the queue buffer, and must still be subject to the
+ * normal queue-full checks.
+ *
+ * @retval Number of failures
+ */
+uint32_t test_start (void)
+{
+    int failures;
+    uint8_t msg, i;
+    uint8_t status;
+
+    /* Default to zero failures */
+    failures = 0;
+
+    /* Create test queue */
+    if (atomQueueCreate (&queue1, &queue1_storage[0], sizeof(queue1_storage[0]), QUEUE_ENTRIES) != ATOM_OK)
+    {
+        ATOMLOG (_STR("Error creating test queue\n"));
+        failures++;
+    }
+    else
+    {
+        /* Parameter checks */
+        msg = 0;
+        if (atomQueuePutUrgent (NULL, 0, &msg) != ATOM_ERR_PARAM)
+        {
+            ATOMLOG (_STR("Urgent queue ptr check\n"));
+            failures++;
+        }
+        if (atomQueuePutUrgent (&queue1, 0, NULL) != ATOM_ERR_PARAM)
+        {
+            ATOMLOG (_STR("Urgent msg ptr check\n"));
+            failures++;
+        }
+
+        /*
+         * Run twice so that the second pass starts with the queue head
+         * part-way through the buffer and urgent inserts wrap around.
+         */
+        for (i = 0; i < 2; i++)
+        {
+            /* Post two normal messages, then one urgent */
+            msg = 1;
+            if (atomQueuePut (&queue1, -1, &msg) != ATOM_OK)
+            {
+                ATOMLOG (_STR("Put1 fail\n"));
+                failures++;
+            }
+            msg = 2;
+            if (atomQueuePut (&queue1, -1, &msg) != ATOM_OK)
+            {
+                ATOMLOG (_STR("Put2 fail\n"));
+                failures++;
+            }
+            msg = 3;
+            if (atomQueuePutUrgent (&queue1, -1, &msg) != ATOM_OK)
+            {
+                ATOMLOG (_STR("Urgent1 fail\n"));
+                failures++;
+            }
+
+            /* Fill the queue with a second urgent message */
+            msg = 4;
+            if (atomQueuePutUrgent (&queue1, -1, &msg) != ATOM_OK)
+            {
+                ATOMLOG (_STR("Urgent2 fail\n"));
+                failures++;
+            }
+
+            /* Urgent put on a full queue should not block */
+            msg = 5;
+            if ((status = atomQueuePutUrgent (&queue1, -1, &msg)) != ATOM_WOULDBLOCK)
+            {
+                ATOMLOG (_STR("Urgent full (%d)\n"), status);
+                failures++;
+            }
+
+            /* Expect the urgent messages first (LIFO), then the normal ones */
+            if ((atomQueueGet (&queue1, -1, &msg) != ATOM_OK) || (msg != 4))
+            {
+                ATOMLOG (_STR("Get1 %d\n"), msg);
+                failures++;
+            }
+            if ((atomQueueGet (&queue1, -1, &msg) != ATOM_OK) || (msg != 3))
+            {
+                ATOMLOG (_STR("Get2 %d\n"), msg);
+                failures++;
+            }
+            if ((atomQueueGet (&queue1, -1, &msg) != ATOM_OK) || (msg != 1))
+            {
+                ATOMLOG (_STR("Get3 %d\n"), msg);
+                failures++;
+            }
+
+            /* An urgent message still overtakes the remaining normal one */
+            msg = 6;
+            if (atomQueuePutUrgent (&queue1, -1, &msg) != ATOM_OK)
+            {
+                ATOMLOG (_STR("Urgent3 fail\n"));
+                failures++;
+            }
+            if ((atomQueueGet (&queue1, -1, &msg) != ATOM_OK) || (msg != 6))
+            {
+                ATOMLOG (_STR("Get4 %d\n"), msg);
+                failures++;
+            }
+            if ((atomQueueGet (&queue1, -1, &msg) != ATOM_OK) || (msg != 2))
+            {
+                ATOMLOG (_STR("Get5 %d\n"), msg);
+                failures++;
+            }
+
+            /* Queue should now be empty */
+            if (atomQueueGet (&queue1, -1, &msg) != ATOM_WOULDBLOCK)
+            {
+                ATOMLOG (_STR("Not empty\n"));
+                failures++;
+            }
+
+            /* Shift the head along one slot before the second pass */
+            msg = 7;
+            if ((atomQueuePut (&queue1, -1, &msg) != ATOM_OK)
+                || (atomQueueGet (&queue1, -1, &msg) != ATOM_OK))
+            {
+                ATOMLOG (_STR("Shift fail\n"));
+                failures++;
+            }
+        }
+
+        /* Delete queue, test finished */
+        if (atomQueueDelete (&queue1) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Delete failed\n"));
+            failures++;
+        }
+    }
+
+    /* Quit */
+    return failures;
+}
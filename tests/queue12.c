@@ -0,0 +1,309 @@
+/*
+ * Copyright (c) 2022, Matt Liss
+ * Copyright (c) 2010, Kelvin Lawson. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. No personal names or organizations' names associated with the
+ *    Atomthreads project may be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE ATOMTHREADS PROJECT AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "atom.h"
+#include "atomqueue.h"
+#include "atomtests.h"
+
+
+/* Test queue size */
+#define QUEUE_ENTRIES       4
+
+
+/* Number of message priority levels */
+#define QUEUE_LEVELS        3
+
+
+/* Number of test threads */
+#define NUM_TEST_THREADS      1
+
+
+/* Test OS objects */
+static ATOM_QUEUE queue1;
+static ATOM_QUEUE_LEVEL queue1_levels[QUEUE_LEVELS];
+static uint8_t queue1_storage[QUEUE_ENTRIES];
+static uint32_t queue1_links[QUEUE_ENTRIES];
+static ATOM_TCB tcb[NUM_TEST_THREADS];
+static uint8_t test_thread_stack[NUM_TEST_THREADS][TEST_THREAD_STACK_SIZE];
+
+
+/* Test result tracking */
+static volatile int g_result;
+
+
+/* Forward declarations */
+static void test_thread_func (uint32_t param);
+
+
+/**
+ * \b test_start
+ *
+ * Start queue test.
+ *
+ * This test exercises priority queues created with
+ * atomQueueCreatePriority(). Messages posted at different levels must be
+ * received highest priority first, and FIFO within a level. The total
+ * message count is shared between levels, and slots freed by messages
+ * at one level must be reused by messages at other levels. A thread
+ * blocking in atomQueueGet() must be woken by a message at any level.
+ *
+ * @retval Number of failures
+ */
+uint32_t test_start (void)
+{
+    int failures;
+    uint8_t msg, i;
+    uint8_t status;
+    static const uint8_t expected[QUEUE_ENTRIES] = { 0x01, 0x11, 0x12, 0x21 };
+    static const uint8_t expected_reuse[QUEUE_ENTRIES] = { 0x00, 0x01, 0x23, 0x24 };
+
+    /* Default to zero failures */
+    failures = 0;
+    g_result = 0;
+
+    /* Creation checks */
+    if (atomQueueCreatePriority (&queue1, &queue1_storage[0], sizeof(uint8_t), QUEUE_ENTRIES, NULL, &queue1_levels[0], QUEUE_LEVELS) != ATOM_ERR_PARAM)
+    {
+        ATOMLOG (_STR("Bad links ptr check\n"));
+        failures++;
+    }
+    if (atomQueueCreatePriority (&queue1, &queue1_storage[0], sizeof(uint8_t), QUEUE_ENTRIES, &queue1_links[0], NULL, QUEUE_LEVELS) != ATOM_ERR_PARAM)
+    {
+        ATOMLOG (_STR("Bad levels ptr check\n"));
+        failures++;
+    }
+    if (atomQueueCreatePriority (&queue1, &queue1_storage[0], sizeof(uint8_t), QUEUE_ENTRIES, &queue1_links[0], &queue1_levels[0], 0) != ATOM_ERR_PARAM)
+    {
+        ATOMLOG (_STR("Bad num levels check\n"));
+        failures++;
+    }
+
+    /* Create test queue */
+    if (atomQueueCreatePriority (&queue1, &queue1_storage[0], sizeof(uint8_t), QUEUE_ENTRIES, &queue1_links[0], &queue1_levels[0], QUEUE_LEVELS) != ATOM_OK)
+    {
+        ATOMLOG (_STR("Error creating test queue\n"));
+        failures++;
+    }
+    else
+    {
+        /* Out of range priority should be rejected */
+        msg = 0;
+        if (atomQueuePutPriority (&queue1, -1, QUEUE_LEVELS, &msg) != ATOM_ERR_PARAM)
+        {
+            ATOMLOG (_STR("Bad priority check\n"));
+            failures++;
+        }
+
+        /* Post messages in mixed order (atomQueuePut() uses the lowest level) */
+        msg = 0x21;
+        if (atomQueuePut (&queue1, -1, &msg) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Put fail\n"));
+            failures++;
+        }
+        msg = 0x11;
+        if (atomQueuePutPriority (&queue1, -1, 1, &msg) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Put1 fail\n"));
+            failures++;
+        }
+        msg = 0x01;
+        if (atomQueuePutPriority (&queue1, -1, 0, &msg) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Put0 fail\n"));
+            failures++;
+        }
+        msg = 0x12;
+        if (atomQueuePutPriority (&queue1, -1, 1, &msg) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Put1b fail\n"));
+            failures++;
+        }
+
+        /* Queue is now full (count is shared between levels) */
+        msg = 0x02;
+        if ((status = atomQueuePutPriority (&queue1, -1, 0, &msg)) != ATOM_WOULDBLOCK)
+        {
+            ATOMLOG (_STR("Full check (%d)\n"), status);
+            failures++;
+        }
+
+        /* Check messages arrive in priority order */
+        for (i = 0; i < QUEUE_ENTRIES; i++)
+        {
+            if ((atomQueueGet (&queue1, -1, &msg) != ATOM_OK) || (msg != expected[i]))
+            {
+                ATOMLOG (_STR("Get%d 0x%x\n"), i, msg);
+                failures++;
+            }
+        }
+
+        /* Fill every slot at the lowest level, then free two of them */
+        for (i = 0; i < QUEUE_ENTRIES; i++)
+        {
+            msg = 0x21 + i;
+            if (atomQueuePut (&queue1, -1, &msg) != ATOM_OK)
+            {
+                ATOMLOG (_STR("Fill%d fail\n"), i);
+                failures++;
+            }
+        }
+        for (i = 0; i < 2; i++)
+        {
+            if ((atomQueueGet (&queue1, -1, &msg) != ATOM_OK) || (msg != 0x21 + i))
+            {
+                ATOMLOG (_STR("Drain%d 0x%x\n"), i, msg);
+                failures++;
+            }
+        }
+
+        /* Reuse the freed slots at the highest level, one of them urgent */
+        msg = 0x01;
+        if (atomQueuePutPriority (&queue1, -1, 0, &msg) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Reuse put fail\n"));
+            failures++;
+        }
+        msg = 0x00;
+        if (atomQueuePutUrgent (&queue1, -1, &msg) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Reuse urgent fail\n"));
+            failures++;
+        }
+        for (i = 0; i < QUEUE_ENTRIES; i++)
+        {
+            if ((atomQueueGet (&queue1, -1, &msg) != ATOM_OK) || (msg != expected_reuse[i]))
+            {
+                ATOMLOG (_STR("Reuse%d 0x%x\n"), i, msg);
+                failures++;
+            }
+        }
+
+        /* Create a higher priority thread to block on the empty queue */
+        if (atomThreadCreate(&tcb[0], TEST_THREAD_PRIO - 1, test_thread_func, 0,
+              &test_thread_stack[0][0],
+              TEST_THREAD_STACK_SIZE, TRUE) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Error creating test thread\n"));
+            failures++;
+        }
+        else
+        {
+            /* Wake it with a mid-level message */
+            atomTimerDelay (SYSTEM_TICKS_PER_SEC/4);
+            msg = 0x55;
+            if (atomQueuePutPriority (&queue1, -1, 1, &msg) != ATOM_OK)
+            {
+                ATOMLOG (_STR("Wake put fail\n"));
+                failures++;
+            }
+            atomTimerDelay (SYSTEM_TICKS_PER_SEC/4);
+            if (g_result != 0x55)
+            {
+                ATOMLOG (_STR("Thread not woken\n"));
+                failures++;
+            }
+        }
+
+        /* Delete queue, test finished */
+        if (atomQueueDelete (&queue1) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Delete failed\n"));
+            failures++;
+        }
+    }
+
+    /* Check thread stack usage (if enabled) */
+#ifdef ATOM_STACK_CHECKING
+    {
+        uint32_t used_bytes, free_bytes;
+        int thread;
+
+        /* Check all threads */
+        for (thread = 0; thread < NUM_TEST_THREADS; thread++)
+        {
+            /* Check thread stack usage */
+            if (atomThreadStackCheck (&tcb[thread], &used_bytes, &free_bytes) != ATOM_OK)
+            {
+                ATOMLOG (_STR("StackCheck\n"));
+                failures++;
+            }
+            else
+            {
+                /* Check the thread did not use up to the end of stack */
+                if (free_bytes == 0)
+                {
+                    ATOMLOG (_STR("StackOverflow %d\n"), thread);
+                    failures++;
+                }
+
+                /* Log the stack usage */
+#ifdef TESTS_LOG_STACK_USAGE
+                ATOMLOG (_STR("StackUse:%d\n"), (int)used_bytes);
+#endif
+            }
+        }
+    }
+#endif
+
+    /* Quit */
+    return failures;
+}
+
+
+/**
+ * \b test_thread_func
+ *
+ * Entry point for test thread.
+ *
+ * @param[in] param Unused (optional thread entry parameter)
+ *
+ * @return None
+ */
+static void test_thread_func (uint32_t param)
+{
+    uint8_t msg;
+
+    /* Compiler warnings */
+    param = param;
+
+    /* Block on the empty queue and store the received message */
+    if (atomQueueGet (&queue1, 0, &msg) == ATOM_OK)
+    {
+        g_result = msg;
+    }
+
+    /* Loop forever */
+    while (1)
+    {
+        atomTimerDelay (SYSTEM_TICKS_PER_SEC);
+    }
+}
@@ -0,0 +1,290 @@
+/*
+ * Copyright (c) 2022, Matt Liss
+ * Copyright (c) 2010, Kelvin Lawson. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. No personal names or organizations' names associated with the
+ *    Atomthreads project may be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE ATOMTHREADS PROJECT AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "atom.h"
+#include "atomqueue.h"
+#include "atomtests.h"
+
+
+/* Test queue size */
+#define QUEUE_ENTRIES       4
+
+
+/* Number of test threads */
+#define NUM_TEST_THREADS      2
+
+
+/* Test OS objects */
+static ATOM_QUEUE queue1;
+static uint8_t queue1_storage[QUEUE_ENTRIES];
+static ATOM_TCB tcb[NUM_TEST_THREADS];
+static uint8_t test_thread_stack[NUM_TEST_THREADS][TEST_THREAD_STACK_SIZE];
+
+
+/* Test result tracking */
+static volatile uint8_t g_status[NUM_TEST_THREADS];
+static volatile uint8_t g_msg[NUM_TEST_THREADS];
+
+
+/* Forward declarations */
+static void test_thread_func (uint32_t param);
+
+
+/**
+ * \b test_start
+ *
+ * Start queue test.
+ *
+ * This test exercises atomQueuePeek(), atomQueueCount() and
+ * atomQueueSpace(). Peeking must not remove messages, and every thread
+ * blocking in atomQueuePeek() on an empty queue must be woken with a copy
+ * of the next message posted, which stays on the queue. Peek timeouts and
+ * queue deletion while peeking are also checked.
+ *
+ * @retval Number of failures
+ */
+uint32_t test_start (void)
+{
+    int failures;
+    uint8_t msg;
+    uint32_t count, space;
+    int i;
+
+    /* Default to zero failures */
+    failures = 0;
+
+    /* Create test queue */
+    if (atomQueueCreate (&queue1, &queue1_storage[0], sizeof(queue1_storage[0]), QUEUE_ENTRIES) != ATOM_OK)
+    {
+        ATOMLOG (_STR("Error creating test queue\n"));
+        failures++;
+    }
+    else
+    {
+        /* Parameter checks */
+        if ((atomQueuePeek (NULL, -1, &msg) != ATOM_ERR_PARAM)
+            || (atomQueuePeek (&queue1, -1, NULL) != ATOM_ERR_PARAM)
+            || (atomQueueCount (NULL, &count) != ATOM_ERR_PARAM)
+            || (atomQueueCount (&queue1, NULL) != ATOM_ERR_PARAM)
+            || (atomQueueSpace (NULL, &space) != ATOM_ERR_PARAM)
+            || (atomQueueSpace (&queue1, NULL) != ATOM_ERR_PARAM))
+        {
+            ATOMLOG (_STR("Param checks\n"));
+            failures++;
+        }
+
+        /* Empty queue checks */
+        if ((atomQueuePeek (&queue1, -1, &msg) != ATOM_WOULDBLOCK)
+            || (atomQueueCount (&queue1, &count) != ATOM_OK) || (count != 0)
+            || (atomQueueSpace (&queue1, &space) != ATOM_OK) || (space != QUEUE_ENTRIES))
+        {
+            ATOMLOG (_STR("Empty checks\n"));
+            failures++;
+        }
+
+        /* Peek with timeout on an empty queue */
+        if (atomQueuePeek (&queue1, SYSTEM_TICKS_PER_SEC/10, &msg) != ATOM_TIMEOUT)
+        {
+            ATOMLOG (_STR("Peek timeout\n"));
+            failures++;
+        }
+
+        /* Post two messages and check peek does not consume them */
+        msg = 0x11;
+        (void)atomQueuePut (&queue1, -1, &msg);
+        msg = 0x22;
+        (void)atomQueuePut (&queue1, -1, &msg);
+        for (i = 0; i < 2; i++)
+        {
+            msg = 0;
+            if ((atomQueuePeek (&queue1, -1, &msg) != ATOM_OK) || (msg != 0x11))
+            {
+                ATOMLOG (_STR("Peek%d 0x%x\n"), i, msg);
+                failures++;
+            }
+        }
+        if ((atomQueueCount (&queue1, &count) != ATOM_OK) || (count != 2)
+            || (atomQueueSpace (&queue1, &space) != ATOM_OK) || (space != QUEUE_ENTRIES - 2))
+        {
+            ATOMLOG (_STR("Count %d space %d\n"), (int)count, (int)space);
+            failures++;
+        }
+
+        /* Peek sees an urgent message at the head */
+        msg = 0x33;
+        (void)atomQueuePutUrgent (&queue1, -1, &msg);
+        if ((atomQueuePeek (&queue1, -1, &msg) != ATOM_OK) || (msg != 0x33))
+        {
+            ATOMLOG (_STR("Urgent peek 0x%x\n"), msg);
+            failures++;
+        }
+
+        /* Drain the queue in order */
+        if ((atomQueueGet (&queue1, -1, &msg) != ATOM_OK) || (msg != 0x33)
+            || (atomQueueGet (&queue1, -1, &msg) != ATOM_OK) || (msg != 0x11)
+            || (atomQueueGet (&queue1, -1, &msg) != ATOM_OK) || (msg != 0x22))
+        {
+            ATOMLOG (_STR("Drain\n"));
+            failures++;
+        }
+
+        /* Create two higher priority threads to peek the empty queue */
+        for (i = 0; i < NUM_TEST_THREADS; i++)
+        {
+            g_status[i] = 0xFF;
+            g_msg[i] = 0;
+            if (atomThreadCreate(&tcb[i], TEST_THREAD_PRIO - 1, test_thread_func, i,
+                  &test_thread_stack[i][0],
+                  TEST_THREAD_STACK_SIZE, TRUE) != ATOM_OK)
+            {
+                ATOMLOG (_STR("Error creating test thread\n"));
+                failures++;
+            }
+        }
+
+        /* Let both threads block, then post one message */
+        atomTimerDelay (SYSTEM_TICKS_PER_SEC/4);
+        msg = 0x44;
+        if (atomQueuePut (&queue1, -1, &msg) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Wake put fail\n"));
+            failures++;
+        }
+
+        /**
+         * The peekers have run (they are higher priority) but must have
+         * left the message on the queue. Remove it before they peek again.
+         */
+        if ((atomQueueGet (&queue1, -1, &msg) != ATOM_OK) || (msg != 0x44))
+        {
+            ATOMLOG (_STR("Peeked msg lost\n"));
+            failures++;
+        }
+        atomTimerDelay (SYSTEM_TICKS_PER_SEC/4);
+
+        /* Both peekers should have seen the message */
+        for (i = 0; i < NUM_TEST_THREADS; i++)
+        {
+            if ((g_status[i] != ATOM_OK) || (g_msg[i] != 0x44))
+            {
+                ATOMLOG (_STR("Peeker%d %d 0x%x\n"), i, g_status[i], g_msg[i]);
+                failures++;
+            }
+        }
+
+        /* Both threads now peek again, deleting the queue should wake them */
+        if (atomQueueDelete (&queue1) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Delete failed\n"));
+            failures++;
+        }
+        atomTimerDelay (SYSTEM_TICKS_PER_SEC/4);
+        for (i = 0; i < NUM_TEST_THREADS; i++)
+        {
+            if (g_status[i] != ATOM_ERR_DELETED)
+            {
+                ATOMLOG (_STR("Delete wake%d %d\n"), i, g_status[i]);
+                failures++;
+            }
+        }
+    }
+
+    /* Check thread stack usage (if enabled) */
+#ifdef ATOM_STACK_CHECKING
+    {
+        uint32_t used_bytes, free_bytes;
+        int thread;
+
+        /* Check all threads */
+        for (thread = 0; thread < NUM_TEST_THREADS; thread++)
+        {
+            /* Check thread stack usage */
+            if (atomThreadStackCheck (&tcb[thread], &used_bytes, &free_bytes) != ATOM_OK)
+            {
+                ATOMLOG (_STR("StackCheck\n"));
+                failures++;
+            }
+            else
+            {
+                /* Check the thread did not use up to the end of stack */
+                if (free_bytes == 0)
+                {
+                    ATOMLOG (_STR("StackOverflow %d\n"), thread);
+                    failures++;
+                }
+
+                /* Log the stack usage */
+#ifdef TESTS_LOG_STACK_USAGE
+                ATOMLOG (_STR("StackUse:%d\n"), (int)used_bytes);
+#endif
+            }
+        }
+    }
+#endif
+
+    /* Quit */
+    return failures;
+}
+
+
+/**
+ * \b test_thread_func
+ *
+ * Entry point for test thread.
+ *
+ * @param[in] param Index of this thread's result slots
+ *
+ * @return None
+ */
+static void test_thread_func (uint32_t param)
+{
+    uint8_t msg;
+    uint8_t status;
+
+    /* Peek the queue until it is deleted, recording each result */
+    do
+    {
+        msg = 0;
+        status = atomQueuePeek (&queue1, 0, &msg);
+        g_msg[param] = msg;
+        g_status[param] = status;
+
+        /* Give the main thread time to consume the message */
+        if (status == ATOM_OK)
+            atomTimerDelay (SYSTEM_TICKS_PER_SEC/8);
+    } while (status == ATOM_OK);
+
+    /* Loop forever */
+    while (1)
+    {
+        atomTimerDelay (SYSTEM_TICKS_PER_SEC);
+    }
+}
@@ -0,0 +1,273 @@
+/*
+ * Copyright (c) 2022, Matt Liss
+ * Copyright (c) 2010, Kelvin Lawson. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. No personal names or organizations' names associated with the
+ *    Atomthreads project may be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE ATOMTHREADS PROJECT AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "atom.h"
+#include "atomqueue.h"
+#include "atomtests.h"
+
+
+/* Test queue size */
+#define QUEUE_ENTRIES       2
+
+
+/* Number of test threads */
+#define NUM_TEST_THREADS    2
+
+
+/* Test OS objects */
+static ATOM_QUEUE queue1;
+static uint8_t queue1_storage[QUEUE_ENTRIES];
+static ATOM_TCB tcb[NUM_TEST_THREADS];
+static uint8_t test_thread_stack[NUM_TEST_THREADS][TEST_THREAD_STACK_SIZE];
+
+
+/* Test result tracking */
+static volatile uint8_t g_get_status, g_put_status;
+static volatile uint8_t g_get_msg;
+
+
+/* Forward declarations */
+static void get_thread_func (uint32_t param);
+static void put_thread_func (uint32_t param);
+
+
+/**
+ * \b test_start
+ *
+ * Start queue test.
+ *
+ * This tests that messages are handed directly between threads when one
+ * side is already blocked. The blocked threads are of lower priority than
+ * the main thread, so they are not scheduled in until it sleeps, and the
+ * main thread can check that each operation was completed on the blocked
+ * thread's behalf at the time of the put or get:
+ *
+ * A put to an empty queue with a receiver blocked must leave the queue
+ * empty, with the message already given to the receiver. A get from a
+ * full queue with a sender blocked must leave the queue full, with the
+ * sender's (urgent) message already posted.
+ *
+ * @retval Number of failures
+ */
+uint32_t test_start (void)
+{
+    int failures;
+    uint8_t msg;
+    uint32_t count;
+
+    /* Default to zero failures */
+    failures = 0;
+    g_get_status = g_put_status = 0xFF;
+
+    /* Create test queue */
+    if (atomQueueCreate (&queue1, &queue1_storage[0], sizeof(queue1_storage[0]), QUEUE_ENTRIES) != ATOM_OK)
+    {
+        ATOMLOG (_STR("Error creating test queue\n"));
+        failures++;
+        return failures;
+    }
+
+    /* Create a lower priority receiver and let it block */
+    if (atomThreadCreate(&tcb[0], TEST_THREAD_PRIO + 1, get_thread_func, 0,
+          &test_thread_stack[0][0],
+          TEST_THREAD_STACK_SIZE, TRUE) != ATOM_OK)
+    {
+        ATOMLOG (_STR("Error creating get thread\n"));
+        failures++;
+    }
+    atomTimerDelay (SYSTEM_TICKS_PER_SEC/10);
+
+    /* Put two messages: the first goes straight to the receiver */
+    msg = 0x11;
+    (void)atomQueuePut (&queue1, -1, &msg);
+    msg = 0x22;
+    (void)atomQueuePut (&queue1, -1, &msg);
+    if ((atomQueueCount (&queue1, &count) != ATOM_OK) || (count != 1))
+    {
+        ATOMLOG (_STR("Receiver handoff count %d\n"), (int)count);
+        failures++;
+    }
+
+    /* Let the receiver run and check it got the first message */
+    atomTimerDelay (SYSTEM_TICKS_PER_SEC/10);
+    if ((g_get_status != ATOM_OK) || (g_get_msg != 0x11))
+    {
+        ATOMLOG (_STR("Receiver got 0x%x (%d)\n"), g_get_msg, g_get_status);
+        failures++;
+    }
+
+    /* Fill the queue (0x22, 0x33) and let a lower priority sender block */
+    msg = 0x33;
+    (void)atomQueuePut (&queue1, -1, &msg);
+    if (atomThreadCreate(&tcb[1], TEST_THREAD_PRIO + 1, put_thread_func, 0,
+          &test_thread_stack[1][0],
+          TEST_THREAD_STACK_SIZE, TRUE) != ATOM_OK)
+    {
+        ATOMLOG (_STR("Error creating put thread\n"));
+        failures++;
+    }
+    atomTimerDelay (SYSTEM_TICKS_PER_SEC/10);
+
+    /* A get makes space, which the sender's message fills immediately */
+    if ((atomQueueGet (&queue1, -1, &msg) != ATOM_OK) || (msg != 0x22))
+    {
+        ATOMLOG (_STR("Get 0x%x\n"), msg);
+        failures++;
+    }
+    if ((atomQueueCount (&queue1, &count) != ATOM_OK) || (count != QUEUE_ENTRIES))
+    {
+        ATOMLOG (_STR("Sender handoff count %d\n"), (int)count);
+        failures++;
+    }
+
+    /* Nobody else can now post ahead of the sender */
+    msg = 0x55;
+    if (atomQueuePut (&queue1, -1, &msg) != ATOM_WOULDBLOCK)
+    {
+        ATOMLOG (_STR("Space stolen\n"));
+        failures++;
+    }
+
+    /* The sender's urgent message was posted at the head */
+    if ((atomQueueGet (&queue1, -1, &msg) != ATOM_OK) || (msg != 0x44)
+        || (atomQueueGet (&queue1, -1, &msg) != ATOM_OK) || (msg != 0x33))
+    {
+        ATOMLOG (_STR("Sender ordering\n"));
+        failures++;
+    }
+
+    /* Let the sender run and check its status */
+    atomTimerDelay (SYSTEM_TICKS_PER_SEC/10);
+    if (g_put_status != ATOM_OK)
+    {
+        ATOMLOG (_STR("Sender status %d\n"), g_put_status);
+        failures++;
+    }
+
+    /* Delete queue, test finished */
+    if (atomQueueDelete (&queue1) != ATOM_OK)
+    {
+        ATOMLOG (_STR("Delete failed\n"));
+        failures++;
+    }
+
+    /* Check thread stack usage (if enabled) */
+#ifdef ATOM_STACK_CHECKING
+    {
+        uint32_t used_bytes, free_bytes;
+        int thread;
+
+        /* Check all threads */
+        for (thread = 0; thread < NUM_TEST_THREADS; thread++)
+        {
+            /* Check thread stack usage */
+            if (atomThreadStackCheck (&tcb[thread], &used_bytes, &free_bytes) != ATOM_OK)
+            {
+                ATOMLOG (_STR("StackCheck\n"));
+                failures++;
+            }
+            else
+            {
+                /* Check the thread did not use up to the end of stack */
+                if (free_bytes == 0)
+                {
+                    ATOMLOG (_STR("StackOverflow %d\n"), thread);
+                    failures++;
+                }
+
+                /* Log the stack usage */
+#ifdef TESTS_LOG_STACK_USAGE
+                ATOMLOG (_STR("StackUse:%d\n"), (int)used_bytes);
+#endif
+            }
+        }
+    }
+#endif
+
+    /* Quit */
+    return failures;
+}
+
+
+/**
+ * \b get_thread_func
+ *
+ * Entry point for the receiver thread.
+ *
+ * @param[in] param Unused (optional thread entry parameter)
+ *
+ * @return None
+ */
+static void get_thread_func (uint32_t param)
+{
+    uint8_t msg;
+
+    /* Compiler warnings */
+    param = param;
+
+    /* Block on the empty queue */
+    g_get_status = atomQueueGet (&queue1, 0, &msg);
+    g_get_msg = msg;
+
+    /* Loop forever */
+    while (1)
+    {
+        atomTimerDelay (SYSTEM_TICKS_PER_SEC);
+    }
+}
+
+
+/**
+ * \b put_thread_func
+ *
+ * Entry point for the sender thread.
+ *
+ * @param[in] param Unused (optional thread entry parameter)
+ *
+ * @return None
+ */
+static void put_thread_func (uint32_t param)
+{
+    uint8_t msg;
+
+    /* Compiler warnings */
+    param = param;
+
+    /* Block on the full queue with an urgent message */
+    msg = 0x44;
+    g_put_status = atomQueuePutUrgent (&queue1, 0, &msg);
+
+    /* Loop forever */
+    while (1)
+    {
+        atomTimerDelay (SYSTEM_TICKS_PER_SEC);
+    }
+}
@@ -0,0 +1,248 @@
+/*
+ * Copyright (c) 2022, Matt Liss
+ * Copyright (c) 2010, Kelvin Lawson. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. No personal names or organizations' names associated with the
+ *    Atomthreads project may be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE ATOMTHREADS PROJECT AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "atom.h"
+#include "atomqueue.h"
+#include "atomtests.h"
+
+
+/* Test queue size */
+#define QUEUE_ENTRIES       2
+#define QUEUE_LEVELS        2
+
+
+/* Number of test threads */
+#define NUM_TEST_THREADS    2
+
+
+/* Test OS objects */
+static ATOM_QUEUE queue1;
+static ATOM_QUEUE_LEVEL queue1_levels[QUEUE_LEVELS];
+static uint8_t queue1_storage[QUEUE_ENTRIES];
+static uint32_t queue1_links[QUEUE_ENTRIES];
+static ATOM_TCB tcb[NUM_TEST_THREADS];
+static uint8_t test_thread_stack[NUM_TEST_THREADS][TEST_THREAD_STACK_SIZE];
+
+
+/* Data updated by threads */
+static volatile uint8_t wake_status[NUM_TEST_THREADS];
+static volatile uint8_t wake_cnt[NUM_TEST_THREADS];
+
+
+/* Forward declarations */
+static void test_thread_func (uint32_t param);
+
+
+/**
+ * \b test_start
+ *
+ * Start queue test.
+ *
+ * This tests atomQueueFlush(). A priority queue is filled, then two threads
+ * block trying to post further messages, one forever and one with a
+ * timeout. Flushing the queue should discard the stored messages and wake
+ * both senders with ATOM_ERR_DELETED, without posting their messages. The
+ * queue should be empty and usable afterwards.
+ *
+ * @retval Number of failures
+ */
+uint32_t test_start (void)
+{
+    int failures;
+    int i;
+    uint8_t msg;
+    uint32_t count;
+
+    /* Default to zero failures */
+    failures = 0;
+
+    /* Check parameter */
+    if (atomQueueFlush (NULL) != ATOM_ERR_PARAM)
+    {
+        ATOMLOG (_STR("Param\n"));
+        failures++;
+    }
+
+    /* Create test queue */
+    if (atomQueueCreatePriority (&queue1, &queue1_storage[0], sizeof(queue1_storage[0]),
+            QUEUE_ENTRIES, &queue1_links[0], &queue1_levels[0], QUEUE_LEVELS) != ATOM_OK)
+    {
+        ATOMLOG (_STR("Error creating test queue\n"));
+        failures++;
+        return failures;
+    }
+
+    /* Fill the queue at the lower priority level */
+    for (i = 0; i < QUEUE_ENTRIES; i++)
+    {
+        msg = 0x10 + i;
+        if (atomQueuePutPriority (&queue1, -1, 1, &msg) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Put %d\n"), i);
+            failures++;
+        }
+    }
+
+    /* Create the test threads, which block trying to post */
+    for (i = 0; i < NUM_TEST_THREADS; i++)
+    {
+        wake_status[i] = 0xFF;
+        wake_cnt[i] = 0;
+        if (atomThreadCreate(&tcb[i], TEST_THREAD_PRIO - 1, test_thread_func, i,
+              &test_thread_stack[i][0],
+              TEST_THREAD_STACK_SIZE, TRUE) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Error creating test thread %d\n"), i);
+            failures++;
+        }
+    }
+
+    /* Give the threads time to block */
+    atomTimerDelay (SYSTEM_TICKS_PER_SEC/4);
+
+    /* Flush the queue */
+    if (atomQueueFlush (&queue1) != ATOM_OK)
+    {
+        ATOMLOG (_STR("Flush\n"));
+        failures++;
+    }
+
+    /* Both senders should have been woken with ATOM_ERR_DELETED */
+    for (i = 0; i < NUM_TEST_THREADS; i++)
+    {
+        if ((wake_cnt[i] != 1) || (wake_status[i] != ATOM_ERR_DELETED))
+        {
+            ATOMLOG (_STR("Thread %d woke %d (%d)\n"), i, wake_cnt[i], wake_status[i]);
+            failures++;
+        }
+    }
+
+    /* The queue should now be empty, including the senders' messages */
+    if ((atomQueueCount (&queue1, &count) != ATOM_OK) || (count != 0)
+        || (atomQueueGet (&queue1, -1, &msg) != ATOM_WOULDBLOCK))
+    {
+        ATOMLOG (_STR("Not empty\n"));
+        failures++;
+    }
+
+    /* Wait past the original timeout, nothing else should happen */
+    atomTimerDelay (SYSTEM_TICKS_PER_SEC);
+    if ((wake_cnt[0] != 1) || (wake_cnt[1] != 1))
+    {
+        ATOMLOG (_STR("Rewoke\n"));
+        failures++;
+    }
+
+    /* The queue is still usable, with both levels reset */
+    msg = 0x30;
+    (void)atomQueuePutPriority (&queue1, -1, 1, &msg);
+    msg = 0x40;
+    (void)atomQueuePutPriority (&queue1, -1, 0, &msg);
+    if ((atomQueueGet (&queue1, -1, &msg) != ATOM_OK) || (msg != 0x40)
+        || (atomQueueGet (&queue1, -1, &msg) != ATOM_OK) || (msg != 0x30)
+        || (atomQueueGet (&queue1, -1, &msg) != ATOM_WOULDBLOCK))
+    {
+        ATOMLOG (_STR("Reuse\n"));
+        failures++;
+    }
+
+    /* Delete queue, test finished */
+    if (atomQueueDelete (&queue1) != ATOM_OK)
+    {
+        ATOMLOG (_STR("Delete failed\n"));
+        failures++;
+    }
+
+    /* Check thread stack usage (if enabled) */
+#ifdef ATOM_STACK_CHECKING
+    {
+        uint32_t used_bytes, free_bytes;
+        int thread;
+
+        /* Check all threads */
+        for (thread = 0; thread < NUM_TEST_THREADS; thread++)
+        {
+            /* Check thread stack usage */
+            if (atomThreadStackCheck (&tcb[thread], &used_bytes, &free_bytes) != ATOM_OK)
+            {
+                ATOMLOG (_STR("StackCheck\n"));
+                failures++;
+            }
+            else
+            {
+                /* Check the thread did not use up to the end of stack */
+                if (free_bytes == 0)
+                {
+                    ATOMLOG (_STR("StackOverflow %d\n"), thread);
+                    failures++;
+                }
+
+                /* Log the stack usage */
+#ifdef TESTS_LOG_STACK_USAGE
+                ATOMLOG (_STR("StackUse:%d\n"), (int)used_bytes);
+#endif
+            }
+        }
+    }
+#endif
+
+    /* Quit */
+    return failures;
+}
+
+
+/**
+ * \b test_thread_func
+ *
+ * Entry point for test thread. Thread 0 blocks forever trying to post,
+ * thread 1 blocks with a timeout of half a second.
+ *
+ * @param[in] param Thread number
+ *
+ * @return None
+ */
+static void test_thread_func (uint32_t param)
+{
+    uint8_t msg;
+    int32_t timeout;
+
+    /* Block trying to post to the full queue */
+    msg = 0x20 + (uint8_t)param;
+    timeout = param ? (SYSTEM_TICKS_PER_SEC/2) : 0;
+    wake_status[param] = atomQueuePutPriority (&queue1, timeout, 0, &msg);
+    wake_cnt[param]++;
+
+    /* Loop forever */
+    while (1)
+    {
+        atomTimerDelay (SYSTEM_TICKS_PER_SEC);
+    }
+}
@@ -0,0 +1,256 @@
+/*
+ * Copyright (c) 2022, Matt Liss
+ * Copyright (c) 2010, Kelvin Lawson. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. No personal names or organizations' names associated with the
+ *    Atomthreads project may be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE ATOMTHREADS PROJECT AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "atom.h"
+#include "atomqueue.h"
+#include "atomtests.h"
+
+
+/* Test queue size */
+#define QUEUE_ENTRIES       3
+
+
+/* Number of test threads */
+#define NUM_TEST_THREADS    1
+
+
+/* Delay used for timing measurements */
+#define TEST_DELAY          (SYSTEM_TICKS_PER_SEC/10)
+
+
+/* Test OS objects */
+static ATOM_QUEUE queue1;
+static uint8_t queue1_storage[QUEUE_ENTRIES];
+static ATOM_QUEUE_STATS queue1_stats;
+static uint32_t queue1_timestamps[QUEUE_ENTRIES];
+static ATOM_TCB tcb[NUM_TEST_THREADS];
+static uint8_t test_thread_stack[NUM_TEST_THREADS][TEST_THREAD_STACK_SIZE];
+
+
+/* Forward declarations */
+static void test_thread_func (uint32_t param);
+
+
+/**
+ * \b test_start
+ *
+ * Start queue test.
+ *
+ * This tests the queue statistics. A queue with statistics and latency
+ * timestamps enabled is filled, overflowed, drained after a delay, and
+ * then used by a thread which blocks waiting for a message. The high-water
+ * mark, blocked and ATOM_WOULDBLOCK counts, blocked time and latency are
+ * then checked, together with the reset performed by atomQueueStatsRead().
+ *
+ * @retval Number of failures
+ */
+uint32_t test_start (void)
+{
+    int failures;
+    int i;
+    uint8_t msg;
+    ATOM_QUEUE_STATS stats;
+
+    /* Default to zero failures */
+    failures = 0;
+
+    /* Create test queue */
+    if (atomQueueCreate (&queue1, &queue1_storage[0], sizeof(queue1_storage[0]), QUEUE_ENTRIES) != ATOM_OK)
+    {
+        ATOMLOG (_STR("Error creating test queue\n"));
+        failures++;
+        return failures;
+    }
+
+    /* Check statistics are off by default */
+    if (atomQueueStatsRead (&queue1, &stats, FALSE) != ATOM_ERR_NOT_FOUND)
+    {
+        ATOMLOG (_STR("Default on\n"));
+        failures++;
+    }
+
+    /* Enable statistics */
+    if ((atomQueueStatsEnable (NULL, &queue1_stats, NULL) != ATOM_ERR_PARAM)
+        || (atomQueueStatsEnable (&queue1, NULL, &queue1_timestamps[0]) != ATOM_ERR_PARAM)
+        || (atomQueueStatsEnable (&queue1, &queue1_stats, &queue1_timestamps[0]) != ATOM_OK))
+    {
+        ATOMLOG (_STR("Enable\n"));
+        failures++;
+    }
+
+    /* Fill the queue, then try to overflow it */
+    for (i = 0; i < QUEUE_ENTRIES; i++)
+    {
+        msg = i;
+        (void)atomQueuePut (&queue1, -1, &msg);
+    }
+    if (atomQueuePut (&queue1, -1, &msg) != ATOM_WOULDBLOCK)
+    {
+        ATOMLOG (_STR("Overflow\n"));
+        failures++;
+    }
+
+    /* Leave the messages in the queue for a while, then drain it */
+    atomTimerDelay (TEST_DELAY);
+    for (i = 0; i < QUEUE_ENTRIES; i++)
+    {
+        (void)atomQueueGet (&queue1, -1, &msg);
+    }
+    if (atomQueueGet (&queue1, -1, &msg) != ATOM_WOULDBLOCK)
+    {
+        ATOMLOG (_STR("Underflow\n"));
+        failures++;
+    }
+
+    /* Create a higher priority thread which blocks on the empty queue */
+    if (atomThreadCreate(&tcb[0], TEST_THREAD_PRIO - 1, test_thread_func, 0,
+          &test_thread_stack[0][0],
+          TEST_THREAD_STACK_SIZE, TRUE) != ATOM_OK)
+    {
+        ATOMLOG (_STR("Error creating test thread\n"));
+        failures++;
+    }
+
+    /* Keep it waiting for a while, then post it a message */
+    atomTimerDelay (TEST_DELAY);
+    msg = 0x55;
+    (void)atomQueuePut (&queue1, -1, &msg);
+
+    /* Read and reset the statistics */
+    if (atomQueueStatsRead (&queue1, &stats, TRUE) != ATOM_OK)
+    {
+        ATOMLOG (_STR("Read\n"));
+        failures++;
+    }
+    else
+    {
+        if ((stats.max_msgs_stored != QUEUE_ENTRIES)
+            || (stats.put_wouldblock != 1) || (stats.put_blocked != 0)
+            || (stats.get_wouldblock != 1) || (stats.get_blocked != 1))
+        {
+            ATOMLOG (_STR("Counts\n"));
+            failures++;
+        }
+        if ((stats.get_wait_ticks < TEST_DELAY - 1)
+            || (stats.get_wait_max != stats.get_wait_ticks)
+            || (stats.put_wait_ticks != 0))
+        {
+            ATOMLOG (_STR("Wait %d\n"), (int)stats.get_wait_ticks);
+            failures++;
+        }
+        if ((stats.latency_count != QUEUE_ENTRIES + 1)
+            || (stats.latency_max < TEST_DELAY)
+            || (stats.latency_ticks < (QUEUE_ENTRIES * TEST_DELAY)))
+        {
+            ATOMLOG (_STR("Latency %d\n"), (int)stats.latency_max);
+            failures++;
+        }
+    }
+
+    /* Check the statistics were reset */
+    if ((atomQueueStatsRead (&queue1, &stats, FALSE) != ATOM_OK)
+        || (stats.max_msgs_stored != 0) || (stats.get_blocked != 0)
+        || (stats.latency_count != 0) || (stats.get_wait_max != 0))
+    {
+        ATOMLOG (_STR("Reset\n"));
+        failures++;
+    }
+
+    /* Delete queue, test finished */
+    if (atomQueueDelete (&queue1) != ATOM_OK)
+    {
+        ATOMLOG (_STR("Delete failed\n"));
+        failures++;
+    }
+
+    /* Check thread stack usage (if enabled) */
+#ifdef ATOM_STACK_CHECKING
+    {
+        uint32_t used_bytes, free_bytes;
+        int thread;
+
+        /* Check all threads */
+        for (thread = 0; thread < NUM_TEST_THREADS; thread++)
+        {
+            /* Check thread stack usage */
+            if (atomThreadStackCheck (&tcb[thread], &used_bytes, &free_bytes) != ATOM_OK)
+            {
+                ATOMLOG (_STR("StackCheck\n"));
+                failures++;
+            }
+            else
+            {
+                /* Check the thread did not use up to the end of stack */
+                if (free_bytes == 0)
+                {
+                    ATOMLOG (_STR("StackOverflow %d\n"), thread);
+                    failures++;
+                }
+
+                /* Log the stack usage */
+#ifdef TESTS_LOG_STACK_USAGE
+                ATOMLOG (_STR("StackUse:%d\n"), (int)used_bytes);
+#endif
+            }
+        }
+    }
+#endif
+
+    /* Quit */
+    return failures;
+}
+
+
+/**
+ * \b test_thread_func
+ *
+ * Entry point for test thread.
+ *
+ * @param[in] param Unused (optional thread entry parameter)
+ *
+ * @return None
+ */
+static void test_thread_func (uint32_t param)
+{
+    uint8_t msg;
+
+    /* Compiler warnings */
+    param = param;
+
+    /* Block waiting for a message */
+    (void)atomQueueGet (&queue1, 0, &msg);
+
+    /* Loop forever */
+    while (1)
+    {
+        atomTimerDelay (SYSTEM_TICKS_PER_SEC);
+    }
+}
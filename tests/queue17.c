@@ -0,0 +1,193 @@
+/*
+ * Copyright (c) 2010, Kelvin Lawson. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. No personal names or organizations' names associated with the
+ *    Atomthreads project may be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE ATOMTHREADS PROJECT AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "atom.h"
+#include "atomqueue.h"
+#include "atomtimer.h"
+#include "atomtests.h"
+
+
+/* Ticks until the receiver's timeout, and the callback posting the message */
+#define TIMEOUT_TICKS         5
+
+
+/* Test message */
+#define TEST_MSG              0x5A
+
+
+/* Test OS objects */
+static ATOM_QUEUE queue1;
+static uint8_t queue1_storage[1];
+static ATOM_TCB tcb;
+static ATOM_TIMER timer_cb;
+static uint8_t test_thread_stack[TEST_THREAD_STACK_SIZE];
+
+
+/* Test results */
+static volatile int wake_count;
+static volatile uint8_t wake_status;
+static volatile uint8_t received_msg;
+static volatile uint8_t put_status;
+
+
+/* Forward declarations */
+static void test_thread_func (uint32_t param);
+static void testCallback (POINTER cb_data);
+
+
+/**
+ * \b test_start
+ *
+ * Start queue test.
+ *
+ * This test posts a message from a timer callback which expires on the
+ * same tick as the timeout of a thread blocking to receive. The message is
+ * handed straight to the receiver, which must have its expired timeout
+ * removed first, so the receiver is woken exactly once with the message
+ * and ATOM_OK and the message is not also left on the queue.
+ *
+ * @retval Number of failures
+ */
+uint32_t test_start (void)
+{
+    int failures;
+    uint8_t msg;
+
+    /* Default to zero failures */
+    failures = 0;
+    wake_count = 0;
+    put_status = 0xFF;
+
+    if (atomQueueCreate (&queue1, &queue1_storage[0], sizeof(uint8_t), 1) != ATOM_OK)
+    {
+        ATOMLOG (_STR("Error creating test queue\n"));
+        failures++;
+    }
+    else
+    {
+        /* Start on a tick boundary so both timers are registered on one tick */
+        atomTimerDelay (1);
+
+        /* Register the posting callback first so it is called back first */
+        timer_cb.cb_func = testCallback;
+        timer_cb.cb_data = (POINTER)&queue1;
+        timer_cb.cb_ticks = TIMEOUT_TICKS;
+        if (atomTimerRegister (&timer_cb) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Error registering timer\n"));
+            failures++;
+        }
+
+        /* Create a higher priority thread which blocks with the same timeout */
+        else if (atomThreadCreate(&tcb, TEST_THREAD_PRIO - 1, test_thread_func, 0,
+                  &test_thread_stack[0],
+                  TEST_THREAD_STACK_SIZE, TRUE) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Error creating test thread\n"));
+            failures++;
+        }
+        else
+        {
+            /* Our delay must still expire after the post */
+            if (atomTimerDelay (TIMEOUT_TICKS * 2) != ATOM_OK)
+            {
+                ATOMLOG (_STR("Delay\n"));
+                failures++;
+            }
+
+            /* The thread must have been woken once, with the message */
+            if ((put_status != ATOM_OK) || (wake_count != 1)
+                || (wake_status != ATOM_OK) || (received_msg != TEST_MSG))
+            {
+                ATOMLOG (_STR("Wake %d status %d\n"), wake_count, (int)wake_status);
+                failures++;
+            }
+
+            /* The message must not also have been stored on the queue */
+            if (atomQueueGet (&queue1, -1, &msg) != ATOM_WOULDBLOCK)
+            {
+                ATOMLOG (_STR("Stored\n"));
+                failures++;
+            }
+        }
+    }
+
+    /* Quit */
+    return failures;
+
+}
+
+
+/**
+ * \b test_thread_func
+ *
+ * Entry point for test thread.
+ *
+ * @param[in] param Unused (optional thread entry parameter)
+ *
+ * @return None
+ */
+static void test_thread_func (uint32_t param)
+{
+    uint8_t msg;
+
+    /* Compiler warnings */
+    param = param;
+
+    /* Block for a message with the timeout */
+    msg = 0;
+    wake_status = atomQueueGet (&queue1, TIMEOUT_TICKS, &msg);
+    received_msg = msg;
+    wake_count++;
+
+    /* Loop forever */
+    while (1)
+    {
+        atomTimerDelay (SYSTEM_TICKS_PER_SEC);
+    }
+}
+
+
+/**
+ * \b testCallback
+ *
+ * Timer callback. Posts the test message.
+ *
+ * @param[in] cb_data Pointer to the queue
+ *
+ * @return None
+ */
+static void testCallback (POINTER cb_data)
+{
+    uint8_t msg;
+
+    msg = TEST_MSG;
+    put_status = atomQueuePut ((ATOM_QUEUE *)cb_data, -1, &msg);
+}
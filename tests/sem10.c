@@ -0,0 +1,216 @@
+/*
+ * Copyright (c) 2010, Kelvin Lawson. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. No personal names or organizations' names associated with the
+ *    Atomthreads project may be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE ATOMTHREADS PROJECT AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "atom.h"
+#include "atomtests.h"
+#include "atomsem.h"
+
+
+/* Number of test threads */
+#define NUM_TEST_THREADS      4
+
+
+/* Test OS objects */
+static ATOM_SEM sem1;
+static ATOM_TCB tcb[NUM_TEST_THREADS];
+static uint8_t test_thread_stack[NUM_TEST_THREADS][TEST_THREAD_STACK_SIZE];
+
+
+/* Data updated by threads */
+static volatile uint8_t wake_status[NUM_TEST_THREADS];
+static volatile uint8_t wake_cnt[NUM_TEST_THREADS];
+
+
+/* Forward declarations */
+static void test_thread_func (uint32_t param);
+
+
+/**
+ * \b test_start
+ *
+ * Start semaphore test.
+ *
+ * This tests atomSemFlush(). Four threads block on a semaphore, two of them
+ * forever and two with timeouts. Flushing the semaphore should wake all of
+ * them with ATOM_ERR_DELETED and set the new count, with the semaphore
+ * still usable afterwards.
+ *
+ * The timeouts of the woken threads must also have been removed from the
+ * timer list, so we check that nothing happens to the woken threads when
+ * their timeouts would have expired, and that timer delays still work.
+ *
+ * @retval Number of failures
+ */
+uint32_t test_start (void)
+{
+    int failures;
+    int i;
+
+    /* Default to zero failures */
+    failures = 0;
+
+    /* Check parameter */
+    if (atomSemFlush (NULL, 0) != ATOM_ERR_PARAM)
+    {
+        ATOMLOG (_STR("Param\n"));
+        failures++;
+    }
+
+    /* Create semaphore with count zero */
+    if (atomSemCreate (&sem1, 0) != ATOM_OK)
+    {
+        ATOMLOG (_STR("Error creating test semaphore 1\n"));
+        failures++;
+        return failures;
+    }
+
+    /* Create the test threads, which all block on the semaphore */
+    for (i = 0; i < NUM_TEST_THREADS; i++)
+    {
+        wake_status[i] = 0xFF;
+        wake_cnt[i] = 0;
+        if (atomThreadCreate(&tcb[i], TEST_THREAD_PRIO - 1, test_thread_func, i,
+              &test_thread_stack[i][0],
+              TEST_THREAD_STACK_SIZE, TRUE) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Error creating test thread %d\n"), i);
+            failures++;
+        }
+    }
+
+    /* Give the threads time to block */
+    atomTimerDelay (SYSTEM_TICKS_PER_SEC/4);
+
+    /* Flush the semaphore, setting a count of one */
+    if (atomSemFlush (&sem1, 1) != ATOM_OK)
+    {
+        ATOMLOG (_STR("Flush\n"));
+        failures++;
+    }
+
+    /* All threads should have been woken with ATOM_ERR_DELETED */
+    for (i = 0; i < NUM_TEST_THREADS; i++)
+    {
+        if ((wake_cnt[i] != 1) || (wake_status[i] != ATOM_ERR_DELETED))
+        {
+            ATOMLOG (_STR("Thread %d woke %d (%d)\n"), i, wake_cnt[i], wake_status[i]);
+            failures++;
+        }
+    }
+
+    /* Wait past the original timeouts, nothing else should happen */
+    atomTimerDelay (SYSTEM_TICKS_PER_SEC);
+    for (i = 0; i < NUM_TEST_THREADS; i++)
+    {
+        if (wake_cnt[i] != 1)
+        {
+            ATOMLOG (_STR("Thread %d rewoke\n"), i);
+            failures++;
+        }
+    }
+
+    /* The semaphore is still usable, with the new count */
+    if ((atomSemGet (&sem1, -1) != ATOM_OK)
+        || (atomSemGet (&sem1, -1) != ATOM_WOULDBLOCK))
+    {
+        ATOMLOG (_STR("Count\n"));
+        failures++;
+    }
+
+    /* Delete semaphore, test finished */
+    if (atomSemDelete (&sem1) != ATOM_OK)
+    {
+        ATOMLOG (_STR("Delete failed\n"));
+        failures++;
+    }
+
+    /* Check thread stack usage (if enabled) */
+#ifdef ATOM_STACK_CHECKING
+    {
+        uint32_t used_bytes, free_bytes;
+        int thread;
+
+        /* Check all threads */
+        for (thread = 0; thread < NUM_TEST_THREADS; thread++)
+        {
+            /* Check thread stack usage */
+            if (atomThreadStackCheck (&tcb[thread], &used_bytes, &free_bytes) != ATOM_OK)
+            {
+                ATOMLOG (_STR("StackCheck\n"));
+                failures++;
+            }
+            else
+            {
+                /* Check the thread did not use up to the end of stack */
+                if (free_bytes == 0)
+                {
+                    ATOMLOG (_STR("StackOverflow %d\n"), thread);
+                    failures++;
+                }
+
+                /* Log the stack usage */
+#ifdef TESTS_LOG_STACK_USAGE
+                ATOMLOG (_STR("StackUse:%d\n"), (int)used_bytes);
+#endif
+            }
+        }
+    }
+#endif
+
+    /* Quit */
+    return failures;
+}
+
+
+/**
+ * \b test_thread_func
+ *
+ * Entry point for test thread. Odd numbered threads block with a timeout
+ * of half a second, even numbered threads block forever.
+ *
+ * @param[in] param Thread number
+ *
+ * @return None
+ */
+static void test_thread_func (uint32_t param)
+{
+    int32_t timeout;
+
+    /* Block on the semaphore */
+    timeout = (param & 1) ? (SYSTEM_TICKS_PER_SEC/2) : 0;
+    wake_status[param] = atomSemGet (&sem1, timeout);
+    wake_cnt[param]++;
+
+    /* Loop forever */
+    while (1)
+    {
+        atomTimerDelay (SYSTEM_TICKS_PER_SEC);
+    }
+}
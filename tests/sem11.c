@@ -0,0 +1,169 @@
+/*
+ * Copyright (c) 2010, Kelvin Lawson. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. No personal names or organizations' names associated with the
+ *    Atomthreads project may be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE ATOMTHREADS PROJECT AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "atom.h"
+#include "atomsem.h"
+#include "atomtimer.h"
+#include "atomtests.h"
+
+
+/* Ticks until the waiter's timeout, and the callback deleting the semaphore */
+#define TIMEOUT_TICKS         5
+
+
+/* Test OS objects */
+static ATOM_SEM sem1;
+static ATOM_TCB tcb;
+static ATOM_TIMER timer_cb;
+static uint8_t test_thread_stack[TEST_THREAD_STACK_SIZE];
+
+
+/* Test results */
+static volatile int wake_count;
+static volatile uint8_t wake_status;
+
+
+/* Forward declarations */
+static void test_thread_func (uint32_t param);
+static void testCallback (POINTER cb_data);
+
+
+/**
+ * \b test_start
+ *
+ * Start semaphore test.
+ *
+ * This test deletes a semaphore from a timer callback which expires on the
+ * same tick as the timeout of a thread blocking on the semaphore. The
+ * deletion must remove the thread's expired timeout before its callback is
+ * made, so the thread is woken exactly once with ATOM_ERR_DELETED, and the
+ * other outstanding timers (here our own delay) must be unaffected.
+ *
+ * @retval Number of failures
+ */
+uint32_t test_start (void)
+{
+    int failures;
+
+    /* Default to zero failures */
+    failures = 0;
+    wake_count = 0;
+
+    if (atomSemCreate (&sem1, 0) != ATOM_OK)
+    {
+        ATOMLOG (_STR("Error creating test semaphore\n"));
+        failures++;
+    }
+    else
+    {
+        /* Start on a tick boundary so both timers are registered on one tick */
+        atomTimerDelay (1);
+
+        /* Register the deleting callback first so it is called back first */
+        timer_cb.cb_func = testCallback;
+        timer_cb.cb_data = (POINTER)&sem1;
+        timer_cb.cb_ticks = TIMEOUT_TICKS;
+        if (atomTimerRegister (&timer_cb) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Error registering timer\n"));
+            failures++;
+        }
+
+        /* Create a higher priority thread which blocks with the same timeout */
+        else if (atomThreadCreate(&tcb, TEST_THREAD_PRIO - 1, test_thread_func, 0,
+                  &test_thread_stack[0],
+                  TEST_THREAD_STACK_SIZE, TRUE) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Error creating test thread\n"));
+            failures++;
+        }
+        else
+        {
+            /* Our delay must still expire after the deletion */
+            if (atomTimerDelay (TIMEOUT_TICKS * 2) != ATOM_OK)
+            {
+                ATOMLOG (_STR("Delay\n"));
+                failures++;
+            }
+
+            /* The thread must have been woken once, by the deletion */
+            if ((wake_count != 1) || (wake_status != ATOM_ERR_DELETED))
+            {
+                ATOMLOG (_STR("Wake %d status %d\n"), wake_count, (int)wake_status);
+                failures++;
+            }
+        }
+    }
+
+    /* Quit */
+    return failures;
+
+}
+
+
+/**
+ * \b test_thread_func
+ *
+ * Entry point for test thread.
+ *
+ * @param[in] param Unused (optional thread entry parameter)
+ *
+ * @return None
+ */
+static void test_thread_func (uint32_t param)
+{
+    /* Compiler warnings */
+    param = param;
+
+    /* Block on the semaphore with the timeout */
+    wake_status = atomSemGet (&sem1, TIMEOUT_TICKS);
+    wake_count++;
+
+    /* Loop forever */
+    while (1)
+    {
+        atomTimerDelay (SYSTEM_TICKS_PER_SEC);
+    }
+}
+
+
+/**
+ * \b testCallback
+ *
+ * Timer callback. Deletes the semaphore.
+ *
+ * @param[in] cb_data Pointer to the semaphore
+ *
+ * @return None
+ */
+static void testCallback (POINTER cb_data)
+{
+    (void)atomSemDelete ((ATOM_SEM *)cb_data);
+}
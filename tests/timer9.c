@@ -0,0 +1,207 @@
+/*
+ * Copyright (c) 2016, Kelvin Lawson. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. No personal names or organizations' names associated with the
+ *    Atomthreads project may be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE ATOMTHREADS PROJECT AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "atom.h"
+#include "atomtimer.h"
+#include "atomtests.h"
+
+
+/* Ticks accounted in one call to atomTimerAdvance() */
+#define ADVANCE_TICKS           10
+
+/* Timers used by the test (the trigger timer calls atomTimerAdvance()) */
+#define TIMER_TRIGGER           0
+#define TIMER_A                 1
+#define TIMER_B                 2
+#define TIMER_C                 3
+#define TIMER_D                 4
+#define TIMER_E                 5
+#define NUM_TIMERS              6
+
+
+/* Test OS objects */
+static ATOM_TIMER timer_cb[NUM_TIMERS];
+
+
+/* Global test data */
+static volatile int callback_count;
+static volatile int callback_id[NUM_TIMERS];
+static volatile uint32_t callback_time[NUM_TIMERS];
+static volatile uint32_t advance_end;
+
+
+/* Forward declarations */
+static void testCallback (POINTER cb_data);
+static void triggerCallback (POINTER cb_data);
+
+
+/**
+ * \b test_start
+ *
+ * Start timer test.
+ *
+ * This test checks atomTimerAdvance(). A timer callback (made from the
+ * timer tick interrupt, as for a port which has detected missed ticks)
+ * advances the system tick count by several ticks in one call. The timers
+ * due within that span must be called back in deadline order, including
+ * two with the same deadline which are called back in the order they were
+ * registered, each seeing the system tick count at its own deadline. A
+ * timer cancelled before the advance must not be called back and must not
+ * disturb the later timers, and a timer due after the span must still be
+ * called back on its original deadline.
+ *
+ * @retval Number of failures
+ */
+uint32_t test_start (void)
+{
+    int failures, i;
+    uint32_t start;
+
+    /* Expected callback order and deadlines (relative to start) */
+    static const int expected_id[] = { TIMER_TRIGGER, TIMER_A, TIMER_B, TIMER_C, TIMER_D };
+    static const uint32_t expected_time[] = { 1, 4, 8, 8, 21 };
+
+    /* Default to zero failures */
+    failures = 0;
+    callback_count = 0;
+
+    /* Start on a tick boundary so the timers are registered on one tick */
+    atomTimerDelay (1);
+    start = atomTimeGet();
+
+    /* Set up the timers */
+    for (i = 0; i < NUM_TIMERS; i++)
+    {
+        timer_cb[i].cb_func = testCallback;
+        timer_cb[i].cb_data = (POINTER)&timer_cb[i];
+    }
+    timer_cb[TIMER_TRIGGER].cb_func = triggerCallback;
+    timer_cb[TIMER_TRIGGER].cb_ticks = 1;
+    timer_cb[TIMER_A].cb_ticks = 4;
+    timer_cb[TIMER_B].cb_ticks = 8;
+    timer_cb[TIMER_C].cb_ticks = 8;
+    timer_cb[TIMER_D].cb_ticks = 21;
+    timer_cb[TIMER_E].cb_ticks = 6;
+
+    /* Register out of deadline order, B before C */
+    if ((atomTimerRegister (&timer_cb[TIMER_D]) != ATOM_OK)
+        || (atomTimerRegister (&timer_cb[TIMER_B]) != ATOM_OK)
+        || (atomTimerRegister (&timer_cb[TIMER_E]) != ATOM_OK)
+        || (atomTimerRegister (&timer_cb[TIMER_A]) != ATOM_OK)
+        || (atomTimerRegister (&timer_cb[TIMER_C]) != ATOM_OK)
+        || (atomTimerRegister (&timer_cb[TIMER_TRIGGER]) != ATOM_OK))
+    {
+        ATOMLOG (_STR("Register\n"));
+        failures++;
+    }
+
+    /* Cancel E, which falls between A and B */
+    else if (atomTimerCancel (&timer_cb[TIMER_E]) != ATOM_OK)
+    {
+        ATOMLOG (_STR("Cancel\n"));
+        failures++;
+    }
+    else
+    {
+        /* Wait for D (the delay also counts the advanced ticks) */
+        atomTimerDelay (25);
+
+        /* The advance must have moved the clock on in one step */
+        if (advance_end != start + 1 + ADVANCE_TICKS)
+        {
+            ATOMLOG (_STR("Advance end %d\n"), (int)(advance_end - start));
+            failures++;
+        }
+
+        /* Check the callbacks ran in deadline order at their deadlines */
+        if (callback_count != sizeof(expected_id) / sizeof(expected_id[0]))
+        {
+            ATOMLOG (_STR("Count %d\n"), callback_count);
+            failures++;
+        }
+        else
+        {
+            for (i = 0; i < callback_count; i++)
+            {
+                if ((callback_id[i] != expected_id[i])
+                    || (callback_time[i] - start != expected_time[i]))
+                {
+                    ATOMLOG (_STR("Callback %d: %d at %d\n"), i, callback_id[i], (int)(callback_time[i] - start));
+                    failures++;
+                }
+            }
+        }
+    }
+
+    /* Quit */
+    return failures;
+
+}
+
+
+/**
+ * \b testCallback
+ *
+ * Timer callback. Records which timer was called back, and when.
+ *
+ * @param[in] cb_data Pointer to the timer
+ *
+ * @return None
+ */
+static void testCallback (POINTER cb_data)
+{
+    if (callback_count < NUM_TIMERS)
+    {
+        callback_id[callback_count] = (int)((ATOM_TIMER *)cb_data - &timer_cb[0]);
+        callback_time[callback_count] = atomTimeGet();
+        callback_count++;
+    }
+}
+
+
+/**
+ * \b triggerCallback
+ *
+ * Timer callback which accounts for ADVANCE_TICKS missed ticks in one
+ * call, as a port's timer interrupt would on detecting lost ticks.
+ *
+ * @param[in] cb_data Pointer to the timer
+ *
+ * @return None
+ */
+static void triggerCallback (POINTER cb_data)
+{
+    /* Record the trigger itself */
+    testCallback (cb_data);
+
+    /* Account for the missed ticks */
+    atomTimerAdvance (ADVANCE_TICKS);
+    advance_end = atomTimeGet();
+}
@@ -0,0 +1,234 @@
+/*
+ * Copyright (c) 2022, Matt Liss
+ * Copyright (c) 2010, Kelvin Lawson. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. No personal names or organizations' names associated with the
+ *    Atomthreads project may be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE ATOMTHREADS PROJECT AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "atom.h"
+#include "atomtopic.h"
+#include "atomtests.h"
+
+
+/* Test inbox size */
+#define INBOX_ENTRIES       3
+
+
+/* Test OS objects */
+static ATOM_TOPIC topic1;
+static ATOM_TOPIC_SUB sub_oldest, sub_newest, sub_block;
+static uint8_t oldest_storage[INBOX_ENTRIES];
+static uint8_t newest_storage[INBOX_ENTRIES];
+static uint8_t block_storage[INBOX_ENTRIES];
+
+
+/**
+ * \b test_start
+ *
+ * Start topic test.
+ *
+ * This tests publish/subscribe topics from a single thread: parameter
+ * checks, fan-out of each message to every subscriber, and each of the
+ * overflow policies (drop-oldest, drop-newest and block) applied to full
+ * inboxes. Also checks that unsubscribed inboxes receive no new messages
+ * but can still be drained.
+ *
+ * @retval Number of failures
+ */
+uint32_t test_start (void)
+{
+    int failures;
+    uint8_t msg, i;
+    uint8_t status;
+
+    /* Default to zero failures */
+    failures = 0;
+
+    /* Parameter checks */
+    if ((atomTopicCreate (NULL, sizeof(uint8_t)) != ATOM_ERR_PARAM)
+        || (atomTopicCreate (&topic1, 0) != ATOM_ERR_PARAM))
+    {
+        ATOMLOG (_STR("Create param checks\n"));
+        failures++;
+    }
+
+    /* Create test topic */
+    if (atomTopicCreate (&topic1, sizeof(uint8_t)) != ATOM_OK)
+    {
+        ATOMLOG (_STR("Error creating test topic\n"));
+        failures++;
+    }
+    else
+    {
+        /* Publishing with no subscribers is fine */
+        msg = 0;
+        if (atomTopicPublish (&topic1, -1, &msg) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Publish no subs\n"));
+            failures++;
+        }
+
+        /* Subscribe parameter checks */
+        if ((atomTopicSubscribe (NULL, &sub_block, block_storage, INBOX_ENTRIES, ATOM_TOPIC_BLOCK) != ATOM_ERR_PARAM)
+            || (atomTopicSubscribe (&topic1, NULL, block_storage, INBOX_ENTRIES, ATOM_TOPIC_BLOCK) != ATOM_ERR_PARAM)
+            || (atomTopicSubscribe (&topic1, &sub_block, NULL, INBOX_ENTRIES, ATOM_TOPIC_BLOCK) != ATOM_ERR_PARAM)
+            || (atomTopicSubscribe (&topic1, &sub_block, block_storage, 0, ATOM_TOPIC_BLOCK) != ATOM_ERR_PARAM)
+            || (atomTopicSubscribe (&topic1, &sub_block, block_storage, INBOX_ENTRIES, ATOM_TOPIC_BLOCK + 1) != ATOM_ERR_PARAM))
+        {
+            ATOMLOG (_STR("Subscribe param checks\n"));
+            failures++;
+        }
+
+        /* Subscribe one inbox with each policy */
+        if ((atomTopicSubscribe (&topic1, &sub_oldest, oldest_storage, INBOX_ENTRIES, ATOM_TOPIC_DROP_OLDEST) != ATOM_OK)
+            || (atomTopicSubscribe (&topic1, &sub_newest, newest_storage, INBOX_ENTRIES, ATOM_TOPIC_DROP_NEWEST) != ATOM_OK)
+            || (atomTopicSubscribe (&topic1, &sub_block, block_storage, INBOX_ENTRIES, ATOM_TOPIC_BLOCK) != ATOM_OK))
+        {
+            ATOMLOG (_STR("Subscribe\n"));
+            failures++;
+        }
+
+        /* Fill all of the inboxes */
+        for (i = 1; i <= INBOX_ENTRIES; i++)
+        {
+            if (atomTopicPublish (&topic1, -1, &i) != ATOM_OK)
+            {
+                ATOMLOG (_STR("Publish %d\n"), i);
+                failures++;
+            }
+        }
+
+        /* The blocking subscriber now holds up publishers */
+        msg = 0x10;
+        if ((status = atomTopicPublish (&topic1, -1, &msg)) != ATOM_WOULDBLOCK)
+        {
+            ATOMLOG (_STR("Block policy (%d)\n"), status);
+            failures++;
+        }
+
+        /* Nothing should have been delivered or dropped anywhere */
+        if ((sub_oldest.num_dropped != 0) || (sub_newest.num_dropped != 0)
+            || (sub_block.num_dropped != 0))
+        {
+            ATOMLOG (_STR("Partial delivery\n"));
+            failures++;
+        }
+
+        /* Receive one from the blocking inbox, then publish again */
+        if ((atomTopicReceive (&sub_block, -1, &msg) != ATOM_OK) || (msg != 1))
+        {
+            ATOMLOG (_STR("Block receive %d\n"), msg);
+            failures++;
+        }
+        msg = 0x10;
+        if (atomTopicPublish (&topic1, -1, &msg) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Publish after receive\n"));
+            failures++;
+        }
+
+        /* Drop-oldest inbox should hold 2, 3, 0x10 */
+        if ((sub_oldest.num_dropped != 1)
+            || (atomTopicReceive (&sub_oldest, -1, &msg) != ATOM_OK) || (msg != 2)
+            || (atomTopicReceive (&sub_oldest, -1, &msg) != ATOM_OK) || (msg != 3)
+            || (atomTopicReceive (&sub_oldest, -1, &msg) != ATOM_OK) || (msg != 0x10))
+        {
+            ATOMLOG (_STR("Drop oldest\n"));
+            failures++;
+        }
+
+        /* Drop-newest inbox should hold 1, 2, 3 */
+        if ((sub_newest.num_dropped != 1)
+            || (atomTopicReceive (&sub_newest, -1, &msg) != ATOM_OK) || (msg != 1)
+            || (atomTopicReceive (&sub_newest, -1, &msg) != ATOM_OK) || (msg != 2)
+            || (atomTopicReceive (&sub_newest, -1, &msg) != ATOM_OK) || (msg != 3))
+        {
+            ATOMLOG (_STR("Drop newest\n"));
+            failures++;
+        }
+
+        /* Both inboxes are now empty */
+        if ((atomTopicReceive (&sub_oldest, -1, &msg) != ATOM_WOULDBLOCK)
+            || (atomTopicReceive (&sub_newest, -1, &msg) != ATOM_WOULDBLOCK))
+        {
+            ATOMLOG (_STR("Not empty\n"));
+            failures++;
+        }
+
+        /* Unsubscribe the blocking inbox, which still holds 2, 3, 0x10 */
+        if (atomTopicUnsubscribe (&sub_block) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Unsubscribe\n"));
+            failures++;
+        }
+        if (atomTopicUnsubscribe (&sub_block) != ATOM_ERR_NOT_FOUND)
+        {
+            ATOMLOG (_STR("Unsubscribe twice\n"));
+            failures++;
+        }
+
+        /* Publishing no longer blocks, nor reaches the unsubscribed inbox */
+        msg = 0x20;
+        if (atomTopicPublish (&topic1, -1, &msg) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Publish after unsubscribe\n"));
+            failures++;
+        }
+        if ((atomTopicReceive (&sub_block, -1, &msg) != ATOM_OK) || (msg != 2)
+            || (atomTopicReceive (&sub_block, -1, &msg) != ATOM_OK) || (msg != 3)
+            || (atomTopicReceive (&sub_block, -1, &msg) != ATOM_OK) || (msg != 0x10))
+        {
+            ATOMLOG (_STR("Drain unsubscribed\n"));
+            failures++;
+        }
+
+        /* An empty unsubscribed inbox will never receive anything */
+        if (atomTopicReceive (&sub_block, 0, &msg) != ATOM_ERR_DELETED)
+        {
+            ATOMLOG (_STR("Receive unsubscribed\n"));
+            failures++;
+        }
+
+        /* The remaining subscribers got the last message */
+        if ((atomTopicReceive (&sub_oldest, -1, &msg) != ATOM_OK) || (msg != 0x20)
+            || (atomTopicReceive (&sub_newest, -1, &msg) != ATOM_OK) || (msg != 0x20))
+        {
+            ATOMLOG (_STR("Remaining subs\n"));
+            failures++;
+        }
+
+        /* Delete topic, test finished */
+        if (atomTopicDelete (&topic1) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Delete failed\n"));
+            failures++;
+        }
+    }
+
+    /* Quit */
+    return failures;
+}
@@ -0,0 +1,298 @@
+/*
+ * Copyright (c) 2022, Matt Liss
+ * Copyright (c) 2010, Kelvin Lawson. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. No personal names or organizations' names associated with the
+ *    Atomthreads project may be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE ATOMTHREADS PROJECT AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "atom.h"
+#include "atomtopic.h"
+#include "atomtests.h"
+
+
+/* Number of test threads */
+#define NUM_RECEIVERS       2
+#define NUM_TEST_THREADS    (NUM_RECEIVERS + 1)
+
+
+/* Test inbox size */
+#define INBOX_ENTRIES       2
+
+
+/* Test OS objects */
+static ATOM_TOPIC topic1;
+static ATOM_TOPIC_SUB sub[NUM_RECEIVERS];
+static uint8_t sub_storage[NUM_RECEIVERS][INBOX_ENTRIES];
+static ATOM_TOPIC_SUB sub_block;
+static uint8_t block_storage[1];
+static ATOM_TCB tcb[NUM_TEST_THREADS];
+static uint8_t test_thread_stack[NUM_TEST_THREADS][TEST_THREAD_STACK_SIZE];
+
+
+/* Test result tracking */
+static volatile int g_count[NUM_RECEIVERS];
+static volatile uint8_t g_msg[NUM_RECEIVERS];
+static volatile uint8_t g_status[NUM_RECEIVERS];
+static volatile uint8_t g_drained;
+
+
+/* Forward declarations */
+static void receiver_thread_func (uint32_t param);
+static void drain_thread_func (uint32_t param);
+
+
+/**
+ * \b test_start
+ *
+ * Start topic test.
+ *
+ * This tests publish/subscribe topics with blocking threads. Two
+ * subscriber threads wait on empty inboxes and must both be handed each
+ * published message. A third subscriber uses the blocking overflow policy
+ * with no reader: publishing must then time out, or block until another
+ * thread drains that inbox. Finally deleting the topic must wake the
+ * waiting subscriber threads.
+ *
+ * @retval Number of failures
+ */
+uint32_t test_start (void)
+{
+    int failures;
+    uint8_t msg;
+    uint8_t status;
+    int i;
+
+    /* Default to zero failures */
+    failures = 0;
+    g_drained = 0;
+
+    /* Create test topic and subscribers */
+    if ((atomTopicCreate (&topic1, sizeof(uint8_t)) != ATOM_OK)
+        || (atomTopicSubscribe (&topic1, &sub[0], &sub_storage[0][0], INBOX_ENTRIES, ATOM_TOPIC_DROP_OLDEST) != ATOM_OK)
+        || (atomTopicSubscribe (&topic1, &sub[1], &sub_storage[1][0], INBOX_ENTRIES, ATOM_TOPIC_DROP_OLDEST) != ATOM_OK))
+    {
+        ATOMLOG (_STR("Error creating test topic\n"));
+        failures++;
+        return failures;
+    }
+
+    /* Create the higher priority receiver threads */
+    for (i = 0; i < NUM_RECEIVERS; i++)
+    {
+        g_count[i] = 0;
+        if (atomThreadCreate(&tcb[i], TEST_THREAD_PRIO - 1, receiver_thread_func, i,
+              &test_thread_stack[i][0],
+              TEST_THREAD_STACK_SIZE, TRUE) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Error creating receiver %d\n"), i);
+            failures++;
+        }
+    }
+
+    /* Both receivers are now waiting, one publish should wake both */
+    msg = 0x42;
+    if (atomTopicPublish (&topic1, -1, &msg) != ATOM_OK)
+    {
+        ATOMLOG (_STR("Publish 1\n"));
+        failures++;
+    }
+    for (i = 0; i < NUM_RECEIVERS; i++)
+    {
+        if ((g_count[i] != 1) || (g_msg[i] != 0x42))
+        {
+            ATOMLOG (_STR("Receiver %d count %d msg 0x%x\n"), i, g_count[i], g_msg[i]);
+            failures++;
+        }
+    }
+
+    /* Add a blocking subscriber which nobody reads, and fill it */
+    if (atomTopicSubscribe (&topic1, &sub_block, &block_storage[0], 1, ATOM_TOPIC_BLOCK) != ATOM_OK)
+    {
+        ATOMLOG (_STR("Subscribe block\n"));
+        failures++;
+    }
+    msg = 0x43;
+    if (atomTopicPublish (&topic1, -1, &msg) != ATOM_OK)
+    {
+        ATOMLOG (_STR("Publish 2\n"));
+        failures++;
+    }
+
+    /* Publisher must now time out */
+    msg = 0x44;
+    if ((status = atomTopicPublish (&topic1, SYSTEM_TICKS_PER_SEC/10, &msg)) != ATOM_TIMEOUT)
+    {
+        ATOMLOG (_STR("Publish timeout (%d)\n"), status);
+        failures++;
+    }
+
+    /* Another thread drains the blocking inbox shortly */
+    if (atomThreadCreate(&tcb[NUM_RECEIVERS], TEST_THREAD_PRIO - 1, drain_thread_func, 0,
+          &test_thread_stack[NUM_RECEIVERS][0],
+          TEST_THREAD_STACK_SIZE, TRUE) != ATOM_OK)
+    {
+        ATOMLOG (_STR("Error creating drain thread\n"));
+        failures++;
+    }
+
+    /* So this publish blocks until then, and succeeds */
+    if (atomTopicPublish (&topic1, SYSTEM_TICKS_PER_SEC, &msg) != ATOM_OK)
+    {
+        ATOMLOG (_STR("Blocked publish\n"));
+        failures++;
+    }
+    if (g_drained != 0x43)
+    {
+        ATOMLOG (_STR("Drained 0x%x\n"), g_drained);
+        failures++;
+    }
+    for (i = 0; i < NUM_RECEIVERS; i++)
+    {
+        if ((g_count[i] != 3) || (g_msg[i] != 0x44))
+        {
+            ATOMLOG (_STR("Receiver %d count %d msg 0x%x\n"), i, g_count[i], g_msg[i]);
+            failures++;
+        }
+    }
+
+    /* Deleting the topic wakes the waiting receivers */
+    if (atomTopicDelete (&topic1) != ATOM_OK)
+    {
+        ATOMLOG (_STR("Delete failed\n"));
+        failures++;
+    }
+    for (i = 0; i < NUM_RECEIVERS; i++)
+    {
+        if (g_status[i] != ATOM_ERR_DELETED)
+        {
+            ATOMLOG (_STR("Receiver %d delete status %d\n"), i, g_status[i]);
+            failures++;
+        }
+    }
+
+    /* Check thread stack usage (if enabled) */
+#ifdef ATOM_STACK_CHECKING
+    {
+        uint32_t used_bytes, free_bytes;
+        int thread;
+
+        /* Check all threads */
+        for (thread = 0; thread < NUM_TEST_THREADS; thread++)
+        {
+            /* Check thread stack usage */
+            if (atomThreadStackCheck (&tcb[thread], &used_bytes, &free_bytes) != ATOM_OK)
+            {
+                ATOMLOG (_STR("StackCheck\n"));
+                failures++;
+            }
+            else
+            {
+                /* Check the thread did not use up to the end of stack */
+                if (free_bytes == 0)
+                {
+                    ATOMLOG (_STR("StackOverflow %d\n"), thread);
+                    failures++;
+                }
+
+                /* Log the stack usage */
+#ifdef TESTS_LOG_STACK_USAGE
+                ATOMLOG (_STR("StackUse:%d\n"), (int)used_bytes);
+#endif
+            }
+        }
+    }
+#endif
+
+    /* Quit */
+    return failures;
+}
+
+
+/**
+ * \b receiver_thread_func
+ *
+ * Entry point for subscriber threads. Receives messages until the topic
+ * is deleted, recording the latest message and status.
+ *
+ * @param[in] param Subscriber index
+ *
+ * @return None
+ */
+static void receiver_thread_func (uint32_t param)
+{
+    uint8_t msg;
+    uint8_t status;
+
+    /* Receive until an error */
+    do
+    {
+        status = atomTopicReceive (&sub[param], 0, &msg);
+        if (status == ATOM_OK)
+        {
+            g_msg[param] = msg;
+            g_count[param]++;
+        }
+        g_status[param] = status;
+    } while (status == ATOM_OK);
+
+    /* Loop forever */
+    while (1)
+    {
+        atomTimerDelay (SYSTEM_TICKS_PER_SEC);
+    }
+}
+
+
+/**
+ * \b drain_thread_func
+ *
+ * Entry point for the thread which drains the blocking subscriber.
+ *
+ * @param[in] param Unused (optional thread entry parameter)
+ *
+ * @return None
+ */
+static void drain_thread_func (uint32_t param)
+{
+    uint8_t msg;
+
+    /* Compiler warnings */
+    param = param;
+
+    /* Give the main thread time to block, then make space */
+    atomTimerDelay (SYSTEM_TICKS_PER_SEC/10);
+    if (atomTopicReceive (&sub_block, -1, &msg) == ATOM_OK)
+    {
+        g_drained = msg;
+    }
+
+    /* Loop forever */
+    while (1)
+    {
+        atomTimerDelay (SYSTEM_TICKS_PER_SEC);
+    }
+}
@@ -0,0 +1,378 @@
+/*
+ * Copyright (c) 2022, Matt Liss
+ * Copyright (c) 2010, Kelvin Lawson. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. No personal names or organizations' names associated with the
+ *    Atomthreads project may be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE ATOMTHREADS PROJECT AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "atom.h"
+#include "atomsem.h"
+#include "atomwork.h"
+#include "atomtests.h"
+
+
+/* Number of worker threads */
+#define NUM_WORKERS         2
+
+/* Number of test work items */
+#define NUM_ITEMS           6
+
+/* Size of the pending item ring */
+#define RING_SIZE           8
+
+
+/* Test OS objects */
+static ATOM_WORK_QUEUE wq1;
+static ATOM_WORKER workers[NUM_WORKERS];
+static uint8_t worker_stacks[NUM_WORKERS][TEST_THREAD_STACK_SIZE];
+static POINTER ring[RING_SIZE];
+static ATOM_WORK work[NUM_ITEMS];
+static ATOM_TIMER timer1;
+static ATOM_SEM sem1;
+
+
+/* Test global data */
+static volatile int run_count[NUM_ITEMS];
+static volatile uint8_t isr_status;
+
+
+/* Forward declarations */
+static void test_work_func (POINTER arg);
+static void test_blocking_work_func (POINTER arg);
+static void test_timer_cb (POINTER cb_data);
+
+
+/**
+ * \b test_start
+ *
+ * Start work queue test.
+ *
+ * Creates a work queue with two workers at a lower priority than this
+ * thread, so that submitted items only run when this thread sleeps. Tests
+ * coalescing of repeated submissions, cancelling pending and delayed items,
+ * delayed submission, submission from interrupt context and two items
+ * running concurrently on the two workers while one of them blocks.
+ *
+ * @retval Number of failures
+ */
+uint32_t test_start (void)
+{
+    int failures;
+    int i;
+
+    /* Default to zero failures */
+    failures = 0;
+
+    /* Initialise global data */
+    for (i = 0; i < NUM_ITEMS; i++)
+    {
+        run_count[i] = 0;
+    }
+    isr_status = 0xFF;
+
+    /* Check parameter checks */
+    if (atomWorkQueueCreate (&wq1, ring, RING_SIZE - 1, workers, NUM_WORKERS,
+            TEST_THREAD_PRIO + 1, &worker_stacks[0][0], TEST_THREAD_STACK_SIZE) != ATOM_ERR_PARAM)
+    {
+        ATOMLOG (_STR("Ring size check\n"));
+        failures++;
+    }
+    if (atomWorkInit (&work[0], NULL, 0) != ATOM_ERR_PARAM)
+    {
+        ATOMLOG (_STR("Init param check\n"));
+        failures++;
+    }
+
+    /* Create the work queue and items */
+    if (atomSemCreate (&sem1, 0) != ATOM_OK)
+    {
+        ATOMLOG (_STR("Error creating test semaphore 1\n"));
+        failures++;
+    }
+    else if (atomWorkQueueCreate (&wq1, ring, RING_SIZE, workers, NUM_WORKERS,
+            TEST_THREAD_PRIO + 1, &worker_stacks[0][0], TEST_THREAD_STACK_SIZE) != ATOM_OK)
+    {
+        ATOMLOG (_STR("Error creating work queue\n"));
+        failures++;
+    }
+    else
+    {
+        for (i = 0; i < NUM_ITEMS; i++)
+        {
+            if (atomWorkInit (&work[i], (i == 5) ? test_blocking_work_func : test_work_func,
+                    (POINTER)&run_count[i]) != ATOM_OK)
+            {
+                ATOMLOG (_STR("Init %d\n"), i);
+                failures++;
+            }
+        }
+
+        /* Test 1: repeated submissions run once */
+        if ((atomWorkSubmit (&wq1, &work[0]) != ATOM_OK)
+            || (atomWorkSubmit (&wq1, &work[0]) != ATOM_OK)
+            || (atomWorkSubmit (&wq1, &work[0]) != ATOM_OK))
+        {
+            ATOMLOG (_STR("Submit\n"));
+            failures++;
+        }
+        else if (run_count[0] != 0)
+        {
+            ATOMLOG (_STR("Ran early\n"));
+            failures++;
+        }
+        else
+        {
+            atomTimerDelay (2);
+            if (run_count[0] != 1)
+            {
+                ATOMLOG (_STR("Coalesce %d\n"), run_count[0]);
+                failures++;
+            }
+        }
+
+        /* Test 2: cancelled pending item does not run */
+        if (atomWorkSubmit (&wq1, &work[1]) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Submit\n"));
+            failures++;
+        }
+        else if (atomWorkCancel (&work[1]) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Cancel pending\n"));
+            failures++;
+        }
+        else if (atomWorkCancel (&work[1]) != ATOM_ERR_NOT_FOUND)
+        {
+            ATOMLOG (_STR("Cancel idle\n"));
+            failures++;
+        }
+        else
+        {
+            atomTimerDelay (2);
+            if (run_count[1] != 0)
+            {
+                ATOMLOG (_STR("Cancelled item ran\n"));
+                failures++;
+            }
+        }
+
+        /* Test 3: delayed submission */
+        if (atomWorkSubmitDelayed (&wq1, &work[2], 10) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Submit delayed\n"));
+            failures++;
+        }
+        else
+        {
+            atomTimerDelay (5);
+            if (run_count[2] != 0)
+            {
+                ATOMLOG (_STR("Delayed item ran early\n"));
+                failures++;
+            }
+            atomTimerDelay (10);
+            if (run_count[2] != 1)
+            {
+                ATOMLOG (_STR("Delayed item %d\n"), run_count[2]);
+                failures++;
+            }
+        }
+
+        /* Test 4: cancelled delayed item does not run */
+        if (atomWorkSubmitDelayed (&wq1, &work[3], 5) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Submit delayed\n"));
+            failures++;
+        }
+        else if (atomWorkCancel (&work[3]) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Cancel delayed\n"));
+            failures++;
+        }
+        else
+        {
+            atomTimerDelay (10);
+            if (run_count[3] != 0)
+            {
+                ATOMLOG (_STR("Cancelled delayed item ran\n"));
+                failures++;
+            }
+        }
+
+        /* Test 5: submission from interrupt context */
+        timer1.cb_func = test_timer_cb;
+        timer1.cb_data = NULL;
+        timer1.cb_ticks = 2;
+        if (atomTimerRegister (&timer1) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Timer register\n"));
+            failures++;
+        }
+        else
+        {
+            atomTimerDelay (5);
+            if ((isr_status != ATOM_OK) || (run_count[4] != 1))
+            {
+                ATOMLOG (_STR("ISR submit %d %d\n"), isr_status, run_count[4]);
+                failures++;
+            }
+        }
+
+        /* Test 6: one worker blocks, the other runs further items */
+        if ((atomWorkSubmit (&wq1, &work[5]) != ATOM_OK)
+            || (atomWorkSubmit (&wq1, &work[0]) != ATOM_OK))
+        {
+            ATOMLOG (_STR("Submit\n"));
+            failures++;
+        }
+        else
+        {
+            atomTimerDelay (2);
+            if ((run_count[5] != 0) || (run_count[0] != 2))
+            {
+                ATOMLOG (_STR("Concurrent %d %d\n"), run_count[5], run_count[0]);
+                failures++;
+            }
+
+            /* Release the blocked item */
+            if (atomSemPut (&sem1) != ATOM_OK)
+            {
+                ATOMLOG (_STR("SemPut\n"));
+                failures++;
+            }
+            atomTimerDelay (2);
+            if (run_count[5] != 1)
+            {
+                ATOMLOG (_STR("Blocked item %d\n"), run_count[5]);
+                failures++;
+            }
+        }
+
+        /* Delete the work queue, pending items return to idle */
+        if (atomWorkSubmit (&wq1, &work[1]) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Submit\n"));
+            failures++;
+        }
+        else if (atomWorkQueueDelete (&wq1) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Delete\n"));
+            failures++;
+        }
+        else if ((work[1].state != ATOM_WORK_IDLE) || (workers[0].tcb.terminated != TRUE)
+            || (workers[1].tcb.terminated != TRUE))
+        {
+            ATOMLOG (_STR("Delete state\n"));
+            failures++;
+        }
+    }
+
+    /* Check thread stack usage (if enabled) */
+#ifdef ATOM_STACK_CHECKING
+    {
+        uint32_t used_bytes, free_bytes;
+        int thread;
+
+        /* Check all threads */
+        for (thread = 0; thread < NUM_WORKERS; thread++)
+        {
+            /* Check thread stack usage */
+            if (atomThreadStackCheck (&workers[thread].tcb, &used_bytes, &free_bytes) != ATOM_OK)
+            {
+                ATOMLOG (_STR("StackCheck\n"));
+                failures++;
+            }
+            else
+            {
+                /* Check the thread did not use up to the end of stack */
+                if (free_bytes == 0)
+                {
+                    ATOMLOG (_STR("StackOverflow %d\n"), thread);
+                    failures++;
+                }
+
+                /* Log the stack usage */
+#ifdef TESTS_LOG_STACK_USAGE
+                ATOMLOG (_STR("StackUse:%d\n"), (int)used_bytes);
+#endif
+            }
+        }
+    }
+#endif
+
+    /* Quit */
+    return failures;
+
+}
+
+
+/**
+ * \b test_work_func
+ *
+ * Work function which counts its executions.
+ *
+ * @param[in] arg Pointer to the item's run count
+ *
+ * @return None
+ */
+static void test_work_func (POINTER arg)
+{
+    (*(volatile int *)arg)++;
+}
+
+
+/**
+ * \b test_blocking_work_func
+ *
+ * Work function which blocks on the semaphore before counting its
+ * execution.
+ *
+ * @param[in] arg Pointer to the item's run count
+ *
+ * @return None
+ */
+static void test_blocking_work_func (POINTER arg)
+{
+    if (atomSemGet (&sem1, 0) == ATOM_OK)
+    {
+        (*(volatile int *)arg)++;
+    }
+}
+
+
+/**
+ * \b test_timer_cb
+ *
+ * Timer callback which submits a work item from interrupt context.
+ *
+ * @param[in] cb_data Unused
+ *
+ * @return None
+ */
+static void test_timer_cb (POINTER cb_data)
+{
+    isr_status = atomWorkSubmit (&wq1, &work[4]);
+}
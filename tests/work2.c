@@ -0,0 +1,284 @@
+/*
+ * Copyright (c) 2022, Matt Liss
+ * Copyright (c) 2010, Kelvin Lawson. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. No personal names or organizations' names associated with the
+ *    Atomthreads project may be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE ATOMTHREADS PROJECT AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "atom.h"
+#include "atomsem.h"
+#include "atomwork.h"
+#include "atomtests.h"
+
+
+/* Number of worker threads */
+#define NUM_WORKERS         2
+
+/* Size of the pending item ring */
+#define RING_SIZE           4
+
+/* Number of items needed to occupy the workers and fill the ring */
+#define NUM_FILL            (NUM_WORKERS + RING_SIZE)
+
+
+/* Test OS objects */
+static ATOM_WORK_QUEUE wq1;
+static ATOM_WORKER workers[NUM_WORKERS];
+static uint8_t worker_stacks[NUM_WORKERS][TEST_THREAD_STACK_SIZE];
+static POINTER ring[RING_SIZE];
+static ATOM_WORK work1, delayed_work;
+static ATOM_WORK fill_work[NUM_FILL];
+static ATOM_SEM sem1;
+
+
+/* Test global data */
+static volatile int work1_count;
+static volatile int delayed_count;
+static volatile int fill_count;
+
+
+/* Forward declarations */
+static void test_work_func (POINTER arg);
+static void test_blocking_work_func (POINTER arg);
+
+
+/**
+ * \b test_start
+ *
+ * Start work queue full ring test.
+ *
+ * Checks that cancelling a pending item frees its ring entry, so that an
+ * item can be submitted and cancelled repeatedly without filling the ring,
+ * and that a delayed item whose delay expires while the ring is full is
+ * submitted once there is room rather than being dropped.
+ *
+ * @retval Number of failures
+ */
+uint32_t test_start (void)
+{
+    int failures;
+    int i;
+
+    /* Default to zero failures */
+    failures = 0;
+
+    /* Initialise global data */
+    work1_count = delayed_count = fill_count = 0;
+
+    /* Create the work queue and items */
+    if (atomSemCreate (&sem1, 0) != ATOM_OK)
+    {
+        ATOMLOG (_STR("Error creating test semaphore 1\n"));
+        failures++;
+    }
+    else if (atomWorkQueueCreate (&wq1, ring, RING_SIZE, workers, NUM_WORKERS,
+            TEST_THREAD_PRIO + 1, &worker_stacks[0][0], TEST_THREAD_STACK_SIZE) != ATOM_OK)
+    {
+        ATOMLOG (_STR("Error creating work queue\n"));
+        failures++;
+    }
+    else if ((atomWorkInit (&work1, test_work_func, (POINTER)&work1_count) != ATOM_OK)
+        || (atomWorkInit (&delayed_work, test_work_func, (POINTER)&delayed_count) != ATOM_OK))
+    {
+        ATOMLOG (_STR("Init\n"));
+        failures++;
+    }
+    else
+    {
+        for (i = 0; i < NUM_FILL; i++)
+        {
+            if (atomWorkInit (&fill_work[i], test_blocking_work_func, (POINTER)&fill_count) != ATOM_OK)
+            {
+                ATOMLOG (_STR("Init %d\n"), i);
+                failures++;
+            }
+        }
+
+        /* Let the workers start and wait for work */
+        atomTimerDelay (2);
+
+        /**
+         * Test 1: submit and cancel an item many more times than there are
+         * ring entries. The workers do not run in between, as they are
+         * lower priority than this thread.
+         */
+        for (i = 0; i < (4 * RING_SIZE); i++)
+        {
+            if (atomWorkSubmit (&wq1, &work1) != ATOM_OK)
+            {
+                ATOMLOG (_STR("Submit %d\n"), i);
+                failures++;
+                break;
+            }
+            if (atomWorkCancel (&work1) != ATOM_OK)
+            {
+                ATOMLOG (_STR("Cancel %d\n"), i);
+                failures++;
+                break;
+            }
+        }
+        atomTimerDelay (2);
+        if (work1_count != 0)
+        {
+            ATOMLOG (_STR("Cancelled item ran %d\n"), work1_count);
+            failures++;
+        }
+
+        /* Test 2: occupy both workers, then fill the ring */
+        for (i = 0; i < NUM_WORKERS; i++)
+        {
+            if (atomWorkSubmit (&wq1, &fill_work[i]) != ATOM_OK)
+            {
+                ATOMLOG (_STR("Submit fill %d\n"), i);
+                failures++;
+            }
+        }
+        atomTimerDelay (2);
+        for (i = NUM_WORKERS; i < NUM_FILL; i++)
+        {
+            if (atomWorkSubmit (&wq1, &fill_work[i]) != ATOM_OK)
+            {
+                ATOMLOG (_STR("Submit fill %d\n"), i);
+                failures++;
+            }
+        }
+        if (atomWorkSubmit (&wq1, &work1) != ATOM_WOULDBLOCK)
+        {
+            ATOMLOG (_STR("Ring not full\n"));
+            failures++;
+        }
+
+        /* Let a delayed item expire while the ring is full */
+        if (atomWorkSubmitDelayed (&wq1, &delayed_work, 2) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Submit delayed\n"));
+            failures++;
+        }
+        else
+        {
+            atomTimerDelay (5);
+            if ((delayed_count != 0) || (delayed_work.state != ATOM_WORK_DELAYED))
+            {
+                ATOMLOG (_STR("Delayed state %d %d\n"), delayed_count, delayed_work.state);
+                failures++;
+            }
+
+            /* Release the blocked items, the delayed item should then run */
+            for (i = 0; i < NUM_FILL; i++)
+            {
+                if (atomSemPut (&sem1) != ATOM_OK)
+                {
+                    ATOMLOG (_STR("SemPut\n"));
+                    failures++;
+                }
+            }
+            atomTimerDelay (5);
+            if ((fill_count != NUM_FILL) || (delayed_count != 1))
+            {
+                ATOMLOG (_STR("Delayed item lost %d %d\n"), fill_count, delayed_count);
+                failures++;
+            }
+        }
+
+        /* Delete the work queue */
+        if (atomWorkQueueDelete (&wq1) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Delete\n"));
+            failures++;
+        }
+    }
+
+    /* Check thread stack usage (if enabled) */
+#ifdef ATOM_STACK_CHECKING
+    {
+        uint32_t used_bytes, free_bytes;
+        int thread;
+
+        /* Check all threads */
+        for (thread = 0; thread < NUM_WORKERS; thread++)
+        {
+            /* Check thread stack usage */
+            if (atomThreadStackCheck (&workers[thread].tcb, &used_bytes, &free_bytes) != ATOM_OK)
+            {
+                ATOMLOG (_STR("StackCheck\n"));
+                failures++;
+            }
+            else
+            {
+                /* Check the thread did not use up to the end of stack */
+                if (free_bytes == 0)
+                {
+                    ATOMLOG (_STR("StackOverflow %d\n"), thread);
+                    failures++;
+                }
+
+                /* Log the stack usage */
+#ifdef TESTS_LOG_STACK_USAGE
+                ATOMLOG (_STR("StackUse:%d\n"), (int)used_bytes);
+#endif
+            }
+        }
+    }
+#endif
+
+    /* Quit */
+    return failures;
+
+}
+
+
+/**
+ * \b test_work_func
+ *
+ * Work function which counts its executions.
+ *
+ * @param[in] arg Pointer to the item's run count
+ *
+ * @return None
+ */
+static void test_work_func (POINTER arg)
+{
+    (*(volatile int *)arg)++;
+}
+
+
+/**
+ * \b test_blocking_work_func
+ *
+ * Work function which blocks on the semaphore before counting its
+ * execution.
+ *
+ * @param[in] arg Pointer to the run count
+ *
+ * @return None
+ */
+static void test_blocking_work_func (POINTER arg)
+{
+    if (atomSemGet (&sem1, 0) == ATOM_OK)
+    {
+        (*(volatile int *)arg)++;
+    }
+}
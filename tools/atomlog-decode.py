@@ -0,0 +1,199 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2010, Kelvin Lawson. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#
+# 1. Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+# 2. Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+# 3. No personal names or organizations' names associated with the
+#    Atomthreads project may be used to endorse or promote products
+#    derived from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE ATOMTHREADS PROJECT AND CONTRIBUTORS
+# "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+# TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE
+# LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+# CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+# SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+# INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+# CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+# ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+# POSSIBILITY OF SUCH DAMAGE.
+#
+
+"""
+Decoder for binary log records written by kernel/atomlog.c.
+
+The target sends each record as the sync bytes 0xA5 0x5A, the address of
+the format string (4 bytes for 32-bit ELF files, 8 for 64-bit), the
+timestamp and four 32-bit arguments, least significant byte first. This
+script reads the records from a capture file (or stdin), looks the format
+strings up in the application's ELF file and prints the messages.
+
+Usage: atomlog-decode.py [--args N] application.elf [capture.bin]
+"""
+
+import re
+import struct
+import sys
+
+
+SYNC = b'\xa5\x5a'
+NUM_ARGS = 4
+
+# ELF section flags and types needed to find loaded data
+SHF_ALLOC = 0x2
+SHT_NOBITS = 8
+
+# AVR toolchains place data memory at this offset in the ELF address space,
+# but pointers on the target hold the plain data-space address
+EM_AVR = 83
+AVR_DATA_OFFSET = 0x800000
+
+
+class Elf(object):
+    """Minimal ELF reader: maps addresses to the contents of loaded sections."""
+
+    def __init__(self, path):
+        with open(path, 'rb') as f:
+            self.data = f.read()
+        if self.data[:4] != b'\x7fELF':
+            raise ValueError('%s is not an ELF file' % path)
+        self.addr_size = 8 if self.data[4] == 2 else 4
+        endian = '<' if self.data[5] == 1 else '>'
+        machine, = struct.unpack_from(endian + 'H', self.data, 0x12)
+        self.data_offset = AVR_DATA_OFFSET if machine == EM_AVR else 0
+
+        if self.addr_size == 4:
+            shoff, = struct.unpack_from(endian + 'I', self.data, 0x20)
+            shentsize, shnum = struct.unpack_from(endian + 'HH', self.data, 0x2E)
+            shfmt = endian + 'IIIIII'
+        else:
+            shoff, = struct.unpack_from(endian + 'Q', self.data, 0x28)
+            shentsize, shnum = struct.unpack_from(endian + 'HH', self.data, 0x3A)
+            shfmt = endian + 'IIQQQQ'
+
+        # Keep (address, size, file offset) of sections loaded on the target
+        self.sections = []
+        for i in range(shnum):
+            _, sh_type, flags, addr, offset, size = struct.unpack_from(
+                shfmt, self.data, shoff + (i * shentsize))
+            if (flags & SHF_ALLOC) and sh_type != SHT_NOBITS and size:
+                self.sections.append((addr, size, offset))
+
+    def string(self, addr):
+        """Returns the NUL-terminated string at a target address, or None."""
+        addr += self.data_offset
+        for start, size, offset in self.sections:
+            if start <= addr < start + size:
+                pos = offset + (addr - start)
+                end = self.data.find(b'\0', pos, offset + size)
+                if end < 0:
+                    end = offset + size
+                return self.data[pos:end].decode('latin-1')
+        return None
+
+
+# printf conversion: flags, width, precision, length modifier, conversion
+CONVERSION = re.compile(r'%([-+ #0]*)(\d*|\*)(\.\d*)?(hh|h|ll|l|z|t|j)?([diouxXcsp%])')
+
+
+def format_record(elf, fmt, args):
+    """Formats a record's arguments with its printf-style format string."""
+    args = list(args)
+
+    def convert(match):
+        flags, width, precision, _, conv = match.groups()
+        if conv == '%':
+            return '%'
+        if width == '*':
+            width = str(args.pop(0)) if args else ''
+        value = args.pop(0) if args else 0
+        spec = '%' + flags + width + (precision or '')
+        if conv in 'di':
+            return (spec + 'd') % (value - (1 << 32) if value & 0x80000000 else value)
+        if conv == 'u':
+            return (spec + 'd') % value
+        if conv in 'oxX':
+            return (spec + conv) % value
+        if conv == 'c':
+            return (spec + 'c') % chr(value & 0xFF)
+        if conv == 'p':
+            return (spec + 's') % ('0x%x' % value)
+        # %s arguments must point to strings in the ELF image
+        string = elf.string(value)
+        return (spec + 's') % (string if string is not None else '<0x%x>' % value)
+
+    return CONVERSION.sub(convert, fmt)
+
+
+def decode(elf, capture, out):
+    """Finds the records in the captured bytes and prints each message."""
+    frame_size = len(SYNC) + elf.addr_size + 4 + (4 * NUM_ARGS)
+    pos = 0
+    while True:
+        pos = capture.find(SYNC, pos)
+        if pos < 0 or pos + frame_size > len(capture):
+            break
+        fields = struct.unpack_from('<' + ('Q' if elf.addr_size == 8 else 'I') + 'I' * (1 + NUM_ARGS),
+                                    capture, pos + len(SYNC))
+        addr, timestamp, args = fields[0], fields[1], fields[2:]
+
+        if addr == 0:
+            # Records were dropped on the target because the ring was full
+            out.write('[%10u] <%u records dropped>\n' % (timestamp, args[0]))
+            pos += frame_size
+            continue
+
+        fmt = elf.string(addr)
+        if fmt is None:
+            # Report a record followed by another (or the end of the
+            # capture) even if its format string can't be found, as the
+            # ELF file may not match the target
+            end = pos + frame_size
+            if end == len(capture) or capture.startswith(SYNC, end):
+                out.write('[%10u] <unknown format 0x%x> %s\n' % (
+                    timestamp, addr, ' '.join('0x%x' % arg for arg in args)))
+                pos = end
+                continue
+
+            # Not a record (sync bytes inside other output), resynchronise
+            pos += 1
+            continue
+
+        out.write('[%10u] %s' % (timestamp, format_record(elf, fmt, args)))
+        if not fmt.endswith('\n'):
+            out.write('\n')
+        pos += frame_size
+
+
+def main(argv):
+    global NUM_ARGS
+
+    if len(argv) >= 3 and argv[1] == '--args':
+        NUM_ARGS = int(argv[2])
+        argv = argv[:1] + argv[3:]
+    if len(argv) not in (2, 3):
+        sys.stderr.write(__doc__.strip() + '\n')
+        return 1
+
+    elf = Elf(argv[1])
+    if len(argv) == 3:
+        with open(argv[2], 'rb') as f:
+            capture = f.read()
+    else:
+        capture = sys.stdin.buffer.read()
+
+    decode(elf, capture, sys.stdout)
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main(sys.argv))